@@ -0,0 +1,163 @@
+// Graphics pipeline lookup with thousands of resident pipelines, by each of
+// the ways `PipelinePool` can be queried. No device needed: handles are fake,
+// and the pipeline "created" for a key is its index. `PipelinePool` itself
+// needs a device, hence the interned cases replay its lookup paths on the
+// same `GraphicsKeyTable`, lock and LRU tick included
+//   avk-bench-graphics-key [residentCount] [lookupCount]
+#include "render/vk/graphics-key-table.h"
+#include "render/vk/pipeline-info.h"
+
+// std
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+using avk::vk::GraphicsInfo;
+using avk::vk::GraphicsKey;
+using avk::vk::GraphicsKeyTable;
+
+// `PipelinePool::GraphicsSlot`
+struct Slot {
+  uint64_t pipeline;
+  uint64_t lastUse;
+};
+
+// state of `PipelinePool` touched by graphics lookups
+struct Pool {
+  std::mutex mtx;
+  GraphicsKeyTable<Slot> keys;
+  GraphicsKey lookupKey;
+  uint64_t useTick = 0;
+
+  // `getOrCreateGraphicsPipeline(GraphicsInfo&)`
+  uint64_t lookup(GraphicsInfo const& info) {
+    std::lock_guard lk{mtx};
+    lookupKey.assign(info);
+    return hit(*keys.find(keys.intern(lookupKey)));
+  }
+  // `getOrCreateGraphicsPipeline(GraphicsInfo const&, GraphicsKeyID&)`
+  uint64_t lookup(GraphicsInfo const& info, GraphicsKeyTable<Slot>::ID& id) {
+    std::lock_guard lk{mtx};
+    Slot* slot = keys.find(id);
+    if (!slot) {
+      lookupKey.assign(info);
+      id = keys.intern(lookupKey);
+      slot = keys.find(id);
+    }
+    return hit(*slot);
+  }
+  uint64_t hit(Slot& slot) {
+    slot.lastUse = ++useTick;
+    return slot.pipeline;
+  }
+};
+
+template <typename T>
+static T fakeHandle(uint64_t value) {
+  return reinterpret_cast<T>(static_cast<uintptr_t>(value));
+}
+
+// what a typical mesh pass looks like, with `index` spread over shader
+// modules, layouts and a specialization constant
+static GraphicsInfo makeGraphicsInfo(uint32_t index) {
+  GraphicsInfo info{};
+  info.vertexIn.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+  info.vertexIn.attributes = {
+      {0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0},
+      {1, 0, VK_FORMAT_R32G32B32_SFLOAT, 12},
+      {2, 0, VK_FORMAT_R32G32_SFLOAT, 24},
+  };
+  info.vertexIn.bindings = {{0, 32, VK_VERTEX_INPUT_RATE_VERTEX}};
+  info.preRasterization.vertexModule =
+      fakeHandle<VkShaderModule>(1 + index % 7);
+  info.fragmentShader.fragmentModule =
+      fakeHandle<VkShaderModule>(100 + index % 61);
+  info.fragmentShader.fragmentSpecialization.set(0, index / 61);
+  info.fragmentShader.viewports.resize(1);
+  info.fragmentShader.scissors.resize(1);
+  info.fragmentOut.colorAttachmentCount = 1;
+  info.fragmentOut.colorAttachmentFormats = {VK_FORMAT_B8G8R8A8_SRGB};
+  info.fragmentOut.depthAttachmentFormat = VK_FORMAT_D32_SFLOAT;
+  info.fragmentOut.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+  info.opts.rasterizationPolygonMode = VK_POLYGON_MODE_FILL;
+  info.pipelineLayout = fakeHandle<VkPipelineLayout>(1000 + index % 13);
+  return info;
+}
+
+template <typename F>
+static void run(char const* name, std::vector<uint32_t> const& sequence,
+                F&& lookup) {
+  uint64_t checksum = 0;
+  auto const start = std::chrono::steady_clock::now();
+  for (uint32_t const index : sequence) {
+    checksum += lookup(index);
+  }
+  auto const end = std::chrono::steady_clock::now();
+  double const ns =
+      std::chrono::duration<double, std::nano>(end - start).count();
+  printf("%-28s %8.1f ns/lookup (checksum %llu)\n", name,
+         ns / static_cast<double>(sequence.size()),
+         static_cast<unsigned long long>(checksum));
+}
+
+int main(int argc, char** argv) {
+  uint32_t const residentCount =
+      argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : 4096;
+  uint32_t const lookupCount =
+      argc > 2 ? static_cast<uint32_t>(strtoul(argv[2], nullptr, 10))
+               : 1u << 20;
+  if (residentCount == 0) {
+    return EXIT_FAILURE;
+  }
+
+  std::vector<GraphicsInfo> infos;
+  infos.reserve(residentCount);
+  std::unordered_map<GraphicsInfo, uint64_t> byInfo;
+  std::unordered_map<GraphicsKey, uint64_t> byKey;
+  std::vector<GraphicsKey> keys;
+  keys.reserve(residentCount);
+  // interning: key -> ID once, then ID -> slot
+  Pool pool;
+  std::vector<GraphicsKeyTable<Slot>::ID> ids;
+  ids.reserve(residentCount);
+  for (uint32_t i = 0; i < residentCount; ++i) {
+    infos.push_back(makeGraphicsInfo(i));
+    keys.emplace_back(infos.back());
+    byInfo.try_emplace(infos.back(), i);
+    byKey.try_emplace(keys.back(), i);
+    GraphicsKeyTable<Slot>::ID const id = pool.keys.intern(keys.back());
+    if (Slot* const slot = pool.keys.find(id); slot->pipeline == 0) {
+      slot->pipeline = i + 1;
+    }
+    ids.push_back(id);
+  }
+  printf("%u resident pipelines (%zu distinct), %u lookups\n", residentCount,
+         pool.keys.size(), lookupCount);
+
+  // same scattered access order for every variant
+  std::vector<uint32_t> sequence(lookupCount);
+  uint32_t state = 0x9E3779B9u;
+  for (uint32_t& index : sequence) {
+    state = state * 1664525u + 1013904223u;
+    index = (state >> 8) % residentCount;
+  }
+
+  run("GraphicsInfo map", sequence,
+      [&](uint32_t i) { return byInfo.find(infos[i])->second; });
+  GraphicsKey scratch;
+  run("GraphicsKey map, serialize", sequence, [&](uint32_t i) {
+    scratch.assign(infos[i]);
+    return byKey.find(scratch)->second;
+  });
+  run("GraphicsKey map, prebuilt", sequence,
+      [&](uint32_t i) { return byKey.find(keys[i])->second; });
+  run("pool, serialize and intern", sequence,
+      [&](uint32_t i) { return pool.lookup(infos[i]); });
+  run("pool, interned ID", sequence,
+      [&](uint32_t i) { return pool.lookup(infos[i], ids[i]); });
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,162 @@
+// Contention of the manager tables under a draw-path like load: mostly gets
+// of resident keys, with creates and discards of per-thread keys mixed in.
+// `ShardedTable` against the single `std::shared_mutex` + `unordered_map` it
+// replaced
+//   avk-bench-sharded-table [opsPerThread] [residentCount]
+#include "utils/sharded-table.h"
+
+// std
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// size of a manager entry (handle, allocation, info)
+struct Entry {
+  uint64_t handle;
+  uint64_t allocation;
+  uint64_t size;
+  uint64_t usage;
+};
+
+class LockedMap {
+ public:
+  bool tryEmplace(uint64_t key, Entry const& entry) {
+    std::unique_lock wlock{m_mtx};
+    return m_map.try_emplace(key, entry).second;
+  }
+  template <typename F>
+  bool read(uint64_t key, F&& f) const {
+    std::shared_lock rlock{m_mtx};
+    auto const it = m_map.find(key);
+    if (it == m_map.end()) {
+      return false;
+    }
+    f(it->second);
+    return true;
+  }
+  template <typename F>
+  bool erase(uint64_t key, F&& f) {
+    std::unique_lock wlock{m_mtx};
+    auto const it = m_map.find(key);
+    if (it == m_map.end()) {
+      return false;
+    }
+    f(it->second);
+    m_map.erase(it);
+    return true;
+  }
+
+ private:
+  mutable std::shared_mutex m_mtx;
+  std::unordered_map<uint64_t, Entry> m_map;
+};
+
+// resident keys are [0, residentCount), thread keys have the thread index in
+// the high bits, such that threads never collide
+static uint64_t threadKey(uint32_t thread, uint64_t serial) {
+  return (uint64_t(thread + 1) << 40) | serial;
+}
+
+template <typename Table>
+static double run(Table& table, uint32_t threadCount, uint32_t opsPerThread,
+                  uint32_t residentCount) {
+  std::atomic<uint32_t> ready{0};
+  std::atomic<bool> go{false};
+  std::atomic<uint64_t> checksum{0};
+  std::vector<std::thread> threads;
+  threads.reserve(threadCount);
+  for (uint32_t t = 0; t < threadCount; ++t) {
+    threads.emplace_back([&, t]() {
+      uint32_t state = 0x9E3779B9u * (t + 1);
+      std::vector<uint64_t> owned;
+      owned.reserve(opsPerThread / 16 + 1);
+      uint64_t serial = 0;
+      uint64_t sum = 0;
+      ready.fetch_add(1);
+      while (!go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      for (uint32_t i = 0; i < opsPerThread; ++i) {
+        state = state * 1664525u + 1013904223u;
+        uint32_t const roll = (state >> 24) % 100;
+        if (roll < 5) {
+          // create
+          uint64_t const key = threadKey(t, serial++);
+          table.tryEmplace(key, Entry{key, key, 256, 0});
+          owned.push_back(key);
+        } else if (roll < 10 && !owned.empty()) {
+          // discard, most recent first as transient resources
+          table.erase(owned.back(),
+                      [&sum](Entry const& entry) { sum += entry.size; });
+          owned.pop_back();
+        } else {
+          // get
+          uint64_t const key = (state >> 4) % residentCount;
+          table.read(key,
+                     [&sum](Entry const& entry) { sum += entry.handle; });
+        }
+      }
+      for (uint64_t const key : owned) {
+        table.erase(key, [](Entry const&) {});
+      }
+      checksum.fetch_add(sum);
+    });
+  }
+  while (ready.load() < threadCount) {
+    std::this_thread::yield();
+  }
+  auto const start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  auto const end = std::chrono::steady_clock::now();
+  double const seconds = std::chrono::duration<double>(end - start).count();
+  // keeps the work observable
+  if (checksum.load() == 1) {
+    printf("!");
+  }
+  return static_cast<double>(threadCount) * opsPerThread / seconds * 1e-6;
+}
+
+template <typename Table>
+static void populate(Table& table, uint32_t residentCount) {
+  for (uint32_t i = 0; i < residentCount; ++i) {
+    table.tryEmplace(i, Entry{i, i, 256, 0});
+  }
+}
+
+int main(int argc, char** argv) {
+  uint32_t const opsPerThread =
+      argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10))
+               : 1u << 20;
+  uint32_t const residentCount =
+      argc > 2 ? static_cast<uint32_t>(strtoul(argv[2], nullptr, 10)) : 16384;
+  if (residentCount == 0) {
+    return EXIT_FAILURE;
+  }
+  printf("%u resident keys, %u ops per thread (90%% get, 5%% create, "
+         "5%% discard), %u hardware threads\n",
+         residentCount, opsPerThread, std::thread::hardware_concurrency());
+  printf("%8s %22s %22s\n", "threads", "shared_mutex+map Mop/s",
+         "ShardedTable Mop/s");
+  for (uint32_t const threadCount : {1u, 8u, 16u, 32u}) {
+    LockedMap locked;
+    populate(locked, residentCount);
+    double const lockedMops =
+        run(locked, threadCount, opsPerThread, residentCount);
+    avk::ShardedTable<Entry> sharded{residentCount};
+    populate(sharded, residentCount);
+    double const shardedMops =
+        run(sharded, threadCount, opsPerThread, residentCount);
+    printf("%8u %22.2f %22.2f\n", threadCount, lockedMops, shardedMops);
+  }
+  return EXIT_SUCCESS;
+}
@@ -124,6 +124,7 @@ void ApplicationBase::RTonRender() AVK_NO_CFI {
   // check for destruction of discarded resources. Monitor ticks every N frame
   // to collect resources which are not used anymore calling the discard pool
   m_vkDiscardPoolMonitor.get()->onFrame();
+  m_vkComputeDiscardPoolMonitor.get()->onFrame();
 
   // acquire a swapchain image (handle resize pt.1)
   VkResult res = m_vkSwapchain.get()->acquireNextImage();
@@ -152,6 +153,8 @@ void ApplicationBase::RTonRender() AVK_NO_CFI {
   // prepare VMA for querying memory budget
   m_vkDevice->refreshMemoryBudgets(m_vkSwapchain.get()->frameIndex());
   [[maybe_unused]] auto const &memoryBudgets = m_vkDevice->heapBudgets();
+  // evicts (through the registered callbacks) before allocations can fail
+  m_budgetGovernor.get()->onFrame();
 #ifdef AVK_DEBUG
   if ((m_timeline % 30000) == 0) {
     uint32_t heapIndex = 0;
@@ -169,6 +172,16 @@ void ApplicationBase::RTonRender() AVK_NO_CFI {
   }
 #endif
 
+  // reset the transient region of this frame, used by the submission which
+  // signals the next timeline value
+  m_frameAllocator.get()->beginFrame(m_vkSwapchain.get()->frameIndex(),
+                                     m_vkDiscardPool.get(), m_timeline + 1);
+  uint64_t const completedValue = m_vkDiscardPool.get()->queryTime();
+  m_bufferSuballocator.get()->releaseCompleted(completedValue);
+  // deliver readbacks copied by completed submissions, never waiting
+  m_readbackService.get()->poll(completedValue);
+  m_uploadScheduler.get()->poll(completedValue);
+
   // call overridden rendering function
   res = RTdoOnRender(swapchainData);
   if (res == VK_ERROR_DEVICE_LOST) {
@@ -178,6 +191,11 @@ void ApplicationBase::RTonRender() AVK_NO_CFI {
   VK_CHECK(res);
   // increment timeline on successful submit
   m_timeline++;
+  m_crossQueueSubmitter.get()->notifySubmitted(
+      experimental::CrossQueueSubmitter::EQueue::eGraphics, m_timeline);
+  // pipelines evicted by the LRU policy (if any) are discarded to the value
+  // signaled by this submission, hence their last uses are safe
+  m_vkPipelines.get()->evictPipelines(m_vkDiscardPool.get(), m_timeline);
 
   // increment frame index after submission (fence is what we care about)
   // NOT presentation (otherwise might deadlock on submission fence)
@@ -210,6 +228,22 @@ void ApplicationBase::RTonRender() AVK_NO_CFI {
   }
 }
 
+uint64_t ApplicationBase::RTrecordScheduledUploads(
+    VkCommandBuffer cmd, experimental::StagingTransientManager &staging,
+    VkPipelineStageFlags &outWaitStages) {
+  experimental::UploadContext *const uploadContext = m_uploadContext.get();
+  outWaitStages = 0;
+  if (!*uploadContext) {
+    m_uploadScheduler.get()->enqueueFrame(staging, m_timeline + 1);
+    return 0;
+  }
+  m_uploadScheduler.get()->enqueueFrame(staging, m_timeline + 1,
+                                        uploadContext);
+  // the transfer submission precedes the graphics one waiting on it
+  uploadContext->submit();
+  return uploadContext->recordAcquireBarriers(cmd, outWaitStages);
+}
+
 void ApplicationBase::onSaveState() { doOnSaveState(); }
 
 void ApplicationBase::onRestoreState() { doOnRestoreState(); }
@@ -219,7 +253,9 @@ void ApplicationBase::RThandleDeviceLost() {
   // Note: We are not discarding resources, because the user is responsible to
   // clean them up
   m_vkCommandPools.get()->threadShutdown();
+  m_vkComputeCommandPools.get()->threadShutdown();
   m_vkDiscardPool.get()->destroyDiscardedResources(true);
+  m_vkComputeDiscardPool.get()->destroyDiscardedResources(true);
   RTdestroyDeviceAndDependencies();
   // crash if physical device is lost
   RTcreateDeviceAndDependencies();
@@ -231,15 +267,27 @@ void ApplicationBase::RThandleDeviceLost() {
 
 void ApplicationBase::RTdestroyDeviceAndDependencies() {
   // resource managers (Note: user is responsible to dump their things)
+  m_defragmentation.destroy();
   m_bufferManager.destroy();
   m_imageManager.destroy();
+  m_frameAllocator.destroy();
+  m_bufferSuballocator.destroy();
+  m_readbackService.destroy();
+  m_uploadScheduler.destroy();
+  m_uploadContext.destroy();
+  m_budgetGovernor.destroy();
 
   // resource handling mechanisms
+  m_vkShaderObjects.destroy();
   m_vkPipelines.destroy();
+  m_crossQueueSubmitter.destroy();
+  m_vkComputeCommandPools.destroy();
   m_vkCommandPools.destroy();
   m_vkDescriptorPools.destroy();
+  m_vkComputeDiscardPoolMonitor.destroy();
   m_vkDiscardPoolMonitor.destroy();
   // last before main 3
+  m_vkComputeDiscardPool.destroy();
   m_vkDiscardPool.destroy();
 
   // main 3 handles
@@ -273,13 +321,47 @@ void ApplicationBase::RTcreateDeviceAndDependencies() {
   m_vkCommandPools.create(vkDevice(),
                           m_vkDevice->universalGraphicsQueueFamilyIndex());
   LOGI << PREFIX "Command Pools Created" << std::endl;
+  m_vkComputeDiscardPool.create(m_vkInstance.get(), vkDevice());
+  m_vkComputeDiscardPoolMonitor.create(m_vkComputeDiscardPool.get());
+  m_vkComputeCommandPools.create(vkDevice(),
+                                 m_vkDevice->computeQueueFamilyIndex());
+  m_crossQueueSubmitter.create(vkDevice(), m_vkDiscardPool.get(),
+                               m_vkComputeDiscardPool.get());
+  LOGI << PREFIX "Compute Discard Pool, Command Pools and Cross Queue "
+                 "Submitter Created"
+       << std::endl;
   m_vkDescriptorPools.create(vkDevice());
   LOGI << PREFIX "Descriptor Pools Created" << std::endl;
   m_vkPipelines.create(vkDevice());
   LOGI << PREFIX "Pipeline Pool Created" << std::endl;
+  if (m_vkDevice->shaderObject()) {
+    m_vkShaderObjects.create(vkDevice());
+    LOGI << PREFIX "Shader Object Pool Created" << std::endl;
+  }
+  m_budgetGovernor.create(vkDevice(), m_vkDiscardPool.get());
+  LOGI << PREFIX "[Experimental] Memory Budget Governor created" << std::endl;
   m_bufferManager.create(vkDevice());
   m_imageManager.create(vkDevice());
+  m_bufferManager.get()->setBudgetGovernor(m_budgetGovernor.get());
+  m_imageManager.get()->setBudgetGovernor(m_budgetGovernor.get());
   LOGI << PREFIX "[Experimental] Buffer/Image Manager created" << std::endl;
+  m_frameAllocator.create(
+      vkDevice(), static_cast<uint32_t>(m_vkSwapchain.get()->frameCount()),
+      FrameAllocatorBytes);
+  LOGI << PREFIX "[Experimental] Frame Linear Allocator created" << std::endl;
+  m_bufferSuballocator.create(vkDevice());
+  LOGI << PREFIX "[Experimental] Buffer Suballocator created" << std::endl;
+  m_readbackService.create(vkDevice());
+  LOGI << PREFIX "[Experimental] Readback Service created" << std::endl;
+  m_uploadScheduler.create();
+  LOGI << PREFIX "[Experimental] Upload Scheduler created" << std::endl;
+  m_uploadContext.create(vkDevice());
+  LOGI << PREFIX "[Experimental] Upload Context created, "
+       << (*m_uploadContext.get() ? "with" : "without")
+       << " transfer queue" << std::endl;
+  m_defragmentation.create(vkDevice(), m_vkDiscardPool.get(),
+                           m_bufferManager.get(), m_imageManager.get());
+  LOGI << PREFIX "[Experimental] Defragmentation Service created" << std::endl;
 #undef PREFIX
 }
 
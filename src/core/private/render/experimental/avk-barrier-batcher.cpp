@@ -0,0 +1,253 @@
+#include "render/experimental/avk-barrier-batcher.h"
+
+// std
+#include <algorithm>
+#include <cassert>
+
+// legacy flags are the low 32 bits of the synchronization2 ones
+static bool fitsLegacy(uint64_t flags) { return (flags >> 32) == 0; }
+// legacy barriers need stages, synchronization2 ones accept none
+static bool fitsLegacyStages(uint64_t stages) {
+  return stages != 0 && fitsLegacy(stages);
+}
+
+template <typename Barrier>
+static bool sameDependency(Barrier const& barrier,
+                           VkPipelineStageFlags2KHR srcStages,
+                           VkAccessFlags2KHR srcAccess,
+                           VkPipelineStageFlags2KHR dstStages,
+                           VkAccessFlags2KHR dstAccess) {
+  return barrier.srcStageMask == srcStages &&
+         barrier.srcAccessMask == srcAccess &&
+         barrier.dstStageMask == dstStages &&
+         barrier.dstAccessMask == dstAccess;
+}
+
+namespace avk::experimental {
+
+BarrierBatcher::BarrierBatcher() {
+  // some good enough capacity
+  m_buffers.reserve(64);
+  m_images.reserve(16);
+}
+
+void BarrierBatcher::bufferBarrier(VkBuffer buffer, VkDeviceSize offset,
+                                   VkDeviceSize size,
+                                   VkPipelineStageFlags2KHR srcStages,
+                                   VkAccessFlags2KHR srcAccess,
+                                   VkPipelineStageFlags2KHR dstStages,
+                                   VkAccessFlags2KHR dstAccess) {
+  // few barriers per scope, hence a linear search
+  for (VkBufferMemoryBarrier2KHR& barrier : m_buffers) {
+    if (barrier.buffer != buffer ||
+        !sameDependency(barrier, srcStages, srcAccess, dstStages, dstAccess)) {
+      continue;
+    }
+    if (barrier.size == VK_WHOLE_SIZE || size == VK_WHOLE_SIZE) {
+      barrier.offset = std::min(barrier.offset, offset);
+      barrier.size = VK_WHOLE_SIZE;
+    } else {
+      // bytes in between are harmless to cover
+      VkDeviceSize const end =
+          std::max(barrier.offset + barrier.size, offset + size);
+      barrier.offset = std::min(barrier.offset, offset);
+      barrier.size = end - barrier.offset;
+    }
+    return;
+  }
+  VkBufferMemoryBarrier2KHR& barrier = m_buffers.emplace_back();
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR;
+  barrier.srcStageMask = srcStages;
+  barrier.srcAccessMask = srcAccess;
+  barrier.dstStageMask = dstStages;
+  barrier.dstAccessMask = dstAccess;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = buffer;
+  barrier.offset = offset;
+  barrier.size = size;
+}
+
+void BarrierBatcher::imageBarrier(VkImage image,
+                                  VkImageSubresourceRange const& range,
+                                  VkImageLayout oldLayout,
+                                  VkImageLayout newLayout,
+                                  VkPipelineStageFlags2KHR srcStages,
+                                  VkAccessFlags2KHR srcAccess,
+                                  VkPipelineStageFlags2KHR dstStages,
+                                  VkAccessFlags2KHR dstAccess) {
+  for (VkImageMemoryBarrier2KHR& barrier : m_images) {
+    VkImageSubresourceRange& merged = barrier.subresourceRange;
+    if (barrier.image != image || barrier.oldLayout != oldLayout ||
+        barrier.newLayout != newLayout ||
+        !sameDependency(barrier, srcStages, srcAccess, dstStages,
+                        dstAccess) ||
+        merged.aspectMask != range.aspectMask ||
+        merged.baseArrayLayer != range.baseArrayLayer ||
+        merged.layerCount != range.layerCount ||
+        merged.levelCount == VK_REMAINING_MIP_LEVELS ||
+        range.levelCount == VK_REMAINING_MIP_LEVELS) {
+      continue;
+    }
+    // a layout transition applies once per subresource, hence only disjoint
+    // adjacent mip ranges are merged
+    if (merged.baseMipLevel + merged.levelCount == range.baseMipLevel) {
+      merged.levelCount += range.levelCount;
+      return;
+    }
+    if (range.baseMipLevel + range.levelCount == merged.baseMipLevel) {
+      merged.baseMipLevel = range.baseMipLevel;
+      merged.levelCount += range.levelCount;
+      return;
+    }
+  }
+  VkImageMemoryBarrier2KHR& barrier = m_images.emplace_back();
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR;
+  barrier.srcStageMask = srcStages;
+  barrier.srcAccessMask = srcAccess;
+  barrier.dstStageMask = dstStages;
+  barrier.dstAccessMask = dstAccess;
+  barrier.oldLayout = oldLayout;
+  barrier.newLayout = newLayout;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange = range;
+}
+
+void BarrierBatcher::memoryBarrier(VkPipelineStageFlags2KHR srcStages,
+                                   VkAccessFlags2KHR srcAccess,
+                                   VkPipelineStageFlags2KHR dstStages,
+                                   VkAccessFlags2KHR dstAccess) {
+  for (VkMemoryBarrier2KHR& barrier : m_memory) {
+    if (barrier.srcStageMask == srcStages &&
+        barrier.dstStageMask == dstStages) {
+      barrier.srcAccessMask |= srcAccess;
+      barrier.dstAccessMask |= dstAccess;
+      return;
+    }
+  }
+  VkMemoryBarrier2KHR& barrier = m_memory.emplace_back();
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2_KHR;
+  barrier.srcStageMask = srcStages;
+  barrier.srcAccessMask = srcAccess;
+  barrier.dstStageMask = dstStages;
+  barrier.dstAccessMask = dstAccess;
+}
+
+void BarrierBatcher::flush(vk::Device* device,
+                           VkCommandBuffer cmd) AVK_NO_CFI {
+  if (empty()) {
+    return;
+  }
+  if (!device->synchronization2()) {
+    flushLegacy(device, cmd);
+    clear();
+    return;
+  }
+  VkDependencyInfoKHR dependencyInfo{};
+  dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR;
+  dependencyInfo.memoryBarrierCount = static_cast<uint32_t>(m_memory.size());
+  dependencyInfo.pMemoryBarriers = m_memory.data();
+  dependencyInfo.bufferMemoryBarrierCount =
+      static_cast<uint32_t>(m_buffers.size());
+  dependencyInfo.pBufferMemoryBarriers = m_buffers.data();
+  dependencyInfo.imageMemoryBarrierCount =
+      static_cast<uint32_t>(m_images.size());
+  dependencyInfo.pImageMemoryBarriers = m_images.data();
+  device->table()->vkCmdPipelineBarrier2KHR(cmd, &dependencyInfo);
+  clear();
+}
+
+void BarrierBatcher::flushLegacy(vk::Device* device,
+                                 VkCommandBuffer cmd) AVK_NO_CFI {
+  auto const* const vkDevApi = device->table();
+  // distinct stage pairs, in order of first use
+  m_stagePairs.clear();
+  auto const addPair = [this](VkPipelineStageFlags2KHR src,
+                              VkPipelineStageFlags2KHR dst) {
+    assert(fitsLegacyStages(src) && fitsLegacyStages(dst));
+    std::pair<VkPipelineStageFlags, VkPipelineStageFlags> const pair{
+        static_cast<VkPipelineStageFlags>(src),
+        static_cast<VkPipelineStageFlags>(dst)};
+    if (std::find(m_stagePairs.begin(), m_stagePairs.end(), pair) ==
+        m_stagePairs.end()) {
+      m_stagePairs.push_back(pair);
+    }
+  };
+  for (VkMemoryBarrier2KHR const& barrier : m_memory) {
+    addPair(barrier.srcStageMask, barrier.dstStageMask);
+  }
+  for (VkBufferMemoryBarrier2KHR const& barrier : m_buffers) {
+    addPair(barrier.srcStageMask, barrier.dstStageMask);
+  }
+  for (VkImageMemoryBarrier2KHR const& barrier : m_images) {
+    addPair(barrier.srcStageMask, barrier.dstStageMask);
+  }
+
+  for (auto const& [srcStages, dstStages] : m_stagePairs) {
+    auto const samePair = [src = srcStages, dst = dstStages](auto const& b) {
+      return b.srcStageMask == src && b.dstStageMask == dst;
+    };
+    m_legacyMemory.clear();
+    m_legacyBuffers.clear();
+    m_legacyImages.clear();
+    for (VkMemoryBarrier2KHR const& barrier : m_memory) {
+      if (!samePair(barrier)) {
+        continue;
+      }
+      assert(fitsLegacy(barrier.srcAccessMask) &&
+             fitsLegacy(barrier.dstAccessMask));
+      VkMemoryBarrier& legacy = m_legacyMemory.emplace_back();
+      legacy.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+      legacy.srcAccessMask = static_cast<VkAccessFlags>(barrier.srcAccessMask);
+      legacy.dstAccessMask = static_cast<VkAccessFlags>(barrier.dstAccessMask);
+    }
+    for (VkBufferMemoryBarrier2KHR const& barrier : m_buffers) {
+      if (!samePair(barrier)) {
+        continue;
+      }
+      assert(fitsLegacy(barrier.srcAccessMask) &&
+             fitsLegacy(barrier.dstAccessMask));
+      VkBufferMemoryBarrier& legacy = m_legacyBuffers.emplace_back();
+      legacy.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+      legacy.srcAccessMask = static_cast<VkAccessFlags>(barrier.srcAccessMask);
+      legacy.dstAccessMask = static_cast<VkAccessFlags>(barrier.dstAccessMask);
+      legacy.srcQueueFamilyIndex = barrier.srcQueueFamilyIndex;
+      legacy.dstQueueFamilyIndex = barrier.dstQueueFamilyIndex;
+      legacy.buffer = barrier.buffer;
+      legacy.offset = barrier.offset;
+      legacy.size = barrier.size;
+    }
+    for (VkImageMemoryBarrier2KHR const& barrier : m_images) {
+      if (!samePair(barrier)) {
+        continue;
+      }
+      assert(fitsLegacy(barrier.srcAccessMask) &&
+             fitsLegacy(barrier.dstAccessMask));
+      VkImageMemoryBarrier& legacy = m_legacyImages.emplace_back();
+      legacy.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+      legacy.srcAccessMask = static_cast<VkAccessFlags>(barrier.srcAccessMask);
+      legacy.dstAccessMask = static_cast<VkAccessFlags>(barrier.dstAccessMask);
+      legacy.oldLayout = barrier.oldLayout;
+      legacy.newLayout = barrier.newLayout;
+      legacy.srcQueueFamilyIndex = barrier.srcQueueFamilyIndex;
+      legacy.dstQueueFamilyIndex = barrier.dstQueueFamilyIndex;
+      legacy.image = barrier.image;
+      legacy.subresourceRange = barrier.subresourceRange;
+    }
+    vkDevApi->vkCmdPipelineBarrier(
+        cmd, srcStages, dstStages, 0,
+        static_cast<uint32_t>(m_legacyMemory.size()), m_legacyMemory.data(),
+        static_cast<uint32_t>(m_legacyBuffers.size()), m_legacyBuffers.data(),
+        static_cast<uint32_t>(m_legacyImages.size()), m_legacyImages.data());
+  }
+}
+
+void BarrierBatcher::clear() {
+  m_memory.clear();
+  m_buffers.clear();
+  m_images.clear();
+}
+
+}  // namespace avk::experimental
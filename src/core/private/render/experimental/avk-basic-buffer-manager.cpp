@@ -1,14 +1,17 @@
 #include "render/experimental/avk-basic-buffer-manager.h"
 
+#include "render/experimental/avk-memory-budget-governor.h"
 #include "render/vk/buffers/buffer-vk.h"
 
 // library
 #include <cassert>
+#include <sstream>
+#include <string>
 
 // TODO:add support for pNext chain and some flags like descriptor buffer
 // https://docs.vulkan.org/refpages/latest/refpages/source/VkBufferCreateInfo.html
 
-// TODO: suppport for periodic memory defragmentation
+// periodic memory defragmentation: see `DefragmentationService`
 // https://gpuopen-librariesandsdks.github.io/VulkanMemoryAllocator/html/defragmentation.html
 
 static VkBufferCreateInfo startCreateInfo(size_t size,
@@ -23,22 +26,39 @@ static VkBufferCreateInfo startCreateInfo(size_t size,
 
 // TODO logging functions for allocation infos, whet you requested
 
+// VMA name of a managed allocation: its id if named, its handle otherwise
+template <typename Handle>
+static std::string allocationName(char const *prefix, uint64_t id,
+                                  Handle handle) {
+  std::ostringstream name;
+  name << prefix << ' ';
+  if (id != 0) {
+    name << "0x" << std::hex << id;
+  } else {
+    name << '#' << handle.index << '.' << handle.generation;
+  }
+  return name.str();
+}
+
 namespace avk::experimental {
 
-BufferManager::BufferManager(vk::Device *device, size_t cap) : m_deps{device} {
-  m_bufferMap.reserve(cap);
-}
+BufferManager::BufferManager(vk::Device *device, size_t cap)
+    : m_deps{device}, m_buffers(cap), m_names(cap) {}
 
 int32_t BufferManager::createBufferGPUOnly(
     uint64_t id, size_t bytes, VkBufferCreateFlags usage,
     [[maybe_unused]] bool forceWithinBudget,
-    [[maybe_unused]] bool forceNoAllocation) AVK_NO_CFI {
+    [[maybe_unused]] bool forceNoAllocation,
+    BufferHandle *outHandle) AVK_NO_CFI {
   assert(m_deps.device && m_deps.device->device());
-  VmaAllocator const allocator = m_deps.device->vmaAllocator();
+  [[maybe_unused]] VmaAllocator const allocator =
+      m_deps.device->vmaAllocator();
   bool const isSoC = m_deps.device->isSoC();
   // GPU only buffer is probably filled in by someone if not mapped (not SoC)
-  VkBufferCreateInfo createInfo =
-      startCreateInfo(bytes, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+  // transfer src to be the source of a defragmentation move
+  VkBufferCreateInfo createInfo = startCreateInfo(
+      bytes, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
   VmaAllocationCreateInfo allocInfo{};
   allocInfo.usage =
       isSoC ? VMA_MEMORY_USAGE_AUTO : VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
@@ -56,10 +76,11 @@ int32_t BufferManager::createBufferGPUOnly(
 
   VkBuffer buffer = VK_NULL_HANDLE;
   VmaAllocation alloc = VK_NULL_HANDLE;
-  VkResult const res = vmaCreateBuffer(allocator, &createInfo, &allocInfo,
-                                       &buffer, &alloc, nullptr);
-  if (res < 0) {
-    return VulkanError;
+  if (int32_t const res =
+          allocateBuffer(vk::EMemoryClass::eStaticGeometry, true, createInfo,
+                         allocInfo, buffer, alloc);
+      res != Success) {
+    return res;
   }
 
 #ifdef AVK_DEBUG
@@ -72,24 +93,15 @@ int32_t BufferManager::createBufferGPUOnly(
   }
 #endif
 
-  bool wasInserted = false;
-  {
-    std::unique_lock wlock{m_mtx};
-    wasInserted = m_bufferMap.try_emplace(id, buffer, alloc).second;
-  }
-  if (!wasInserted) {
-    vmaDestroyBuffer(allocator, buffer, alloc);
-    return Collision;
-  }
-  return Success;
+  return registerBuffer(id, buffer, alloc, createInfo, outHandle);
 }
 
 int32_t BufferManager::createBufferStaging(uint64_t id, size_t bytes,
                                            bool forceWithinBudget,
-                                           bool forceNoAllocation) AVK_NO_CFI {
+                                           bool forceNoAllocation,
+                                           BufferHandle *outHandle) AVK_NO_CFI {
   assert(m_deps.device && m_deps.device->device());
   assert(!m_deps.device->isSoC() && "Integrated graphics/SoC -> no staging");
-  VmaAllocator const allocator = m_deps.device->vmaAllocator();
 
   VkBufferCreateInfo createInfo =
       startCreateInfo(bytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
@@ -111,29 +123,20 @@ int32_t BufferManager::createBufferStaging(uint64_t id, size_t bytes,
   VkBuffer buffer = VK_NULL_HANDLE;
   VmaAllocation alloc = VK_NULL_HANDLE;
 
-  VkResult const res = vmaCreateBuffer(allocator, &createInfo, &allocInfo,
-                                       &buffer, &alloc, nullptr);
-  if (res < 0) {
-    return VulkanError;
-  }
-  bool wasInserted = false;
-  {
-    std::unique_lock wlock{m_mtx};
-    wasInserted = m_bufferMap.try_emplace(id, buffer, alloc).second;
-  }
-  if (!wasInserted) {
-    vmaDestroyBuffer(allocator, buffer, alloc);
-    return Collision;
+  if (int32_t const res =
+          allocateBuffer(vk::EMemoryClass::eStaging, false, createInfo,
+                         allocInfo, buffer, alloc);
+      res != Success) {
+    return res;
   }
-  return Success;
+  return registerBuffer(id, buffer, alloc, createInfo, outHandle);
 }
 
-int32_t BufferManager::createBufferReadback(uint64_t id, size_t bytes,
-                                            bool forceWithinBudget,
-                                            bool forceNoAllocation) AVK_NO_CFI {
+int32_t BufferManager::createBufferReadback(
+    uint64_t id, size_t bytes, bool forceWithinBudget, bool forceNoAllocation,
+    BufferHandle *outHandle) AVK_NO_CFI {
   assert(m_deps.device && m_deps.device->device());
   assert(!m_deps.device->isSoC() && "Integrated graphics/SoC -> no staging");
-  VmaAllocator const allocator = m_deps.device->vmaAllocator();
 
   VkBufferCreateInfo createInfo =
       startCreateInfo(bytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT);
@@ -155,26 +158,18 @@ int32_t BufferManager::createBufferReadback(uint64_t id, size_t bytes,
   VkBuffer buffer = VK_NULL_HANDLE;
   VmaAllocation alloc = VK_NULL_HANDLE;
 
-  VkResult const res = vmaCreateBuffer(allocator, &createInfo, &allocInfo,
-                                       &buffer, &alloc, nullptr);
-  if (res < 0) {
-    return VulkanError;
-  }
-  bool wasInserted = false;
-  {
-    std::unique_lock wlock{m_mtx};
-    wasInserted = m_bufferMap.try_emplace(id, buffer, alloc).second;
-  }
-  if (!wasInserted) {
-    vmaDestroyBuffer(allocator, buffer, alloc);
-    return Collision;
+  if (int32_t const res =
+          allocateBuffer(vk::EMemoryClass::eStaging, false, createInfo,
+                         allocInfo, buffer, alloc);
+      res != Success) {
+    return res;
   }
-  return Success;
+  return registerBuffer(id, buffer, alloc, createInfo, outHandle);
 }
 
 int32_t BufferManager::createBufferStreaming(
     uint64_t id, size_t bytes, VkBufferUsageFlags usage, bool forceWithinBudget,
-    bool forceNoAllocation) AVK_NO_CFI {
+    bool forceNoAllocation, BufferHandle *outHandle) AVK_NO_CFI {
   assert(m_deps.device && m_deps.device->device());
   VmaAllocator const allocator = m_deps.device->vmaAllocator();
 
@@ -195,19 +190,16 @@ int32_t BufferManager::createBufferStreaming(
 
   VkBuffer buffer = VK_NULL_HANDLE;
   VmaAllocation alloc = VK_NULL_HANDLE;
-  VkResult const res = vmaCreateBuffer(allocator, &createInfo, &allocInfo,
-                                       &buffer, &alloc, nullptr);
-  if (res < 0) {
-    return VulkanError;
+  if (int32_t const res =
+          allocateBuffer(vk::EMemoryClass::eStreaming, true, createInfo,
+                         allocInfo, buffer, alloc);
+      res != Success) {
+    return res;
   }
-  bool wasInserted = false;
-  {
-    std::unique_lock wlock{m_mtx};
-    wasInserted = m_bufferMap.try_emplace(id, buffer, alloc).second;
-  }
-  if (!wasInserted) {
-    vmaDestroyBuffer(allocator, buffer, alloc);
-    return Collision;
+  if (int32_t const reg =
+          registerBuffer(id, buffer, alloc, createInfo, outHandle);
+      reg != Success) {
+    return reg;
   }
   // now check whether we got memory mapped I/O or
   // transfer operation (`vmaCopyMemoryToAllocation`) + `VkBufferMemoryBarrier`
@@ -221,46 +213,161 @@ int32_t BufferManager::createBufferStreaming(
   }
 }
 
+BufferHandle BufferManager::find(uint64_t id) const {
+  BufferHandle handle{};
+  m_names.read(id, [&](BufferHandle const &named) { handle = named; });
+  return handle;
+}
+
+bool BufferManager::get(BufferHandle handle, VkBuffer &outBuffer,
+                        VmaAllocation &outAlloc) const {
+  return m_buffers.read(handle, [&](ManagedBuffer const &buffer) {
+    outBuffer = buffer.handle;
+    outAlloc = buffer.alloc;
+  });
+}
+
 bool BufferManager::get(uint64_t id, VkBuffer &outBuffer,
-                        VmaAllocation &outAlloc) {
-  std::shared_lock rlock{m_mtx};
-  auto it = m_bufferMap.find(id);
-  if (it == m_bufferMap.end()) {
-    return false;
+                        VmaAllocation &outAlloc) const {
+  return get(find(id), outBuffer, outAlloc);
+}
+
+bool BufferManager::discard(vk::DiscardPool *discardPool, BufferHandle handle,
+                            uint64_t timeline) {
+  uint64_t name = NoName;
+  bool const found = m_buffers.erase(handle, [&](ManagedBuffer &buffer) {
+    name = buffer.name;
+    discardOrDefer(discardPool, buffer, timeline);
+  });
+  // the name may already belong to a newer buffer
+  if (found && name != NoName) {
+    m_names.eraseIf(name,
+                    [&](BufferHandle const &named) { return named == handle; });
   }
-  outBuffer = it->second.handle;
-  outAlloc = it->second.alloc;
-  return true;
+  return found;
 }
 
 bool BufferManager::discardById(vk::DiscardPool *discardPool, uint64_t id,
                                 uint64_t timeline) {
-  {
-    std::shared_lock rlock{m_mtx};
-    auto it = m_bufferMap.find(id);
-    if (it == m_bufferMap.end()) {
-      showErrorScreenAndExit("Tried to discard a nonexisting buffer");
-      return false;
-    }
-  }
-  std::unique_lock wlock{m_mtx};
-  auto it = m_bufferMap.find(id);
-  if (it == m_bufferMap.end()) {
+  if (!discard(discardPool, find(id), timeline)) {
     showErrorScreenAndExit("Tried to discard a nonexisting buffer");
     return false;
   }
-  discardPool->discardBuffer(it->second.handle, it->second.alloc, timeline);
-  m_bufferMap.erase(it);
   return true;
 }
 
 void BufferManager::discardEverything(vk::DiscardPool *discard,
                                       uint64_t timeline) {
-  std::unique_lock wlock{m_mtx};
-  for (auto const &[id, pair] : m_bufferMap) {
-    discard->discardBuffer(pair.handle, pair.alloc, timeline);
+  m_buffers.drain([&](BufferHandle /*handle*/, ManagedBuffer &buffer) {
+    discardOrDefer(discard, buffer, timeline);
+  });
+  m_names.clear();
+}
+
+bool BufferManager::setMovable(BufferHandle handle, bool movable) {
+  VkBufferUsageFlags const transfer =
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  bool set = false;
+  m_buffers.modify(handle, [&](ManagedBuffer &buffer) {
+    if (!movable || (buffer.usage & transfer) == transfer) {
+      buffer.movable = movable;
+      set = true;
+    }
+  });
+  return set;
+}
+
+bool BufferManager::setMovable(uint64_t id, bool movable) {
+  return setMovable(find(id), movable);
+}
+
+int32_t BufferManager::allocateBuffer(vk::EMemoryClass memoryClass,
+                                      bool admitted,
+                                      VkBufferCreateInfo const &createInfo,
+                                      VmaAllocationCreateInfo const &allocInfo,
+                                      VkBuffer &outBuffer,
+                                      VmaAllocation &outAlloc) AVK_NO_CFI {
+  if (admitted && m_governor &&
+      !m_governor->admit(memoryClass, createInfo.size)) {
+    return OverBudget;
+  }
+  // memory class isolation, falling back to VMA default pools
+  VkResult res = m_deps.device->createPooledBuffer(
+      memoryClass, createInfo, allocInfo, outBuffer, outAlloc);
+  if (res == VK_ERROR_OUT_OF_DEVICE_MEMORY && m_governor &&
+      m_governor->reclaim(memoryClass, createInfo.size)) {
+    res = m_deps.device->createPooledBuffer(memoryClass, createInfo,
+                                            allocInfo, outBuffer, outAlloc);
+  }
+  return res < 0 ? VulkanError : Success;
+}
+
+int32_t BufferManager::registerBuffer(uint64_t id, VkBuffer buffer,
+                                      VmaAllocation alloc,
+                                      VkBufferCreateInfo const &createInfo,
+                                      BufferHandle *outHandle) AVK_NO_CFI {
+  BufferHandle const handle = m_buffers.insert(buffer, alloc, createInfo, id);
+  if (id != NoName && !m_names.tryEmplace(id, handle)) {
+    m_buffers.erase(handle, [](ManagedBuffer & /*buffer*/) {});
+    vmaDestroyBuffer(m_deps.device->vmaAllocator(), buffer, alloc);
+    return Collision;
+  }
+  m_deps.device->tagAllocation(alloc, vk::EAllocationTag::eBufferManager,
+                               allocationName("buffer", id, handle));
+  if (outHandle) {
+    *outHandle = handle;
+  }
+  return Success;
+}
+
+void BufferManager::discardOrDefer(vk::DiscardPool *discardPool,
+                                   ManagedBuffer const &buffer,
+                                   uint64_t timeline) {
+  if (buffer.pinned) {
+    std::lock_guard lk{m_pinnedMtx};
+    m_pinnedDiscards.appendTimeline(timeline, buffer);
+  } else {
+    discardPool->discardBuffer(buffer.handle, buffer.alloc, timeline);
+  }
+}
+
+void BufferManager::collectMoveCandidates(
+    std::unordered_map<VmaAllocation, MoveCandidate> &outCandidates) const {
+  outCandidates.clear();
+  m_buffers.forEach([&](BufferHandle handle, ManagedBuffer const &buffer) {
+    if (buffer.movable && !buffer.pinned) {
+      MoveCandidate const candidate{handle, buffer.name, buffer.size,
+                                    buffer.usage};
+      outCandidates.try_emplace(buffer.alloc, candidate);
+    }
+  });
+}
+
+bool BufferManager::rebindForMove(BufferHandle handle, VmaAllocation alloc,
+                                  VkBuffer newBuffer, VkBuffer &outOldBuffer) {
+  bool rebound = false;
+  m_buffers.modify(handle, [&](ManagedBuffer &buffer) {
+    // recreated since the candidates were collected
+    if (buffer.alloc != alloc || !buffer.movable) {
+      return;
+    }
+    outOldBuffer = buffer.handle;
+    buffer.handle = newBuffer;
+    buffer.pinned = true;
+    rebound = true;
+  });
+  return rebound;
+}
+
+void BufferManager::unpinAll(vk::DiscardPool *discardPool) {
+  m_buffers.forEachMutable([](BufferHandle /*handle*/, ManagedBuffer &buffer) {
+    buffer.pinned = false;
+  });
+  std::lock_guard lk{m_pinnedMtx};
+  for (auto const &[timeline, buffer] : m_pinnedDiscards) {
+    discardPool->discardBuffer(buffer.handle, buffer.alloc, timeline);
   }
-  m_bufferMap.clear();
+  m_pinnedDiscards.clear();
 }
 
 }  // namespace avk::experimental
\ No newline at end of file
@@ -1,7 +1,11 @@
 #include "render/experimental/avk-basic-image-manager.h"
 
+#include "render/experimental/avk-memory-budget-governor.h"
+
 // library
 #include <cassert>
+#include <sstream>
+#include <string>
 
 static VkImageCreateInfo startCreateInfo(VkExtent2D extent, VkFormat format,
                                          VkImageUsageFlags usage,
@@ -21,20 +25,40 @@ static VkImageCreateInfo startCreateInfo(VkExtent2D extent, VkFormat format,
   return createInfo;
 }
 
+// admission estimate, before VMA knows the real memory requirements. Assumes
+// 4 bytes per texel, which is conservative for compressed formats
+static VkDeviceSize estimateBytes(VkImageCreateInfo const& createInfo) {
+  return VkDeviceSize(createInfo.extent.width) * createInfo.extent.height *
+         createInfo.extent.depth * createInfo.arrayLayers * createInfo.samples *
+         4;
+}
+
+// VMA name of a managed allocation: its id if named, its handle otherwise
+template <typename Handle>
+static std::string allocationName(char const* prefix, uint64_t id,
+                                  Handle handle) {
+  std::ostringstream name;
+  name << prefix << ' ';
+  if (id != 0) {
+    name << "0x" << std::hex << id;
+  } else {
+    name << '#' << handle.index << '.' << handle.generation;
+  }
+  return name.str();
+}
+
 namespace avk::experimental {
 
-ImageManager::ImageManager(vk::Device* device, size_t cap) : m_deps{device} {
+ImageManager::ImageManager(vk::Device* device, size_t cap)
+    : m_deps{device}, m_images(cap), m_names(cap) {
   assert(device);
-  m_imageMap.reserve(cap);
 }
 
 // Note: add VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT and
 // VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT as preferredFlags
 int32_t ImageManager::createTransientAttachment(
     uint64_t id, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage,
-    VkSampleCountFlagBits samples) AVK_NO_CFI {
-  VmaAllocator allocator = m_deps.device->vmaAllocator();
-
+    VkSampleCountFlagBits samples, ImageHandle* outHandle) AVK_NO_CFI {
   VkImageCreateInfo const createInfo = startCreateInfo(
       extent, format, usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, samples);
   VmaAllocationCreateInfo allocInfo{};
@@ -59,31 +83,24 @@ int32_t ImageManager::createTransientAttachment(
   VkImage image = VK_NULL_HANDLE;
   VmaAllocation alloc = VK_NULL_HANDLE;
 
-  VkResult res = vmaCreateImage(allocator, &createInfo, &allocInfo, &image,
-                                &alloc, nullptr);
+  // memory class isolation, falling back to VMA default pools. Attachments
+  // share the blocks of their pool instead of dedicated memory
+  VkResult res = m_deps.device->createPooledImage(
+      vk::EMemoryClass::eRenderTargets, createInfo, allocInfo, image, alloc);
 
   if (res == VK_ERROR_OUT_OF_DEVICE_MEMORY && m_deps.device->isSoC()) {
     allocInfo.flags &= ~VMA_ALLOCATION_CREATE_NEVER_ALLOCATE_BIT;
     LOGW << AVK_LOG_YLW
         "Failed never allocate lazy allocation. retry without it" AVK_LOG_RST
          << std::endl;
-    res = vmaCreateImage(allocator, &createInfo, &allocInfo, &image, &alloc,
-                         nullptr);
+    res = m_deps.device->createPooledImage(vk::EMemoryClass::eRenderTargets,
+                                           createInfo, allocInfo, image, alloc);
   }
 
   if (res < 0) {
     return VulkanError;
   }
-  bool wasInserted = false;
-  {
-    std::unique_lock wlock{m_mtx};
-    wasInserted = m_imageMap.try_emplace(id, image, alloc).second;
-  }
-  if (!wasInserted) {
-    vmaDestroyImage(allocator, image, alloc);
-    return Collision;
-  }
-  return Success;
+  return registerImage(id, image, alloc, createInfo, outHandle);
 }
 
 // sampled texture -> VK_IMAGE_USAGE_SAMPLED_BIT
@@ -93,7 +110,8 @@ int32_t ImageManager::createTexture(uint64_t id, VkExtent2D extent,
                                     VkSampleCountFlagBits samples,
                                     bool streamingNeeded,
                                     bool forceWithinBudget,
-                                    bool forceNoAllocation) AVK_NO_CFI {
+                                    bool forceNoAllocation,
+                                    ImageHandle* outHandle) AVK_NO_CFI {
   VmaAllocator allocator = m_deps.device->vmaAllocator();
 
   VkImageCreateInfo const createInfo =
@@ -114,12 +132,25 @@ int32_t ImageManager::createTexture(uint64_t id, VkExtent2D extent,
   if (forceNoAllocation) {
     allocInfo.flags |= VMA_ALLOCATION_CREATE_NEVER_ALLOCATE_BIT;
   }
+  vk::EMemoryClass const memoryClass = streamingNeeded
+                                           ? vk::EMemoryClass::eStreaming
+                                           : vk::EMemoryClass::eTextures;
+  VkDeviceSize const bytes = estimateBytes(createInfo);
+  if (m_governor && !m_governor->admit(memoryClass, bytes)) {
+    return OverBudget;
+  }
 
   VkImage image = VK_NULL_HANDLE;
   VmaAllocation alloc = VK_NULL_HANDLE;
 
-  VkResult const res = vmaCreateImage(allocator, &createInfo, &allocInfo,
-                                      &image, &alloc, nullptr);
+  // memory class isolation, falling back to VMA default pools
+  VkResult res = m_deps.device->createPooledImage(memoryClass, createInfo,
+                                                  allocInfo, image, alloc);
+  if (res == VK_ERROR_OUT_OF_DEVICE_MEMORY && m_governor &&
+      m_governor->reclaim(memoryClass, bytes)) {
+    res = m_deps.device->createPooledImage(memoryClass, createInfo, allocInfo,
+                                           image, alloc);
+  }
   if (res < 0) {
     return VulkanError;
   }
@@ -132,56 +163,141 @@ int32_t ImageManager::createTexture(uint64_t id, VkExtent2D extent,
         "SoC GPUs should have Mappable memory on streaming allocation request");
   }
 #endif
-  bool wasInserted = false;
-  {
-    std::unique_lock wlock{m_mtx};
-    wasInserted = m_imageMap.try_emplace(id, image, alloc).second;
-  }
-  if (!wasInserted) {
-    vmaDestroyImage(allocator, image, alloc);
-    return Collision;
-  }
-  return Success;
+  return registerImage(id, image, alloc, createInfo, outHandle);
+}
+
+ImageHandle ImageManager::find(uint64_t id) const {
+  ImageHandle handle{};
+  m_names.read(id, [&](ImageHandle const& named) { handle = named; });
+  return handle;
+}
+
+bool ImageManager::get(ImageHandle handle, VkImage& outImage,
+                       VmaAllocation& outAlloc) const {
+  return m_images.read(handle, [&](ManagedImage const& image) {
+    outImage = image.handle;
+    outAlloc = image.alloc;
+  });
 }
 
 bool ImageManager::get(uint64_t id, VkImage& outImage,
-                       VmaAllocation& outAlloc) {
-  std::shared_lock rlock{m_mtx};
-  auto it = m_imageMap.find(id);
-  if (it == m_imageMap.end()) {
-    return false;
+                       VmaAllocation& outAlloc) const {
+  return get(find(id), outImage, outAlloc);
+}
+
+bool ImageManager::discard(vk::DiscardPool* discardPool, ImageHandle handle,
+                           uint64_t timeline) {
+  uint64_t name = NoName;
+  bool const found = m_images.erase(handle, [&](ManagedImage& image) {
+    name = image.name;
+    discardOrDefer(discardPool, image, timeline);
+  });
+  // the name may already belong to a newer image
+  if (found && name != NoName) {
+    m_names.eraseIf(name,
+                    [&](ImageHandle const& named) { return named == handle; });
   }
-  outImage = it->second.handle;
-  outAlloc = it->second.alloc;
-  return true;
+  return found;
 }
 
 bool ImageManager::discardById(vk::DiscardPool* discardPool, uint64_t id,
                                uint64_t timeline) {
-  {
-    std::shared_lock rlock{m_mtx};
-    auto it = m_imageMap.find(id);
-    if (it == m_imageMap.end()) {
-      return false;
+  return discard(discardPool, find(id), timeline);
+}
+
+void ImageManager::discardEverything(vk::DiscardPool* discardPool,
+                                     uint64_t timeline) {
+  m_images.drain([&](ImageHandle /*handle*/, ManagedImage& image) {
+    discardOrDefer(discardPool, image, timeline);
+  });
+  m_names.clear();
+}
+
+bool ImageManager::setMovable(ImageHandle handle, VkImageLayout layout) {
+  VkImageUsageFlags const transfer =
+      VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  bool set = false;
+  m_images.modify(handle, [&](ManagedImage& image) {
+    if (layout == VK_IMAGE_LAYOUT_UNDEFINED ||
+        (image.createInfo.usage & transfer) == transfer) {
+      image.movableLayout = layout;
+      set = true;
     }
+  });
+  return set;
+}
+
+bool ImageManager::setMovable(uint64_t id, VkImageLayout layout) {
+  return setMovable(find(id), layout);
+}
+
+int32_t ImageManager::registerImage(uint64_t id, VkImage image,
+                                    VmaAllocation alloc,
+                                    VkImageCreateInfo const& createInfo,
+                                    ImageHandle* outHandle) AVK_NO_CFI {
+  ImageHandle const handle = m_images.insert(image, alloc, createInfo, id);
+  if (id != NoName && !m_names.tryEmplace(id, handle)) {
+    m_images.erase(handle, [](ManagedImage& /*image*/) {});
+    vmaDestroyImage(m_deps.device->vmaAllocator(), image, alloc);
+    return Collision;
+  }
+  m_deps.device->tagAllocation(alloc, vk::EAllocationTag::eImageManager,
+                               allocationName("image", id, handle));
+  if (outHandle) {
+    *outHandle = handle;
   }
-  std::unique_lock wlock{m_mtx};
-  auto it = m_imageMap.find(id);
-  if (it == m_imageMap.end()) {
-    return false;
+  return Success;
+}
+
+void ImageManager::discardOrDefer(vk::DiscardPool* discardPool,
+                                  ManagedImage const& image,
+                                  uint64_t timeline) {
+  if (image.pinned) {
+    std::lock_guard lk{m_pinnedMtx};
+    m_pinnedDiscards.appendTimeline(timeline, image);
+  } else {
+    discardPool->discardImage(image.handle, image.alloc, timeline);
   }
-  discardPool->discardImage(it->second.handle, it->second.alloc, timeline);
-  m_imageMap.erase(it);
-  return true;
 }
 
-void ImageManager::discardEverything(vk::DiscardPool* discardPool,
-                                     uint64_t timeline) {
-  std::unique_lock wlock{m_mtx};
-  for (auto const& [id, pair] : m_imageMap) {
-    discardPool->discardImage(pair.handle, pair.alloc, timeline);
+void ImageManager::collectMoveCandidates(
+    std::unordered_map<VmaAllocation, MoveCandidate>& outCandidates) const {
+  outCandidates.clear();
+  m_images.forEach([&](ImageHandle handle, ManagedImage const& image) {
+    if (image.movableLayout != VK_IMAGE_LAYOUT_UNDEFINED && !image.pinned) {
+      MoveCandidate const candidate{handle, image.name, image.createInfo,
+                                    image.movableLayout};
+      outCandidates.try_emplace(image.alloc, candidate);
+    }
+  });
+}
+
+bool ImageManager::rebindForMove(ImageHandle handle, VmaAllocation alloc,
+                                 VkImage newImage, VkImage& outOldImage) {
+  bool rebound = false;
+  m_images.modify(handle, [&](ManagedImage& image) {
+    // recreated since the candidates were collected
+    if (image.alloc != alloc ||
+        image.movableLayout == VK_IMAGE_LAYOUT_UNDEFINED) {
+      return;
+    }
+    outOldImage = image.handle;
+    image.handle = newImage;
+    image.pinned = true;
+    rebound = true;
+  });
+  return rebound;
+}
+
+void ImageManager::unpinAll(vk::DiscardPool* discardPool) {
+  m_images.forEachMutable([](ImageHandle /*handle*/, ManagedImage& image) {
+    image.pinned = false;
+  });
+  std::lock_guard lk{m_pinnedMtx};
+  for (auto const& [timeline, image] : m_pinnedDiscards) {
+    discardPool->discardImage(image.handle, image.alloc, timeline);
   }
-  m_imageMap.clear();
+  m_pinnedDiscards.clear();
 }
 
 }  // namespace avk::experimental
\ No newline at end of file
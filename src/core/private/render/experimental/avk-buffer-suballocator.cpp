@@ -0,0 +1,162 @@
+#include "render/experimental/avk-buffer-suballocator.h"
+
+#include "utils/bits.h"
+
+// library
+#include <algorithm>
+#include <cassert>
+#include <string>
+
+#define PREFIX "[BufferSuballocator] "
+
+namespace avk::experimental {
+
+BufferSuballocator::BufferSuballocator(vk::Device* device,
+                                       VkDeviceSize blockBytes,
+                                       VkBufferUsageFlags usage)
+    : m_deps{device}, m_blockBytes(blockBytes), m_usage(usage) {
+  assert(m_deps.device && m_deps.device->device());
+  VkPhysicalDeviceLimits const& limits = m_deps.device->limits();
+  m_minAlignment = 16;
+  if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
+    m_minAlignment =
+        std::max(m_minAlignment, limits.minUniformBufferOffsetAlignment);
+  }
+  if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) {
+    m_minAlignment =
+        std::max(m_minAlignment, limits.minStorageBufferOffsetAlignment);
+  }
+}
+
+BufferSuballocator::~BufferSuballocator() noexcept AVK_NO_CFI {
+  VmaAllocator const allocator = m_deps.device->vmaAllocator();
+  for (auto const& [timeline, range] : m_pendingFrees) {
+    vmaVirtualFree(m_blocks[range.block].virtualBlock, range.alloc);
+  }
+  m_pendingFrees.clear();
+  for (Block& block : m_blocks) {
+    // ranges never freed are leaks of the user, don't let VMA assert on them
+    vmaClearVirtualBlock(block.virtualBlock);
+    vmaDestroyVirtualBlock(block.virtualBlock);
+    m_deps.device->untagAllocation(block.alloc);
+    vmaDestroyBuffer(allocator, block.buffer, block.alloc);
+  }
+  m_blocks.clear();
+}
+
+BufferSuballocator::Range BufferSuballocator::allocate(
+    VkDeviceSize bytes, VkDeviceSize alignment) {
+  assert((alignment & (alignment - 1)) == 0 && "alignment must be POT");
+  // VMA virtual blocks don't accept empty allocations
+  if (bytes == 0) {
+    return {};
+  }
+  VkDeviceSize const align = std::max(alignment, m_minAlignment);
+  Range range{};
+  std::lock_guard lk{m_mtx};
+  for (uint32_t i = 0; i < m_blocks.size(); ++i) {
+    if (allocateFromBlock(i, bytes, align, range)) {
+      return range;
+    }
+  }
+  if (!createBlock(std::max(m_blockBytes, nextMultipleOf(bytes, align)))) {
+    return {};
+  }
+  allocateFromBlock(static_cast<uint32_t>(m_blocks.size() - 1), bytes, align,
+                    range);
+  return range;
+}
+
+void BufferSuballocator::free(Range const& range, uint64_t timeline) {
+  assert(range);
+  std::lock_guard lk{m_mtx};
+  m_pendingFrees.appendTimeline(timeline, range);
+}
+
+void BufferSuballocator::releaseCompleted(uint64_t completedValue) {
+  std::lock_guard lk{m_mtx};
+  m_pendingFrees.removeOld(completedValue, [this](Range const& range) {
+    vmaVirtualFree(m_blocks[range.block].virtualBlock, range.alloc);
+  });
+}
+
+VkDeviceSize BufferSuballocator::usedBytes() const {
+  std::lock_guard lk{m_mtx};
+  VkDeviceSize used = 0;
+  for (Block const& block : m_blocks) {
+    VmaStatistics stats{};
+    vmaGetVirtualBlockStatistics(block.virtualBlock, &stats);
+    used += stats.allocationBytes;
+  }
+  return used;
+}
+
+bool BufferSuballocator::createBlock(VkDeviceSize bytes) AVK_NO_CFI {
+  bool const isSoC = m_deps.device->isSoC();
+
+  VkBufferCreateInfo createInfo{};
+  createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  createInfo.usage = m_usage;
+  createInfo.size = bytes;
+  createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  // same placement of `BufferManager::createBufferGPUOnly`
+  VmaAllocationCreateInfo allocInfo{};
+  allocInfo.usage =
+      isSoC ? VMA_MEMORY_USAGE_AUTO : VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+  allocInfo.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  if (isSoC) {
+    allocInfo.flags |= VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                       VMA_ALLOCATION_CREATE_MAPPED_BIT;
+  }
+  allocInfo.priority = 1.f;
+  Block block{};
+  VmaAllocationInfo info{};
+  if (VkResult const res = m_deps.device->createPooledBuffer(
+          vk::EMemoryClass::eStaticGeometry, createInfo, allocInfo,
+          block.buffer, block.alloc, &info);
+      res != VK_SUCCESS) {
+    LOGW << PREFIX "Couldn't allocate a block of " << bytes << " B: " << res
+         << std::endl;
+    return false;
+  }
+  block.mapped = reinterpret_cast<uint8_t*>(info.pMappedData);
+
+  VmaVirtualBlockCreateInfo virtualInfo{};
+  virtualInfo.size = bytes;
+  VK_CHECK(vmaCreateVirtualBlock(&virtualInfo, &block.virtualBlock));
+  m_blocks.push_back(block);
+  m_deps.device->tagAllocation(
+      block.alloc, vk::EAllocationTag::eSuballocator,
+      "suballocator block " + std::to_string(m_blocks.size() - 1));
+  LOGI << PREFIX "Block " << m_blocks.size() - 1 << " of " << bytes << " B"
+       << std::endl;
+  return true;
+}
+
+bool BufferSuballocator::allocateFromBlock(uint32_t blockIndex,
+                                           VkDeviceSize bytes,
+                                           VkDeviceSize alignment,
+                                           Range& outRange) {
+  Block const& block = m_blocks[blockIndex];
+  VmaVirtualAllocationCreateInfo allocInfo{};
+  allocInfo.size = bytes;
+  allocInfo.alignment = alignment;
+  VmaVirtualAllocation alloc = VK_NULL_HANDLE;
+  VkDeviceSize offset = 0;
+  if (vmaVirtualAllocate(block.virtualBlock, &allocInfo, &alloc, &offset) !=
+      VK_SUCCESS) {
+    return false;
+  }
+  outRange.buffer = block.buffer;
+  outRange.offset = offset;
+  outRange.size = bytes;
+  outRange.mapped = block.mapped ? block.mapped + offset : nullptr;
+  outRange.block = blockIndex;
+  outRange.alloc = alloc;
+  return true;
+}
+
+}  // namespace avk::experimental
+
+#undef PREFIX
@@ -0,0 +1,124 @@
+#include "render/experimental/avk-cross-queue-submitter.h"
+
+// std
+#include <algorithm>
+#include <cassert>
+
+#define PREFIX "[CrossQueueSubmitter] "
+
+namespace avk::experimental {
+
+CrossQueueSubmitter::CrossQueueSubmitter(vk::Device* device,
+                                         vk::DiscardPool* graphicsDiscardPool,
+                                         vk::DiscardPool* computeDiscardPool)
+    : m_deps{device} {
+  assert(m_deps.device && m_deps.device->device());
+  assert(graphicsDiscardPool && computeDiscardPool &&
+         graphicsDiscardPool != computeDiscardPool);
+  Queue& graphics = m_queues[index(EQueue::eGraphics)];
+  graphics.queue = m_deps.device->queue();
+  graphics.familyIndex = m_deps.device->universalGraphicsQueueFamilyIndex();
+  graphics.discardPool = graphicsDiscardPool;
+  Queue& compute = m_queues[index(EQueue::eCompute)];
+  compute.queue = m_deps.device->computeQueue();
+  compute.familyIndex = m_deps.device->computeQueueFamilyIndex();
+  compute.discardPool = computeDiscardPool;
+  LOGI << PREFIX "Compute on queue family " << compute.familyIndex
+       << (m_deps.device->asyncCompute() ? " (async)" : " (universal)")
+       << std::endl;
+}
+
+void CrossQueueSubmitter::waitFor(EQueue queue, EQueue other,
+                                  VkPipelineStageFlags stages) {
+  assert(queue != other);
+  Queue const& signaling = m_queues[index(other)];
+  if (signaling.lastValue == 0) {
+    return;
+  }
+  addWait(queue, signaling.discardPool->timelineSemaphore(),
+          signaling.lastValue, stages);
+}
+
+void CrossQueueSubmitter::addWait(EQueue queue, VkSemaphore semaphore,
+                                  uint64_t value,
+                                  VkPipelineStageFlags stages) {
+  Queue& waiting = m_queues[index(queue)];
+  // the same timeline twice: the greatest value suffices
+  for (size_t i = 0; i < waiting.waitSemaphores.size(); ++i) {
+    if (waiting.waitSemaphores[i] == semaphore) {
+      waiting.waitValues[i] = std::max(waiting.waitValues[i], value);
+      waiting.waitStages[i] |= stages;
+      return;
+    }
+  }
+  waiting.waitSemaphores.push_back(semaphore);
+  waiting.waitValues.push_back(value);
+  waiting.waitStages.push_back(stages);
+}
+
+void CrossQueueSubmitter::addSignal(EQueue queue, VkSemaphore semaphore) {
+  Queue& signaling = m_queues[index(queue)];
+  signaling.signalSemaphores.push_back(semaphore);
+  signaling.signalValues.push_back(0);
+}
+
+VkResult CrossQueueSubmitter::submit(EQueue queue, VkCommandBuffer const* cmds,
+                                     uint32_t cmdCount,
+                                     VkFence fence) AVK_NO_CFI {
+  auto const* const vkDevApi = m_deps.device->table();
+  Queue& submitting = m_queues[index(queue)];
+  uint64_t const signalValue = submitting.lastValue + 1;
+  submitting.signalSemaphores.push_back(
+      submitting.discardPool->timelineSemaphore());
+  submitting.signalValues.push_back(signalValue);
+
+  VkTimelineSemaphoreSubmitInfoKHR timelineInfo{};
+  timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+  timelineInfo.waitSemaphoreValueCount =
+      static_cast<uint32_t>(submitting.waitValues.size());
+  timelineInfo.pWaitSemaphoreValues = submitting.waitValues.data();
+  timelineInfo.signalSemaphoreValueCount =
+      static_cast<uint32_t>(submitting.signalValues.size());
+  timelineInfo.pSignalSemaphoreValues = submitting.signalValues.data();
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.pNext = &timelineInfo;
+  submitInfo.waitSemaphoreCount =
+      static_cast<uint32_t>(submitting.waitSemaphores.size());
+  submitInfo.pWaitSemaphores = submitting.waitSemaphores.data();
+  submitInfo.pWaitDstStageMask = submitting.waitStages.data();
+  submitInfo.commandBufferCount = cmdCount;
+  submitInfo.pCommandBuffers = cmds;
+  submitInfo.signalSemaphoreCount =
+      static_cast<uint32_t>(submitting.signalSemaphores.size());
+  submitInfo.pSignalSemaphores = submitting.signalSemaphores.data();
+  VkResult const res =
+      vkDevApi->vkQueueSubmit(submitting.queue, 1, &submitInfo, fence);
+  clearPending(submitting);
+  if (res != VK_SUCCESS) {
+    LOGE << PREFIX "vkQueueSubmit failed: " << res << std::endl;
+    return res;
+  }
+  submitting.lastValue = signalValue;
+  return VK_SUCCESS;
+}
+
+void CrossQueueSubmitter::notifySubmitted(EQueue queue, uint64_t value) {
+  Queue& submitting = m_queues[index(queue)];
+  // no-op if the submission went through `submit`
+  assert(value >= submitting.lastValue);
+  submitting.lastValue = value;
+}
+
+void CrossQueueSubmitter::clearPending(Queue& queue) {
+  queue.waitSemaphores.clear();
+  queue.waitValues.clear();
+  queue.waitStages.clear();
+  queue.signalSemaphores.clear();
+  queue.signalValues.clear();
+}
+
+}  // namespace avk::experimental
+
+#undef PREFIX
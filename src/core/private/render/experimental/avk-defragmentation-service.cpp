@@ -0,0 +1,349 @@
+#include "render/experimental/avk-defragmentation-service.h"
+
+// library
+#include <algorithm>
+#include <cassert>
+
+#define PREFIX "[DefragmentationService] "
+
+namespace avk::experimental {
+
+static VkImageSubresourceRange allColorSubresources(
+    VkImageCreateInfo const& createInfo) {
+  VkImageSubresourceRange range{};
+  range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  range.baseMipLevel = 0;
+  range.levelCount = createInfo.mipLevels;
+  range.baseArrayLayer = 0;
+  range.layerCount = createInfo.arrayLayers;
+  return range;
+}
+
+static VkImageMemoryBarrier imageBarrier(VkImage image,
+                                         VkImageCreateInfo const& createInfo,
+                                         VkImageLayout oldLayout,
+                                         VkImageLayout newLayout,
+                                         VkAccessFlags srcAccess,
+                                         VkAccessFlags dstAccess) {
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = srcAccess;
+  barrier.dstAccessMask = dstAccess;
+  barrier.oldLayout = oldLayout;
+  barrier.newLayout = newLayout;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange = allColorSubresources(createInfo);
+  return barrier;
+}
+
+static void logRunStatistics(VmaDefragmentationStats const& stats) {
+  LOGI << PREFIX "Run completed: moved " << stats.allocationsMoved
+       << " allocations (" << stats.bytesMoved << " B), freed "
+       << stats.deviceMemoryBlocksFreed << " blocks (" << stats.bytesFreed
+       << " B)" << std::endl;
+}
+
+DefragmentationService::DefragmentationService(vk::Device* device,
+                                               vk::DiscardPool* discardPool,
+                                               BufferManager* bufferManager,
+                                               ImageManager* imageManager)
+    : m_deps{device, discardPool, bufferManager, imageManager} {
+  assert(m_deps.device && m_deps.discardPool && *m_deps.discardPool);
+  assert(m_deps.bufferManager && m_deps.imageManager);
+}
+
+DefragmentationService::~DefragmentationService() noexcept AVK_NO_CFI {
+  // device is idle, hence copies of a pending pass are done
+  if (m_passPending) {
+    endPass();
+  }
+  if (m_context) {
+    vmaEndDefragmentation(m_deps.device->vmaAllocator(), m_context, nullptr);
+    m_context = VK_NULL_HANDLE;
+  }
+}
+
+void DefragmentationService::recordFrame(VkCommandBuffer cmd,
+                                         uint64_t signalValue) AVK_NO_CFI {
+  if (m_passPending) {
+    if (m_deps.discardPool->queryTime() < m_passValue) {
+      return;
+    }
+    endPass();
+  }
+
+  if (!running()) {
+    if (!m_runRequested && ++m_frameCounter < Conf.RunEveryNFrames) {
+      return;
+    }
+    startRun();
+  }
+  if (!m_context && !beginTarget()) {
+    return;
+  }
+  beginPass(cmd, signalValue);
+}
+
+void DefragmentationService::startRun() {
+  m_frameCounter = 0;
+  m_runRequested = false;
+  m_runStats = {};
+  m_targetIndex = 0;
+  m_targets.clear();
+  // linear pools don't support defragmentation. Render targets are skipped,
+  // since transient attachments can't be copied
+  for (vk::EMemoryClass const memoryClass :
+       {vk::EMemoryClass::eStaticGeometry, vk::EMemoryClass::eTextures}) {
+    if (!m_deps.device->memoryPoolConfig(memoryClass).linear) {
+      m_deps.device->collectMemoryPools(memoryClass, m_targets);
+    }
+  }
+  m_targets.push_back(VK_NULL_HANDLE);
+  LOGI << PREFIX "Starting run on " << m_targets.size() << " pools"
+       << std::endl;
+}
+
+bool DefragmentationService::beginTarget() {
+  VmaAllocator const allocator = m_deps.device->vmaAllocator();
+  for (; m_targetIndex < m_targets.size(); ++m_targetIndex) {
+    VmaDefragmentationInfo info{};
+    info.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT;
+    info.pool = m_targets[m_targetIndex];
+    info.maxBytesPerPass = Conf.MaxBytesPerPass;
+    info.maxAllocationsPerPass = Conf.MaxAllocationsPerPass;
+    if (VkResult const res =
+            vmaBeginDefragmentation(allocator, &info, &m_context);
+        res != VK_SUCCESS) {
+      LOGW << PREFIX "Couldn't defragment pool " << m_targetIndex << ": "
+           << res << std::endl;
+      m_context = VK_NULL_HANDLE;
+      continue;
+    }
+    return true;
+  }
+
+  logRunStatistics(m_runStats);
+  return false;
+}
+
+void DefragmentationService::endTarget() {
+  VmaDefragmentationStats stats{};
+  vmaEndDefragmentation(m_deps.device->vmaAllocator(), m_context, &stats);
+  m_context = VK_NULL_HANDLE;
+  m_runStats.bytesMoved += stats.bytesMoved;
+  m_runStats.bytesFreed += stats.bytesFreed;
+  m_runStats.allocationsMoved += stats.allocationsMoved;
+  m_runStats.deviceMemoryBlocksFreed += stats.deviceMemoryBlocksFreed;
+  if (++m_targetIndex >= m_targets.size()) {
+    logRunStatistics(m_runStats);
+  }
+}
+
+void DefragmentationService::beginPass(VkCommandBuffer cmd,
+                                       uint64_t signalValue) {
+  VmaAllocator const allocator = m_deps.device->vmaAllocator();
+  VkResult const res =
+      vmaBeginDefragmentationPass(allocator, m_context, &m_passInfo);
+  if (res == VK_SUCCESS) {
+    // nothing left to move in this target
+    endTarget();
+    return;
+  }
+  if (res != VK_INCOMPLETE) {
+    LOGE << PREFIX "vmaBeginDefragmentationPass failed: " << res << std::endl;
+    endTarget();
+    return;
+  }
+
+  m_deps.bufferManager->collectMoveCandidates(m_bufferCandidates);
+  m_deps.imageManager->collectMoveCandidates(m_imageCandidates);
+  m_bufferMoves.clear();
+  m_imageMoves.clear();
+  for (uint32_t i = 0; i < m_passInfo.moveCount; ++i) {
+    VmaDefragmentationMove& move = m_passInfo.pMoves[i];
+    bool moved = false;
+    if (auto it = m_bufferCandidates.find(move.srcAllocation);
+        it != m_bufferCandidates.end()) {
+      moved = prepareBufferMove(move, it->second, signalValue);
+    } else if (auto it = m_imageCandidates.find(move.srcAllocation);
+               it != m_imageCandidates.end()) {
+      moved = prepareImageMove(move, it->second, signalValue);
+    }
+    if (!moved) {
+      move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+    }
+  }
+
+  if (m_bufferMoves.empty() && m_imageMoves.empty()) {
+    // nothing in flight, hence the pass can end right away
+    endPass();
+    return;
+  }
+  recordCopies(cmd);
+  m_passPending = true;
+  m_passValue = signalValue;
+}
+
+void DefragmentationService::endPass() {
+  VkResult const res = vmaEndDefragmentationPass(
+      m_deps.device->vmaAllocator(), m_context, &m_passInfo);
+  m_passPending = false;
+  // allocations now point to their new place, hence discards deferred during
+  // the pass free the right memory
+  m_deps.bufferManager->unpinAll(m_deps.discardPool);
+  m_deps.imageManager->unpinAll(m_deps.discardPool);
+  if (res == VK_SUCCESS) {
+    endTarget();
+  }
+}
+
+bool DefragmentationService::prepareBufferMove(
+    VmaDefragmentationMove const& move,
+    BufferManager::MoveCandidate const& candidate,
+    uint64_t signalValue) AVK_NO_CFI {
+  auto const* const vkDevApi = m_deps.device->table();
+  VkDevice const dev = m_deps.device->device();
+  VmaAllocator const allocator = m_deps.device->vmaAllocator();
+
+  VkBufferCreateInfo createInfo{};
+  createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  createInfo.size = candidate.size;
+  createInfo.usage = candidate.usage;
+  createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  VkBuffer newBuffer = VK_NULL_HANDLE;
+  if (vkDevApi->vkCreateBuffer(
+      dev, &createInfo,
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_BUFFER),
+      &newBuffer) != VK_SUCCESS) {
+    return false;
+  }
+  VkBuffer oldBuffer = VK_NULL_HANDLE;
+  if (vmaBindBufferMemory(allocator, move.dstTmpAllocation, newBuffer) !=
+          VK_SUCCESS ||
+      !m_deps.bufferManager->rebindForMove(
+          candidate.handle, move.srcAllocation, newBuffer, oldBuffer)) {
+    vkDevApi->vkDestroyBuffer(
+        dev, newBuffer,
+        m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_BUFFER));
+    return false;
+  }
+
+  // the allocation stays with the moved buffer, hence retire only the handle
+  m_deps.discardPool->discardBuffer(oldBuffer, VK_NULL_HANDLE, signalValue);
+  m_bufferMoves.push_back({oldBuffer, newBuffer, candidate.size});
+  if (m_bufferMoveListener) {
+    m_bufferMoveListener(candidate.handle, candidate.id, newBuffer);
+  }
+  return true;
+}
+
+bool DefragmentationService::prepareImageMove(
+    VmaDefragmentationMove const& move,
+    ImageManager::MoveCandidate const& candidate,
+    uint64_t signalValue) AVK_NO_CFI {
+  auto const* const vkDevApi = m_deps.device->table();
+  VkDevice const dev = m_deps.device->device();
+  VmaAllocator const allocator = m_deps.device->vmaAllocator();
+
+  VkImage newImage = VK_NULL_HANDLE;
+  if (vkDevApi->vkCreateImage(
+      dev, &candidate.createInfo,
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_IMAGE),
+      &newImage) != VK_SUCCESS) {
+    return false;
+  }
+  VkImage oldImage = VK_NULL_HANDLE;
+  if (vmaBindImageMemory(allocator, move.dstTmpAllocation, newImage) !=
+          VK_SUCCESS ||
+      !m_deps.imageManager->rebindForMove(candidate.handle, move.srcAllocation,
+                                          newImage, oldImage)) {
+    vkDevApi->vkDestroyImage(
+        dev, newImage,
+        m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_IMAGE));
+    return false;
+  }
+
+  m_deps.discardPool->discardImage(oldImage, VK_NULL_HANDLE, signalValue);
+  m_imageMoves.push_back({oldImage, newImage, candidate});
+  if (m_imageMoveListener) {
+    m_imageMoveListener(candidate.handle, candidate.id, newImage);
+  }
+  return true;
+}
+
+void DefragmentationService::recordCopies(VkCommandBuffer cmd) AVK_NO_CFI {
+  auto const* const vkDevApi = m_deps.device->table();
+
+  // 1. wait for previous uses of the old resources, one barrier for the pass
+  VkMemoryBarrier memoryBarrier{};
+  memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+  memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  m_imageBarriers.clear();
+  for (ImageMove const& move : m_imageMoves) {
+    VkImageCreateInfo const& createInfo = move.candidate.createInfo;
+    m_imageBarriers.push_back(imageBarrier(
+        move.oldImage, createInfo, move.candidate.layout,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_MEMORY_WRITE_BIT,
+        VK_ACCESS_TRANSFER_READ_BIT));
+    m_imageBarriers.push_back(imageBarrier(
+        move.newImage, createInfo, VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT));
+  }
+  vkDevApi->vkCmdPipelineBarrier(
+      cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+      0, 1, &memoryBarrier, 0, nullptr,
+      static_cast<uint32_t>(m_imageBarriers.size()), m_imageBarriers.data());
+
+  // 2. copies
+  for (BufferMove const& move : m_bufferMoves) {
+    VkBufferCopy region{};
+    region.size = move.size;
+    vkDevApi->vkCmdCopyBuffer(cmd, move.oldBuffer, move.newBuffer, 1, &region);
+  }
+  for (ImageMove const& move : m_imageMoves) {
+    VkImageCreateInfo const& createInfo = move.candidate.createInfo;
+    m_imageCopies.clear();
+    for (uint32_t mip = 0; mip < createInfo.mipLevels; ++mip) {
+      VkImageCopy region{};
+      region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      region.srcSubresource.mipLevel = mip;
+      region.srcSubresource.baseArrayLayer = 0;
+      region.srcSubresource.layerCount = createInfo.arrayLayers;
+      region.dstSubresource = region.srcSubresource;
+      region.extent.width = std::max(createInfo.extent.width >> mip, 1u);
+      region.extent.height = std::max(createInfo.extent.height >> mip, 1u);
+      region.extent.depth = std::max(createInfo.extent.depth >> mip, 1u);
+      m_imageCopies.push_back(region);
+    }
+    vkDevApi->vkCmdCopyImage(cmd, move.oldImage,
+                             VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                             move.newImage,
+                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                             static_cast<uint32_t>(m_imageCopies.size()),
+                             m_imageCopies.data());
+  }
+
+  // 3. make the copies visible to the rest of the frame, and restore layouts
+  memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  memoryBarrier.dstAccessMask =
+      VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+  m_imageBarriers.clear();
+  for (ImageMove const& move : m_imageMoves) {
+    m_imageBarriers.push_back(imageBarrier(
+        move.newImage, move.candidate.createInfo,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, move.candidate.layout,
+        VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT));
+  }
+  vkDevApi->vkCmdPipelineBarrier(
+      cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+      0, 1, &memoryBarrier, 0, nullptr,
+      static_cast<uint32_t>(m_imageBarriers.size()), m_imageBarriers.data());
+}
+
+}  // namespace avk::experimental
+
+#undef PREFIX
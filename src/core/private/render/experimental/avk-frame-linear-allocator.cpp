@@ -0,0 +1,120 @@
+#include "render/experimental/avk-frame-linear-allocator.h"
+
+#include "utils/bits.h"
+
+// library
+#include <algorithm>
+#include <cassert>
+#include <string>
+
+namespace avk::experimental {
+
+FrameLinearAllocator::FrameLinearAllocator(vk::Device* device,
+                                           uint32_t frameCount,
+                                           VkDeviceSize bytesPerFrame,
+                                           VkBufferUsageFlags usage) AVK_NO_CFI
+    : m_deps{device} {
+  assert(m_deps.device && m_deps.device->device());
+  assert(frameCount > 0);
+  VmaAllocator const allocator = m_deps.device->vmaAllocator();
+  VkPhysicalDeviceLimits const& limits = m_deps.device->limits();
+
+  m_minAlignment = std::max<VkDeviceSize>(
+      limits.minUniformBufferOffsetAlignment, 16);
+  if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) {
+    m_minAlignment =
+        std::max(m_minAlignment, limits.minStorageBufferOffsetAlignment);
+  }
+  m_bytesPerFrame = nextMultipleOf(bytesPerFrame, m_minAlignment);
+
+  VkBufferCreateInfo createInfo{};
+  createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  createInfo.usage = usage;
+  createInfo.size = m_bytesPerFrame;
+  createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  // host coherent is guaranteed to exist for host visible memory. Prefer
+  // DEVICE_LOCAL (SoC, Resizable BAR), otherwise reads go through PCIe
+  VmaAllocationCreateInfo allocInfo{};
+  allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+  allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                    VMA_ALLOCATION_CREATE_MAPPED_BIT;
+  allocInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  allocInfo.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  allocInfo.priority = 1.f;
+
+  m_regions.resize(frameCount);
+  for (uint32_t i = 0; i < frameCount; ++i) {
+    Region& region = m_regions[i];
+    VmaAllocationInfo info{};
+    VK_CHECK(vmaCreateBuffer(allocator, &createInfo, &allocInfo,
+                             &region.buffer, &region.alloc, &info));
+    region.mapped = reinterpret_cast<uint8_t*>(info.pMappedData);
+    AVK_EXT_CHECK(region.mapped);
+    m_deps.device->tagAllocation(region.alloc,
+                                 vk::EAllocationTag::eFrameAllocator,
+                                 "frame region " + std::to_string(i));
+  }
+  LOGI << "[FrameLinearAllocator] " << frameCount << " regions of "
+       << m_bytesPerFrame << " B, alignment " << m_minAlignment << std::endl;
+}
+
+FrameLinearAllocator::~FrameLinearAllocator() noexcept AVK_NO_CFI {
+  VmaAllocator const allocator = m_deps.device->vmaAllocator();
+  for (Region& region : m_regions) {
+    m_deps.device->untagAllocation(region.alloc);
+    vmaDestroyBuffer(allocator, region.buffer, region.alloc);
+  }
+  m_regions.clear();
+}
+
+void FrameLinearAllocator::beginFrame(uint32_t frameIndex,
+                                      vk::DiscardPool* discardPool,
+                                      uint64_t signalValue) AVK_NO_CFI {
+  assert(discardPool && *discardPool);
+  m_current = frameIndex % static_cast<uint32_t>(m_regions.size());
+  Region& region = m_regions[m_current];
+
+  if (region.pendingValue > discardPool->queryTime()) {
+    LOGW << "[FrameLinearAllocator] Region " << m_current
+         << " still in use, waiting for " << region.pendingValue << std::endl;
+    auto const* const vkDevApi = m_deps.device->table();
+    VkSemaphore const timeline = discardPool->timelineSemaphore();
+    VkSemaphoreWaitInfoKHR waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &timeline;
+    waitInfo.pValues = &region.pendingValue;
+    VK_CHECK(vkDevApi->vkWaitSemaphoresKHR(m_deps.device->device(), &waitInfo,
+                                           UINT64_MAX));
+  }
+
+  region.pendingValue = signalValue;
+  m_head.store(0, std::memory_order_relaxed);
+}
+
+FrameLinearAllocator::Allocation FrameLinearAllocator::allocate(
+    VkDeviceSize bytes, VkDeviceSize alignment) {
+  assert((alignment & (alignment - 1)) == 0 && "alignment must be POT");
+  VkDeviceSize const align = std::max(alignment, m_minAlignment);
+  VkDeviceSize head = m_head.load(std::memory_order_relaxed);
+  VkDeviceSize offset = 0;
+  do {
+    offset = nextMultipleOf(head, align);
+    if (offset + bytes > m_bytesPerFrame) {
+      return {};
+    }
+  } while (!m_head.compare_exchange_weak(head, offset + bytes,
+                                         std::memory_order_relaxed));
+
+  Region const& region = m_regions[m_current];
+  Allocation allocation{};
+  allocation.buffer = region.buffer;
+  allocation.offset = offset;
+  allocation.size = bytes;
+  allocation.mapped = region.mapped + offset;
+  return allocation;
+}
+
+}  // namespace avk::experimental
@@ -43,6 +43,7 @@ struct KtxThreadLocalAlloc : public NonMoveable {
       for (auto const& [id, alloc] : allocations) {
         LOGI << "[Global KTX2 Texture Manager] destroy alloc " << (void*)alloc
              << std::endl;
+        device->untagAllocation(alloc);
         vmaFreeMemory(device->vmaAllocator(), alloc);
       }
       LOGW << AVK_LOG_YLW
@@ -189,6 +190,8 @@ static uint64_t ktxAllocMem(VkMemoryAllocateInfo* allocInfo,
 
   uint64_t const id = gKtxAllocManager->nextId++;
   gKtxAllocManager->allocations.try_emplace(id, allocation);
+  device->tagAllocation(allocation, vk::EAllocationTag::eTextureLoader,
+                        "ktx memory " + std::to_string(id));
 
   return id;
 }
@@ -267,6 +270,7 @@ static void ktxFreeMem(uint64_t allocId) AVK_NO_CFI {
   LOGI << "[KTX Free Mem] --------------"
           "-------------- free: "
        << (void*)alloc << std::endl;
+  device->untagAllocation(alloc);
   vmaFreeMemory(device->vmaAllocator(), alloc);
 }
 
@@ -444,11 +448,13 @@ void TextureLoaderKTX2::Impl::initialize() AVK_NO_CFI {
       m_deps.device->universalGraphicsQueueFamilyIndex();
 
   VK_CHECK(m_deps.device->table()->vkCreateCommandPool(
-      m_deps.device->device(), &createInfo, nullptr, &m_commandPool));
+      m_deps.device->device(), &createInfo,
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_COMMAND_POOL),
+      &m_commandPool));
   KTX_CHECK(ktxVulkanDeviceInfo_ConstructEx(
       &m_ktxDevInfo, m_deps.instance->handle(), m_deps.device->physicalDevice(),
-      m_deps.device->device(), m_deps.device->queue(), m_commandPool, nullptr,
-      &ktxTable));
+      m_deps.device->device(), m_deps.device->queue(), m_commandPool,
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_IMAGE), &ktxTable));
   m_allocCallbacks = ktxAllocCallbacksFromVMA();
 }
 
@@ -463,15 +469,18 @@ void TextureLoaderKTX2::Impl::cleanup() AVK_NO_CFI {
   }
   for (auto& [id, vkTex] : m_loadedTextures) {
     KTX_CHECK(ktxVulkanTexture_Destruct_WithSuballocator(
-        &vkTex, m_deps.device->device(), nullptr, &m_allocCallbacks));
+        &vkTex, m_deps.device->device(),
+        m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_IMAGE),
+        &m_allocCallbacks));
   }
   m_loadedTextures.clear();
   // destroy KTX device info
   if (m_ktxDevInfo.device != VK_NULL_HANDLE) {
     ktxVulkanDeviceInfo_Destruct(&m_ktxDevInfo);
   }
-  m_deps.device->table()->vkDestroyCommandPool(m_deps.device->device(),
-                                               m_commandPool, nullptr);
+  m_deps.device->table()->vkDestroyCommandPool(
+      m_deps.device->device(), m_commandPool,
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_COMMAND_POOL));
   m_commandPool = VK_NULL_HANDLE;
   m_ktxDevInfo = {};
   gKtxAllocManager.reset();
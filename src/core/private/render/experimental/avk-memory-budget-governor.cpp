@@ -0,0 +1,236 @@
+#include "render/experimental/avk-memory-budget-governor.h"
+
+// library
+#include <algorithm>
+#include <cassert>
+
+#define PREFIX "[MemoryBudgetGovernor] "
+
+static char const* pressureName(
+    avk::experimental::MemoryBudgetGovernor::EPressure pressure) {
+  using EPressure = avk::experimental::MemoryBudgetGovernor::EPressure;
+  switch (pressure) {
+    case EPressure::eNone:
+      return "none";
+    case EPressure::eSoft:
+      return "soft";
+    case EPressure::eHard:
+      return "hard";
+  }
+  return "unknown";
+}
+
+// bytes of `usage` over `threshold` of `budget`
+static VkDeviceSize bytesOver(VkDeviceSize usage, VkDeviceSize budget,
+                              float threshold) {
+  auto const limit = static_cast<VkDeviceSize>(budget * threshold);
+  return usage > limit ? usage - limit : 0;
+}
+
+namespace avk::experimental {
+
+MemoryBudgetGovernor::MemoryBudgetGovernor(vk::Device* device,
+                                           vk::DiscardPool* discardPool)
+    : m_deps{device, discardPool} {
+  assert(m_deps.device && m_deps.discardPool);
+  VkPhysicalDeviceMemoryProperties const* memProps = nullptr;
+  vmaGetMemoryProperties(m_deps.device->vmaAllocator(), &memProps);
+  // on SoC every heap is device local, or there's nothing to tell apart
+  for (uint32_t heap = 0; heap < memProps->memoryHeapCount; ++heap) {
+    if (m_deps.device->isSoC() || (memProps->memoryHeaps[heap].flags &
+                                   VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)) {
+      m_heaps.push_back(heap);
+    }
+  }
+  if (m_heaps.empty()) {
+    for (uint32_t heap = 0; heap < memProps->memoryHeapCount; ++heap) {
+      m_heaps.push_back(heap);
+    }
+  }
+  refreshUsage();
+}
+
+uint32_t MemoryBudgetGovernor::addEvictionCallback(EvictionCallback callback,
+                                                   int32_t priority) {
+  std::lock_guard lk{m_mtx};
+  uint32_t const id = m_nextEvictionId++;
+  auto const it = std::upper_bound(
+      m_evictions.begin(), m_evictions.end(), priority,
+      [](int32_t p, Eviction const& e) { return p < e.priority; });
+  m_evictions.insert(it, Eviction{id, priority, std::move(callback)});
+  return id;
+}
+
+void MemoryBudgetGovernor::removeEvictionCallback(uint32_t id) {
+  std::lock_guard lk{m_mtx};
+  m_evictions.erase(
+      std::remove_if(m_evictions.begin(), m_evictions.end(),
+                     [id](Eviction const& e) { return e.id == id; }),
+      m_evictions.end());
+}
+
+void MemoryBudgetGovernor::onFrame() {
+  std::lock_guard lk{m_mtx};
+  refreshUsage();
+  // evicted memory shows up as a usage drop once its frames retired. Compared
+  // with the previous `onFrame`, as `admit` and `reclaim` refresh `m_usage`
+  // in between
+  if (m_pendingEvictedBytes > 0) {
+    VkDeviceSize const dropped =
+        m_frameUsage > m_usage ? m_frameUsage - m_usage : 0;
+    m_pendingEvictedBytes -= std::min(m_pendingEvictedBytes, dropped);
+    if (++m_pendingEvictionFrames >= Conf.EvictionRetireFrames) {
+      m_pendingEvictedBytes = 0;
+    }
+  }
+  m_admittedBytes = 0;
+  m_streamingBytes = 0;
+  for (uint32_t i = 0; i < m_classStats.size(); ++i) {
+    m_classStats[i] =
+        m_deps.device->memoryClassStatistics(static_cast<vk::EMemoryClass>(i));
+  }
+
+  // get back under the soft threshold before allocations start failing
+  EPressure pressure = pressureOf(m_usage);
+  if (pressure != EPressure::eNone &&
+      evict(vk::EMemoryClass::eCount,
+            bytesOver(m_usage, m_budget, Conf.SoftThreshold), pressure) > 0) {
+    m_deps.discardPool->destroyDiscardedResources();
+    refreshUsage();
+    pressure = pressureOf(m_usage);
+  }
+  m_frameUsage = m_usage;
+
+  if (pressure != m_pressure) {
+    if (pressure > m_pressure) {
+      LOGW << PREFIX "Memory pressure " << pressureName(pressure) << ": "
+           << m_usage << " B used of " << m_budget << " B" << std::endl;
+    } else {
+      LOGI << PREFIX "Memory pressure " << pressureName(pressure) << ": "
+           << m_usage << " B used of " << m_budget << " B" << std::endl;
+    }
+    m_pressure = pressure;
+  }
+}
+
+bool MemoryBudgetGovernor::admit(vk::EMemoryClass memoryClass,
+                                 VkDeviceSize bytes) {
+  assert(memoryClass != vk::EMemoryClass::eCount);
+  bool const critical = memoryClass == vk::EMemoryClass::eRenderTargets ||
+                        memoryClass == vk::EMemoryClass::eStaging;
+  std::lock_guard lk{m_mtx};
+  VkDeviceSize projected = m_usage + m_admittedBytes + bytes;
+  EPressure pressure = pressureOf(projected);
+  if (pressure == EPressure::eHard) {
+    // what's evicted now is still in flight, only earlier evictions may be
+    // destroyed already
+    evict(memoryClass, bytesOver(projected, m_budget, Conf.SoftThreshold),
+          EPressure::eHard);
+    m_deps.discardPool->destroyDiscardedResources();
+    refreshUsage();
+    projected = m_usage + m_admittedBytes + bytes;
+    pressure = pressureOf(projected);
+    if (pressure == EPressure::eHard && !critical) {
+      LOGW << PREFIX "Rejected " << bytes << " B (class "
+           << static_cast<uint32_t>(memoryClass) << "): " << projected
+           << " B would be used of " << m_budget << " B" << std::endl;
+      return false;
+    }
+  }
+  // throttle streaming, which can be retried next frame
+  if (memoryClass == vk::EMemoryClass::eStreaming) {
+    if (pressure != EPressure::eNone &&
+        m_streamingBytes + bytes > Conf.StreamingBytesPerFrameUnderPressure) {
+      return false;
+    }
+    m_streamingBytes += bytes;
+  }
+  m_admittedBytes += bytes;
+  return true;
+}
+
+bool MemoryBudgetGovernor::reclaim(vk::EMemoryClass memoryClass,
+                                   VkDeviceSize bytes) {
+  std::lock_guard lk{m_mtx};
+  refreshUsage();
+  VkDeviceSize const before = m_usage;
+  VkDeviceSize const evicted = evict(memoryClass, bytes, EPressure::eHard);
+  // only resources discarded by earlier frames may be completed already
+  m_deps.discardPool->destroyDiscardedResources();
+  refreshUsage();
+  LOGI << PREFIX "Reclaim of " << bytes << " B: evicted " << evicted
+       << " B, usage " << before << " -> " << m_usage << " B" << std::endl;
+  return m_usage < before;
+}
+
+MemoryBudgetGovernor::EPressure MemoryBudgetGovernor::pressure() const {
+  std::lock_guard lk{m_mtx};
+  return m_pressure;
+}
+
+VkDeviceSize MemoryBudgetGovernor::usage() const {
+  std::lock_guard lk{m_mtx};
+  return m_usage;
+}
+
+VkDeviceSize MemoryBudgetGovernor::budget() const {
+  std::lock_guard lk{m_mtx};
+  return m_budget;
+}
+
+VmaStatistics MemoryBudgetGovernor::classStatistics(
+    vk::EMemoryClass memoryClass) const {
+  assert(memoryClass != vk::EMemoryClass::eCount);
+  std::lock_guard lk{m_mtx};
+  return m_classStats[static_cast<uint32_t>(memoryClass)];
+}
+
+MemoryBudgetGovernor::EPressure MemoryBudgetGovernor::pressureOf(
+    VkDeviceSize usage) const {
+  if (m_budget == 0) {
+    return EPressure::eNone;
+  }
+  if (bytesOver(usage, m_budget, Conf.HardThreshold) > 0) {
+    return EPressure::eHard;
+  }
+  if (bytesOver(usage, m_budget, Conf.SoftThreshold) > 0) {
+    return EPressure::eSoft;
+  }
+  return EPressure::eNone;
+}
+
+VkDeviceSize MemoryBudgetGovernor::evict(vk::EMemoryClass memoryClass,
+                                         VkDeviceSize bytes,
+                                         EPressure pressure) {
+  if (bytes <= m_pendingEvictedBytes) {
+    return 0;
+  }
+  bytes -= m_pendingEvictedBytes;
+  VkDeviceSize released = 0;
+  for (Eviction const& eviction : m_evictions) {
+    if (released >= bytes) {
+      break;
+    }
+    released += eviction.callback(memoryClass, bytes - released, pressure);
+  }
+  if (released > 0) {
+    m_pendingEvictedBytes += released;
+    m_pendingEvictionFrames = 0;
+  }
+  return released;
+}
+
+void MemoryBudgetGovernor::refreshUsage() {
+  VmaBudget budgets[VK_MAX_MEMORY_HEAPS]{};
+  vmaGetHeapBudgets(m_deps.device->vmaAllocator(), budgets);
+  m_usage = 0;
+  m_budget = 0;
+  for (uint32_t heap : m_heaps) {
+    m_usage += budgets[heap].usage;
+    m_budget += budgets[heap].budget;
+  }
+}
+
+}  // namespace avk::experimental
+
+#undef PREFIX
@@ -0,0 +1,217 @@
+#include "render/experimental/avk-readback-service.h"
+
+#include "utils/bits.h"
+
+// library
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <numeric>
+
+#define PREFIX "[ReadbackService] "
+
+// `x` rounded up to a multiple of `base`, which needn't be a power of two
+static VkDeviceSize alignUp(VkDeviceSize x, VkDeviceSize base) {
+  return (x + base - 1) / base * base;
+}
+
+namespace avk::experimental {
+
+ReadbackService::ReadbackService(vk::Device* device,
+                                 VkDeviceSize ringBytes) AVK_NO_CFI
+    : m_deps{device} {
+  assert(m_deps.device && m_deps.device->device());
+  VkPhysicalDeviceLimits const& limits = m_deps.device->limits();
+  // both powers of two, hence the max is a multiple of both
+  m_alignment = std::max<VkDeviceSize>(limits.nonCoherentAtomSize, 16);
+  m_ringBytes = nextMultipleOf(ringBytes, m_alignment);
+
+  VkBufferCreateInfo createInfo{};
+  createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  createInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  createInfo.size = m_ringBytes;
+  createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  // same placement of `BufferManager::createBufferReadback`, which is also
+  // valid on SoC, where the memory is host visible anyway
+  VmaAllocationCreateInfo allocInfo{};
+  allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+  allocInfo.priority = 1.f;
+  allocInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+  allocInfo.preferredFlags =
+      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+  allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT |
+                    VMA_ALLOCATION_CREATE_MAPPED_BIT;
+  VmaAllocationInfo info{};
+  VK_CHECK(m_deps.device->createPooledBuffer(vk::EMemoryClass::eStaging,
+                                             createInfo, allocInfo, m_buffer,
+                                             m_alloc, &info));
+  m_mapped = reinterpret_cast<uint8_t*>(info.pMappedData);
+  AVK_EXT_CHECK(m_mapped);
+  m_deps.device->tagAllocation(m_alloc, vk::EAllocationTag::eReadback,
+                               "readback ring");
+  LOGI << PREFIX "Ring of " << m_ringBytes << " B, alignment " << m_alignment
+       << std::endl;
+}
+
+ReadbackService::~ReadbackService() noexcept AVK_NO_CFI {
+  if (!m_pending.empty()) {
+    LOGW << PREFIX "Dropping " << m_pending.size() << " pending readbacks"
+         << std::endl;
+  }
+  m_pending.clear();
+  m_deps.device->untagAllocation(m_alloc);
+  vmaDestroyBuffer(m_deps.device->vmaAllocator(), m_buffer, m_alloc);
+}
+
+bool ReadbackService::readBuffer(VkCommandBuffer cmd, uint64_t signalValue,
+                                 VkBuffer src, VkDeviceSize offset,
+                                 VkDeviceSize bytes,
+                                 Callback callback) AVK_NO_CFI {
+  assert(m_pending.empty() || m_pending.back().value <= signalValue);
+  VkDeviceSize ringOffset = 0;
+  if (!reserve(bytes, m_alignment, ringOffset)) {
+    return false;
+  }
+  auto const* const vkDevApi = m_deps.device->table();
+  recordBarriers(cmd, true);
+  VkBufferCopy region{};
+  region.srcOffset = offset;
+  region.dstOffset = ringOffset;
+  region.size = bytes;
+  vkDevApi->vkCmdCopyBuffer(cmd, src, m_buffer, 1, &region);
+  recordBarriers(cmd, false);
+  m_pending.push_back(
+      Request{signalValue, ringOffset, bytes, std::move(callback)});
+  return true;
+}
+
+bool ReadbackService::readImage(VkCommandBuffer cmd, uint64_t signalValue,
+                                VkImage src, VkImageLayout layout,
+                                VkImageSubresourceLayers subresource,
+                                VkOffset3D offset, VkExtent3D extent,
+                                uint32_t texelBytes,
+                                Callback callback) AVK_NO_CFI {
+  assert(m_pending.empty() || m_pending.back().value <= signalValue);
+  assert(layout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL ||
+         layout == VK_IMAGE_LAYOUT_GENERAL);
+  VkDeviceSize const bytes = VkDeviceSize(extent.width) * extent.height *
+                             extent.depth * subresource.layerCount *
+                             texelBytes;
+  // `bufferOffset` must be a multiple of the texel block size, which isn't
+  // a power of two for 3 component formats (eg. 3, 6, 12 B)
+  VkDeviceSize const alignment =
+      std::lcm(VkDeviceSize{texelBytes}, m_alignment);
+  VkDeviceSize ringOffset = 0;
+  if (!reserve(bytes, alignment, ringOffset)) {
+    return false;
+  }
+  auto const* const vkDevApi = m_deps.device->table();
+  recordBarriers(cmd, true);
+  // zero row length and image height mean tightly packed
+  VkBufferImageCopy region{};
+  region.bufferOffset = ringOffset;
+  region.imageSubresource = subresource;
+  region.imageOffset = offset;
+  region.imageExtent = extent;
+  vkDevApi->vkCmdCopyImageToBuffer(cmd, src, layout, m_buffer, 1, &region);
+  recordBarriers(cmd, false);
+  m_pending.push_back(
+      Request{signalValue, ringOffset, bytes, std::move(callback)});
+  return true;
+}
+
+std::future<std::vector<uint8_t>> ReadbackService::readBuffer(
+    VkCommandBuffer cmd, uint64_t signalValue, VkBuffer src,
+    VkDeviceSize offset, VkDeviceSize bytes) {
+  // shared, as `std::function` needs a copyable callable
+  auto promise = std::make_shared<std::promise<std::vector<uint8_t>>>();
+  std::future<std::vector<uint8_t>> future = promise->get_future();
+  bool const accepted =
+      readBuffer(cmd, signalValue, src, offset, bytes,
+                 [promise](void const* data, VkDeviceSize size) {
+                   auto const* begin = static_cast<uint8_t const*>(data);
+                   promise->set_value(
+                       std::vector<uint8_t>(begin, begin + size));
+                 });
+  if (!accepted) {
+    return {};
+  }
+  return future;
+}
+
+void ReadbackService::poll(uint64_t completedValue) {
+  VmaAllocator const allocator = m_deps.device->vmaAllocator();
+  while (!m_pending.empty() && m_pending.front().value <= completedValue) {
+    Request const request = std::move(m_pending.front());
+    m_pending.pop_front();
+    // no-op on coherent memory, otherwise rounded to `nonCoherentAtomSize`
+    VK_CHECK(vmaInvalidateAllocation(allocator, m_alloc, request.offset,
+                                     request.size));
+    if (request.callback) {
+      request.callback(m_mapped + request.offset, request.size);
+    }
+  }
+  if (m_pending.empty()) {
+    m_head = 0;
+  }
+}
+
+bool ReadbackService::reserve(VkDeviceSize bytes, VkDeviceSize alignment,
+                              VkDeviceSize& outOffset) {
+  assert(alignment % m_alignment == 0);
+  VkDeviceSize const size = nextMultipleOf(bytes, m_alignment);
+  if (m_pending.empty()) {
+    m_head = 0;
+  }
+  if (size == 0 || size > m_ringBytes) {
+    return false;
+  }
+  // head never reaches the tail while requests are pending, such that
+  // head == tail always means empty. Bytes skipped to align the offset free
+  // up with the request before it
+  VkDeviceSize const tail = m_pending.empty() ? 0 : m_pending.front().offset;
+  VkDeviceSize const offset = alignUp(m_head, alignment);
+  if (m_pending.empty() || m_head > tail) {
+    if (offset + size <= m_ringBytes) {
+      outOffset = offset;
+    } else if (m_pending.empty() || size < tail) {
+      outOffset = 0;  // wrap around, the skipped tail bytes free up later
+    } else {
+      return false;
+    }
+  } else if (offset + size < tail) {
+    outOffset = offset;
+  } else {
+    return false;
+  }
+  m_head = outOffset + size;
+  return true;
+}
+
+void ReadbackService::recordBarriers(VkCommandBuffer cmd,
+                                     bool beforeCopy) const AVK_NO_CFI {
+  auto const* const vkDevApi = m_deps.device->table();
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  if (beforeCopy) {
+    // whatever produced the source, in this or previous submissions
+    barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkDevApi->vkCmdPipelineBarrier(
+        cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+  } else {
+    // the timeline signal makes device writes available, the host read
+    // barrier keeps the dependency explicit
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkDevApi->vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                   VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier,
+                                   0, nullptr, 0, nullptr);
+  }
+}
+
+}  // namespace avk::experimental
+
+#undef PREFIX
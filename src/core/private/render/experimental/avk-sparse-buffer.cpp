@@ -0,0 +1,254 @@
+#include "render/experimental/avk-sparse-buffer.h"
+
+#include "utils/bits.h"
+
+// library
+#include <algorithm>
+#include <cassert>
+#include <string>
+
+#define PREFIX "[SparseBuffer] "
+
+namespace avk::experimental {
+
+SparseBuffer::SparseBuffer(vk::Device* device, VkDeviceSize size,
+                           VkBufferUsageFlags usage) AVK_NO_CFI
+    : m_deps{device} {
+  assert(m_deps.device && m_deps.device->device());
+  assert(size > 0);
+  auto const* const vkDevApi = m_deps.device->table();
+  VkDevice const dev = m_deps.device->device();
+  if (!m_deps.device->sparseResidencyBuffer()) {
+    LOGW << PREFIX "Sparse residency buffers unsupported" << std::endl;
+    return;
+  }
+  if (size > m_deps.device->limits().sparseAddressSpaceSize) {
+    LOGW << PREFIX "Size " << size << " B exceeds the sparse address space"
+         << std::endl;
+    return;
+  }
+
+  VkBufferCreateInfo createInfo{};
+  createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  createInfo.flags = VK_BUFFER_CREATE_SPARSE_BINDING_BIT |
+                     VK_BUFFER_CREATE_SPARSE_RESIDENCY_BIT;
+  createInfo.usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  createInfo.size = size;
+  createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  if (VkResult const res = vkDevApi->vkCreateBuffer(
+          dev, &createInfo,
+          m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_BUFFER), &m_buffer);
+      res != VK_SUCCESS) {
+    LOGE << PREFIX "Couldn't create buffer: " << res << std::endl;
+    m_buffer = VK_NULL_HANDLE;
+    return;
+  }
+  // for sparse resources, the alignment is the binding granularity
+  VkMemoryRequirements requirements{};
+  vkDevApi->vkGetBufferMemoryRequirements(dev, m_buffer, &requirements);
+  m_size = size;
+  m_pageSize = requirements.alignment;
+  m_pageCount = static_cast<uint32_t>((size + m_pageSize - 1) / m_pageSize);
+  m_memoryTypeBits = requirements.memoryTypeBits;
+  m_residency.resize((m_pageCount + 63) / 64, 0);
+
+  VkSemaphoreTypeCreateInfoKHR semType{};
+  semType.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+  semType.initialValue = 0;
+  semType.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+  VkSemaphoreCreateInfo semCreateInfo{};
+  semCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  semCreateInfo.pNext = &semType;
+  VK_CHECK(vkDevApi->vkCreateSemaphore(
+      dev, &semCreateInfo,
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_SEMAPHORE),
+      &m_semaphore));
+
+  LOGI << PREFIX << size << " B of address space, " << m_pageCount
+       << " pages of " << m_pageSize << " B" << std::endl;
+}
+
+SparseBuffer::~SparseBuffer() noexcept AVK_NO_CFI {
+  if (m_buffer == VK_NULL_HANDLE) {
+    return;
+  }
+  auto const* const vkDevApi = m_deps.device->table();
+  VkDevice const dev = m_deps.device->device();
+  VmaAllocator const allocator = m_deps.device->vmaAllocator();
+  if (m_bindValue > 0) {
+    VkSemaphoreWaitInfoKHR waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_semaphore;
+    waitInfo.pValues = &m_bindValue;
+    VK_CHECK(vkDevApi->vkWaitSemaphoresKHR(dev, &waitInfo, UINT64_MAX));
+  }
+  vkDevApi->vkDestroyBuffer(
+      dev, m_buffer, m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_BUFFER));
+  vkDevApi->vkDestroySemaphore(
+      dev, m_semaphore,
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_SEMAPHORE));
+  freeRetiredPages(UINT64_MAX);
+  for (auto const& [page, alloc] : m_pages) {
+    m_deps.device->untagAllocation(alloc);
+    vmaFreeMemory(allocator, alloc);
+  }
+}
+
+int32_t SparseBuffer::commit(VkDeviceSize offset, VkDeviceSize bytes) {
+  assert(*this && offset + bytes <= m_size);
+  if (bytes == 0) {
+    return Success;
+  }
+  VmaAllocator const allocator = m_deps.device->vmaAllocator();
+  VkMemoryRequirements requirements{};
+  requirements.size = m_pageSize;
+  requirements.alignment = m_pageSize;
+  requirements.memoryTypeBits = m_memoryTypeBits;
+  // no `VMA_MEMORY_USAGE_AUTO*`, which needs a resource create info
+  VmaAllocationCreateInfo allocInfo{};
+  allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+  uint32_t const first = static_cast<uint32_t>(offset / m_pageSize);
+  uint32_t const last =
+      static_cast<uint32_t>((offset + bytes - 1) / m_pageSize);
+  for (uint32_t page = first; page <= last; ++page) {
+    if (resident(page)) {
+      continue;
+    }
+    VmaAllocation alloc = VK_NULL_HANDLE;
+    if (VkResult const res = vmaAllocateMemory(allocator, &requirements,
+                                               &allocInfo, &alloc, nullptr);
+        res != VK_SUCCESS) {
+      LOGE << PREFIX "Couldn't commit page " << page << ": " << res
+           << std::endl;
+      return VulkanError;
+    }
+    m_deps.device->tagAllocation(alloc, vk::EAllocationTag::eSparseBuffers,
+                                 "sparse page " + std::to_string(page));
+    m_residency[page >> 6] |= uint64_t(1) << (page & 63);
+    m_pages.try_emplace(page, alloc);
+    // replaces an unbind queued in the same batch
+    m_pendingBinds[page] = alloc;
+  }
+  return Success;
+}
+
+void SparseBuffer::decommit(VkDeviceSize offset, VkDeviceSize bytes) {
+  assert(*this && offset + bytes <= m_size);
+  uint32_t const first =
+      static_cast<uint32_t>(nextMultipleOf(offset, m_pageSize) / m_pageSize);
+  // the last page is whole also when it ends at the end of the buffer
+  VkDeviceSize const end = offset + bytes;
+  uint32_t const last = static_cast<uint32_t>(
+      end == m_size ? m_pageCount : end / m_pageSize);
+  for (uint32_t page = first; page < last; ++page) {
+    if (!resident(page)) {
+      continue;
+    }
+    auto const it = m_pages.find(page);
+    assert(it != m_pages.end());
+    // freed once the unbind of the next `flush` completed
+    m_retired.push_back(RetiredPage{it->second, m_bindValue + 1});
+    m_pages.erase(it);
+    m_residency[page >> 6] &= ~(uint64_t(1) << (page & 63));
+    m_pendingBinds[page] = VK_NULL_HANDLE;
+  }
+}
+
+int32_t SparseBuffer::flush(VkSemaphore waitSemaphore,
+                            uint64_t waitValue) AVK_NO_CFI {
+  assert(*this);
+  auto const* const vkDevApi = m_deps.device->table();
+  VkDevice const dev = m_deps.device->device();
+  VmaAllocator const allocator = m_deps.device->vmaAllocator();
+  uint64_t completedValue = 0;
+  VK_CHECK(vkDevApi->vkGetSemaphoreCounterValueKHR(dev, m_semaphore,
+                                                   &completedValue));
+  freeRetiredPages(completedValue);
+  if (m_pendingBinds.empty()) {
+    return Success;
+  }
+
+  m_binds.clear();
+  m_binds.reserve(m_pendingBinds.size());
+  for (auto const& [page, alloc] : m_pendingBinds) {
+    VkSparseMemoryBind& bind = m_binds.emplace_back();
+    bind.resourceOffset = VkDeviceSize(page) * m_pageSize;
+    // the last page may end with the buffer
+    bind.size = std::min(m_pageSize, m_size - bind.resourceOffset);
+    if (alloc != VK_NULL_HANDLE) {
+      VmaAllocationInfo info{};
+      vmaGetAllocationInfo(allocator, alloc, &info);
+      bind.memory = info.deviceMemory;
+      bind.memoryOffset = info.offset;
+    }
+  }
+
+  VkSparseBufferMemoryBindInfo bufferBinds{};
+  bufferBinds.buffer = m_buffer;
+  bufferBinds.bindCount = static_cast<uint32_t>(m_binds.size());
+  bufferBinds.pBinds = m_binds.data();
+
+  uint64_t const signalValue = m_bindValue + 1;
+  VkTimelineSemaphoreSubmitInfoKHR timelineInfo{};
+  timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+  timelineInfo.waitSemaphoreValueCount = waitSemaphore ? 1 : 0;
+  timelineInfo.pWaitSemaphoreValues = &waitValue;
+  timelineInfo.signalSemaphoreValueCount = 1;
+  timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+  VkBindSparseInfo bindInfo{};
+  bindInfo.sType = VK_STRUCTURE_TYPE_BIND_SPARSE_INFO;
+  bindInfo.pNext = &timelineInfo;
+  bindInfo.waitSemaphoreCount = waitSemaphore ? 1 : 0;
+  bindInfo.pWaitSemaphores = &waitSemaphore;
+  bindInfo.bufferBindCount = 1;
+  bindInfo.pBufferBinds = &bufferBinds;
+  bindInfo.signalSemaphoreCount = 1;
+  bindInfo.pSignalSemaphores = &m_semaphore;
+  if (VkResult const res = vkDevApi->vkQueueBindSparse(
+          m_deps.device->queue(), 1, &bindInfo, VK_NULL_HANDLE);
+      res != VK_SUCCESS) {
+    // binds stay queued for the next flush
+    LOGE << PREFIX "vkQueueBindSparse failed: " << res << std::endl;
+    return VulkanError;
+  }
+  m_bindValue = signalValue;
+  m_pendingBinds.clear();
+  return Success;
+}
+
+bool SparseBuffer::isResident(VkDeviceSize offset, VkDeviceSize bytes) const {
+  assert(*this && offset + bytes <= m_size);
+  if (bytes == 0) {
+    return true;
+  }
+  uint32_t const first = static_cast<uint32_t>(offset / m_pageSize);
+  uint32_t const last =
+      static_cast<uint32_t>((offset + bytes - 1) / m_pageSize);
+  for (uint32_t page = first; page <= last; ++page) {
+    if (!resident(page)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SparseBuffer::freeRetiredPages(uint64_t completedValue) {
+  VmaAllocator const allocator = m_deps.device->vmaAllocator();
+  auto const firstPending =
+      std::find_if(m_retired.begin(), m_retired.end(),
+                   [completedValue](RetiredPage const& retired) {
+                     return retired.value > completedValue;
+                   });
+  for (auto it = m_retired.begin(); it != firstPending; ++it) {
+    m_deps.device->untagAllocation(it->alloc);
+    vmaFreeMemory(allocator, it->alloc);
+  }
+  m_retired.erase(m_retired.begin(), firstPending);
+}
+
+}  // namespace avk::experimental
+
+#undef PREFIX
@@ -1,43 +1,23 @@
 #include "render/experimental/avk-staging-transient-manager.h"
 
-#include <array>
+#include "utils/bits.h"
+
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+
+#define PREFIX "[StagingTransientManager] "
+
+// alignment of the data of each operation inside the ring
+static VkDeviceSize constexpr OpAlignment = 16;
 
 namespace avk::experimental {
 
 StagingTransientManager::StagingTransientManager() {
   // some good enough capacity
   m_stagingOps.reserve(64);
-
-  // TODO add more if needed
-  static constexpr std::array<VkPipelineStageFlags, 17> StageFlags{
-      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-      VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
-      VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-      VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
-      VK_PIPELINE_STAGE_TESSELLATION_CONTROL_SHADER_BIT,
-      VK_PIPELINE_STAGE_TESSELLATION_EVALUATION_SHADER_BIT,
-      VK_PIPELINE_STAGE_GEOMETRY_SHADER_BIT,
-      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-      VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-      VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
-      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-      VK_PIPELINE_STAGE_TRANSFER_BIT,
-      VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-      VK_PIPELINE_STAGE_HOST_BIT,
-      VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT,
-      VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-  };
-  // again, some capacity for each stage
-  m_barriersPerStage.reserve(64);
-  for (auto const stage : StageFlags) {
-    m_barriersPerStage.try_emplace(stage);
-  }
-  m_barriersPerStage.rehash(32);
-  for (auto const stage : StageFlags) {
-    m_barriersPerStage.at(stage).reserve(16);
-  }
+  m_order.reserve(64);
+  m_regions.reserve(64);
 }
 
 void StagingTransientManager::enqueue(StagingOperation const& op) {
@@ -46,78 +26,109 @@ void StagingTransientManager::enqueue(StagingOperation const& op) {
     LOGE << "WHAT" << std::endl;
   }
   m_stagingOps.push_back(op);
+  m_enqueuedBytes += op.srcBytes;
 }
 
-// TODO possibly handle out of budget gracefully
-void StagingTransientManager::flush() AVK_NO_CFI {
+bool StagingTransientManager::flush() AVK_NO_CFI {
   assert(refreshed);
-  for (auto const& op : m_stagingOps) {
-    VkBuffer stagingBuf = VK_NULL_HANDLE;
-    VmaAllocation stagingAlloc = VK_NULL_HANDLE;
-    int res = m_tmp.bufferManager->createBufferStaging(
-        op.stagingId, op.srcBytes, true, false);
-    if (res)
-      showErrorScreenAndExit(("Couldn't allocate staging buffer for id "));
-    if (!m_tmp.bufferManager->get(op.stagingId, stagingBuf, stagingAlloc))
-      showErrorScreenAndExit(("Couldn't get staging buffer for id "));
-    // copy host data
-    VK_CHECK(vmaCopyMemoryToAllocation(m_tmp.device->vmaAllocator(), op.srcData,
-                                       stagingAlloc, 0, op.srcBytes));
-
-    // host -> transfer barrier (cannot be grouped as it needs to affect
-    // the copy command which comes immediately after)
-    VkBufferMemoryBarrier barrier = {};
-    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
-    barrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;  // host
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;  // don't care
-    barrier.buffer = stagingBuf;
-    barrier.offset = 0;
-    barrier.size = op.srcBytes;  // VK_WHOLE_SIZE equivalent
-
-    m_tmp.device->table()->vkCmdPipelineBarrier(
-        m_tmp.cmd, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-        0, 0, nullptr, 1, &barrier, 0, nullptr);
-    // copy staging -> destination buffer
-    VkBufferCopy copy{};
-    copy.srcOffset = 0;
-    copy.dstOffset = 0;
-    copy.size = op.srcBytes;
-    m_tmp.device->table()->vkCmdCopyBuffer(m_tmp.cmd, stagingBuf, op.dstBuffer,
-                                           1, &copy);
-    // transfer -> destination stage pipeline barrier
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = op.dstAccess;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;  // no ownership tsfr
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;  // no ownership tsfr
-    barrier.buffer = op.dstBuffer;
-    barrier.offset = 0;
-    barrier.size = op.srcBytes;
-    m_barriersPerStage.at(op.dstStage).push_back(barrier);
-
-    // discard staging buffer on next timeline
-    m_tmp.bufferManager->discardById(m_tmp.discardPool, op.stagingId,
-                                     m_tmp.timeline);
+  auto const* const vkDevApi = m_tmp.device->table();
+  VmaAllocator const allocator = m_tmp.device->vmaAllocator();
+  // host visible destinations (SoC, ReBAR) are written in place, the others
+  // are grouped by destination, in enqueue order within each group
+  m_order.clear();
+  m_inPlace.clear();
+  VkDeviceSize totalBytes = 0;
+  for (uint32_t i = 0; i < m_stagingOps.size(); ++i) {
+    StagingOperation const& op = m_stagingOps[i];
+    if (op.dstAlloc != VK_NULL_HANDLE &&
+        vk::isAllocHostVisible(allocator, op.dstAlloc)) {
+      m_inPlace.push_back(i);
+      continue;
+    }
+    m_order.push_back(i);
+    totalBytes += nextMultipleOf<OpAlignment>(op.srcBytes);
   }
-  m_stagingOps.clear();
 
-  for (auto& [stage, barriers] : m_barriersPerStage) {
-    if (barriers.empty()) continue;
-    m_tmp.device->table()->vkCmdPipelineBarrier(
-        m_tmp.cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, stage, 0, 0, nullptr,
-        static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+  // nothing is written nor recorded before the ring space is secured, such
+  // that a failed flush can be retried as is
+  VkDeviceSize ringOffset = 0;
+  if (totalBytes > 0 && !reserve(totalBytes, ringOffset)) {
+    LOGE << PREFIX "Couldn't reserve " << totalBytes
+         << " B of staging ring, operations kept for the next flush"
+         << std::endl;
+    resetTransient();
+    return false;
+  }
 
-    barriers.clear();
+  for (uint32_t const i : m_inPlace) {
+    StagingOperation const& op = m_stagingOps[i];
+    // flushes non coherent memory
+    VK_CHECK(vmaCopyMemoryToAllocation(allocator, op.srcData, op.dstAlloc,
+                                       op.dstOffset, op.srcBytes));
+    // host writes -> destination stages. Submission already makes them
+    // visible, the barrier only states it. Merged by destination stages
+    m_barriers.memoryBarrier(VK_PIPELINE_STAGE_2_HOST_BIT_KHR,
+                             VK_ACCESS_2_HOST_WRITE_BIT_KHR, op.dstStage,
+                             op.dstAccess);
   }
+  std::stable_sort(m_order.begin(), m_order.end(),
+                   [this](uint32_t a, uint32_t b) {
+                     return m_stagingOps[a].dstBuffer <
+                            m_stagingOps[b].dstBuffer;
+                   });
+  // copy host data, one memcpy per operation. Submission makes host writes
+  // visible to the device, hence no host -> transfer barrier
+  VkDeviceSize srcOffset = ringOffset;
+  for (size_t first = 0; first < m_order.size();) {
+    VkBuffer const dstBuffer = m_stagingOps[m_order[first]].dstBuffer;
+    // one barrier per destination, covering all its ranges
+    VkPipelineStageFlags dstStages = 0;
+    VkAccessFlags dstAccess = 0;
+    VkDeviceSize begin = VK_WHOLE_SIZE;
+    VkDeviceSize end = 0;
 
-  // reset everything
-  m_tmp.cmd = VK_NULL_HANDLE;
-  m_tmp.bufferManager = nullptr;
-  m_tmp.device = nullptr;
-  m_tmp.discardPool = nullptr;
-  m_tmp.timeline = -1;
-  refreshed = false;
+    m_regions.clear();
+    size_t last = first;
+    for (; last < m_order.size(); ++last) {
+      StagingOperation const& op = m_stagingOps[m_order[last]];
+      if (op.dstBuffer != dstBuffer) {
+        break;
+      }
+      memcpy(m_ringMapped + srcOffset, op.srcData, op.srcBytes);
+      VkBufferCopy& copy = m_regions.emplace_back();
+      copy.srcOffset = srcOffset;
+      copy.dstOffset = op.dstOffset;
+      copy.size = op.srcBytes;
+      srcOffset += nextMultipleOf<OpAlignment>(op.srcBytes);
+      dstStages |= op.dstStage;
+      dstAccess |= op.dstAccess;
+      begin = std::min(begin, op.dstOffset);
+      end = std::max(end, op.dstOffset + op.srcBytes);
+    }
+    vkDevApi->vkCmdCopyBuffer(m_tmp.cmd, m_ringBuffer, dstBuffer,
+                              static_cast<uint32_t>(m_regions.size()),
+                              m_regions.data());
+    m_barriers.bufferBarrier(dstBuffer, begin, end - begin,
+                             VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR,
+                             VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR, dstStages,
+                             dstAccess);
+    first = last;
+  }
+  if (totalBytes > 0) {
+    // no-op on coherent memory
+    VK_CHECK(vmaFlushAllocation(allocator, m_ringAlloc, ringOffset,
+                                totalBytes));
+    m_pending.push_back(RingSpan{m_tmp.timeline, ringOffset, totalBytes});
+  }
+  m_stagingOps.clear();
+  m_enqueuedBytes = 0;
+
+  // transfer and host writes -> destination stages, for all destinations
+  // at once
+  m_barriers.flush(m_tmp.device, m_tmp.cmd);
+
+  resetTransient();
+  return true;
 }
 
 void StagingTransientManager::refresh(VkCommandBuffer cmd,
@@ -134,4 +145,121 @@ void StagingTransientManager::refresh(VkCommandBuffer cmd,
   refreshed = true;
 }
 
+void StagingTransientManager::resetTransient() {
+  m_tmp.cmd = VK_NULL_HANDLE;
+  m_tmp.bufferManager = nullptr;
+  m_tmp.device = nullptr;
+  m_tmp.discardPool = nullptr;
+  m_tmp.timeline = -1;
+  refreshed = false;
+}
+
+void StagingTransientManager::discardRing(BufferManager* bufferManager,
+                                          vk::DiscardPool* discardPool,
+                                          uint64_t timeline) {
+  if (m_ringBuffer != VK_NULL_HANDLE) {
+    bufferManager->discard(discardPool, m_ring, timeline);
+  }
+  m_ring = {};
+  m_ringBuffer = VK_NULL_HANDLE;
+  m_ringAlloc = VK_NULL_HANDLE;
+  m_ringMapped = nullptr;
+  m_ringBytes = 0;
+  m_head = 0;
+  m_pending.clear();
+}
+
+bool StagingTransientManager::reserve(VkDeviceSize bytes,
+                                      VkDeviceSize& outOffset) {
+  uint64_t const completed = m_tmp.discardPool->queryTime();
+  while (!m_pending.empty() && m_pending.front().timeline <= completed) {
+    m_pending.pop_front();
+  }
+  if (m_pending.empty()) {
+    m_head = 0;
+  }
+  if (m_ringBuffer != VK_NULL_HANDLE) {
+    // head never reaches the tail while spans are pending, such that
+    // head == tail always means empty
+    VkDeviceSize const tail =
+        m_pending.empty() ? 0 : m_pending.front().offset;
+    bool fits = true;
+    if (m_pending.empty() || m_head > tail) {
+      if (m_head + bytes <= m_ringBytes) {
+        outOffset = m_head;
+      } else if (m_pending.empty() || bytes < tail) {
+        outOffset = 0;  // wrap around, the skipped tail bytes free up later
+      } else {
+        fits = false;
+      }
+    } else if (m_head + bytes < tail) {
+      outOffset = m_head;
+    } else {
+      fits = false;
+    }
+    if (fits) {
+      m_head = outOffset + bytes;
+      return true;
+    }
+  }
+
+  // full: replace the ring with a larger one. Pending spans are used by
+  // submissions up to the one signaling the current timeline, hence so is
+  // the old ring. The new one is created first, such that a failed growth
+  // keeps the old ring and its pending spans
+  VkDeviceSize ringBytes = std::max(DefaultRingBytes, m_ringBytes * 2);
+  while (ringBytes < bytes) {
+    ringBytes *= 2;
+  }
+  BufferHandle ring;
+  VkBuffer ringBuffer = VK_NULL_HANDLE;
+  VmaAllocation ringAlloc = VK_NULL_HANDLE;
+  uint8_t* ringMapped = nullptr;
+  if (!createRing(ringBytes, ring, ringBuffer, ringAlloc, ringMapped)) {
+    return false;
+  }
+  if (m_ringBuffer != VK_NULL_HANDLE) {
+    LOGI << PREFIX "Growing ring from " << m_ringBytes << " B to "
+         << ringBytes << " B" << std::endl;
+    discardRing(m_tmp.bufferManager, m_tmp.discardPool, m_tmp.timeline);
+  }
+  m_ring = ring;
+  m_ringBuffer = ringBuffer;
+  m_ringAlloc = ringAlloc;
+  m_ringMapped = ringMapped;
+  m_ringBytes = ringBytes;
+  outOffset = 0;
+  m_head = bytes;
+  return true;
+}
+
+bool StagingTransientManager::createRing(VkDeviceSize bytes,
+                                         BufferHandle& outRing,
+                                         VkBuffer& outBuffer,
+                                         VmaAllocation& outAlloc,
+                                         uint8_t*& outMapped) {
+  BufferManager* const bufferManager = m_tmp.bufferManager;
+  if (int32_t const res = bufferManager->createBufferStaging(
+          BufferManager::NoName, bytes, false, false, &outRing);
+      res != BufferManager::Success) {
+    LOGE << PREFIX "Couldn't allocate ring of " << bytes << " B: " << res
+         << std::endl;
+    return false;
+  }
+  VmaAllocationInfo info{};
+  if (bufferManager->get(outRing, outBuffer, outAlloc)) {
+    vmaGetAllocationInfo(m_tmp.device->vmaAllocator(), outAlloc, &info);
+  }
+  outMapped = static_cast<uint8_t*>(info.pMappedData);
+  if (outMapped == nullptr) {
+    // never used by the device, hence no need to wait for any timeline
+    bufferManager->discard(m_tmp.discardPool, outRing,
+                           m_tmp.discardPool->queryTime());
+    return false;
+  }
+  return true;
+}
+
 }  // namespace avk::experimental
+
+#undef PREFIX
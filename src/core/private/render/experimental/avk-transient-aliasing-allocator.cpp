@@ -0,0 +1,282 @@
+#include "render/experimental/avk-transient-aliasing-allocator.h"
+
+#include "utils/bits.h"
+
+// library
+#include <algorithm>
+#include <cassert>
+
+#define PREFIX "[TransientAliasingAllocator] "
+
+using AttachmentDesc =
+    avk::experimental::TransientAliasingAllocator::AttachmentDesc;
+
+static bool lifetimesOverlap(AttachmentDesc const& a, AttachmentDesc const& b) {
+  return a.firstPass <= b.lastPass && b.firstPass <= a.lastPass;
+}
+
+static VkImageCreateInfo createInfoOf(AttachmentDesc const& desc) {
+  VkImageCreateInfo createInfo{};
+  createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  createInfo.extent = {desc.extent.width, desc.extent.height, 1};
+  createInfo.format = desc.format;
+  createInfo.imageType = VK_IMAGE_TYPE_2D;
+  createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  createInfo.arrayLayers = 1;
+  createInfo.mipLevels = 1;
+  createInfo.usage = desc.usage;
+  createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  createInfo.samples = desc.samples;
+  return createInfo;
+}
+
+// stages and accesses of the first use of an attachment
+static void firstUseOf(AttachmentDesc const& desc,
+                       VkPipelineStageFlags& outStages,
+                       VkAccessFlags& outAccess) {
+  if (desc.aspect &
+      (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT)) {
+    outStages |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                 VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    outAccess = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  } else if (desc.layout == VK_IMAGE_LAYOUT_GENERAL) {
+    // storage image written by compute
+    outStages |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    outAccess = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  } else {
+    outStages |= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    outAccess = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+                VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  }
+}
+
+namespace avk::experimental {
+
+TransientAliasingAllocator::TransientAliasingAllocator(vk::Device* device)
+    : m_deps{device} {
+  assert(m_deps.device && m_deps.device->device());
+}
+
+TransientAliasingAllocator::~TransientAliasingAllocator() noexcept AVK_NO_CFI {
+  destroyImages();
+  if (m_alloc != VK_NULL_HANDLE) {
+    m_deps.device->untagAllocation(m_alloc);
+    vmaFreeMemory(m_deps.device->vmaAllocator(), m_alloc);
+  }
+}
+
+int32_t TransientAliasingAllocator::declare(uint64_t id,
+                                            AttachmentDesc const& desc) {
+  assert(!built() && "declare before build, or reset first");
+  assert(desc.firstPass <= desc.lastPass);
+  auto const [it, inserted] = m_indices.try_emplace(
+      id, static_cast<uint32_t>(m_attachments.size()));
+  if (!inserted) {
+    return Collision;
+  }
+  m_attachments.push_back(Attachment{desc});
+  return Success;
+}
+
+int32_t TransientAliasingAllocator::build() AVK_NO_CFI {
+  assert(!built());
+  auto const* const vkDevApi = m_deps.device->table();
+  VkDevice const dev = m_deps.device->device();
+  VmaAllocator const allocator = m_deps.device->vmaAllocator();
+  if (m_attachments.empty()) {
+    return Success;
+  }
+
+  // images first, to know their memory requirements
+  VkMemoryRequirements requirements{};
+  requirements.memoryTypeBits = ~0u;
+  m_requiredBytes = 0;
+  for (Attachment& attachment : m_attachments) {
+    VkImageCreateInfo const createInfo = createInfoOf(attachment.desc);
+    if (VkResult const res = vkDevApi->vkCreateImage(
+            dev, &createInfo,
+            m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_IMAGE),
+            &attachment.image);
+        res != VK_SUCCESS) {
+      LOGE << PREFIX "Couldn't create attachment image: " << res << std::endl;
+      destroyImages();
+      return VulkanError;
+    }
+    vkDevApi->vkGetImageMemoryRequirements(dev, attachment.image,
+                                           &attachment.requirements);
+    requirements.memoryTypeBits &= attachment.requirements.memoryTypeBits;
+    requirements.alignment =
+        std::max(requirements.alignment, attachment.requirements.alignment);
+    m_requiredBytes += attachment.requirements.size;
+  }
+  if (requirements.memoryTypeBits == 0) {
+    LOGE << PREFIX "Attachments have no memory type in common" << std::endl;
+    destroyImages();
+    return VulkanError;
+  }
+  requirements.size = pack();
+
+  // one block for the whole chain, bound at the packed offsets. No
+  // `VMA_MEMORY_USAGE_AUTO*`, which needs a resource create info
+  VmaAllocationCreateInfo allocInfo{};
+  allocInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT |
+                    VMA_ALLOCATION_CREATE_CAN_ALIAS_BIT;
+  allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  allocInfo.priority = 1.f;
+  if (VkResult const res = vmaAllocateMemory(allocator, &requirements,
+                                             &allocInfo, &m_alloc, nullptr);
+      res != VK_SUCCESS) {
+    LOGE << PREFIX "Couldn't allocate " << requirements.size
+         << " B: " << res << std::endl;
+    m_alloc = VK_NULL_HANDLE;
+    destroyImages();
+    return VulkanError;
+  }
+  for (Attachment const& attachment : m_attachments) {
+    VK_CHECK(vmaBindImageMemory2(allocator, m_alloc, attachment.offset,
+                                 attachment.image, nullptr));
+  }
+  m_allocatedBytes = requirements.size;
+  m_deps.device->tagAllocation(m_alloc,
+                               vk::EAllocationTag::eTransientAttachments,
+                               "aliased attachments");
+  LOGI << PREFIX << m_attachments.size() << " attachments in "
+       << m_allocatedBytes << " B (" << m_requiredBytes
+       << " B without aliasing)" << std::endl;
+  return Success;
+}
+
+VkImage TransientAliasingAllocator::image(uint64_t id) const {
+  auto const it = m_indices.find(id);
+  if (it == m_indices.end()) {
+    return VK_NULL_HANDLE;
+  }
+  return m_attachments[it->second].image;
+}
+
+void TransientAliasingAllocator::recordPassBarriers(
+    VkCommandBuffer cmd, uint32_t passIndex) const AVK_NO_CFI {
+  if (!built()) {
+    return;
+  }
+  // whatever used the memory before (an alias earlier in the frame, or the
+  // previous frame) wrote it as attachment, in a shader or by a transfer
+  // (clear, copy, blit), or read it in a shader
+  VkPipelineStageFlags const srcStages =
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+      VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+  VkPipelineStageFlags dstStages = 0;
+  m_barriers.clear();
+  for (Attachment const& attachment : m_attachments) {
+    if (attachment.desc.firstPass != passIndex) {
+      continue;
+    }
+    VkImageMemoryBarrier& barrier = m_barriers.emplace_back();
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                            VK_ACCESS_SHADER_WRITE_BIT |
+                            VK_ACCESS_TRANSFER_WRITE_BIT;
+    firstUseOf(attachment.desc, dstStages, barrier.dstAccessMask);
+    // contents of an aliased image are undefined anyway
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = attachment.desc.layout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = attachment.image;
+    barrier.subresourceRange.aspectMask = attachment.desc.aspect;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.layerCount = 1;
+  }
+  if (m_barriers.empty()) {
+    return;
+  }
+  auto const* const vkDevApi = m_deps.device->table();
+  vkDevApi->vkCmdPipelineBarrier(
+      cmd, srcStages, dstStages, 0, 0, nullptr, 0, nullptr,
+      static_cast<uint32_t>(m_barriers.size()), m_barriers.data());
+}
+
+void TransientAliasingAllocator::reset(vk::DiscardPool* discardPool,
+                                       uint64_t timeline) {
+  for (Attachment const& attachment : m_attachments) {
+    if (attachment.image != VK_NULL_HANDLE) {
+      discardPool->discardImage(attachment.image, VK_NULL_HANDLE, timeline);
+    }
+  }
+  if (m_alloc != VK_NULL_HANDLE) {
+    discardPool->discardImage(VK_NULL_HANDLE, m_alloc, timeline);
+  }
+  m_attachments.clear();
+  m_indices.clear();
+  m_alloc = VK_NULL_HANDLE;
+  m_allocatedBytes = 0;
+  m_requiredBytes = 0;
+}
+
+VkDeviceSize TransientAliasingAllocator::pack() {
+  std::vector<uint32_t> order(m_attachments.size());
+  for (uint32_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+    return m_attachments[a].requirements.size >
+           m_attachments[b].requirements.size;
+  });
+
+  // first fit: lowest offset clear of the placed attachments whose lifetime
+  // overlaps, which are visited by ascending offset
+  std::vector<uint32_t> placed;
+  std::vector<uint32_t> overlapping;
+  VkDeviceSize end = 0;
+  for (uint32_t const index : order) {
+    Attachment& attachment = m_attachments[index];
+    overlapping.clear();
+    for (uint32_t const other : placed) {
+      if (lifetimesOverlap(attachment.desc, m_attachments[other].desc)) {
+        overlapping.push_back(other);
+      }
+    }
+    std::sort(overlapping.begin(), overlapping.end(),
+              [this](uint32_t a, uint32_t b) {
+                return m_attachments[a].offset < m_attachments[b].offset;
+              });
+    VkDeviceSize const size = attachment.requirements.size;
+    VkDeviceSize const alignment = attachment.requirements.alignment;
+    VkDeviceSize offset = 0;
+    for (uint32_t const other : overlapping) {
+      Attachment const& occupied = m_attachments[other];
+      if (offset + size <= occupied.offset) {
+        break;
+      }
+      offset = std::max(
+          offset, nextMultipleOf(occupied.offset + occupied.requirements.size,
+                                 alignment));
+    }
+    attachment.offset = offset;
+    end = std::max(end, offset + size);
+    placed.push_back(index);
+  }
+  return end;
+}
+
+void TransientAliasingAllocator::destroyImages() AVK_NO_CFI {
+  auto const* const vkDevApi = m_deps.device->table();
+  VkDevice const dev = m_deps.device->device();
+  for (Attachment& attachment : m_attachments) {
+    if (attachment.image != VK_NULL_HANDLE) {
+      vkDevApi->vkDestroyImage(
+          dev, attachment.image,
+          m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_IMAGE));
+      attachment.image = VK_NULL_HANDLE;
+    }
+  }
+}
+
+}  // namespace avk::experimental
+
+#undef PREFIX
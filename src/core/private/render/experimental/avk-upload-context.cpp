@@ -0,0 +1,293 @@
+#include "render/experimental/avk-upload-context.h"
+
+#include "utils/bits.h"
+
+// library
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#define PREFIX "[UploadContext] "
+
+namespace avk::experimental {
+
+UploadContext::UploadContext(vk::Device* device,
+                             VkDeviceSize ringBytes) AVK_NO_CFI
+    : m_deps{device} {
+  assert(m_deps.device && m_deps.device->device());
+  auto const* const vkDevApi = m_deps.device->table();
+  VkDevice const dev = m_deps.device->device();
+  if (m_deps.device->transferQueue() == VK_NULL_HANDLE) {
+    LOGW << PREFIX "No dedicated transfer queue" << std::endl;
+    return;
+  }
+  VkPhysicalDeviceLimits const& limits = m_deps.device->limits();
+  m_alignment = std::max<VkDeviceSize>(limits.nonCoherentAtomSize, 16);
+  m_ringBytes = nextMultipleOf(ringBytes, m_alignment);
+
+  VkBufferCreateInfo createInfo{};
+  createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  createInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+  createInfo.size = m_ringBytes;
+  createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  // same placement of `BufferManager::createBufferStaging`
+  VmaAllocationCreateInfo allocInfo{};
+  allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+  allocInfo.priority = 1.f;
+  allocInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+  allocInfo.preferredFlags = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                    VMA_ALLOCATION_CREATE_MAPPED_BIT;
+  VmaAllocationInfo info{};
+  VK_CHECK(m_deps.device->createPooledBuffer(vk::EMemoryClass::eStaging,
+                                             createInfo, allocInfo, m_buffer,
+                                             m_alloc, &info));
+  m_mapped = reinterpret_cast<uint8_t*>(info.pMappedData);
+  AVK_EXT_CHECK(m_mapped);
+  m_deps.device->tagAllocation(m_alloc, vk::EAllocationTag::eUploads,
+                               "upload ring");
+
+  VkSemaphoreTypeCreateInfoKHR semType{};
+  semType.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+  semType.initialValue = 0;
+  semType.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+  VkSemaphoreCreateInfo semCreateInfo{};
+  semCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  semCreateInfo.pNext = &semType;
+  VK_CHECK(vkDevApi->vkCreateSemaphore(
+      dev, &semCreateInfo,
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_SEMAPHORE),
+      &m_semaphore));
+
+  VkCommandPoolCreateInfo poolCreateInfo{};
+  poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+                         VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  poolCreateInfo.queueFamilyIndex = m_deps.device->transferQueueFamilyIndex();
+  VK_CHECK(vkDevApi->vkCreateCommandPool(
+      dev, &poolCreateInfo,
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_COMMAND_POOL),
+      &m_commandPool));
+
+  LOGI << PREFIX "Ring of " << m_ringBytes << " B on transfer family "
+       << m_deps.device->transferQueueFamilyIndex() << std::endl;
+}
+
+UploadContext::~UploadContext() noexcept AVK_NO_CFI {
+  if (m_commandPool == VK_NULL_HANDLE) {
+    return;
+  }
+  auto const* const vkDevApi = m_deps.device->table();
+  VkDevice const dev = m_deps.device->device();
+  if (m_submittedValue > 0) {
+    VkSemaphoreWaitInfoKHR waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_semaphore;
+    waitInfo.pValues = &m_submittedValue;
+    VK_CHECK(vkDevApi->vkWaitSemaphoresKHR(dev, &waitInfo, UINT64_MAX));
+  }
+  if (!m_submittedAcquires.empty() || !m_recordedAcquires.empty()) {
+    LOGW << PREFIX "Destroyed with uploads not acquired" << std::endl;
+  }
+  // frees its command buffers
+  vkDevApi->vkDestroyCommandPool(
+      dev, m_commandPool,
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_COMMAND_POOL));
+  vkDevApi->vkDestroySemaphore(
+      dev, m_semaphore,
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_SEMAPHORE));
+  m_deps.device->untagAllocation(m_alloc);
+  vmaDestroyBuffer(m_deps.device->vmaAllocator(), m_buffer, m_alloc);
+}
+
+int32_t UploadContext::uploadBuffer(VkBuffer dst, VkDeviceSize dstOffset,
+                                    void const* data, VkDeviceSize bytes,
+                                    VkPipelineStageFlags dstStage,
+                                    VkAccessFlags dstAccess) AVK_NO_CFI {
+  assert(*this && dst != VK_NULL_HANDLE);
+  if (bytes == 0) {
+    return Success;
+  }
+  retireCompleted();
+  if (m_cmd == VK_NULL_HANDLE) {
+    m_cmd = beginCommands();
+    if (m_cmd == VK_NULL_HANDLE) {
+      return VulkanError;
+    }
+  }
+  VkDeviceSize ringOffset = 0;
+  if (!reserve(bytes, ringOffset)) {
+    return RingFull;
+  }
+  memcpy(m_mapped + ringOffset, data, bytes);
+  // no-op on coherent memory, otherwise rounded to `nonCoherentAtomSize`
+  VK_CHECK(vmaFlushAllocation(m_deps.device->vmaAllocator(), m_alloc,
+                              ringOffset, bytes));
+  // freed once the next `submit` completed
+  m_pending.push_back(RingSpan{m_submittedValue + 1, ringOffset,
+                               nextMultipleOf(bytes, m_alignment)});
+
+  VkBufferCopy region{};
+  region.srcOffset = ringOffset;
+  region.dstOffset = dstOffset;
+  region.size = bytes;
+  m_deps.device->table()->vkCmdCopyBuffer(m_cmd, m_buffer, dst, 1, &region);
+
+  // release and acquire must describe the same range and families
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcQueueFamilyIndex = m_deps.device->transferQueueFamilyIndex();
+  barrier.dstQueueFamilyIndex =
+      m_deps.device->universalGraphicsQueueFamilyIndex();
+  barrier.buffer = dst;
+  barrier.offset = dstOffset;
+  barrier.size = bytes;
+  // destination access of a release is ignored
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  m_releases.push_back(barrier);
+  // source access of an acquire is ignored
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = dstAccess;
+  m_recordedAcquires.push_back(Acquire{barrier, dstStage});
+  return Success;
+}
+
+uint64_t UploadContext::submit() AVK_NO_CFI {
+  assert(*this);
+  if (m_cmd == VK_NULL_HANDLE) {
+    return 0;
+  }
+  auto const* const vkDevApi = m_deps.device->table();
+  // all releases in one batch, the semaphore signal waits for them
+  vkDevApi->vkCmdPipelineBarrier(
+      m_cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+      static_cast<uint32_t>(m_releases.size()), m_releases.data(), 0, nullptr);
+  VK_CHECK(vkDevApi->vkEndCommandBuffer(m_cmd));
+
+  uint64_t const signalValue = m_submittedValue + 1;
+  VkTimelineSemaphoreSubmitInfoKHR timelineInfo{};
+  timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+  timelineInfo.signalSemaphoreValueCount = 1;
+  timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.pNext = &timelineInfo;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &m_cmd;
+  submitInfo.signalSemaphoreCount = 1;
+  submitInfo.pSignalSemaphores = &m_semaphore;
+  VK_CHECK(vkDevApi->vkQueueSubmit(m_deps.device->transferQueue(), 1,
+                                   &submitInfo, VK_NULL_HANDLE));
+
+  m_submittedValue = signalValue;
+  m_inFlight.push_back(InFlightCommands{signalValue, m_cmd});
+  m_cmd = VK_NULL_HANDLE;
+  m_releases.clear();
+  m_submittedAcquires.insert(m_submittedAcquires.end(),
+                             m_recordedAcquires.begin(),
+                             m_recordedAcquires.end());
+  m_recordedAcquires.clear();
+  return signalValue;
+}
+
+uint64_t UploadContext::recordAcquireBarriers(
+    VkCommandBuffer cmd, VkPipelineStageFlags& outWaitStages) AVK_NO_CFI {
+  outWaitStages = 0;
+  if (m_submittedAcquires.empty()) {
+    return 0;
+  }
+  m_barriers.clear();
+  m_barriers.reserve(m_submittedAcquires.size());
+  for (Acquire const& acquire : m_submittedAcquires) {
+    m_barriers.push_back(acquire.barrier);
+    outWaitStages |= acquire.dstStage;
+  }
+  m_submittedAcquires.clear();
+  // the source stages are the wait stages, such that the acquire is chained
+  // after the semaphore wait
+  m_deps.device->table()->vkCmdPipelineBarrier(
+      cmd, outWaitStages, outWaitStages, 0, 0, nullptr,
+      static_cast<uint32_t>(m_barriers.size()), m_barriers.data(), 0, nullptr);
+  return m_submittedValue;
+}
+
+void UploadContext::retireCompleted() AVK_NO_CFI {
+  if (m_pending.empty() && m_inFlight.empty()) {
+    m_head = 0;
+    return;
+  }
+  uint64_t completedValue = 0;
+  VK_CHECK(m_deps.device->table()->vkGetSemaphoreCounterValueKHR(
+      m_deps.device->device(), m_semaphore, &completedValue));
+  while (!m_pending.empty() && m_pending.front().value <= completedValue) {
+    m_pending.pop_front();
+  }
+  if (m_pending.empty()) {
+    m_head = 0;
+  }
+  while (!m_inFlight.empty() && m_inFlight.front().value <= completedValue) {
+    m_freeCommands.push_back(m_inFlight.front().cmd);
+    m_inFlight.pop_front();
+  }
+}
+
+bool UploadContext::reserve(VkDeviceSize bytes, VkDeviceSize& outOffset) {
+  VkDeviceSize const size = nextMultipleOf(bytes, m_alignment);
+  if (size > m_ringBytes) {
+    return false;
+  }
+  // head never reaches the tail while spans are pending, such that
+  // head == tail always means empty
+  VkDeviceSize const tail = m_pending.empty() ? 0 : m_pending.front().offset;
+  if (m_pending.empty() || m_head > tail) {
+    if (m_head + size <= m_ringBytes) {
+      outOffset = m_head;
+    } else if (m_pending.empty() || size < tail) {
+      outOffset = 0;  // wrap around, the skipped tail bytes free up later
+    } else {
+      return false;
+    }
+  } else if (m_head + size < tail) {
+    outOffset = m_head;
+  } else {
+    return false;
+  }
+  m_head = outOffset + size;
+  return true;
+}
+
+VkCommandBuffer UploadContext::beginCommands() AVK_NO_CFI {
+  auto const* const vkDevApi = m_deps.device->table();
+  VkCommandBuffer cmd = VK_NULL_HANDLE;
+  if (!m_freeCommands.empty()) {
+    cmd = m_freeCommands.back();
+    m_freeCommands.pop_back();
+  } else {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = m_commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    if (VkResult const res = vkDevApi->vkAllocateCommandBuffers(
+            m_deps.device->device(), &allocInfo, &cmd);
+        res != VK_SUCCESS) {
+      LOGE << PREFIX "Couldn't allocate command buffer: " << res
+           << std::endl;
+      return VK_NULL_HANDLE;
+    }
+  }
+  // implicitly reset, as the pool allows resetting command buffers
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  VK_CHECK(vkDevApi->vkBeginCommandBuffer(cmd, &beginInfo));
+  return cmd;
+}
+
+}  // namespace avk::experimental
+
+#undef PREFIX
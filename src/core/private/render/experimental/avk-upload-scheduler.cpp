@@ -0,0 +1,139 @@
+#include "render/experimental/avk-upload-scheduler.h"
+
+// std
+#include <algorithm>
+#include <cassert>
+
+// partial chunks keep the source and destination offsets aligned
+static VkDeviceSize constexpr ChunkAlignment = 16;
+
+namespace avk::experimental {
+
+UploadScheduler::UploadScheduler(VkDeviceSize frameBudget)
+    : m_frameBudget(frameBudget) {
+  // some good enough capacity
+  m_queued.reserve(64);
+}
+
+UploadScheduler::Ticket UploadScheduler::schedule(Request request) {
+  assert(request.op.dstBuffer != VK_NULL_HANDLE && request.op.srcData);
+  Ticket const ticket = m_nextTicket++;
+  m_queuedBytes += request.op.srcBytes;
+  m_queued.push_back(Queued{ticket, std::move(request), 0, false});
+  return ticket;
+}
+
+bool UploadScheduler::cancel(Ticket ticket) {
+  auto const it = std::find_if(
+      m_queued.begin(), m_queued.end(),
+      [ticket](Queued const& queued) { return queued.ticket == ticket; });
+  if (it == m_queued.end()) {
+    return false;
+  }
+  m_queuedBytes -= it->request.op.srcBytes - it->doneBytes;
+  m_queued.erase(it);
+  return true;
+}
+
+VkDeviceSize UploadScheduler::enqueueFrame(StagingTransientManager& staging,
+                                           uint64_t timeline,
+                                           UploadContext* uploadContext) {
+  if (m_queued.empty()) {
+    return 0;
+  }
+  for (Queued& queued : m_queued) {
+    queued.overdue = queued.request.deadline <= timeline;
+  }
+  std::sort(m_queued.begin(), m_queued.end(),
+            [](Queued const& a, Queued const& b) {
+              if (a.overdue != b.overdue) {
+                return a.overdue;
+              }
+              if (a.request.priority != b.request.priority) {
+                return a.request.priority > b.request.priority;
+              }
+              if (a.request.deadline != b.request.deadline) {
+                return a.request.deadline < b.request.deadline;
+              }
+              return a.ticket < b.ticket;
+            });
+
+  VkDeviceSize enqueued = 0;
+  // large requests not started yet go whole to the transfer queue, acquired
+  // by the submission signaling `timeline`
+  if (uploadContext && *uploadContext) {
+    for (Queued& queued : m_queued) {
+      StagingOperation const& op = queued.request.op;
+      if (queued.doneBytes > 0 || op.srcBytes == 0 ||
+          op.srcBytes < m_transferThreshold) {
+        continue;
+      }
+      if (uploadContext->uploadBuffer(op.dstBuffer, op.dstOffset, op.srcData,
+                                      op.srcBytes, op.dstStage,
+                                      op.dstAccess) != UploadContext::Success) {
+        // ring full, staged by the loop below
+        continue;
+      }
+      queued.doneBytes = op.srcBytes;
+      enqueued += op.srcBytes;
+      m_inFlight.push_back(InFlight{queued.ticket, timeline,
+                                    std::move(queued.request.onComplete)});
+    }
+    // queued requests were never complete before, hence these are the
+    // transferred ones
+    auto const transferred = std::remove_if(
+        m_queued.begin(), m_queued.end(), [](Queued const& queued) {
+          return queued.doneBytes != 0 &&
+                 queued.doneBytes == queued.request.op.srcBytes;
+        });
+    m_queued.erase(transferred, m_queued.end());
+  }
+
+  // direct enqueues of this frame count against the budget
+  VkDeviceSize const used = staging.enqueuedBytes();
+  VkDeviceSize budget = used < m_frameBudget ? m_frameBudget - used : 0;
+  size_t doneCount = 0;
+  for (Queued& queued : m_queued) {
+    StagingOperation const& op = queued.request.op;
+    VkDeviceSize const remaining = op.srcBytes - queued.doneBytes;
+    VkDeviceSize chunk = remaining;
+    if (!queued.overdue && chunk > budget) {
+      chunk = budget - budget % ChunkAlignment;
+      if (chunk == 0) {
+        break;
+      }
+    }
+    StagingOperation part = op;
+    part.srcData = static_cast<uint8_t const*>(op.srcData) + queued.doneBytes;
+    part.srcBytes = chunk;
+    part.dstOffset = op.dstOffset + queued.doneBytes;
+    staging.enqueue(part);
+    queued.doneBytes += chunk;
+    enqueued += chunk;
+    budget -= std::min(budget, chunk);
+    if (queued.doneBytes < op.srcBytes) {
+      // budget exhausted by a partial chunk
+      break;
+    }
+    m_inFlight.push_back(InFlight{queued.ticket, timeline,
+                                  std::move(queued.request.onComplete)});
+    ++doneCount;
+  }
+  // fully enqueued requests are a prefix, as the loop stops at the first
+  // request which doesn't fit
+  m_queued.erase(m_queued.begin(), m_queued.begin() + doneCount);
+  m_queuedBytes -= enqueued;
+  return enqueued;
+}
+
+void UploadScheduler::poll(uint64_t completedValue) {
+  while (!m_inFlight.empty() && m_inFlight.front().value <= completedValue) {
+    InFlight const inFlight = std::move(m_inFlight.front());
+    m_inFlight.pop_front();
+    if (inFlight.onComplete) {
+      inFlight.onComplete(inFlight.ticket, inFlight.value);
+    }
+  }
+}
+
+}  // namespace avk::experimental
@@ -44,14 +44,16 @@ VkCommandPool CommandPools::createCommandPool(
     [[maybe_unused]] ThreadPools* tp) const AVK_NO_CFI {
   auto const* const vkDevApi = m_deps.device->table();
   VkDevice const dev = m_deps.device->device();
+  VkAllocationCallbacks const* const allocator =
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_COMMAND_POOL);
   VkCommandPoolCreateInfo createInfo{};
   createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
   createInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
   createInfo.queueFamilyIndex = m_deps.queueFamilyIndex;
 
   VkCommandPool commandPool = VK_NULL_HANDLE;
-  VK_CHECK(
-      vkDevApi->vkCreateCommandPool(dev, &createInfo, nullptr, &commandPool));
+  VK_CHECK(vkDevApi->vkCreateCommandPool(dev, &createInfo, allocator,
+                                         &commandPool));
 
 #ifndef AVK_NO_COMMAND_BUFFER_CACHING
   auto [it, wasInserted] = tp->m_cmdCache.try_emplace(commandPool);
@@ -71,6 +73,8 @@ CommandPools::CommandPools(Device* device, uint32_t queueFamilyIndex)
 CommandPools::~CommandPools() AVK_NO_CFI {
   auto const* const vkDevApi = m_deps.device->table();
   VkDevice const dev = m_deps.device->device();
+  VkAllocationCallbacks const* const allocator =
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_COMMAND_POOL);
 
   // destroy all pools from registry: drain both active and queued recycled
   // pools
@@ -82,9 +86,9 @@ CommandPools::~CommandPools() AVK_NO_CFI {
     std::vector<VkCommandPool> drained;
     tp->recycled.drainTo(drained);
     for (VkCommandPool p : drained)
-      vkDevApi->vkDestroyCommandPool(dev, p, nullptr);
+      vkDevApi->vkDestroyCommandPool(dev, p, allocator);
     if (tp->active != VK_NULL_HANDLE) {
-      vkDevApi->vkDestroyCommandPool(dev, tp->active, nullptr);
+      vkDevApi->vkDestroyCommandPool(dev, tp->active, allocator);
     }
   }
   m_registry.clear();
@@ -139,15 +143,17 @@ void CommandPools::recycle(VkCommandPool pool,
   ThreadPools* tp = threadPoolsForOwner(owner);
   auto const* const vkDevApi = m_deps.device->table();
   VkDevice const dev = m_deps.device->device();
+  VkAllocationCallbacks const* const allocator =
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_COMMAND_POOL);
 
   if (!tp) {  // if owner destroyed its storage, just nuke this
-    vkDevApi->vkDestroyCommandPool(dev, pool, nullptr);
+    vkDevApi->vkDestroyCommandPool(dev, pool, allocator);
   } else {
     // try to push. If full, nuke it
     bool ok = tp->recycled.tryPush(pool);
     if (!ok) {
       // TODO warning log
-      vkDevApi->vkDestroyCommandPool(dev, pool, nullptr);
+      vkDevApi->vkDestroyCommandPool(dev, pool, allocator);
     }
   }
 }
@@ -168,6 +174,8 @@ void CommandPools::discardActivePool(DiscardPool* discardPool, uint64_t value) {
 void CommandPools::threadShutdown() {
   auto const* const vkDevApi = m_deps.device->table();
   VkDevice const dev = m_deps.device->device();
+  VkAllocationCallbacks const* const allocator =
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_COMMAND_POOL);
 
   std::unique_ptr<ThreadPools> tp = nullptr;
   {
@@ -183,10 +191,10 @@ void CommandPools::threadShutdown() {
   std::vector<VkCommandPool> drained;
   tp->recycled.drainTo(drained);
   for (auto p : drained) {
-    vkDevApi->vkDestroyCommandPool(dev, p, nullptr);
+    vkDevApi->vkDestroyCommandPool(dev, p, allocator);
   }
   if (tp->active != VK_NULL_HANDLE) {
-    vkDevApi->vkDestroyCommandPool(dev, tp->active, nullptr);
+    vkDevApi->vkDestroyCommandPool(dev, tp->active, allocator);
     tp->active = VK_NULL_HANDLE;
   }
 }
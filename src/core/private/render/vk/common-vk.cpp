@@ -93,7 +93,8 @@ Expected<VkBuffer> newUnboundStagingBufferHandle(Device *device,
   createInfo.size = nextMultipleOf<16>(size);
   VkBuffer buffer = VK_NULL_HANDLE;
   VkResult const res = device->table()->vkCreateBuffer(
-      device->device(), &createInfo, nullptr, &buffer);
+      device->device(), &createInfo,
+      device->allocationCallbacks(VK_OBJECT_TYPE_BUFFER), &buffer);
   return {buffer, res};
 }
 
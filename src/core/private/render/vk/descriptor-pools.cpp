@@ -33,11 +33,15 @@ DescriptorPools::~DescriptorPools() AVK_NO_CFI {
   auto const* const vkDevApi = m_deps.device->table();
   VkDevice const dev = m_deps.device->device();
   for (VkDescriptorPool pool : m_recycledPools) {
-    vkDevApi->vkDestroyDescriptorPool(dev, pool, nullptr);
+    vkDevApi->vkDestroyDescriptorPool(
+        dev, pool,
+        m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_POOL));
   }
   m_recycledPools.clear();
   if (m_activePool != VK_NULL_HANDLE) {
-    vkDevApi->vkDestroyDescriptorPool(dev, m_activePool, nullptr);
+    vkDevApi->vkDestroyDescriptorPool(
+        dev, m_activePool,
+        m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_POOL));
     m_activePool = VK_NULL_HANDLE;
   }
 }
@@ -121,8 +125,10 @@ void DescriptorPools::ensureActivePool() AVK_NO_CFI {
   createInfo.maxSets = MAX_DESCRIPTOR_SETS;
   createInfo.poolSizeCount = POOL_SIZES;
   createInfo.pPoolSizes = poolSizes;
-  VK_CHECK(vkDevApi->vkCreateDescriptorPool(dev, &createInfo, nullptr,
-                                            &m_activePool));
+  VK_CHECK(vkDevApi->vkCreateDescriptorPool(
+      dev, &createInfo,
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_POOL),
+      &m_activePool));
 }
 
 }  // namespace avk::vk
\ No newline at end of file
@@ -13,6 +13,7 @@
 #include <algorithm>
 #include <cassert>
 #include <memory>
+#include <sstream>
 #include <unordered_set>
 #include <vector>
 
@@ -45,6 +46,14 @@ struct OptionalFeatures {
 
   bool swapchainMaintenance1;
   bool memoryBudget;
+  bool dynamicRendering;
+  bool extendedDynamicState;
+  bool extendedDynamicState2;
+  bool extendedDynamicState3PolygonMode;
+  bool shaderObject;
+  bool pipelineCreationFeedback;
+  bool sparseResidencyBuffer;
+  bool synchronization2;
 
   bool isSoC;
 };
@@ -169,21 +178,55 @@ static void setOptionalFeaturesForDevice(
     VkPhysicalDevice dev, OptionalFeatures &outOptFeatures) AVK_NO_CFI {
   VkPhysicalDeviceFeatures2 features{};
   VkPhysicalDeviceSwapchainMaintenance1FeaturesEXT swapMain1Feat{};
+  VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeat{};
+  VkPhysicalDeviceExtendedDynamicStateFeaturesEXT eds1Feat{};
+  VkPhysicalDeviceExtendedDynamicState2FeaturesEXT eds2Feat{};
+  VkPhysicalDeviceExtendedDynamicState3FeaturesEXT eds3Feat{};
+  VkPhysicalDeviceShaderObjectFeaturesEXT shaderObjectFeat{};
+  VkPhysicalDeviceSynchronization2FeaturesKHR sync2Feat{};
 
   features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
   swapMain1Feat.sType =
       VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SWAPCHAIN_MAINTENANCE_1_FEATURES_EXT;
+  dynamicRenderingFeat.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+  eds1Feat.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+  eds2Feat.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT;
+  eds3Feat.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+  shaderObjectFeat.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT;
+  sync2Feat.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
 
   features.pNext = &swapMain1Feat;
+  swapMain1Feat.pNext = &dynamicRenderingFeat;
+  dynamicRenderingFeat.pNext = &eds1Feat;
+  eds1Feat.pNext = &eds2Feat;
+  eds2Feat.pNext = &eds3Feat;
+  eds3Feat.pNext = &shaderObjectFeat;
+  shaderObjectFeat.pNext = &sync2Feat;
 
   vkGetPhysicalDeviceFeatures2(dev, &features);
 
   outOptFeatures.swapchainMaintenance1 = swapMain1Feat.swapchainMaintenance1;
+  outOptFeatures.dynamicRendering = dynamicRenderingFeat.dynamicRendering;
+  outOptFeatures.extendedDynamicState = eds1Feat.extendedDynamicState;
+  outOptFeatures.extendedDynamicState2 = eds2Feat.extendedDynamicState2;
+  outOptFeatures.extendedDynamicState3PolygonMode =
+      eds3Feat.extendedDynamicState3PolygonMode;
+  outOptFeatures.shaderObject = shaderObjectFeat.shaderObject;
+  outOptFeatures.synchronization2 = sync2Feat.synchronization2;
   outOptFeatures.textureCompressionASTC_LDR =
       features.features.textureCompressionASTC_LDR;
   outOptFeatures.textureCompressionBC = features.features.textureCompressionBC;
   outOptFeatures.textureCompressionETC2 =
       features.features.textureCompressionETC2;
+  outOptFeatures.sparseResidencyBuffer =
+      features.features.sparseBinding &&
+      features.features.sparseResidencyBuffer;
 }
 
 // buffers there too can be beneficial
@@ -424,6 +467,68 @@ static void setCompressedFormats(
          << std::endl;
   }
 
+  // VK_KHR_dynamic_rendering (core in 1.3) removes VkRenderPass and
+  // VkFramebuffer from graphics pipelines and command recording. Depends on
+  // VK_KHR_depth_stencil_resolve (which depends on create_renderpass2)
+  if (outOptFeatures.dynamicRendering) {
+    if (outExtensions.isSupported(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) &&
+        outExtensions.isSupported(
+            VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME)) {
+      outExtensions.enable(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME);
+      outExtensions.enable(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+      LOGI << "[Device::choosePhysicalDevice] VK_KHR_dynamic_rendering "
+              "supported, render passes and framebuffers are optional"
+           << std::endl;
+    } else {
+      outOptFeatures.dynamicRendering = false;
+    }
+  }
+
+  // VK_EXT_extended_dynamic_state{,2,3} move pipeline options (cull mode,
+  // front face, depth write, stencil, depth bias, polygon mode) to command
+  // buffer state, hence out of the pipeline key
+  if (outOptFeatures.extendedDynamicState) {
+    outOptFeatures.extendedDynamicState = outExtensions.enable(
+        VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+  }
+  if (outOptFeatures.extendedDynamicState2) {
+    outOptFeatures.extendedDynamicState2 = outExtensions.enable(
+        VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME);
+  }
+  if (outOptFeatures.extendedDynamicState3PolygonMode) {
+    outOptFeatures.extendedDynamicState3PolygonMode = outExtensions.enable(
+        VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+  }
+  LOGI << "[Device::choosePhysicalDevice] Extended Dynamic State: EDS1 "
+       << outOptFeatures.extendedDynamicState << " EDS2 "
+       << outOptFeatures.extendedDynamicState2 << " EDS3 (polygon mode) "
+       << outOptFeatures.extendedDynamicState3PolygonMode << std::endl;
+
+  // VK_EXT_shader_object replaces graphics pipelines with per stage
+  // VkShaderEXT objects and fully dynamic state. Depends on
+  // VK_KHR_dynamic_rendering
+  if (outOptFeatures.shaderObject) {
+    outOptFeatures.shaderObject =
+        outOptFeatures.dynamicRendering &&
+        outExtensions.enable(VK_EXT_SHADER_OBJECT_EXTENSION_NAME);
+  }
+  LOGI << "[Device::choosePhysicalDevice] Shader Object: "
+       << outOptFeatures.shaderObject << std::endl;
+
+  // VK_EXT_pipeline_creation_feedback (core in 1.3) reports per pipeline and
+  // per stage compile durations and pipeline cache hits. No feature struct
+  outOptFeatures.pipelineCreationFeedback =
+      outExtensions.enable(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+
+  // VK_KHR_synchronization2 (core in 1.3) puts stages and accesses in each
+  // barrier, hence any batch of barriers is a single `vkCmdPipelineBarrier2`
+  if (outOptFeatures.synchronization2) {
+    outOptFeatures.synchronization2 =
+        outExtensions.enable(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+  }
+  LOGI << "[Device::choosePhysicalDevice] Synchronization2: "
+       << outOptFeatures.synchronization2 << std::endl;
+
   LOGI << "[Device::choosePhysicalDevice] Physical Device " << std::hex
        << chosen << std::dec << " chosen" << std::endl;
   return chosen;
@@ -454,8 +559,24 @@ static bool getPresentationSupport(
 #endif
 }
 
-/// For now, support finding only the one queue family and queue which supports
-/// presentation
+/// first family with all the `required` flags and none of the `excluded` ones,
+/// `VK_QUEUE_FAMILY_IGNORED` if there's none
+static uint32_t findDedicatedQueueFamily(
+    std::vector<VkQueueFamilyProperties2> const &queueProperties,
+    VkQueueFlags required, VkQueueFlags excluded) {
+  for (uint32_t index = 0; index < queueProperties.size(); ++index) {
+    VkQueueFamilyProperties const &props =
+        queueProperties[index].queueFamilyProperties;
+    if (props.queueCount > 0 && (props.queueFlags & required) == required &&
+        !(props.queueFlags & excluded)) {
+      return index;
+    }
+  }
+  return VK_QUEUE_FAMILY_IGNORED;
+}
+
+/// One queue of the queue family which supports presentation, plus one of the
+/// dedicated transfer family and of the async compute family, if any
 /// Note: Queue Priorities on each element still to populate
 static std::vector<VkDeviceQueueCreateInfo> newDeviceQueuesCreateInfos(
     VkInstance instance, VkPhysicalDevice physicalDevice,
@@ -494,15 +615,52 @@ static std::vector<VkDeviceQueueCreateInfo> newDeviceQueuesCreateInfos(
   AVK_EXT_CHECK(familyIndex < queueProperties.size());
 
   createInfo.queueFamilyIndex = familyIndex;
+
+#ifndef AVK_NO_TRANSFER_QUEUE
+  // transfer queues of graphics or compute families don't run concurrently
+  // with rendering, hence are no better than the universal queue
+  outQueueFamilies.transfer =
+      findDedicatedQueueFamily(queueProperties, VK_QUEUE_TRANSFER_BIT,
+                               VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+  if (outQueueFamilies.transfer != VK_QUEUE_FAMILY_IGNORED) {
+    VkDeviceQueueCreateInfo &transferInfo = queueCreateInfos.emplace_back();
+    transferInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    transferInfo.queueCount = 1;
+    transferInfo.queueFamilyIndex = outQueueFamilies.transfer;
+  }
+#endif
+#ifndef AVK_NO_ASYNC_COMPUTE
+  outQueueFamilies.asyncCompute = findDedicatedQueueFamily(
+      queueProperties, VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT);
+  if (outQueueFamilies.asyncCompute != VK_QUEUE_FAMILY_IGNORED) {
+    VkDeviceQueueCreateInfo &computeInfo = queueCreateInfos.emplace_back();
+    computeInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    computeInfo.queueCount = 1;
+    computeInfo.queueFamilyIndex = outQueueFamilies.asyncCompute;
+  }
+#endif
   return queueCreateInfos;
 }
 
+static bool queueFamilySupportsSparseBinding(VkPhysicalDevice physicalDevice,
+                                             uint32_t index) AVK_NO_CFI {
+  uint32_t count = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &count, nullptr);
+  std::vector<VkQueueFamilyProperties> queueProperties{count};
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &count,
+                                           queueProperties.data());
+  return index < count &&
+         (queueProperties[index].queueFlags & VK_QUEUE_SPARSE_BINDING_BIT);
+}
+
 static VkDevice createDevice(VkInstance instance,
                              VkPhysicalDevice physicalDevice,
                              Extensions const &extensions,
                              OptionalFeatures const &optFeatures,
                              Surface const *surface,
-                             utils::QueueFamilyMap &queueFamilies) AVK_NO_CFI {
+                             utils::QueueFamilyMap &queueFamilies,
+                             VkAllocationCallbacks const *allocator)
+    AVK_NO_CFI {
   // enable all the necessary features
   VkPhysicalDeviceFeatures2KHR features{};
   VkPhysicalDeviceVulkanMemoryModelFeaturesKHR vulkanMemoryModel{};
@@ -512,6 +670,12 @@ static VkDevice createDevice(VkInstance instance,
   VkPhysicalDeviceInlineUniformBlockFeaturesEXT inlineUniformFeat{};
   VkPhysicalDeviceShaderDrawParametersFeatures shaderDrawFeat{};
   VkPhysicalDeviceSwapchainMaintenance1FeaturesEXT swapchainMaintenance1Feat{};
+  VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeat{};
+  VkPhysicalDeviceExtendedDynamicStateFeaturesEXT eds1Feat{};
+  VkPhysicalDeviceExtendedDynamicState2FeaturesEXT eds2Feat{};
+  VkPhysicalDeviceExtendedDynamicState3FeaturesEXT eds3Feat{};
+  VkPhysicalDeviceShaderObjectFeaturesEXT shaderObjectFeat{};
+  VkPhysicalDeviceSynchronization2FeaturesKHR sync2Feat{};
 
   features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
   vulkanMemoryModel.sType =
@@ -528,6 +692,18 @@ static VkDevice createDevice(VkInstance instance,
       VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_DRAW_PARAMETERS_FEATURES;
   swapchainMaintenance1Feat.sType =
       VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SWAPCHAIN_MAINTENANCE_1_FEATURES_EXT;
+  dynamicRenderingFeat.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+  eds1Feat.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+  eds2Feat.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT;
+  eds3Feat.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+  shaderObjectFeat.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT;
+  sync2Feat.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
 
   features.pNext = &vulkanMemoryModel;
   vulkanMemoryModel.pNext = &ubStandardLayout;
@@ -535,8 +711,35 @@ static VkDevice createDevice(VkInstance instance,
   timelineSemaphoreFeat.pNext = &bufferDeviceAddressFeat;
   bufferDeviceAddressFeat.pNext = &inlineUniformFeat;
   inlineUniformFeat.pNext = &shaderDrawFeat;
+  // optional feature structs are appended to the tail of the chain
+  void **pNextTail = &shaderDrawFeat.pNext;
   if (optFeatures.swapchainMaintenance1) {
-    shaderDrawFeat.pNext = &swapchainMaintenance1Feat;
+    *pNextTail = &swapchainMaintenance1Feat;
+    pNextTail = &swapchainMaintenance1Feat.pNext;
+  }
+  if (optFeatures.dynamicRendering) {
+    *pNextTail = &dynamicRenderingFeat;
+    pNextTail = &dynamicRenderingFeat.pNext;
+  }
+  if (optFeatures.extendedDynamicState) {
+    *pNextTail = &eds1Feat;
+    pNextTail = &eds1Feat.pNext;
+  }
+  if (optFeatures.extendedDynamicState2) {
+    *pNextTail = &eds2Feat;
+    pNextTail = &eds2Feat.pNext;
+  }
+  if (optFeatures.extendedDynamicState3PolygonMode) {
+    *pNextTail = &eds3Feat;
+    pNextTail = &eds3Feat.pNext;
+  }
+  if (optFeatures.shaderObject) {
+    *pNextTail = &shaderObjectFeat;
+    pNextTail = &shaderObjectFeat.pNext;
+  }
+  if (optFeatures.synchronization2) {
+    *pNextTail = &sync2Feat;
+    pNextTail = &sync2Feat.pNext;
   }
 
   // WARNING: Keep in sync with functions
@@ -550,6 +753,24 @@ static VkDevice createDevice(VkInstance instance,
   if (optFeatures.swapchainMaintenance1) {
     swapchainMaintenance1Feat.swapchainMaintenance1 = VK_TRUE;
   }
+  if (optFeatures.dynamicRendering) {
+    dynamicRenderingFeat.dynamicRendering = VK_TRUE;
+  }
+  if (optFeatures.extendedDynamicState) {
+    eds1Feat.extendedDynamicState = VK_TRUE;
+  }
+  if (optFeatures.extendedDynamicState2) {
+    eds2Feat.extendedDynamicState2 = VK_TRUE;
+  }
+  if (optFeatures.extendedDynamicState3PolygonMode) {
+    eds3Feat.extendedDynamicState3PolygonMode = VK_TRUE;
+  }
+  if (optFeatures.shaderObject) {
+    shaderObjectFeat.shaderObject = VK_TRUE;
+  }
+  if (optFeatures.synchronization2) {
+    sync2Feat.synchronization2 = VK_TRUE;
+  }
   if (optFeatures.textureCompressionASTC_LDR) {
     features.features.textureCompressionASTC_LDR = VK_TRUE;
   }
@@ -559,6 +780,10 @@ static VkDevice createDevice(VkInstance instance,
   if (optFeatures.textureCompressionETC2) {
     features.features.textureCompressionETC2 = VK_TRUE;
   }
+  if (optFeatures.sparseResidencyBuffer) {
+    features.features.sparseBinding = VK_TRUE;
+    features.features.sparseResidencyBuffer = VK_TRUE;
+  }
 
   // Create the device::General Setup
   VkDevice device = VK_NULL_HANDLE;
@@ -587,7 +812,7 @@ static VkDevice createDevice(VkInstance instance,
   // both supported features, add that as an optional extension
   // (just for renderdoc though, not to be used in code)
 
-  VK_CHECK(vkCreateDevice(physicalDevice, &createInfo, nullptr, &device));
+  VK_CHECK(vkCreateDevice(physicalDevice, &createInfo, allocator, &device));
   debugPrintDeviceExtensions(extensions.enabled);
   return device;
 }
@@ -597,7 +822,9 @@ static VmaAllocator newVmaAllocator(VkInstance instance,
                                     VkPhysicalDevice physicalDevice,
                                     VkDevice device,
                                     VmaVulkanFunctions *vmaVulkanFunctions,
-                                    bool memoryBudget) AVK_NO_CFI {
+                                    bool memoryBudget,
+                                    VkAllocationCallbacks const *allocator)
+    AVK_NO_CFI {
   assert(vulkanApiVersion >= VK_API_VERSION_1_1);
   VmaAllocatorCreateInfo allocatorCreateInfo{};
   // `VK_KHR_dedicated_allocation` promoted from 1.1
@@ -618,6 +845,8 @@ static VmaAllocator newVmaAllocator(VkInstance instance,
   allocatorCreateInfo.device = device;
   allocatorCreateInfo.physicalDevice = physicalDevice;
   allocatorCreateInfo.vulkanApiVersion = vulkanApiVersion;
+  // also passed by VMA to the buffers and images it creates
+  allocatorCreateInfo.pAllocationCallbacks = allocator;
 
   VK_CHECK(vmaImportVulkanFunctionsFromVolk(&allocatorCreateInfo,
                                             vmaVulkanFunctions));
@@ -630,8 +859,50 @@ static VmaAllocator newVmaAllocator(VkInstance instance,
 
 // ---------------------------------------------------------------------------
 
+// defaults for each `EMemoryClass`, overridable with
+// `Device::setMemoryPoolConfig`. Disabled, and with VMA sized blocks once
+// enabled, as a pool commits a whole block on its first allocation
+static avk::vk::MemoryPoolConfig const
+    DefaultMemoryPoolConfigs[static_cast<uint32_t>(
+        avk::vk::EMemoryClass::eCount)] = {
+        // eStaticGeometry: long lived, TLSF
+        {false, 0, 0, 0, false},
+        // eTextures: long lived and large, TLSF
+        {false, 0, 0, 0, false},
+        // eStreaming: freed in timeline order, hence linear
+        {false, 0, 0, 0, true},
+        // eRenderTargets: recreated on resize, TLSF
+        {false, 0, 0, 0, false},
+        // eStaging: freed in timeline order, hence linear
+        {false, 0, 0, 0, true},
+};
+
+static char const *const MemoryClassNames[static_cast<uint32_t>(
+    avk::vk::EMemoryClass::eCount)] = {
+    "StaticGeometry", "Textures", "Streaming", "RenderTargets", "Staging",
+};
+
+static char const *const AllocationTagNames[static_cast<uint32_t>(
+    avk::vk::EAllocationTag::eCount)] = {
+    "Untagged",       "BufferManager", "ImageManager", "TextureLoader",
+    "FrameAllocator", "Suballocator",  "Readback",     "TransientAttachments",
+    "SparseBuffers",  "Uploads",
+};
+
+// logged names of live allocations per tag in the leak report
+static uint32_t constexpr MaxLeakNamesPerTag = 8;
+
+static inline uint64_t allocationKey(VmaAllocation alloc) {
+  return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(alloc));
+}
+
 namespace avk::vk {
 
+char const *allocationTagName(EAllocationTag tag) {
+  assert(tag < EAllocationTag::eCount);
+  return AllocationTagNames[static_cast<uint32_t>(tag)];
+}
+
 Device::Device(Instance *instance, Surface *surface) AVK_NO_CFI
     : m_deps({instance, surface}) {
   assert(instance && surface);
@@ -643,13 +914,28 @@ Device::Device(Instance *instance, Surface *surface) AVK_NO_CFI
                                           optFeatures, m_comprFormats);
   m_isSoC = optFeatures.isSoC;
   m_swapchainMaintenance1 = optFeatures.swapchainMaintenance1;
+  m_dynamicRendering = optFeatures.dynamicRendering;
+  m_extendedDynamicState = optFeatures.extendedDynamicState;
+  m_extendedDynamicState2 = optFeatures.extendedDynamicState2;
+  m_extendedDynamicState3PolygonMode =
+      optFeatures.extendedDynamicState3PolygonMode;
+  m_shaderObject = optFeatures.shaderObject;
+  m_pipelineCreationFeedback = optFeatures.pipelineCreationFeedback;
+  m_synchronization2 = optFeatures.synchronization2;
+  {
+    VkPhysicalDeviceProperties2 props{};
+    props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    vkGetPhysicalDeviceProperties2(m_physicalDevice, &props);
+    m_limits = props.properties.limits;
+  }
 
   // 2. Device creation, extract graphics/compute/transfer/present queue, load
   // table
   LOGI << "[Device] Creating Device" << std::endl;
   m_device =
       createDevice(m_deps.instance->handle(), m_physicalDevice, extensions,
-                   optFeatures, m_deps.surface, m_queueFamilies);
+                   optFeatures, m_deps.surface, m_queueFamilies,
+                   allocationCallbacks(VK_OBJECT_TYPE_DEVICE));
   LOGI << "[Device] Created Device " << std::hex << m_device << std::dec
        << " | Selected GRAPHICS Queue Family as "
        << m_queueFamilies.universalGraphics << std::endl;
@@ -663,6 +949,26 @@ Device::Device(Instance *instance, Surface *surface) AVK_NO_CFI
   m_table->vkGetDeviceQueue(m_device, m_queueFamilies.universalGraphics, 0,
                             &m_queue);
   LOGI << "[Device] Got Queue " << std::hex << m_queue << std::dec << std::endl;
+  if (m_queueFamilies.transfer != VK_QUEUE_FAMILY_IGNORED) {
+    m_table->vkGetDeviceQueue(m_device, m_queueFamilies.transfer, 0,
+                              &m_transferQueue);
+  }
+  LOGI << "[Device] Transfer Queue Family " << m_queueFamilies.transfer
+       << " Queue " << std::hex << m_transferQueue << std::dec << std::endl;
+  if (m_queueFamilies.asyncCompute != VK_QUEUE_FAMILY_IGNORED) {
+    m_table->vkGetDeviceQueue(m_device, m_queueFamilies.asyncCompute, 0,
+                              &m_computeQueue);
+  }
+  LOGI << "[Device] Async Compute Queue Family "
+       << m_queueFamilies.asyncCompute << " Queue " << std::hex
+       << m_computeQueue << std::dec << std::endl;
+  if (optFeatures.sparseResidencyBuffer) {
+    // features are per device, sparse binding support is per queue family
+    m_sparseResidencyBuffer = queueFamilySupportsSparseBinding(
+        m_physicalDevice, m_queueFamilies.universalGraphics);
+  }
+  LOGI << "[Device] Sparse Residency Buffers: " << m_sparseResidencyBuffer
+       << std::endl;
 
   // memory heap information for VMA (Memory Budget Tracking)
   VkPhysicalDeviceMemoryProperties2 memoryProperties{};
@@ -679,7 +985,11 @@ Device::Device(Instance *instance, Surface *surface) AVK_NO_CFI
   memset(m_vmaVulkanFunctions.get(), 0, sizeof(VmaVulkanFunctions));
   m_vmaAllocator = newVmaAllocator(
       instance->handle(), instance->vulkanApiVersion(), m_physicalDevice,
-      m_device, m_vmaVulkanFunctions.get(), optFeatures.memoryBudget);
+      m_device, m_vmaVulkanFunctions.get(), optFeatures.memoryBudget,
+      allocationCallbacks(VK_OBJECT_TYPE_DEVICE_MEMORY));
+  for (uint32_t i = 0; i < MemoryClassCount; ++i) {
+    m_memoryPoolConfigs[i] = DefaultMemoryPoolConfigs[i];
+  }
 }
 
 Device::~Device() noexcept AVK_NO_CFI {
@@ -688,8 +998,22 @@ Device::~Device() noexcept AVK_NO_CFI {
   }
 
   m_table->vkDeviceWaitIdle(m_device);
+  logLiveAllocations();
+  // allocations of the pools should have been freed by the discard pool
+  for (auto &classPools : m_memoryPools) {
+    for (VmaPool &pool : classPools) {
+      if (pool != VK_NULL_HANDLE) {
+        vmaDestroyPool(m_vmaAllocator, pool);
+        pool = VK_NULL_HANDLE;
+      }
+    }
+  }
   vmaDestroyAllocator(m_vmaAllocator);
-  m_table->vkDestroyDevice(m_device, nullptr);
+  m_table->vkDestroyDevice(m_device,
+                           allocationCallbacks(VK_OBJECT_TYPE_DEVICE));
+#ifndef AVK_NO_HOST_ALLOCATOR
+  m_hostAllocator.logLiveBytes();
+#endif
 }
 
 void Device::refreshMemoryBudgets(uint32_t frameIndex) {
@@ -697,4 +1021,258 @@ void Device::refreshMemoryBudgets(uint32_t frameIndex) {
   vmaGetHeapBudgets(m_vmaAllocator, m_heapBudgets.data());
 }
 
-}  // namespace avk::vk
\ No newline at end of file
+void Device::setMemoryPoolConfig(EMemoryClass memoryClass,
+                                 MemoryPoolConfig const &config) {
+  assert(memoryClass != EMemoryClass::eCount);
+  std::lock_guard lk{m_memoryPoolMtx};
+  m_memoryPoolConfigs[static_cast<uint32_t>(memoryClass)] = config;
+}
+
+MemoryPoolConfig Device::memoryPoolConfig(EMemoryClass memoryClass) const {
+  assert(memoryClass != EMemoryClass::eCount);
+  std::lock_guard lk{m_memoryPoolMtx};
+  return m_memoryPoolConfigs[static_cast<uint32_t>(memoryClass)];
+}
+
+VmaPool Device::bufferMemoryPool(EMemoryClass memoryClass,
+                                 VkBufferCreateInfo const &createInfo,
+                                 VmaAllocationCreateInfo const &allocInfo) {
+  assert(memoryClass != EMemoryClass::eCount);
+  uint32_t const classIndex = static_cast<uint32_t>(memoryClass);
+  uint32_t memoryTypeIndex = 0;
+  if (vmaFindMemoryTypeIndexForBufferInfo(m_vmaAllocator, &createInfo,
+                                          &allocInfo,
+                                          &memoryTypeIndex) != VK_SUCCESS) {
+    return VK_NULL_HANDLE;
+  }
+
+  std::lock_guard lk{m_memoryPoolMtx};
+  return getOrCreateMemoryPool(classIndex, memoryTypeIndex);
+}
+
+VmaPool Device::imageMemoryPool(EMemoryClass memoryClass,
+                                VkImageCreateInfo const &createInfo,
+                                VmaAllocationCreateInfo const &allocInfo) {
+  assert(memoryClass != EMemoryClass::eCount);
+  uint32_t const classIndex = static_cast<uint32_t>(memoryClass);
+  uint32_t memoryTypeIndex = 0;
+  if (vmaFindMemoryTypeIndexForImageInfo(m_vmaAllocator, &createInfo,
+                                         &allocInfo,
+                                         &memoryTypeIndex) != VK_SUCCESS) {
+    return VK_NULL_HANDLE;
+  }
+
+  std::lock_guard lk{m_memoryPoolMtx};
+  return getOrCreateMemoryPool(classIndex, memoryTypeIndex);
+}
+
+VkResult Device::createPooledBuffer(EMemoryClass memoryClass,
+                                    VkBufferCreateInfo const &createInfo,
+                                    VmaAllocationCreateInfo const &allocInfo,
+                                    VkBuffer &outBuffer,
+                                    VmaAllocation &outAlloc,
+                                    VmaAllocationInfo *outAllocInfo) {
+  assert(allocInfo.pool == VK_NULL_HANDLE);
+  VmaAllocationCreateInfo pooledInfo = allocInfo;
+  pooledInfo.pool = bufferMemoryPool(memoryClass, createInfo, allocInfo);
+  // a pool with explicit block size can't hold anything larger
+  VkDeviceSize const blockSize = memoryPoolConfig(memoryClass).blockSize;
+  if (pooledInfo.pool != VK_NULL_HANDLE &&
+      (blockSize == 0 || createInfo.size <= blockSize)) {
+    // pooled resources share the blocks of their pool
+    pooledInfo.flags &= ~VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+    if (vmaCreateBuffer(m_vmaAllocator, &createInfo, &pooledInfo, &outBuffer,
+                        &outAlloc, outAllocInfo) == VK_SUCCESS) {
+      return VK_SUCCESS;
+    }
+  }
+  return vmaCreateBuffer(m_vmaAllocator, &createInfo, &allocInfo, &outBuffer,
+                         &outAlloc, outAllocInfo);
+}
+
+VkResult Device::createPooledImage(EMemoryClass memoryClass,
+                                   VkImageCreateInfo const &createInfo,
+                                   VmaAllocationCreateInfo const &allocInfo,
+                                   VkImage &outImage, VmaAllocation &outAlloc,
+                                   VmaAllocationInfo *outAllocInfo) {
+  assert(allocInfo.pool == VK_NULL_HANDLE);
+  VmaAllocationCreateInfo pooledInfo = allocInfo;
+  pooledInfo.pool = imageMemoryPool(memoryClass, createInfo, allocInfo);
+  // the image size isn't known before its memory requirements, hence an
+  // image larger than the blocks fails in the pool and falls back below
+  if (pooledInfo.pool != VK_NULL_HANDLE) {
+    pooledInfo.flags &= ~VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+    if (vmaCreateImage(m_vmaAllocator, &createInfo, &pooledInfo, &outImage,
+                       &outAlloc, outAllocInfo) == VK_SUCCESS) {
+      return VK_SUCCESS;
+    }
+  }
+  return vmaCreateImage(m_vmaAllocator, &createInfo, &allocInfo, &outImage,
+                        &outAlloc, outAllocInfo);
+}
+
+VmaStatistics Device::memoryClassStatistics(EMemoryClass memoryClass) const {
+  assert(memoryClass != EMemoryClass::eCount);
+  VmaStatistics total{};
+  std::lock_guard lk{m_memoryPoolMtx};
+  for (VmaPool pool : m_memoryPools[static_cast<uint32_t>(memoryClass)]) {
+    if (pool == VK_NULL_HANDLE) {
+      continue;
+    }
+    VmaStatistics stats{};
+    vmaGetPoolStatistics(m_vmaAllocator, pool, &stats);
+    total.blockCount += stats.blockCount;
+    total.allocationCount += stats.allocationCount;
+    total.blockBytes += stats.blockBytes;
+    total.allocationBytes += stats.allocationBytes;
+  }
+  return total;
+}
+
+void Device::collectMemoryPools(EMemoryClass memoryClass,
+                                std::vector<VmaPool> &outPools) const {
+  assert(memoryClass != EMemoryClass::eCount);
+  std::lock_guard lk{m_memoryPoolMtx};
+  for (VmaPool pool : m_memoryPools[static_cast<uint32_t>(memoryClass)]) {
+    if (pool != VK_NULL_HANDLE) {
+      outPools.push_back(pool);
+    }
+  }
+}
+
+void Device::tagAllocation(VmaAllocation alloc, EAllocationTag tag,
+                           std::string name) {
+  assert(alloc != VK_NULL_HANDLE && tag < EAllocationTag::eCount);
+  VmaAllocationInfo info{};
+  vmaGetAllocationInfo(m_vmaAllocator, alloc, &info);
+  // VMA copies the name
+  vmaSetAllocationName(m_vmaAllocator, alloc, name.c_str());
+  auto const userData = static_cast<uintptr_t>(tag);
+  vmaSetAllocationUserData(m_vmaAllocator, alloc,
+                           reinterpret_cast<void *>(userData));
+  TrackedAllocation tracked{tag, info.size, std::move(name)};
+  if (!m_trackedAllocations.tryEmplace(allocationKey(alloc), tracked)) {
+    // same address reused by VMA after a free which wasn't untagged
+    m_trackedAllocations.modify(
+        allocationKey(alloc),
+        [&tracked](TrackedAllocation &entry) { entry = std::move(tracked); });
+  }
+}
+
+void Device::untagAllocation(VmaAllocation alloc) {
+  if (alloc == VK_NULL_HANDLE) {
+    return;
+  }
+  m_trackedAllocations.erase(allocationKey(alloc),
+                             [](TrackedAllocation & /*entry*/) {});
+}
+
+std::string Device::buildStatsJson(bool detailedMap) const {
+  uint64_t counts[static_cast<uint32_t>(EAllocationTag::eCount)]{};
+  VkDeviceSize bytes[static_cast<uint32_t>(EAllocationTag::eCount)]{};
+  VkDeviceSize taggedBytes = 0;
+  m_trackedAllocations.forEach(
+      [&](uint64_t /*key*/, TrackedAllocation const &entry) {
+        uint32_t const tag = static_cast<uint32_t>(entry.tag);
+        ++counts[tag];
+        bytes[tag] += entry.size;
+        taggedBytes += entry.size;
+      });
+  VmaTotalStatistics total{};
+  vmaCalculateStatistics(m_vmaAllocator, &total);
+  uint64_t const allocationCount = total.total.statistics.allocationCount;
+  VkDeviceSize const allocationBytes = total.total.statistics.allocationBytes;
+
+  char *vmaJson = nullptr;
+  vmaBuildStatsString(m_vmaAllocator, &vmaJson,
+                      detailedMap ? VK_TRUE : VK_FALSE);
+  std::ostringstream json;
+  json << "{\"Vma\": " << vmaJson << ", \"Tags\": {";
+  vmaFreeStatsString(m_vmaAllocator, vmaJson);
+  uint64_t taggedCount = 0;
+  for (uint32_t tag = 1; tag < static_cast<uint32_t>(EAllocationTag::eCount);
+       ++tag) {
+    taggedCount += counts[tag];
+    json << "\"" << AllocationTagNames[tag] << "\": {\"Count\": "
+         << counts[tag] << ", \"Bytes\": " << bytes[tag] << "}, ";
+  }
+  // untagged allocations are whatever VMA has and the table doesn't
+  json << "\"" << AllocationTagNames[0] << "\": {\"Count\": "
+       << (allocationCount > taggedCount ? allocationCount - taggedCount : 0)
+       << ", \"Bytes\": "
+       << (allocationBytes > taggedBytes ? allocationBytes - taggedBytes : 0)
+       << "}}, \"Host\": " << m_hostAllocator.buildStatsJson() << "}";
+  return json.str();
+}
+
+void Device::logLiveAllocations() const {
+  struct TagReport {
+    uint64_t count = 0;
+    VkDeviceSize bytes = 0;
+    std::vector<std::string> names;
+  };
+  TagReport reports[static_cast<uint32_t>(EAllocationTag::eCount)];
+  size_t liveCount = 0;
+  m_trackedAllocations.forEach(
+      [&](uint64_t /*key*/, TrackedAllocation const &entry) {
+        TagReport &report = reports[static_cast<uint32_t>(entry.tag)];
+        ++report.count;
+        report.bytes += entry.size;
+        if (report.names.size() < MaxLeakNamesPerTag) {
+          report.names.push_back(entry.name);
+        }
+        ++liveCount;
+      });
+  if (liveCount == 0) {
+    LOGI << "[Device] No live tagged allocations" << std::endl;
+    return;
+  }
+  LOGW << "[Device] " << liveCount << " live tagged allocations" << std::endl;
+  for (uint32_t tag = 0; tag < static_cast<uint32_t>(EAllocationTag::eCount);
+       ++tag) {
+    TagReport const &report = reports[tag];
+    if (report.count == 0) {
+      continue;
+    }
+    LOGW << "  " << AllocationTagNames[tag] << ": " << report.count
+         << " allocations, " << report.bytes << " B" << std::endl;
+    for (std::string const &name : report.names) {
+      LOGW << "    - " << name << std::endl;
+    }
+  }
+}
+
+VmaPool Device::getOrCreateMemoryPool(uint32_t classIndex,
+                                      uint32_t memoryTypeIndex) {
+  MemoryPoolConfig const &config = m_memoryPoolConfigs[classIndex];
+  if (!config.enabled) {
+    return VK_NULL_HANDLE;
+  }
+  VmaPool &pool = m_memoryPools[classIndex][memoryTypeIndex];
+  if (pool != VK_NULL_HANDLE) {
+    return pool;
+  }
+
+  VmaPoolCreateInfo createInfo{};
+  createInfo.memoryTypeIndex = memoryTypeIndex;
+  createInfo.blockSize = config.blockSize;
+  createInfo.minBlockCount = config.minBlockCount;
+  createInfo.maxBlockCount = config.maxBlockCount;
+  if (config.linear) {
+    createInfo.flags |= VMA_POOL_CREATE_LINEAR_ALGORITHM_BIT;
+  }
+  if (VkResult const res = vmaCreatePool(m_vmaAllocator, &createInfo, &pool);
+      res != VK_SUCCESS) {
+    LOGW << "[Device] Couldn't create memory pool "
+         << MemoryClassNames[classIndex] << " for memory type "
+         << memoryTypeIndex << ", using default pools" << std::endl;
+    pool = VK_NULL_HANDLE;
+    return VK_NULL_HANDLE;
+  }
+  vmaSetPoolName(m_vmaAllocator, pool, MemoryClassNames[classIndex]);
+  LOGI << "[Device] Created memory pool " << MemoryClassNames[classIndex]
+       << " on memory type " << memoryTypeIndex << std::endl;
+  return pool;
+}
+
+}  // namespace avk::vk
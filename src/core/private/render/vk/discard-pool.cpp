@@ -25,8 +25,10 @@ DiscardPool::DiscardPool(Instance* instance, Device* device) AVK_NO_CFI
   semCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
   semCreateInfo.pNext = &semType;
 
-  VK_CHECK(
-      vkDevApi->vkCreateSemaphore(dev, &semCreateInfo, nullptr, &m_timeline));
+  VK_CHECK(vkDevApi->vkCreateSemaphore(
+      dev, &semCreateInfo,
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_SEMAPHORE),
+      &m_timeline));
 
   // reserve some space
   m_images.reserve(64);
@@ -36,6 +38,7 @@ DiscardPool::DiscardPool(Instance* instance, Device* device) AVK_NO_CFI
   m_shaderModules.reserve(64);
   m_pipelines.reserve(64);
   m_pipelineLayouts.reserve(64);
+  m_shaderObjects.reserve(64);
   m_descriptorPools.reserve(64);
   m_commandPools.reserve(64);
   m_renderPasses.reserve(64);
@@ -49,7 +52,9 @@ DiscardPool::~DiscardPool() AVK_NO_CFI {
   auto const* const vkDevApi = m_deps.device->table();
   VkDevice const dev = m_deps.device->device();
   destroyDiscardedResources(true);
-  vkDevApi->vkDestroySemaphore(dev, m_timeline, nullptr);
+  vkDevApi->vkDestroySemaphore(
+      dev, m_timeline,
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_SEMAPHORE));
 }
 
 uint64_t DiscardPool::queryTime() const {
@@ -92,6 +97,10 @@ void DiscardPool::discardPipelineLayout(VkPipelineLayout pipelineLayout,
   std::lock_guard lk{m_mtx};
   m_pipelineLayouts.appendTimeline(value, pipelineLayout);
 }
+void DiscardPool::discardShaderObject(VkShaderEXT shader, uint64_t value) {
+  std::lock_guard lk{m_mtx};
+  m_shaderObjects.appendTimeline(value, shader);
+}
 
 void DiscardPool::discardDescriptorPoolForReuse(VkDescriptorPool descriptorPool,
                                                 DescriptorPools* pools,
@@ -129,44 +138,68 @@ void DiscardPool::destroyDiscardedResources(bool force) AVK_NO_CFI {
     VK_CHECK(
         vkDevApi->vkGetSemaphoreCounterValueKHR(dev, m_timeline, &timeline));
   }
+  // each destroy passes the host allocation callbacks of its object type
+  Device* const device = m_deps.device;
   // image and image views (Note: View first)
   m_imageViews.removeOld(
-      timeline, [dev, vkDevApi](VkImageView imageView) AVK_NO_CFI {
-        vkDevApi->vkDestroyImageView(dev, imageView, nullptr);
+      timeline, [device, dev, vkDevApi](VkImageView imageView) AVK_NO_CFI {
+        vkDevApi->vkDestroyImageView(
+            dev, imageView,
+            device->allocationCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW));
       });
   m_images.removeOld(
-      timeline, [vmaAllocator = m_deps.device->vmaAllocator(), vkDevApi,
-                 dev](VMAResource<VkImage> const& pair) AVK_NO_CFI {
+      timeline,
+      [device, vkDevApi, dev](VMAResource<VkImage> const& pair) AVK_NO_CFI {
+        VmaAllocator const vmaAllocator = device->vmaAllocator();
+        device->untagAllocation(pair.alloc);
         if (pair.handle != VK_NULL_HANDLE && pair.alloc != VK_NULL_HANDLE) {
           vmaDestroyImage(vmaAllocator, pair.handle, pair.alloc);
         } else if (pair.handle != VK_NULL_HANDLE) {
-          vkDevApi->vkDestroyImage(dev, pair.handle, nullptr);
+          vkDevApi->vkDestroyImage(
+              dev, pair.handle,
+              device->allocationCallbacks(VK_OBJECT_TYPE_IMAGE));
         } else {
           vmaFreeMemory(vmaAllocator, pair.alloc);
         }
       });
   // buffer and buffer views (Note: View first)
   m_bufferViews.removeOld(
-      timeline, [dev, vkDevApi](VkBufferView bufferView) AVK_NO_CFI {
-        vkDevApi->vkDestroyBufferView(dev, bufferView, nullptr);
+      timeline, [device, dev, vkDevApi](VkBufferView bufferView) AVK_NO_CFI {
+        vkDevApi->vkDestroyBufferView(
+            dev, bufferView,
+            device->allocationCallbacks(VK_OBJECT_TYPE_BUFFER_VIEW));
       });
   m_buffers.removeOld(
-      timeline,
-      [device = m_deps.device](VMAResource<VkBuffer> const& pair) AVK_NO_CFI {
+      timeline, [device](VMAResource<VkBuffer> const& pair) AVK_NO_CFI {
+        device->untagAllocation(pair.alloc);
         vmaDestroyBuffer(device->vmaAllocator(), pair.handle, pair.alloc);
       });
   // pipeline, pipeline layouts, shader modules
-  m_pipelines.removeOld(timeline,
-                        [dev, vkDevApi](VkPipeline pipeline) AVK_NO_CFI {
-                          vkDevApi->vkDestroyPipeline(dev, pipeline, nullptr);
-                        });
+  m_pipelines.removeOld(
+      timeline, [device, dev, vkDevApi](VkPipeline pipeline) AVK_NO_CFI {
+        vkDevApi->vkDestroyPipeline(
+            dev, pipeline,
+            device->allocationCallbacks(VK_OBJECT_TYPE_PIPELINE));
+      });
   m_pipelineLayouts.removeOld(
-      timeline, [dev, vkDevApi](VkPipelineLayout pipelineLayout) AVK_NO_CFI {
-        vkDevApi->vkDestroyPipelineLayout(dev, pipelineLayout, nullptr);
+      timeline,
+      [device, dev, vkDevApi](VkPipelineLayout pipelineLayout) AVK_NO_CFI {
+        vkDevApi->vkDestroyPipelineLayout(
+            dev, pipelineLayout,
+            device->allocationCallbacks(VK_OBJECT_TYPE_PIPELINE_LAYOUT));
       });
   m_shaderModules.removeOld(
-      timeline, [dev, vkDevApi](VkShaderModule shaderModule) AVK_NO_CFI {
-        vkDevApi->vkDestroyShaderModule(dev, shaderModule, nullptr);
+      timeline,
+      [device, dev, vkDevApi](VkShaderModule shaderModule) AVK_NO_CFI {
+        vkDevApi->vkDestroyShaderModule(
+            dev, shaderModule,
+            device->allocationCallbacks(VK_OBJECT_TYPE_SHADER_MODULE));
+      });
+  m_shaderObjects.removeOld(
+      timeline, [device, dev, vkDevApi](VkShaderEXT shader) AVK_NO_CFI {
+        vkDevApi->vkDestroyShaderEXT(
+            dev, shader,
+            device->allocationCallbacks(VK_OBJECT_TYPE_SHADER_EXT));
       });
   // descriptor pools and command pools (TODO)
   m_descriptorPools.removeOld(
@@ -178,12 +211,16 @@ void DiscardPool::destroyDiscardedResources(bool force) AVK_NO_CFI {
   });
   // renderpasses and framebuffers
   m_renderPasses.removeOld(
-      timeline, [vkDevApi, dev](VkRenderPass renderPass) AVK_NO_CFI {
-        vkDevApi->vkDestroyRenderPass(dev, renderPass, nullptr);
+      timeline, [device, vkDevApi, dev](VkRenderPass renderPass) AVK_NO_CFI {
+        vkDevApi->vkDestroyRenderPass(
+            dev, renderPass,
+            device->allocationCallbacks(VK_OBJECT_TYPE_RENDER_PASS));
       });
   m_framebuffers.removeOld(
-      timeline, [vkDevApi, dev](VkFramebuffer framebuffer) AVK_NO_CFI {
-        vkDevApi->vkDestroyFramebuffer(dev, framebuffer, nullptr);
+      timeline, [device, vkDevApi, dev](VkFramebuffer framebuffer) AVK_NO_CFI {
+        vkDevApi->vkDestroyFramebuffer(
+            dev, framebuffer,
+            device->allocationCallbacks(VK_OBJECT_TYPE_FRAMEBUFFER));
       });
 }
 
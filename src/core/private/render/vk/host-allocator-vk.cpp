@@ -0,0 +1,324 @@
+#include "render/vk/host-allocator-vk.h"
+
+#include "utils/bits.h"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <sstream>
+
+// alignment of the arena memory, stricter requests go to the heap
+static size_t constexpr ArenaAlignment = 64;
+
+namespace {
+
+struct CommandArena {
+  uint8_t* memory = nullptr;
+  size_t head = 0;
+  uint32_t liveCount = 0;
+
+  ~CommandArena() noexcept {
+    if (memory) {
+      ::operator delete(memory, std::align_val_t{ArenaAlignment});
+    }
+  }
+};
+
+// right before the pointer returned to the driver
+struct BlockHeader {
+  size_t size;
+  size_t alignment;
+  // from the start of the underlying block to the returned pointer
+  uint32_t offset;
+  uint8_t scope;
+  uint8_t slot;
+  // owner of the block, null for heap blocks
+  CommandArena* arena;
+};
+
+}  // namespace
+
+static thread_local CommandArena tCommandArena;
+
+static char const* const ScopeNames[avk::vk::HostAllocator::ScopeCount] = {
+    "Command", "Object", "Cache", "Device", "Instance",
+};
+
+static char const* const
+    ObjectTypeSlotNames[avk::vk::HostAllocator::ObjectTypeSlotCount] = {
+        "Unknown",
+        "Instance",
+        "PhysicalDevice",
+        "Device",
+        "Queue",
+        "Semaphore",
+        "CommandBuffer",
+        "Fence",
+        "DeviceMemory",
+        "Buffer",
+        "Image",
+        "Event",
+        "QueryPool",
+        "BufferView",
+        "ImageView",
+        "ShaderModule",
+        "PipelineCache",
+        "PipelineLayout",
+        "RenderPass",
+        "Pipeline",
+        "DescriptorSetLayout",
+        "Sampler",
+        "DescriptorPool",
+        "DescriptorSet",
+        "Framebuffer",
+        "CommandPool",
+        "Extension",
+};
+
+static void writeCounters(std::ostringstream& json, char const* name,
+                          avk::vk::HostAllocator::Counters const& counters) {
+  json << "\"" << name << "\": {\"Bytes\": " << counters.bytes
+       << ", \"PeakBytes\": " << counters.peakBytes
+       << ", \"Count\": " << counters.allocationCount << "}";
+}
+
+namespace avk::vk {
+
+// -------------------- AtomicCounters ---------------------------------------
+
+void HostAllocator::AtomicCounters::add(uint64_t size) {
+  uint64_t const live = bytes.fetch_add(size, std::memory_order_relaxed) + size;
+  uint64_t peak = peakBytes.load(std::memory_order_relaxed);
+  while (peak < live && !peakBytes.compare_exchange_weak(
+                            peak, live, std::memory_order_relaxed)) {
+  }
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void HostAllocator::AtomicCounters::sub(uint64_t size) {
+  bytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+HostAllocator::Counters HostAllocator::AtomicCounters::load() const {
+  return Counters{bytes.load(std::memory_order_relaxed),
+                  peakBytes.load(std::memory_order_relaxed),
+                  allocationCount.load(std::memory_order_relaxed)};
+}
+
+// -------------------- HostAllocator ----------------------------------------
+
+HostAllocator::HostAllocator() {
+  for (uint32_t i = 0; i < ObjectTypeSlotCount; ++i) {
+    m_slots[i] = Slot{this, i};
+    VkAllocationCallbacks& callbacks = m_callbacks[i];
+    callbacks.pUserData = &m_slots[i];
+    callbacks.pfnAllocation = pfnAllocation;
+    callbacks.pfnReallocation = pfnReallocation;
+    callbacks.pfnFree = pfnFree;
+    callbacks.pfnInternalAllocation = pfnInternalAllocation;
+    callbacks.pfnInternalFree = pfnInternalFree;
+  }
+}
+
+VkAllocationCallbacks const* HostAllocator::callbacks(
+    VkObjectType objectType) const {
+  uint32_t const slot = objectType <= VK_OBJECT_TYPE_COMMAND_POOL
+                            ? static_cast<uint32_t>(objectType)
+                            : ObjectTypeSlotCount - 1;
+  return &m_callbacks[slot];
+}
+
+HostAllocator::Statistics HostAllocator::statistics() const {
+  Statistics stats{};
+  for (uint32_t i = 0; i < ScopeCount; ++i) {
+    stats.scopes[i] = m_scopes[i].load();
+    stats.internal[i] = m_internal[i].load();
+  }
+  for (uint32_t i = 0; i < ObjectTypeSlotCount; ++i) {
+    stats.objectTypes[i] = m_objectTypes[i].load();
+  }
+  stats.arenaAllocationCount =
+      m_arenaAllocationCount.load(std::memory_order_relaxed);
+  stats.arenaFallbackCount =
+      m_arenaFallbackCount.load(std::memory_order_relaxed);
+  return stats;
+}
+
+std::string HostAllocator::buildStatsJson() const {
+  Statistics const stats = statistics();
+  std::ostringstream json;
+  json << "{\"Scopes\": {";
+  for (uint32_t i = 0; i < ScopeCount; ++i) {
+    json << (i ? ", " : "");
+    writeCounters(json, ScopeNames[i], stats.scopes[i]);
+  }
+  json << "}, \"ObjectTypes\": {";
+  bool first = true;
+  for (uint32_t i = 0; i < ObjectTypeSlotCount; ++i) {
+    if (stats.objectTypes[i].allocationCount == 0) {
+      continue;
+    }
+    json << (first ? "" : ", ");
+    writeCounters(json, ObjectTypeSlotNames[i], stats.objectTypes[i]);
+    first = false;
+  }
+  json << "}, \"Internal\": {";
+  for (uint32_t i = 0; i < ScopeCount; ++i) {
+    json << (i ? ", " : "");
+    writeCounters(json, ScopeNames[i], stats.internal[i]);
+  }
+  json << "}, \"ArenaCount\": " << stats.arenaAllocationCount
+       << ", \"ArenaFallbackCount\": " << stats.arenaFallbackCount << "}";
+  return json.str();
+}
+
+void HostAllocator::logLiveBytes() const {
+  Statistics const stats = statistics();
+  for (uint32_t i = 0; i < ScopeCount; ++i) {
+    Counters const& counters = stats.scopes[i];
+    if (counters.bytes != 0) {
+      LOGW << "[HostAllocator] " << ScopeNames[i] << " scope: "
+           << counters.bytes << " B still live" << std::endl;
+    } else {
+      LOGI << "[HostAllocator] " << ScopeNames[i] << " scope: "
+           << counters.allocationCount << " allocations, peak "
+           << counters.peakBytes << " B" << std::endl;
+    }
+  }
+}
+
+char const* HostAllocator::scopeName(uint32_t scope) {
+  assert(scope < ScopeCount);
+  return ScopeNames[scope];
+}
+
+char const* HostAllocator::objectTypeSlotName(uint32_t slot) {
+  assert(slot < ObjectTypeSlotCount);
+  return ObjectTypeSlotNames[slot];
+}
+
+void* HostAllocator::allocate(uint32_t slot, size_t size, size_t alignment,
+                              VkSystemAllocationScope scope) {
+  if (size == 0) {
+    return nullptr;
+  }
+  alignment = std::max(alignment, alignof(std::max_align_t));
+  // the header fits right before the aligned pointer
+  size_t const offset = nextMultipleOf(sizeof(BlockHeader), alignment);
+  uint8_t* memory = nullptr;
+  CommandArena* arena = nullptr;
+  if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND &&
+      alignment <= ArenaAlignment &&
+      m_commandArena.load(std::memory_order_relaxed)) {
+    CommandArena& local = tCommandArena;
+    if (!local.memory) {
+      local.memory = static_cast<uint8_t*>(::operator new(
+          CommandArenaBytes, std::align_val_t{ArenaAlignment}, std::nothrow));
+    }
+    // the arena base is aligned, hence offsets within it are too
+    size_t const start = nextMultipleOf(local.head, alignment);
+    if (local.memory && start + offset + size <= CommandArenaBytes) {
+      memory = local.memory + start + offset;
+      local.head = start + offset + size;
+      ++local.liveCount;
+      arena = &local;
+      m_arenaAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      m_arenaFallbackCount.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  if (!memory) {
+    auto* const base = static_cast<uint8_t*>(::operator new(
+        offset + size, std::align_val_t{alignment}, std::nothrow));
+    if (!base) {
+      return nullptr;
+    }
+    memory = base + offset;
+  }
+
+  BlockHeader* const header = reinterpret_cast<BlockHeader*>(memory) - 1;
+  header->size = size;
+  header->alignment = alignment;
+  header->offset = static_cast<uint32_t>(offset);
+  header->scope = static_cast<uint8_t>(scope);
+  header->slot = static_cast<uint8_t>(slot);
+  header->arena = arena;
+  m_scopes[scope].add(size);
+  m_objectTypes[slot].add(size);
+  return memory;
+}
+
+void HostAllocator::deallocate(void* memory) {
+  if (!memory) {
+    return;
+  }
+  BlockHeader const* const header = static_cast<BlockHeader*>(memory) - 1;
+  m_scopes[header->scope].sub(header->size);
+  m_objectTypes[header->slot].sub(header->size);
+  if (header->arena) {
+    // freed by the command which allocated it, hence on the same thread
+    CommandArena* const arena = header->arena;
+    assert(arena == &tCommandArena && arena->liveCount > 0);
+    if (--arena->liveCount == 0) {
+      arena->head = 0;
+    }
+    return;
+  }
+  ::operator delete(static_cast<uint8_t*>(memory) - header->offset,
+                    std::align_val_t{header->alignment});
+}
+
+void* VKAPI_CALL HostAllocator::pfnAllocation(void* pUserData, size_t size,
+                                              size_t alignment,
+                                              VkSystemAllocationScope scope) {
+  auto const* const slot = static_cast<Slot const*>(pUserData);
+  return slot->self->allocate(slot->index, size, alignment, scope);
+}
+
+void* VKAPI_CALL HostAllocator::pfnReallocation(
+    void* pUserData, void* pOriginal, size_t size, size_t alignment,
+    VkSystemAllocationScope scope) {
+  auto const* const slot = static_cast<Slot const*>(pUserData);
+  if (!pOriginal) {
+    return slot->self->allocate(slot->index, size, alignment, scope);
+  }
+  if (size == 0) {
+    slot->self->deallocate(pOriginal);
+    return nullptr;
+  }
+  // stays attributed to the object type of the original block. On failure
+  // the original block must be left untouched
+  BlockHeader const* const header = static_cast<BlockHeader*>(pOriginal) - 1;
+  size_t const originalSize = header->size;
+  void* const memory =
+      slot->self->allocate(header->slot, size, alignment, scope);
+  if (!memory) {
+    return nullptr;
+  }
+  memcpy(memory, pOriginal, std::min(originalSize, size));
+  slot->self->deallocate(pOriginal);
+  return memory;
+}
+
+void VKAPI_CALL HostAllocator::pfnFree(void* pUserData, void* pMemory) {
+  static_cast<Slot const*>(pUserData)->self->deallocate(pMemory);
+}
+
+void VKAPI_CALL HostAllocator::pfnInternalAllocation(
+    void* pUserData, size_t size,
+    [[maybe_unused]] VkInternalAllocationType type,
+    VkSystemAllocationScope scope) {
+  static_cast<Slot const*>(pUserData)->self->m_internal[scope].add(size);
+}
+
+void VKAPI_CALL HostAllocator::pfnInternalFree(
+    void* pUserData, size_t size,
+    [[maybe_unused]] VkInternalAllocationType type,
+    VkSystemAllocationScope scope) {
+  static_cast<Slot const*>(pUserData)->self->m_internal[scope].sub(size);
+}
+
+}  // namespace avk::vk
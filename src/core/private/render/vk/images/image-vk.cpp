@@ -58,8 +58,9 @@ Expected<VkImageView> depthStencilImageView(Device* device, VkImage image,
   createInfo.subresourceRange.levelCount = 1;
 
   VkImageView view = VK_NULL_HANDLE;
-  VkResult const res =
-      vkDevApi->vkCreateImageView(dev, &createInfo, nullptr, &view);
+  VkResult const res = vkDevApi->vkCreateImageView(
+      dev, &createInfo, device->allocationCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW),
+      &view);
   return {view, res};
 }
 
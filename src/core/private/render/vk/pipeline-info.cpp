@@ -4,6 +4,92 @@
 
 namespace avk::vk {
 
+template <typename T>
+static void appendBytes(std::vector<uint8_t>& bytes, T const* values,
+                        size_t count) {
+  // Vulkan descriptions used here have no padding, hence raw copies are
+  // canonical
+  static_assert(std::is_trivially_copyable_v<T>);
+  size_t const offset = bytes.size();
+  bytes.resize(offset + count * sizeof(T));
+  if (count > 0) {
+    memcpy(bytes.data() + offset, values, count * sizeof(T));
+  }
+}
+
+template <typename T>
+static void appendValue(std::vector<uint8_t>& bytes, T const& value) {
+  appendBytes(bytes, &value, 1);
+}
+
+// length prefixed, such that adjacent arrays can't be confused
+template <typename T>
+static void appendVector(std::vector<uint8_t>& bytes,
+                         std::vector<T> const& values) {
+  appendValue(bytes, static_cast<uint32_t>(values.size()));
+  appendBytes(bytes, values.data(), values.size());
+}
+
+static void appendSpecialization(std::vector<uint8_t>& bytes,
+                                 SpecializationConstants const& spec) {
+  appendVector(bytes, spec.mapEntries);
+  appendVector(bytes, spec.data);
+}
+
+void GraphicsKey::assign(GraphicsInfo const& graphicsInfo) {
+  m_bytes.clear();
+  m_pipelineLayout = graphicsInfo.pipelineLayout;
+
+  // -- Vertex In --
+  appendValue(m_bytes, graphicsInfo.vertexIn.topology);
+  appendVector(m_bytes, graphicsInfo.vertexIn.attributes);
+  appendVector(m_bytes, graphicsInfo.vertexIn.bindings);
+
+  // -- Pre Rasterization --
+  appendValue(m_bytes, graphicsInfo.preRasterization.vertexModule);
+  appendValue(m_bytes, graphicsInfo.preRasterization.geometryModule);
+  appendSpecialization(m_bytes,
+                       graphicsInfo.preRasterization.vertexSpecialization);
+  appendSpecialization(m_bytes,
+                       graphicsInfo.preRasterization.geometrySpecialization);
+
+  // -- Fragment Shader -- (viewports and scissors are dynamic)
+  appendValue(m_bytes, graphicsInfo.fragmentShader.fragmentModule);
+  appendSpecialization(m_bytes,
+                       graphicsInfo.fragmentShader.fragmentSpecialization);
+  appendValue(m_bytes, static_cast<uint32_t>(
+                           graphicsInfo.fragmentShader.viewports.size()));
+  appendValue(m_bytes, static_cast<uint32_t>(
+                           graphicsInfo.fragmentShader.scissors.size()));
+
+  // -- Fragment Out --
+  appendValue(m_bytes, graphicsInfo.fragmentOut.colorAttachmentCount);
+  appendValue(m_bytes, graphicsInfo.fragmentOut.depthAttachmentFormat);
+  appendValue(m_bytes, graphicsInfo.fragmentOut.stencilAttachmentFormat);
+  appendVector(m_bytes, graphicsInfo.fragmentOut.colorAttachmentFormats);
+  appendValue(m_bytes, graphicsInfo.renderPass);
+  appendValue(m_bytes, graphicsInfo.subpass);
+
+  // -- Options -- (only what isn't dynamic on the device)
+  GraphicsInfo::PipelineOpts const& opts = graphicsInfo.opts;
+  appendValue(m_bytes, opts.dynamicOpts);
+  appendValue(m_bytes, opts.staticFlags());
+  if (!(opts.dynamicOpts & EDynamicOpts::eExtendedDynamicState3PolygonMode)) {
+    appendValue(m_bytes, opts.rasterizationPolygonMode);
+  }
+  if (!(opts.dynamicOpts & EDynamicOpts::eExtendedDynamicState)) {
+    appendValue(m_bytes, opts.stencilCompareOp);
+    appendValue(m_bytes, opts.stencilLogicalOp);
+    appendValue(m_bytes, opts.stencilReference);
+    appendValue(m_bytes, opts.stencilCompareMask);
+    appendValue(m_bytes, opts.stencilWriteMask);
+  }
+
+  appendValue(m_bytes, graphicsInfo.pipelineLayout);
+
+  m_hash = fnv1aHashBytes(m_bytes.data(), m_bytes.size());
+}
+
 VkPipelineLayout createPipelineLayout(
     Device* device, VkDescriptorSetLayout const* pDescriptorSetLayouts,
     uint32_t descriptorSetLayoutCount,
@@ -23,9 +109,85 @@ VkPipelineLayout createPipelineLayout(
   createInfo.pPushConstantRanges = pPushConstantRanges;
 
   VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
-  VK_CHECK(vkDevApi->vkCreatePipelineLayout(dev, &createInfo, nullptr,
-                                            &pipelineLayout));
+  VK_CHECK(vkDevApi->vkCreatePipelineLayout(
+      dev, &createInfo,
+      device->allocationCallbacks(VK_OBJECT_TYPE_PIPELINE_LAYOUT),
+      &pipelineLayout));
   return pipelineLayout;
 }
 
+VkCullModeFlags cullModeFromFlags(EPipelineFlags flags) {
+  using U = std::underlying_type_t<EPipelineFlags>;
+  // eCullFront contains eCull, hence check the front bit alone
+  U const frontBit = static_cast<U>(EPipelineFlags::eCullFront) &
+                     ~static_cast<U>(EPipelineFlags::eCull);
+  if (!(flags & EPipelineFlags::eCull)) {
+    return VK_CULL_MODE_NONE;
+  }
+  return (static_cast<U>(flags) & frontBit) ? VK_CULL_MODE_FRONT_BIT
+                                            : VK_CULL_MODE_BACK_BIT;
+}
+
+VkFrontFace frontFaceFromFlags(EPipelineFlags flags) {
+  return (flags & EPipelineFlags::eInvertFrontFace)
+             ? VK_FRONT_FACE_CLOCKWISE
+             : VK_FRONT_FACE_COUNTER_CLOCKWISE;
+}
+
+bool stencilTestEnabled(GraphicsInfo const& graphicsInfo) {
+  return graphicsInfo.opts.flags & EPipelineFlags::eStencilEnable &&
+         graphicsInfo.fragmentOut.stencilAttachmentFormat !=
+             VK_FORMAT_UNDEFINED;
+}
+
+void stencilOpStatesFromOpts(GraphicsInfo::PipelineOpts const& opts,
+                             VkStencilOpState& front, VkStencilOpState& back) {
+  switch (opts.stencilCompareOp) {
+    case EStencilCompareOp::eEqual:
+      front.compareOp = VK_COMPARE_OP_EQUAL;
+      break;
+    case EStencilCompareOp::eNotEqual:
+      front.compareOp = VK_COMPARE_OP_NOT_EQUAL;
+      break;
+    case EStencilCompareOp::eAlways:
+    case EStencilCompareOp::eNone:
+      front.compareOp = VK_COMPARE_OP_ALWAYS;
+      break;
+  }
+
+  // reference, compare mask and write mask for stencil buffer
+  front.reference = opts.stencilReference;
+  front.compareMask = opts.stencilCompareMask;
+  front.writeMask = opts.stencilWriteMask;
+
+  switch (opts.stencilLogicalOp) {
+    case EStencilLogicOp::eReplace:
+      front.failOp = VK_STENCIL_OP_KEEP;
+      front.passOp = VK_STENCIL_OP_REPLACE;
+      front.depthFailOp = VK_STENCIL_OP_KEEP;
+      back = front;
+      break;
+    case EStencilLogicOp::eCountDepthPass:
+      front.failOp = VK_STENCIL_OP_KEEP;
+      front.passOp = VK_STENCIL_OP_DECREMENT_AND_WRAP;
+      front.depthFailOp = VK_STENCIL_OP_KEEP;
+      back = front;
+      back.passOp = VK_STENCIL_OP_INCREMENT_AND_WRAP;
+      break;
+    case EStencilLogicOp::eCountDepthFail:
+      front.passOp = VK_STENCIL_OP_KEEP;
+      front.failOp = VK_STENCIL_OP_KEEP;
+      front.depthFailOp = VK_STENCIL_OP_INCREMENT_AND_WRAP;
+      back = front;
+      back.depthFailOp = VK_STENCIL_OP_DECREMENT_AND_WRAP;
+      break;
+    case EStencilLogicOp::eNone:
+      front.passOp = VK_STENCIL_OP_KEEP;
+      front.failOp = VK_STENCIL_OP_KEEP;
+      front.depthFailOp = VK_STENCIL_OP_KEEP;
+      back = front;
+      break;
+  }
+}
+
 }  // namespace avk::vk
\ No newline at end of file
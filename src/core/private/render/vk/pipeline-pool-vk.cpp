@@ -5,7 +5,10 @@
 #include "render/vk/discard-pool.h"
 
 // library and stuff
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <sstream>
 
 // ---------------------------------------------------------------------------
 // Static Utility for Constructor
@@ -20,7 +23,8 @@ static inline void ctorShaderStageCreateInfo(
   stages.module = VK_NULL_HANDLE;
   // OpEntryPoint in SPIR-V
   stages.pName = "main";
-  stages.pSpecializationInfo = nullptr;  // TODO
+  // set at creation if the stage has specialization constants
+  stages.pSpecializationInfo = nullptr;
 }
 
 static inline void ctorVertexInputStateCreateInfo(
@@ -190,6 +194,23 @@ static inline void ctorColorBlendStateCreateInfo(
 // ---------------------------------------------------------------------------
 // Static Utility for creation
 // ---------------------------------------------------------------------------
+// points the given VkSpecializationInfo to the key's storage. Returns what
+// should go into `pSpecializationInfo` (null if no constants)
+static VkSpecializationInfo const* setSpecializationInfo(
+    avk::vk::SpecializationConstants const& constants,
+    VkSpecializationInfo& specializationInfo) {
+  if (constants.empty()) {
+    specializationInfo = {};
+    return nullptr;
+  }
+  specializationInfo.mapEntryCount =
+      static_cast<uint32_t>(constants.mapEntries.size());
+  specializationInfo.pMapEntries = constants.mapEntries.data();
+  specializationInfo.dataSize = constants.data.size();
+  specializationInfo.pData = constants.data.data();
+  return &specializationInfo;
+}
+
 static void setDepthStencilStateCreateInfo(
     avk::vk::GraphicsInfo const& graphicsInfo,
     VkPipelineDepthStencilStateCreateInfo& depthStencilState) {
@@ -200,56 +221,49 @@ static void setDepthStencilStateCreateInfo(
     depthStencilState.depthWriteEnable = VK_FALSE;
   }
 
-  if (graphicsInfo.opts.flags & EPipelineFlags::eStencilEnable &&
-      graphicsInfo.fragmentOut.stencilAttachmentFormat != VK_FORMAT_UNDEFINED) {
+  if (stencilTestEnabled(graphicsInfo)) {
     depthStencilState.stencilTestEnable = VK_TRUE;
-    switch (graphicsInfo.opts.stencilCompareOp) {
-      case EStencilCompareOp::eEqual:
-        depthStencilState.front.compareOp = VK_COMPARE_OP_EQUAL;
-        break;
-      case EStencilCompareOp::eNotEqual:
-        depthStencilState.front.compareOp = VK_COMPARE_OP_NOT_EQUAL;
-        break;
-      case EStencilCompareOp::eAlways:
-      case EStencilCompareOp::eNone:
-        depthStencilState.front.compareOp = VK_COMPARE_OP_ALWAYS;
-        break;
-    }
+    stencilOpStatesFromOpts(graphicsInfo.opts, depthStencilState.front,
+                            depthStencilState.back);
+  }
+}
 
-    // reference, compare mask and write mask for stencil buffer
-    depthStencilState.front.reference = graphicsInfo.opts.stencilReference;
-    depthStencilState.front.compareMask = graphicsInfo.opts.stencilCompareMask;
-    depthStencilState.front.writeMask = graphicsInfo.opts.stencilWriteMask;
-
-    switch (graphicsInfo.opts.stencilLogicalOp) {
-      case EStencilLogicOp::eReplace:
-        depthStencilState.front.failOp = VK_STENCIL_OP_KEEP;
-        depthStencilState.front.passOp = VK_STENCIL_OP_REPLACE;
-        depthStencilState.front.depthFailOp = VK_STENCIL_OP_KEEP;
-        depthStencilState.back = depthStencilState.front;
-        break;
-      case EStencilLogicOp::eCountDepthPass:
-        depthStencilState.front.failOp = VK_STENCIL_OP_KEEP;
-        depthStencilState.front.passOp = VK_STENCIL_OP_DECREMENT_AND_WRAP;
-        depthStencilState.front.depthFailOp = VK_STENCIL_OP_KEEP;
-        depthStencilState.back = depthStencilState.front;
-        depthStencilState.back.passOp = VK_STENCIL_OP_INCREMENT_AND_WRAP;
-        break;
-      case EStencilLogicOp::eCountDepthFail:
-        depthStencilState.front.passOp = VK_STENCIL_OP_KEEP;
-        depthStencilState.front.failOp = VK_STENCIL_OP_KEEP;
-        depthStencilState.front.depthFailOp = VK_STENCIL_OP_INCREMENT_AND_WRAP;
-        depthStencilState.back = depthStencilState.front;
-        depthStencilState.back.depthFailOp = VK_STENCIL_OP_DECREMENT_AND_WRAP;
-        break;
-      case EStencilLogicOp::eNone:
-        depthStencilState.front.passOp = VK_STENCIL_OP_KEEP;
-        depthStencilState.front.failOp = VK_STENCIL_OP_KEEP;
-        depthStencilState.front.depthFailOp = VK_STENCIL_OP_KEEP;
-        depthStencilState.back = depthStencilState.front;
-        break;
-    }
+// ---------------------------------------------------------------------------
+// Static Utility for statistics
+// ---------------------------------------------------------------------------
+static uint64_t elapsedNs(std::chrono::steady_clock::time_point start) {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start)
+          .count());
+}
+
+// bucket i -> [2^i, 2^(i+1)) microseconds, last bucket open ended
+static uint32_t compileHistogramBucket(uint64_t durationNs) {
+  uint64_t micros = durationNs / 1000;
+  uint32_t bucket = 0;
+  while (micros > 1 &&
+         bucket + 1 < avk::vk::PipelinePool::CompileHistogramBucketCount) {
+    micros >>= 1;
+    ++bucket;
   }
+  return bucket;
+}
+
+static void writeFeedbackJson(std::ostringstream& oss,
+                              VkPipelineCreationFeedbackEXT const& feedback) {
+  bool const valid =
+      feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT;
+  bool const cacheHit =
+      feedback.flags &
+      VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT;
+  bool const baseAcceleration =
+      feedback.flags &
+      VK_PIPELINE_CREATION_FEEDBACK_BASE_PIPELINE_ACCELERATION_BIT_EXT;
+  oss << "{\"valid\": " << (valid ? "true" : "false")
+      << ", \"cacheHit\": " << (cacheHit ? "true" : "false")
+      << ", \"baseAcceleration\": " << (baseAcceleration ? "true" : "false")
+      << ", \"durationNs\": " << feedback.duration << "}";
 }
 
 // ---------------------------------------------------------------------------
@@ -260,11 +274,12 @@ namespace avk::vk {
 
 void PipelinePool::clearGraphicsPipelineStates() {
   // -- Graphics Pipeline: Shader Stages --
-  // TODO: specialization contants
   m_graphicsPipelineCreateInfo.stageCount = 0;
-  m_pipelineShaderStageCreateInfos[0].module = VK_NULL_HANDLE;
-  m_pipelineShaderStageCreateInfos[1].module = VK_NULL_HANDLE;
-  m_pipelineShaderStageCreateInfos[2].module = VK_NULL_HANDLE;
+  for (uint32_t i = 0; i < ShaderStageCount; ++i) {
+    m_pipelineShaderStageCreateInfos[i].module = VK_NULL_HANDLE;
+    m_pipelineShaderStageCreateInfos[i].pSpecializationInfo = nullptr;
+    m_specializationInfos[i] = {};
+  }
 
   // -- Graphics Pipeline: Vertex Input --
   m_pipelineVertexInputStateCreateInfo.vertexAttributeDescriptionCount = 0;
@@ -311,6 +326,13 @@ void PipelinePool::clearGraphicsPipelineStates() {
   m_pipelineDynamicStateCreateInfo.dynamicStateCount = 0;
   m_pipelineDynamicStateCreateInfo.pDynamicStates = nullptr;
 
+  // -- Graphics Pipeline: Dynamic Rendering --
+  m_graphicsPipelineCreateInfo.pNext = nullptr;
+  m_pipelineRenderingCreateInfo.colorAttachmentCount = 0;
+  m_pipelineRenderingCreateInfo.pColorAttachmentFormats = nullptr;
+  m_pipelineRenderingCreateInfo.depthAttachmentFormat = VK_FORMAT_UNDEFINED;
+  m_pipelineRenderingCreateInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+
   // -- Common Values --
   m_graphicsPipelineCreateInfo.flags = 0;
   m_graphicsPipelineCreateInfo.layout = VK_NULL_HANDLE;
@@ -336,6 +358,7 @@ PipelinePool::PipelinePool(Device* device) : m_deps{device} {
   m_computePipelineCreateInfo.stage.pName = "main";
   m_computePipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
   // stage.pSpecializationInfo, stage.module populate in create function
+  m_computeSpecializationInfo = {};
 
   // initialize graphics pipeline create info
   m_graphicsPipelineCreateInfo = {};
@@ -372,6 +395,7 @@ PipelinePool::PipelinePool(Device* device) : m_deps{device} {
   // -- Graphics Pipeline: Shader Stages --
   for (uint32_t i = 0; i < ShaderStageCount; ++i) {
     ctorShaderStageCreateInfo(m_pipelineShaderStageCreateInfos[i]);
+    m_specializationInfos[i] = {};
   }
 
   // 0. VK_SHADER_STAGE_VERTEX_BIT
@@ -422,10 +446,51 @@ PipelinePool::PipelinePool(Device* device) : m_deps{device} {
   m_dynamicStates.reserve(64);
   m_dynamicStates.push_back(VK_DYNAMIC_STATE_VIEWPORT);
   m_dynamicStates.push_back(VK_DYNAMIC_STATE_SCISSOR);
+  // extended dynamic state takes options out of the pipeline key
+  m_dynamicOpts = EDynamicOpts::eNone;
+  if (device->extendedDynamicState()) {
+    m_dynamicOpts |= EDynamicOpts::eExtendedDynamicState;
+    m_dynamicStates.push_back(VK_DYNAMIC_STATE_CULL_MODE_EXT);
+    m_dynamicStates.push_back(VK_DYNAMIC_STATE_FRONT_FACE_EXT);
+    m_dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT);
+    m_dynamicStates.push_back(VK_DYNAMIC_STATE_STENCIL_TEST_ENABLE_EXT);
+    m_dynamicStates.push_back(VK_DYNAMIC_STATE_STENCIL_OP_EXT);
+    // core 1.0
+    m_dynamicStates.push_back(VK_DYNAMIC_STATE_STENCIL_COMPARE_MASK);
+    m_dynamicStates.push_back(VK_DYNAMIC_STATE_STENCIL_WRITE_MASK);
+    m_dynamicStates.push_back(VK_DYNAMIC_STATE_STENCIL_REFERENCE);
+  }
+  if (device->extendedDynamicState2()) {
+    m_dynamicOpts |= EDynamicOpts::eExtendedDynamicState2;
+    m_dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_BIAS_ENABLE_EXT);
+  }
+  if (device->extendedDynamicState3PolygonMode()) {
+    m_dynamicOpts |= EDynamicOpts::eExtendedDynamicState3PolygonMode;
+    m_dynamicStates.push_back(VK_DYNAMIC_STATE_POLYGON_MODE_EXT);
+  }
   m_dynamicStates.push_back(VK_DYNAMIC_STATE_LINE_WIDTH);
+
+  // -- Graphics Pipeline: Dynamic Rendering --
+  // formats given at creation, view mask 0 (no multiview)
+  m_pipelineRenderingCreateInfo = {};
+  m_pipelineRenderingCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+
+  // -- Pipeline Cache --
+  VkPipelineCacheCreateInfo pipelineCacheCreateInfo{};
+  pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  VK_CHECK(device->table()->vkCreatePipelineCache(
+      device->device(), &pipelineCacheCreateInfo,
+      device->allocationCallbacks(VK_OBJECT_TYPE_PIPELINE_CACHE),
+      &m_pipelineCache));
 }
 
-PipelinePool::~PipelinePool() { destroyAllPipelines(); }
+PipelinePool::~PipelinePool() AVK_NO_CFI {
+  destroyAllPipelines();
+  m_deps.device->table()->vkDestroyPipelineCache(
+      m_deps.device->device(), m_pipelineCache,
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_PIPELINE_CACHE));
+}
 
 VkPipeline PipelinePool::getOrCreateComputePipeline(
     ComputeInfo& computeInfo,
@@ -437,15 +502,19 @@ VkPipeline PipelinePool::getOrCreateComputePipeline(
   std::lock_guard<std::mutex> lk{m_mutex};
   if (auto it = m_computePipelines.find(computeInfo);
       it != m_computePipelines.end()) {
-    VkPipeline result = it->second;
+    VkPipeline result = it->second.pipeline;
     assert(result != VK_NULL_HANDLE);
+    it->second.lastUse = ++m_useTick;
+    ++m_statistics.hits;
     return result;
   }
+  ++m_statistics.misses;
 
   // populate parametrized fields of the create info
-  // TODO: specialization contants
   m_computePipelineCreateInfo.layout = computeInfo.pipelineLayout;
   m_computePipelineCreateInfo.stage.module = computeInfo.shaderModule;
+  m_computePipelineCreateInfo.stage.pSpecializationInfo = setSpecializationInfo(
+      computeInfo.specialization, m_computeSpecializationInfo);
   // !: if base, assume you desire a pipeline derivative (ie, if delete parent
   // pipeline child is invalid)
   if (pipelineBase != VK_NULL_HANDLE) {
@@ -459,41 +528,110 @@ VkPipeline PipelinePool::getOrCreateComputePipeline(
   //       VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
   // }
 
-  // TODO insert pipeline cache static or not
+  VkPipelineCreationFeedbackEXT feedback{};
+  VkPipelineCreationFeedbackEXT stageFeedback{};
+  VkPipelineCreationFeedbackCreateInfoEXT feedbackCreateInfo{};
+  if (m_deps.device->pipelineCreationFeedback()) {
+    feedbackCreateInfo.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+    feedbackCreateInfo.pPipelineCreationFeedback = &feedback;
+    feedbackCreateInfo.pipelineStageCreationFeedbackCount = 1;
+    feedbackCreateInfo.pPipelineStageCreationFeedbacks = &stageFeedback;
+    m_computePipelineCreateInfo.pNext = &feedbackCreateInfo;
+  }
+
   VkPipeline pipeline = VK_NULL_HANDLE;
   // TODO host memory allocators
-  VK_CHECK(vkDevApi->vkCreateComputePipelines(dev, VK_NULL_HANDLE, 1,
-                                              &m_computePipelineCreateInfo,
-                                              nullptr, &pipeline));
+  auto const start = std::chrono::steady_clock::now();
+  VK_CHECK(vkDevApi->vkCreateComputePipelines(
+      dev, m_pipelineCache, 1, &m_computePipelineCreateInfo,
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_PIPELINE), &pipeline));
   assert(pipeline != VK_NULL_HANDLE);
-  m_computePipelines.try_emplace(computeInfo, pipeline);
+  uint64_t const durationNs = elapsedNs(start);
+  recordCompile(pipeline, false, durationNs, feedback, &stageFeedback, 1);
+  m_computePipelines.try_emplace(computeInfo,
+                                 CachedPipeline{pipeline, ++m_useTick});
 
   // cleanup
+  m_computePipelineCreateInfo.pNext = nullptr;
   m_computePipelineCreateInfo.layout = VK_NULL_HANDLE;
   m_computePipelineCreateInfo.flags = 0;
   m_computePipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
   m_computePipelineCreateInfo.stage.module = {};
-  // TODO: specialization contants cleanup
+  m_computePipelineCreateInfo.stage.pSpecializationInfo = nullptr;
+  m_computeSpecializationInfo = {};
 
   return pipeline;
 }
 
 VkPipeline PipelinePool::getOrCreateGraphicsPipeline(
     GraphicsInfo& graphicsInfo, [[maybe_unused]] bool isStaticShader,
+    VkPipeline pipelineBase) {
+  // options which are dynamic on this device are not part of the key
+  graphicsInfo.opts.dynamicOpts = m_dynamicOpts;
+
+  std::lock_guard<std::mutex> lk{m_mutex};
+  m_lookupKey.assign(graphicsInfo);
+  return findOrCreateGraphicsPipeline(graphicsInfo, internLookupKey(),
+                                      pipelineBase);
+}
+
+PipelinePool::GraphicsKeyID PipelinePool::internGraphicsKey(
+    GraphicsInfo& graphicsInfo) {
+  graphicsInfo.opts.dynamicOpts = m_dynamicOpts;
+
+  std::lock_guard<std::mutex> lk{m_mutex};
+  m_lookupKey.assign(graphicsInfo);
+  return internLookupKey();
+}
+
+VkPipeline PipelinePool::getOrCreateGraphicsPipeline(
+    GraphicsInfo const& graphicsInfo, GraphicsKeyID& graphicsKeyID,
+    [[maybe_unused]] bool isStaticShader, VkPipeline pipelineBase) {
+  assert(graphicsInfo.opts.dynamicOpts == m_dynamicOpts &&
+         "key not interned by internGraphicsKey");
+
+  std::lock_guard<std::mutex> lk{m_mutex};
+  if (m_graphicsKeys.find(graphicsKeyID) == nullptr) {
+    // released with its pipeline, the slow path of a miss anyway
+    m_lookupKey.assign(graphicsInfo);
+    graphicsKeyID = internLookupKey();
+  }
+#ifdef AVK_DEBUG
+  else {
+    m_lookupKey.assign(graphicsInfo);
+    assert(m_graphicsKeys.idOf(m_lookupKey) == graphicsKeyID &&
+           "graphicsInfo changed since internGraphicsKey");
+  }
+#endif
+  return findOrCreateGraphicsPipeline(graphicsInfo, graphicsKeyID,
+                                      pipelineBase);
+}
+
+PipelinePool::GraphicsKeyID PipelinePool::internLookupKey() {
+  GraphicsKeyID const graphicsKeyID = m_graphicsKeys.intern(m_lookupKey);
+  m_graphicsKeys.find(graphicsKeyID)->pipelineLayout =
+      m_lookupKey.pipelineLayout();
+  return graphicsKeyID;
+}
+
+VkPipeline PipelinePool::findOrCreateGraphicsPipeline(
+    GraphicsInfo const& graphicsInfo, GraphicsKeyID graphicsKeyID,
     VkPipeline pipelineBase) AVK_NO_CFI {
   auto const* const vkDevApi = m_deps.device->table();
   VkDevice const dev = m_deps.device->device();
 
-  std::lock_guard<std::mutex> lk{m_mutex};
-  if (auto it = m_graphicsPipelines.find(graphicsInfo);
-      it != m_graphicsPipelines.end()) {
-    VkPipeline pipeline = it->second;
-    assert(pipeline != VK_NULL_HANDLE);
-    return pipeline;
+  GraphicsSlot* const slot = m_graphicsKeys.find(graphicsKeyID);
+  assert(slot);
+  if (CachedPipeline& cached = slot->cached;
+      cached.pipeline != VK_NULL_HANDLE) {
+    cached.lastUse = ++m_useTick;
+    ++m_statistics.hits;
+    return cached.pipeline;
   }
+  ++m_statistics.misses;
 
   // parametrize create info
-  // TODO: specialization contants
   // -- Graphics Pipeline: Shader Stages --
   // make geometry module optional
   // TODO: Add support for more stages in programmed primitive shading, and add
@@ -506,6 +644,17 @@ VkPipeline PipelinePool::getOrCreateGraphicsPipeline(
       graphicsInfo.fragmentShader.fragmentModule;
   m_pipelineShaderStageCreateInfos[2].module =
       graphicsInfo.preRasterization.geometryModule;
+  // specialization data lives in the key, which outlives the create call
+  m_pipelineShaderStageCreateInfos[0].pSpecializationInfo =
+      setSpecializationInfo(graphicsInfo.preRasterization.vertexSpecialization,
+                            m_specializationInfos[0]);
+  m_pipelineShaderStageCreateInfos[1].pSpecializationInfo =
+      setSpecializationInfo(graphicsInfo.fragmentShader.fragmentSpecialization,
+                            m_specializationInfos[1]);
+  m_pipelineShaderStageCreateInfos[2].pSpecializationInfo =
+      setSpecializationInfo(
+          graphicsInfo.preRasterization.geometrySpecialization,
+          m_specializationInfos[2]);
 
   // -- Graphics Pipeline: Vertex Input --
   m_pipelineVertexInputStateCreateInfo.vertexAttributeDescriptionCount =
@@ -532,27 +681,28 @@ VkPipeline PipelinePool::getOrCreateGraphicsPipeline(
       static_cast<uint32_t>(graphicsInfo.fragmentShader.scissors.size());
 
   // -- Graphics Pipeline: Rasterization State --
-  if (graphicsInfo.opts.flags & EPipelineFlags::eDepthBias) {
+  // with dynamic depth bias enable, the key doesn't know whether depth bias is
+  // used, hence the factors are always given
+  if (graphicsInfo.opts.flags & EPipelineFlags::eDepthBias ||
+      m_dynamicOpts & EDynamicOpts::eExtendedDynamicState2) {
     // VUID-VkGraphicsPipelineCreateInfo-pDynamicStates-00754
     // if depthBias and no depthBiasClamp feature enabled (TODO) then 0
-    m_pipelineRasterizationStateCreateInfo.depthBiasEnable = VK_TRUE;
+    m_pipelineRasterizationStateCreateInfo.depthBiasEnable =
+        (graphicsInfo.opts.flags & EPipelineFlags::eDepthBias) ? VK_TRUE
+                                                               : VK_FALSE;
     m_pipelineRasterizationStateCreateInfo.depthBiasConstantFactor = 1.f;
     m_pipelineRasterizationStateCreateInfo.depthBiasClamp = 0;  // -> 0x1p-13f;
     m_pipelineRasterizationStateCreateInfo.depthBiasSlopeFactor = 2.f;
     m_pipelineRasterizationStateCreateInfo.lineWidth = 1.f;
   }
   // TODO: check polygon mode support
+  // when dynamic, these are only initial values ignored by the driver
   m_pipelineRasterizationStateCreateInfo.polygonMode =
       graphicsInfo.opts.rasterizationPolygonMode;
-  if (graphicsInfo.opts.flags & ~EPipelineFlags::eCull) {
-    m_pipelineRasterizationStateCreateInfo.cullMode = VK_CULL_MODE_NONE;
-  } else if (graphicsInfo.opts.flags & EPipelineFlags::eCullFront) {
-    m_pipelineRasterizationStateCreateInfo.cullMode = VK_CULL_MODE_FRONT_BIT;
-  }  // else default: cull back face
-
-  if (graphicsInfo.opts.flags & EPipelineFlags::eInvertFrontFace) {
-    m_pipelineRasterizationStateCreateInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
-  }
+  m_pipelineRasterizationStateCreateInfo.cullMode =
+      cullModeFromFlags(graphicsInfo.opts.flags);
+  m_pipelineRasterizationStateCreateInfo.frontFace =
+      frontFaceFromFlags(graphicsInfo.opts.flags);
   // TODO maybe provoking vertex
 
   // -- Graphics Pipeline: Multisample State --
@@ -612,6 +762,23 @@ VkPipeline PipelinePool::getOrCreateGraphicsPipeline(
   }
   m_graphicsPipelineCreateInfo.renderPass = graphicsInfo.renderPass;
   m_graphicsPipelineCreateInfo.subpass = graphicsInfo.subpass;
+  // -- Graphics Pipeline: Dynamic Rendering --
+  // no render pass -> attachment formats are the render pass compatibility
+  if (graphicsInfo.renderPass == VK_NULL_HANDLE) {
+    assert(m_deps.device->dynamicRendering());
+    // VUID-VkGraphicsPipelineCreateInfo-renderPass-06055 (see color blend)
+    assert(graphicsInfo.fragmentOut.colorAttachmentFormats.size() ==
+           colorAttachmentNum);
+    m_pipelineRenderingCreateInfo.colorAttachmentCount = colorAttachmentNum;
+    m_pipelineRenderingCreateInfo.pColorAttachmentFormats =
+        graphicsInfo.fragmentOut.colorAttachmentFormats.data();
+    m_pipelineRenderingCreateInfo.depthAttachmentFormat =
+        graphicsInfo.fragmentOut.depthAttachmentFormat;
+    m_pipelineRenderingCreateInfo.stencilAttachmentFormat =
+        graphicsInfo.fragmentOut.stencilAttachmentFormat;
+    m_graphicsPipelineCreateInfo.pNext = &m_pipelineRenderingCreateInfo;
+    m_graphicsPipelineCreateInfo.subpass = 0;
+  }
   // TODO read more about VK_EXT_descriptor_buffer
   // if (context.device().extensions.isEnabled(
   //         VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME)) {
@@ -619,13 +786,34 @@ VkPipeline PipelinePool::getOrCreateGraphicsPipeline(
   //       VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
   // }
 
+  // -- Creation Feedback --
+  // chained in front of the dynamic rendering info, if any
+  VkPipelineCreationFeedbackEXT feedback{};
+  VkPipelineCreationFeedbackEXT stageFeedbacks[ShaderStageCount]{};
+  VkPipelineCreationFeedbackCreateInfoEXT feedbackCreateInfo{};
+  if (m_deps.device->pipelineCreationFeedback()) {
+    feedbackCreateInfo.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+    feedbackCreateInfo.pNext = m_graphicsPipelineCreateInfo.pNext;
+    feedbackCreateInfo.pPipelineCreationFeedback = &feedback;
+    // if not zero, must match the stage count
+    feedbackCreateInfo.pipelineStageCreationFeedbackCount =
+        m_graphicsPipelineCreateInfo.stageCount;
+    feedbackCreateInfo.pPipelineStageCreationFeedbacks = stageFeedbacks;
+    m_graphicsPipelineCreateInfo.pNext = &feedbackCreateInfo;
+  }
+
   VkPipeline pipeline = VK_NULL_HANDLE;
-  // TODO pipeline cache
+  auto const start = std::chrono::steady_clock::now();
   VkResult const res = vkDevApi->vkCreateGraphicsPipelines(
-      dev, VK_NULL_HANDLE, 1, &m_graphicsPipelineCreateInfo, nullptr,
-      &pipeline);
+      dev, m_pipelineCache, 1, &m_graphicsPipelineCreateInfo,
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_PIPELINE), &pipeline);
   VK_CHECK(res);
-  m_graphicsPipelines.try_emplace(graphicsInfo, pipeline);
+  uint64_t const durationNs = elapsedNs(start);
+  recordCompile(pipeline, true, durationNs, feedback, stageFeedbacks,
+                m_graphicsPipelineCreateInfo.stageCount);
+  slot->cached = CachedPipeline{pipeline, ++m_useTick};
+  ++m_graphicsPipelineCount;
 
   // cleanup create info
   clearGraphicsPipelineStates();
@@ -633,6 +821,47 @@ VkPipeline PipelinePool::getOrCreateGraphicsPipeline(
   return pipeline;
 }
 
+void PipelinePool::cmdSetDynamicOpts(
+    VkCommandBuffer cmd, GraphicsInfo const& graphicsInfo) const AVK_NO_CFI {
+  auto const* const vkDevApi = m_deps.device->table();
+  if (m_dynamicOpts & EDynamicOpts::eExtendedDynamicState) {
+    EPipelineFlags const flags = graphicsInfo.opts.flags;
+    vkDevApi->vkCmdSetCullModeEXT(cmd, cullModeFromFlags(flags));
+    vkDevApi->vkCmdSetFrontFaceEXT(cmd, frontFaceFromFlags(flags));
+    vkDevApi->vkCmdSetDepthWriteEnableEXT(
+        cmd, (flags & EPipelineFlags::eNoDepthWrite) ? VK_FALSE : VK_TRUE);
+    bool const stencilEnable = stencilTestEnabled(graphicsInfo);
+    vkDevApi->vkCmdSetStencilTestEnableEXT(cmd,
+                                           stencilEnable ? VK_TRUE : VK_FALSE);
+    // stencil state must be set even if disabled (previous pipeline may have
+    // left anything). Front and back differ on counting modes
+    VkStencilOpState front{};
+    VkStencilOpState back{};
+    stencilOpStatesFromOpts(graphicsInfo.opts, front, back);
+    vkDevApi->vkCmdSetStencilOpEXT(cmd, VK_STENCIL_FACE_FRONT_BIT, front.failOp,
+                                   front.passOp, front.depthFailOp,
+                                   front.compareOp);
+    vkDevApi->vkCmdSetStencilOpEXT(cmd, VK_STENCIL_FACE_BACK_BIT, back.failOp,
+                                   back.passOp, back.depthFailOp,
+                                   back.compareOp);
+    vkDevApi->vkCmdSetStencilCompareMask(cmd, VK_STENCIL_FACE_FRONT_AND_BACK,
+                                         graphicsInfo.opts.stencilCompareMask);
+    vkDevApi->vkCmdSetStencilWriteMask(cmd, VK_STENCIL_FACE_FRONT_AND_BACK,
+                                       graphicsInfo.opts.stencilWriteMask);
+    vkDevApi->vkCmdSetStencilReference(cmd, VK_STENCIL_FACE_FRONT_AND_BACK,
+                                       graphicsInfo.opts.stencilReference);
+  }
+  if (m_dynamicOpts & EDynamicOpts::eExtendedDynamicState2) {
+    vkDevApi->vkCmdSetDepthBiasEnableEXT(
+        cmd, (graphicsInfo.opts.flags & EPipelineFlags::eDepthBias) ? VK_TRUE
+                                                                   : VK_FALSE);
+  }
+  if (m_dynamicOpts & EDynamicOpts::eExtendedDynamicState3PolygonMode) {
+    vkDevApi->vkCmdSetPolygonModeEXT(
+        cmd, graphicsInfo.opts.rasterizationPolygonMode);
+  }
+}
+
 void PipelinePool::discardAllPipelines(DiscardPool* discardPool,
                                        VkPipelineLayout pipelineLayout,
                                        uint64_t value) {
@@ -640,22 +869,39 @@ void PipelinePool::discardAllPipelines(DiscardPool* discardPool,
   for (auto it = m_computePipelines.begin(); it != m_computePipelines.end();
        /*inside*/) {
     if (it->first.pipelineLayout == pipelineLayout) {
-      discardPool->discardPipeline(it->second, value);
+      discardPool->discardPipeline(it->second.pipeline, value);
+      eraseCompileRecord(it->second.pipeline);
+      ++m_statistics.evictions;
       it = m_computePipelines.erase(it);
     } else {
       ++it;
     }
   }
 
-  for (auto it = m_graphicsPipelines.begin(); it != m_graphicsPipelines.end();
-       /*inside */) {
-    if (it->first.pipelineLayout == pipelineLayout) {
-      discardPool->discardPipeline(it->second, value);
-      it = m_graphicsPipelines.erase(it);
+  // keys interned without a pipeline go too, as the layout may be destroyed
+  // and its handle recycled
+  m_graphicsKeys.forEach([&](GraphicsKeyID id, GraphicsSlot& slot) {
+    if (slot.pipelineLayout != pipelineLayout) {
+      return;
+    }
+    if (slot.cached.pipeline != VK_NULL_HANDLE) {
+      discardGraphicsSlot(id, slot, discardPool, value);
     } else {
-      ++it;
+      m_graphicsKeys.release(id);
     }
-  }
+  });
+}
+
+void PipelinePool::discardGraphicsSlot(GraphicsKeyID graphicsKeyID,
+                                       GraphicsSlot& slot,
+                                       DiscardPool* discardPool,
+                                       uint64_t value) {
+  assert(slot.cached.pipeline != VK_NULL_HANDLE);
+  discardPool->discardPipeline(slot.cached.pipeline, value);
+  eraseCompileRecord(slot.cached.pipeline);
+  ++m_statistics.evictions;
+  --m_graphicsPipelineCount;
+  m_graphicsKeys.release(graphicsKeyID);
 }
 
 void PipelinePool::readStaticCacheFromDisk() AVK_NO_CFI {
@@ -671,16 +917,220 @@ void PipelinePool::destroyAllPipelines() AVK_NO_CFI {
   VkDevice const dev = m_deps.device->device();
 
   std::lock_guard<std::mutex> lk{m_mutex};
-  for (auto& [info, pipeline] : m_computePipelines) {
-    vkDevApi->vkDestroyPipeline(dev, pipeline, nullptr);
-  }
-  for (auto& [info, pipeline] : m_graphicsPipelines) {
-    vkDevApi->vkDestroyPipeline(dev, pipeline, nullptr);
+  for (auto& [info, cached] : m_computePipelines) {
+    vkDevApi->vkDestroyPipeline(
+        dev, cached.pipeline,
+        m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_PIPELINE));
   }
-  // info struct are externally cleaned, so forget them
+  m_graphicsKeys.forEach([&](GraphicsKeyID, GraphicsSlot& slot) {
+    if (slot.cached.pipeline != VK_NULL_HANDLE) {
+      vkDevApi->vkDestroyPipeline(
+          dev, slot.cached.pipeline,
+          m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_PIPELINE));
+    }
+  });
+  // info struct are externally cleaned, so forget them. Interned IDs become
+  // invalid, and are interned again by their next lookup
+  m_graphicsKeys.clear();
   m_computePipelines.clear();
-  m_graphicsPipelines.clear();
-  // TODO destroy pipeline cache
+  m_graphicsPipelineCount = 0;
+  m_compileRecords.clear();
+  m_estimatedBytes = 0;
+}
+
+void PipelinePool::setEvictionPolicy(EvictionPolicy const& policy) {
+  std::lock_guard<std::mutex> lk{m_mutex};
+  m_evictionPolicy = policy;
+}
+
+void PipelinePool::evictPipelines(DiscardPool* discardPool, uint64_t value) {
+  std::lock_guard<std::mutex> lk{m_mutex};
+  // the cache doesn't shrink with evictions, hence its own bound. Pipelines
+  // don't depend on the cache they were created with
+  if (m_evictionPolicy.maxPipelineCacheBytes &&
+      pipelineCacheBytes() > m_evictionPolicy.maxPipelineCacheBytes) {
+    resetPipelineCache();
+    ++m_statistics.pipelineCacheResets;
+  }
+  auto const overBudget = [this]() {
+    size_t const count = m_graphicsPipelineCount + m_computePipelines.size();
+    return (m_evictionPolicy.maxPipelineCount &&
+            count > m_evictionPolicy.maxPipelineCount) ||
+           (m_evictionPolicy.maxEstimatedBytes &&
+            m_estimatedBytes > m_evictionPolicy.maxEstimatedBytes);
+  };
+  if (!overBudget()) {
+    return;
+  }
+
+  // sort all cached pipelines by last use, oldest first. Happens only when
+  // over budget, hence lookups stay a single tick increment
+  struct Candidate {
+    uint64_t lastUse;
+    GraphicsKeyID graphicsKeyID;
+    GraphicsSlot* graphicsSlot;
+    ComputeInfo const* computeInfo;
+  };
+  std::vector<Candidate> candidates;
+  candidates.reserve(m_graphicsPipelineCount + m_computePipelines.size());
+  // slots don't move while evicting, as nothing is interned
+  m_graphicsKeys.forEach([&](GraphicsKeyID id, GraphicsSlot& slot) {
+    if (slot.cached.pipeline != VK_NULL_HANDLE) {
+      candidates.push_back({slot.cached.lastUse, id, &slot, nullptr});
+    }
+  });
+  for (auto const& [info, cached] : m_computePipelines) {
+    candidates.push_back(
+        {cached.lastUse, GraphicsKeyTable<GraphicsSlot>::NullID, nullptr,
+         &info});
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](Candidate const& a, Candidate const& b) {
+              return a.lastUse < b.lastUse;
+            });
+
+  for (Candidate const& candidate : candidates) {
+    if (!overBudget()) {
+      break;
+    }
+    if (candidate.graphicsSlot) {
+      discardGraphicsSlot(candidate.graphicsKeyID, *candidate.graphicsSlot,
+                          discardPool, value);
+      continue;
+    }
+    // candidates point to keys, hence erase the map entry last
+    auto const it = m_computePipelines.find(*candidate.computeInfo);
+    assert(it != m_computePipelines.end());
+    discardPool->discardPipeline(it->second.pipeline, value);
+    eraseCompileRecord(it->second.pipeline);
+    m_computePipelines.erase(it);
+    ++m_statistics.evictions;
+  }
+}
+
+void PipelinePool::recordCompile(
+    VkPipeline pipeline, bool graphics, uint64_t durationNs,
+    VkPipelineCreationFeedbackEXT const& feedback,
+    VkPipelineCreationFeedbackEXT const* stageFeedbacks, uint32_t stageCount) {
+  assert(stageCount <= ShaderStageCount);
+  m_statistics.totalCompileNs += durationNs;
+  ++m_statistics.compileHistogram[compileHistogramBucket(durationNs)];
+
+  CompileRecord record{};
+  record.durationNs = durationNs;
+  record.graphics = graphics;
+  record.feedback = feedback;
+  record.stageCount = stageCount;
+  for (uint32_t i = 0; i < stageCount; ++i) {
+    record.stageFeedbacks[i] = stageFeedbacks[i];
+  }
+  record.estimatedBytes =
+      PipelineStageBytesEstimate * std::max<uint32_t>(stageCount, 1);
+  m_estimatedBytes += record.estimatedBytes;
+  m_compileRecords.insert_or_assign(pipeline, record);
+}
+
+void PipelinePool::eraseCompileRecord(VkPipeline pipeline) {
+  if (auto it = m_compileRecords.find(pipeline);
+      it != m_compileRecords.end()) {
+    assert(m_estimatedBytes >= it->second.estimatedBytes);
+    m_estimatedBytes -= it->second.estimatedBytes;
+    m_compileRecords.erase(it);
+  }
+}
+
+void PipelinePool::resetPipelineCache() AVK_NO_CFI {
+  auto const* const vkDevApi = m_deps.device->table();
+  VkDevice const dev = m_deps.device->device();
+  vkDevApi->vkDestroyPipelineCache(
+      dev, m_pipelineCache,
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_PIPELINE_CACHE));
+  m_pipelineCache = VK_NULL_HANDLE;
+  VkPipelineCacheCreateInfo pipelineCacheCreateInfo{};
+  pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  VK_CHECK(vkDevApi->vkCreatePipelineCache(
+      dev, &pipelineCacheCreateInfo,
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_PIPELINE_CACHE),
+      &m_pipelineCache));
+}
+
+size_t PipelinePool::pipelineCacheBytes() const AVK_NO_CFI {
+  size_t bytes = 0;
+  VK_CHECK(m_deps.device->table()->vkGetPipelineCacheData(
+      m_deps.device->device(), m_pipelineCache, &bytes, nullptr));
+  return bytes;
+}
+
+PipelinePool::Statistics PipelinePool::statistics() const AVK_NO_CFI {
+  std::lock_guard<std::mutex> lk{m_mutex};
+  Statistics statistics = m_statistics;
+  statistics.graphicsPipelineCount = m_graphicsPipelineCount;
+  statistics.computePipelineCount = m_computePipelines.size();
+  statistics.estimatedBytes = m_estimatedBytes;
+  statistics.pipelineCacheBytes = pipelineCacheBytes();
+  return statistics;
+}
+
+bool PipelinePool::compileRecord(VkPipeline pipeline,
+                                 CompileRecord& outRecord) const {
+  std::lock_guard<std::mutex> lk{m_mutex};
+  if (auto it = m_compileRecords.find(pipeline);
+      it != m_compileRecords.end()) {
+    outRecord = it->second;
+    return true;
+  }
+  return false;
+}
+
+std::string PipelinePool::statisticsJson() const {
+  Statistics const stats = statistics();
+  std::ostringstream oss;
+  oss << "{\n  \"hits\": " << stats.hits << ",\n  \"misses\": " << stats.misses
+      << ",\n  \"evictions\": " << stats.evictions
+      << ",\n  \"pipelineCacheBytes\": " << stats.pipelineCacheBytes
+      << ",\n  \"pipelineCacheResets\": " << stats.pipelineCacheResets
+      << ",\n  \"graphicsPipelineCount\": " << stats.graphicsPipelineCount
+      << ",\n  \"computePipelineCount\": " << stats.computePipelineCount
+      << ",\n  \"estimatedBytes\": " << stats.estimatedBytes
+      << ",\n  \"totalCompileNs\": " << stats.totalCompileNs
+      << ",\n  \"compileHistogram\": [";
+  for (uint32_t i = 0; i < CompileHistogramBucketCount; ++i) {
+    // upper bound in microseconds, null for the open ended bucket
+    oss << (i ? ", " : "") << "{\"lessThanUs\": ";
+    if (i + 1 < CompileHistogramBucketCount) {
+      oss << (uint64_t(1) << (i + 1));
+    } else {
+      oss << "null";
+    }
+    oss << ", \"count\": " << stats.compileHistogram[i] << "}";
+  }
+  oss << "],\n  \"pipelines\": [";
+
+  std::lock_guard<std::mutex> lk{m_mutex};
+  bool first = true;
+  for (auto const& [pipeline, record] : m_compileRecords) {
+    oss << (first ? "\n    " : ",\n    ") << "{\"handle\": \"0x" << std::hex
+        << reinterpret_cast<uint64_t>(pipeline) << std::dec
+        << "\", \"graphics\": " << (record.graphics ? "true" : "false")
+        << ", \"durationNs\": " << record.durationNs
+        << ", \"estimatedBytes\": " << record.estimatedBytes
+        << ", \"feedback\": ";
+    writeFeedbackJson(oss, record.feedback);
+    oss << ", \"stages\": [";
+    for (uint32_t i = 0; i < record.stageCount; ++i) {
+      oss << (i ? ", " : "");
+      writeFeedbackJson(oss, record.stageFeedbacks[i]);
+    }
+    oss << "]}";
+    first = false;
+  }
+  oss << (first ? "]\n}\n" : "\n  ]\n}\n");
+  return oss.str();
+}
+
+void PipelinePool::resetStatistics() {
+  std::lock_guard<std::mutex> lk{m_mutex};
+  m_statistics = {};
 }
 
 }  // namespace avk::vk
\ No newline at end of file
@@ -121,8 +121,109 @@ Expected<VkRenderPass> basicRenderPass(Device const* device, VkFormat colorFmt,
   createInfo.pDependencies = dependencies.data();
 
   maybeResult.result = vkDevApi->vkCreateRenderPass2KHR(
-      dev, &createInfo, nullptr, &maybeResult.handle);
+      dev, &createInfo, device->allocationCallbacks(VK_OBJECT_TYPE_RENDER_PASS),
+      &maybeResult.handle);
   return maybeResult;
 }
 
-}  // namespace avk::vk
\ No newline at end of file
+void basicBeginRendering(Device const* device, VkCommandBuffer cmd,
+                         VkImage colorImage, VkImageView colorView,
+                         VkImage depthImage, VkImageView depthView,
+                         VkRect2D renderArea,
+                         VkClearValue const* clear) AVK_NO_CFI {
+  auto const* const vkDevApi = device->table();
+
+  // same as the VK_SUBPASS_EXTERNAL -> 0 dependency of `basicRenderPass`,
+  // plus the layout transitions from its attachment descriptions
+  std::array<VkImageMemoryBarrier, 2> barriers{};
+  barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barriers[0].srcAccessMask = VK_ACCESS_NONE;
+  barriers[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+                              VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  barriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barriers[0].newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barriers[0].image = colorImage;
+  barriers[0].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barriers[0].subresourceRange.levelCount = 1;
+  barriers[0].subresourceRange.layerCount = 1;
+
+  // previous frame might still be writing the depth stencil image
+  barriers[1] = barriers[0];
+  barriers[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  barriers[1].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                              VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  barriers[1].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  barriers[1].image = depthImage;
+  barriers[1].subresourceRange.aspectMask =
+      VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+
+  VkPipelineStageFlags const attachmentStages =
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+      VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+      VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  vkDevApi->vkCmdPipelineBarrier(
+      cmd, attachmentStages, attachmentStages, VK_DEPENDENCY_BY_REGION_BIT, 0,
+      nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()),
+      barriers.data());
+
+  VkRenderingAttachmentInfoKHR colorAttachment{};
+  colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+  colorAttachment.imageView = colorView;
+  colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  colorAttachment.resolveMode = VK_RESOLVE_MODE_NONE;
+  colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  colorAttachment.clearValue = clear[0];
+
+  // depth and stencil aspects share the same view
+  VkRenderingAttachmentInfoKHR depthStencilAttachment{};
+  depthStencilAttachment.sType =
+      VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+  depthStencilAttachment.imageView = depthView;
+  depthStencilAttachment.imageLayout =
+      VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  depthStencilAttachment.resolveMode = VK_RESOLVE_MODE_NONE;
+  depthStencilAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  depthStencilAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthStencilAttachment.clearValue = clear[1];
+
+  VkRenderingInfoKHR renderingInfo{};
+  renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+  renderingInfo.renderArea = renderArea;
+  renderingInfo.layerCount = 1;
+  renderingInfo.viewMask = 0;
+  renderingInfo.colorAttachmentCount = 1;
+  renderingInfo.pColorAttachments = &colorAttachment;
+  renderingInfo.pDepthAttachment = &depthStencilAttachment;
+  renderingInfo.pStencilAttachment = &depthStencilAttachment;
+
+  vkDevApi->vkCmdBeginRenderingKHR(cmd, &renderingInfo);
+}
+
+void basicEndRendering(Device const* device, VkCommandBuffer cmd,
+                       VkImage colorImage) AVK_NO_CFI {
+  auto const* const vkDevApi = device->table();
+  vkDevApi->vkCmdEndRenderingKHR(cmd);
+
+  // same as the 0 -> VK_SUBPASS_EXTERNAL dependency of `basicRenderPass`
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  barrier.dstAccessMask = 0;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = colorImage;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.layerCount = 1;
+  vkDevApi->vkCmdPipelineBarrier(
+      cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+      VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1,
+      &barrier);
+}
+
+}  // namespace avk::vk
@@ -0,0 +1,332 @@
+#include "render/vk/shader-object-pool-vk.h"
+
+// my stuff
+#include "render/vk/device-vk.h"
+#include "render/vk/discard-pool.h"
+
+// library and stuff
+#include <cassert>
+
+// ---------------------------------------------------------------------------
+// Static Utility for state recording
+// ---------------------------------------------------------------------------
+// guaranteed minimum of maxVertexInputBindings, maxVertexInputAttributes
+static uint32_t constexpr MaxVertexInputs = 16;
+// guaranteed minimum of maxColorAttachments is 4, but 8 is universal
+static uint32_t constexpr MaxColorAttachments = 8;
+
+static bool isLineTopology(VkPrimitiveTopology topology) {
+  return topology == VK_PRIMITIVE_TOPOLOGY_LINE_LIST ||
+         topology == VK_PRIMITIVE_TOPOLOGY_LINE_STRIP ||
+         topology == VK_PRIMITIVE_TOPOLOGY_LINE_LIST_WITH_ADJACENCY ||
+         topology == VK_PRIMITIVE_TOPOLOGY_LINE_STRIP_WITH_ADJACENCY;
+}
+
+// same over operator as the `PipelinePool` color blend attachment template
+static VkColorBlendEquationEXT overOperatorBlendEquation() {
+  VkColorBlendEquationEXT equation{};
+  equation.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+  equation.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+  equation.colorBlendOp = VK_BLEND_OP_ADD;
+  equation.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+  equation.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+  equation.alphaBlendOp = VK_BLEND_OP_ADD;
+  return equation;
+}
+
+namespace avk::vk {
+
+// ---------------------------------------------------------------------------
+// API implementation
+// ---------------------------------------------------------------------------
+
+ShaderObjectPool::ShaderObjectPool(Device* device) : m_deps{device} {
+  assert(device->shaderObject());
+  m_shaders.reserve(64);
+}
+
+ShaderObjectPool::~ShaderObjectPool() { destroyAllShaders(); }
+
+void ShaderObjectPool::registerShaderModule(VkShaderModule shaderModule,
+                                            uint32_t const* code,
+                                            size_t codeSize) {
+  assert(shaderModule != VK_NULL_HANDLE && code && codeSize % 4 == 0);
+  std::lock_guard<std::mutex> lk{m_mutex};
+  m_moduleCode[shaderModule].assign(code, code + (codeSize >> 2));
+}
+
+void ShaderObjectPool::unregisterShaderModule(VkShaderModule shaderModule) {
+  std::lock_guard<std::mutex> lk{m_mutex};
+  m_moduleCode.erase(shaderModule);
+}
+
+void ShaderObjectPool::registerPipelineLayout(
+    VkPipelineLayout pipelineLayout, VkDescriptorSetLayout const* pSetLayouts,
+    uint32_t setLayoutCount, VkPushConstantRange const* pPushConstantRanges,
+    uint32_t pushConstantRangeCount) {
+  assert(pipelineLayout != VK_NULL_HANDLE);
+  std::lock_guard<std::mutex> lk{m_mutex};
+  LayoutInfo& layout = m_layouts[pipelineLayout];
+  layout.setLayouts.assign(pSetLayouts, pSetLayouts + setLayoutCount);
+  layout.pushConstantRanges.assign(
+      pPushConstantRanges, pPushConstantRanges + pushConstantRangeCount);
+}
+
+VkShaderEXT ShaderObjectPool::getOrCreateShader(
+    ShaderObjectInfo const& shaderInfo) AVK_NO_CFI {
+  auto const* const vkDevApi = m_deps.device->table();
+  VkDevice const dev = m_deps.device->device();
+
+  std::lock_guard<std::mutex> lk{m_mutex};
+  if (auto it = m_shaders.find(shaderInfo); it != m_shaders.end()) {
+    VkShaderEXT shader = it->second;
+    assert(shader != VK_NULL_HANDLE);
+    return shader;
+  }
+
+  auto const codeIt = m_moduleCode.find(shaderInfo.shaderModule);
+  auto const layoutIt = m_layouts.find(shaderInfo.pipelineLayout);
+  assert(codeIt != m_moduleCode.end() && "shader module not registered");
+  assert(layoutIt != m_layouts.end() && "pipeline layout not registered");
+  std::vector<uint32_t> const& code = codeIt->second;
+  LayoutInfo const& layout = layoutIt->second;
+
+  VkSpecializationInfo specializationInfo{};
+  if (!shaderInfo.specialization.empty()) {
+    specializationInfo.mapEntryCount =
+        static_cast<uint32_t>(shaderInfo.specialization.mapEntries.size());
+    specializationInfo.pMapEntries =
+        shaderInfo.specialization.mapEntries.data();
+    specializationInfo.dataSize = shaderInfo.specialization.data.size();
+    specializationInfo.pData = shaderInfo.specialization.data.data();
+  }
+
+  // unlinked shaders, such that each stage can be reused across combinations
+  VkShaderCreateInfoEXT createInfo{};
+  createInfo.sType = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT;
+  createInfo.flags = 0;
+  createInfo.stage = shaderInfo.stage;
+  createInfo.nextStage = shaderInfo.nextStage;
+  createInfo.codeType = VK_SHADER_CODE_TYPE_SPIRV_EXT;
+  createInfo.codeSize = code.size() << 2;
+  createInfo.pCode = code.data();
+  // OpEntryPoint in SPIR-V
+  createInfo.pName = "main";
+  createInfo.setLayoutCount = static_cast<uint32_t>(layout.setLayouts.size());
+  createInfo.pSetLayouts = layout.setLayouts.data();
+  createInfo.pushConstantRangeCount =
+      static_cast<uint32_t>(layout.pushConstantRanges.size());
+  createInfo.pPushConstantRanges = layout.pushConstantRanges.data();
+  createInfo.pSpecializationInfo =
+      shaderInfo.specialization.empty() ? nullptr : &specializationInfo;
+
+  VkShaderEXT shader = VK_NULL_HANDLE;
+  VK_CHECK(vkDevApi->vkCreateShadersEXT(
+      dev, 1, &createInfo,
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_SHADER_EXT), &shader));
+  assert(shader != VK_NULL_HANDLE);
+  m_shaders.try_emplace(shaderInfo, shader);
+  return shader;
+}
+
+void ShaderObjectPool::getOrCreateGraphicsShaders(
+    GraphicsInfo const& graphicsInfo,
+    VkShaderEXT (&outShaders)[GraphicsStageCount]) {
+  assert(graphicsInfo.renderPass == VK_NULL_HANDLE &&
+         "shader objects are used with dynamic rendering only");
+  bool const hasGeometry =
+      graphicsInfo.preRasterization.geometryModule != VK_NULL_HANDLE;
+
+  ShaderObjectInfo shaderInfo{};
+  shaderInfo.pipelineLayout = graphicsInfo.pipelineLayout;
+
+  // 0. VK_SHADER_STAGE_VERTEX_BIT
+  shaderInfo.shaderModule = graphicsInfo.preRasterization.vertexModule;
+  shaderInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+  shaderInfo.nextStage = hasGeometry ? VK_SHADER_STAGE_GEOMETRY_BIT
+                                     : VK_SHADER_STAGE_FRAGMENT_BIT;
+  shaderInfo.specialization =
+      graphicsInfo.preRasterization.vertexSpecialization;
+  outShaders[0] = getOrCreateShader(shaderInfo);
+
+  // 1. VK_SHADER_STAGE_FRAGMENT_BIT
+  shaderInfo.shaderModule = graphicsInfo.fragmentShader.fragmentModule;
+  shaderInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+  shaderInfo.nextStage = 0;
+  shaderInfo.specialization =
+      graphicsInfo.fragmentShader.fragmentSpecialization;
+  outShaders[1] = getOrCreateShader(shaderInfo);
+
+  // 2. VK_SHADER_STAGE_GEOMETRY_BIT -> VkDevice with geometryShaderFeature
+  outShaders[2] = VK_NULL_HANDLE;
+  if (hasGeometry) {
+    shaderInfo.shaderModule = graphicsInfo.preRasterization.geometryModule;
+    shaderInfo.stage = VK_SHADER_STAGE_GEOMETRY_BIT;
+    shaderInfo.nextStage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderInfo.specialization =
+        graphicsInfo.preRasterization.geometrySpecialization;
+    outShaders[2] = getOrCreateShader(shaderInfo);
+  }
+}
+
+void ShaderObjectPool::cmdBindGraphicsShaders(
+    VkCommandBuffer cmd,
+    VkShaderEXT const (&shaders)[GraphicsStageCount]) const AVK_NO_CFI {
+  auto const* const vkDevApi = m_deps.device->table();
+  // tessellation stages are always unbound (null is valid even without the
+  // tessellationShader feature)
+  VkShaderStageFlagBits const stages[5]{
+      VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT,
+      VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT, VK_SHADER_STAGE_GEOMETRY_BIT,
+      VK_SHADER_STAGE_FRAGMENT_BIT};
+  VkShaderEXT const bound[5]{shaders[0], VK_NULL_HANDLE, VK_NULL_HANDLE,
+                             shaders[2], shaders[1]};
+  vkDevApi->vkCmdBindShadersEXT(cmd, 5, stages, bound);
+}
+
+void ShaderObjectPool::cmdSetGraphicsState(
+    VkCommandBuffer cmd, GraphicsInfo const& graphicsInfo) const AVK_NO_CFI {
+  auto const* const vkDevApi = m_deps.device->table();
+  GraphicsInfo::PipelineOpts const& opts = graphicsInfo.opts;
+
+  // -- Vertex Input --
+  uint32_t const bindingCount =
+      static_cast<uint32_t>(graphicsInfo.vertexIn.bindings.size());
+  uint32_t const attributeCount =
+      static_cast<uint32_t>(graphicsInfo.vertexIn.attributes.size());
+  assert(bindingCount <= MaxVertexInputs && attributeCount <= MaxVertexInputs);
+  VkVertexInputBindingDescription2EXT bindings[MaxVertexInputs];
+  VkVertexInputAttributeDescription2EXT attributes[MaxVertexInputs];
+  for (uint32_t i = 0; i < bindingCount; ++i) {
+    VkVertexInputBindingDescription const& b =
+        graphicsInfo.vertexIn.bindings[i];
+    bindings[i] = {};
+    bindings[i].sType =
+        VK_STRUCTURE_TYPE_VERTEX_INPUT_BINDING_DESCRIPTION_2_EXT;
+    bindings[i].binding = b.binding;
+    bindings[i].stride = b.stride;
+    bindings[i].inputRate = b.inputRate;
+    bindings[i].divisor = 1;
+  }
+  for (uint32_t i = 0; i < attributeCount; ++i) {
+    VkVertexInputAttributeDescription const& a =
+        graphicsInfo.vertexIn.attributes[i];
+    attributes[i] = {};
+    attributes[i].sType =
+        VK_STRUCTURE_TYPE_VERTEX_INPUT_ATTRIBUTE_DESCRIPTION_2_EXT;
+    attributes[i].location = a.location;
+    attributes[i].binding = a.binding;
+    attributes[i].format = a.format;
+    attributes[i].offset = a.offset;
+  }
+  vkDevApi->vkCmdSetVertexInputEXT(cmd, bindingCount, bindings, attributeCount,
+                                   attributes);
+
+  // -- Input Assembly --
+  vkDevApi->vkCmdSetPrimitiveTopologyEXT(cmd, graphicsInfo.vertexIn.topology);
+  vkDevApi->vkCmdSetPrimitiveRestartEnableEXT(cmd, VK_FALSE);
+
+  // -- Rasterization --
+  vkDevApi->vkCmdSetRasterizerDiscardEnableEXT(cmd, VK_FALSE);
+  vkDevApi->vkCmdSetPolygonModeEXT(cmd, opts.rasterizationPolygonMode);
+  vkDevApi->vkCmdSetCullModeEXT(cmd, cullModeFromFlags(opts.flags));
+  vkDevApi->vkCmdSetFrontFaceEXT(cmd, frontFaceFromFlags(opts.flags));
+  bool const depthBias = opts.flags & EPipelineFlags::eDepthBias;
+  vkDevApi->vkCmdSetDepthBiasEnableEXT(cmd, depthBias ? VK_TRUE : VK_FALSE);
+  if (depthBias) {
+    // same factors as `PipelinePool`
+    vkDevApi->vkCmdSetDepthBias(cmd, 1.f, 0.f, 2.f);
+  }
+  if (isLineTopology(graphicsInfo.vertexIn.topology) ||
+      opts.rasterizationPolygonMode == VK_POLYGON_MODE_LINE) {
+    vkDevApi->vkCmdSetLineWidth(cmd, 1.f);
+  }
+
+  // -- Multisample --
+  VkSampleMask const sampleMask = UINT32_MAX;
+  vkDevApi->vkCmdSetRasterizationSamplesEXT(cmd, VK_SAMPLE_COUNT_1_BIT);
+  vkDevApi->vkCmdSetSampleMaskEXT(cmd, VK_SAMPLE_COUNT_1_BIT, &sampleMask);
+  vkDevApi->vkCmdSetAlphaToCoverageEnableEXT(cmd, VK_FALSE);
+
+  // -- Depth Stencil --
+  vkDevApi->vkCmdSetDepthTestEnableEXT(cmd, VK_TRUE);
+  vkDevApi->vkCmdSetDepthWriteEnableEXT(
+      cmd, (opts.flags & EPipelineFlags::eNoDepthWrite) ? VK_FALSE : VK_TRUE);
+  vkDevApi->vkCmdSetDepthCompareOpEXT(cmd, VK_COMPARE_OP_LESS_OR_EQUAL);
+  bool const stencilEnable = stencilTestEnabled(graphicsInfo);
+  vkDevApi->vkCmdSetStencilTestEnableEXT(cmd,
+                                         stencilEnable ? VK_TRUE : VK_FALSE);
+  if (stencilEnable) {
+    VkStencilOpState front{};
+    VkStencilOpState back{};
+    stencilOpStatesFromOpts(opts, front, back);
+    vkDevApi->vkCmdSetStencilOpEXT(cmd, VK_STENCIL_FACE_FRONT_BIT,
+                                   front.failOp, front.passOp,
+                                   front.depthFailOp, front.compareOp);
+    vkDevApi->vkCmdSetStencilOpEXT(cmd, VK_STENCIL_FACE_BACK_BIT, back.failOp,
+                                   back.passOp, back.depthFailOp,
+                                   back.compareOp);
+    vkDevApi->vkCmdSetStencilCompareMask(cmd, VK_STENCIL_FACE_FRONT_AND_BACK,
+                                         opts.stencilCompareMask);
+    vkDevApi->vkCmdSetStencilWriteMask(cmd, VK_STENCIL_FACE_FRONT_AND_BACK,
+                                       opts.stencilWriteMask);
+    vkDevApi->vkCmdSetStencilReference(cmd, VK_STENCIL_FACE_FRONT_AND_BACK,
+                                       opts.stencilReference);
+  }
+
+  // -- Color Blend --
+  uint32_t const colorAttachmentNum = static_cast<uint32_t>(
+      graphicsInfo.fragmentOut.colorAttachmentFormats.size() > 0
+          ? graphicsInfo.fragmentOut.colorAttachmentFormats.size()
+          : 1);
+  assert(colorAttachmentNum <= MaxColorAttachments);
+  VkBool32 blendEnables[MaxColorAttachments];
+  VkColorBlendEquationEXT equations[MaxColorAttachments];
+  VkColorComponentFlags writeMasks[MaxColorAttachments];
+  for (uint32_t i = 0; i < colorAttachmentNum; ++i) {
+    blendEnables[i] = VK_TRUE;
+    equations[i] = overOperatorBlendEquation();
+    writeMasks[i] = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                    VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+  }
+  vkDevApi->vkCmdSetColorBlendEnableEXT(cmd, 0, colorAttachmentNum,
+                                        blendEnables);
+  vkDevApi->vkCmdSetColorBlendEquationEXT(cmd, 0, colorAttachmentNum,
+                                          equations);
+  vkDevApi->vkCmdSetColorWriteMaskEXT(cmd, 0, colorAttachmentNum, writeMasks);
+
+  // depth clamp, depth bounds, logic op and alpha to one are required only if
+  // their features are enabled, which they aren't
+}
+
+void ShaderObjectPool::discardAllShaders(DiscardPool* discardPool,
+                                         VkPipelineLayout pipelineLayout,
+                                         uint64_t value) {
+  std::lock_guard<std::mutex> lk{m_mutex};
+  for (auto it = m_shaders.begin(); it != m_shaders.end(); /*inside*/) {
+    if (it->first.pipelineLayout == pipelineLayout) {
+      discardPool->discardShaderObject(it->second, value);
+      it = m_shaders.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  m_layouts.erase(pipelineLayout);
+}
+
+void ShaderObjectPool::destroyAllShaders() AVK_NO_CFI {
+  auto const* const vkDevApi = m_deps.device->table();
+  VkDevice const dev = m_deps.device->device();
+
+  std::lock_guard<std::mutex> lk{m_mutex};
+  for (auto const& [info, shader] : m_shaders) {
+    vkDevApi->vkDestroyShaderEXT(
+        dev, shader,
+        m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_SHADER_EXT));
+  }
+  m_shaders.clear();
+  m_moduleCode.clear();
+  m_layouts.clear();
+}
+
+}  // namespace avk::vk
@@ -14,7 +14,9 @@ VkShaderModule createShaderModule(Device const* device, uint32_t const* code,
   createInfo.pCode = code;
   createInfo.codeSize = codeSize;
   // TODO specialization constants
-  VK_CHECK(vkDevApi->vkCreateShaderModule(dev, &createInfo, nullptr, &mod));
+  VK_CHECK(vkDevApi->vkCreateShaderModule(
+      dev, &createInfo,
+      device->allocationCallbacks(VK_OBJECT_TYPE_SHADER_MODULE), &mod));
   return mod;
 }
 
@@ -127,7 +127,8 @@ void FrameDiscard::destroy(const Device *device,
   while (!swapchains.empty()) {
     VkSwapchainKHR handle = swapchains.back();
     swapchains.pop_back();
-    vkDevApi->vkDestroySwapchainKHR(dev, handle, nullptr);
+    vkDevApi->vkDestroySwapchainKHR(
+        dev, handle, device->allocationCallbacks(VK_OBJECT_TYPE_SWAPCHAIN_KHR));
   }
   while (!surfaces.empty()) {
     VkSurfaceKHR surface = surfaces.back();
@@ -137,12 +138,14 @@ void FrameDiscard::destroy(const Device *device,
   while (!semaphores.empty()) {
     VkSemaphore handle = semaphores.back();
     semaphores.pop_back();
-    vkDevApi->vkDestroySemaphore(dev, handle, nullptr);
+    vkDevApi->vkDestroySemaphore(
+        dev, handle, device->allocationCallbacks(VK_OBJECT_TYPE_SEMAPHORE));
   }
   while (!imageViews.empty()) {
     VkImageView handle = imageViews.back();
     imageViews.pop_back();
-    vkDevApi->vkDestroyImageView(dev, handle, nullptr);
+    vkDevApi->vkDestroyImageView(
+        dev, handle, device->allocationCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW));
   }
 }
 
@@ -160,11 +163,14 @@ void Frame::destroy(const Device *device, VkInstance instance) AVK_NO_CFI {
   auto const *vkDevApi = device->table();
   VkDevice const dev = device->device();
   if (submissionFence != VK_NULL_HANDLE) {
-    vkDevApi->vkDestroyFence(dev, submissionFence, nullptr);
+    vkDevApi->vkDestroyFence(dev, submissionFence,
+                             device->allocationCallbacks(VK_OBJECT_TYPE_FENCE));
     submissionFence = VK_NULL_HANDLE;
   }
   if (acquireSemaphore != VK_NULL_HANDLE) {
-    vkDevApi->vkDestroySemaphore(dev, acquireSemaphore, nullptr);
+    vkDevApi->vkDestroySemaphore(
+        dev, acquireSemaphore,
+        device->allocationCallbacks(VK_OBJECT_TYPE_SEMAPHORE));
     acquireSemaphore = VK_NULL_HANDLE;
   }
   discard.destroy(device, instance);
@@ -335,8 +341,10 @@ void Swapchain::recreateSwapchain() AVK_NO_CFI {
 
   VkSwapchainKHR swapchain = VK_NULL_HANDLE;
 
-  VkResult res =
-      vkDevApi->vkCreateSwapchainKHR(dev, &createInfo, nullptr, &swapchain);
+  VkResult res = vkDevApi->vkCreateSwapchainKHR(
+      dev, &createInfo,
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_SWAPCHAIN_KHR),
+      &swapchain);
   VK_CHECK(res);
   LOGI << PREFIX "Just Created Pool" << std::endl;
 
@@ -382,12 +390,16 @@ void Swapchain::recreateSwapchain() AVK_NO_CFI {
     // all Android Devices hence: Recreate semaphores
     AVK_EXT_CHECK(m_images[imageIndex].presentSemaphore == VK_NULL_HANDLE);
     VK_CHECK(vkDevApi->vkCreateSemaphore(
-        dev, &semCreateInfo, nullptr, &m_images[imageIndex].presentSemaphore));
+        dev, &semCreateInfo,
+        m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_SEMAPHORE),
+        &m_images[imageIndex].presentSemaphore));
     // Since imageUsage contains COLOR_ATTACHMENT_BIT, we can create image
     // views associated to the swapchain image
     imgViewCreateInfo.image = m_images[imageIndex].image;
-    VK_CHECK(vkDevApi->vkCreateImageView(dev, &imgViewCreateInfo, nullptr,
-                                         &m_images[imageIndex].imageView));
+    VK_CHECK(vkDevApi->vkCreateImageView(
+        dev, &imgViewCreateInfo,
+        m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW),
+        &m_images[imageIndex].imageView));
   }
   m_tmpImages.clear();
   LOGI << PREFIX
@@ -416,13 +428,17 @@ void Swapchain::recreateSwapchain() AVK_NO_CFI {
   for (utils::Frame &frame : m_frames) {
     // semaphores for old frames have been discarded, recreate them (+ new ones)
     if (frame.acquireSemaphore == VK_NULL_HANDLE) {
-      VK_CHECK(vkDevApi->vkCreateSemaphore(dev, &semCreateInfo, nullptr,
-                                           &frame.acquireSemaphore));
+      VK_CHECK(vkDevApi->vkCreateSemaphore(
+          dev, &semCreateInfo,
+          m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_SEMAPHORE),
+          &frame.acquireSemaphore));
     }
     // fences for old frames are still here, and it's safe to reuse them
     if (frame.submissionFence == VK_NULL_HANDLE) {
-      VK_CHECK(vkDevApi->vkCreateFence(dev, &fenceCreateInfo, nullptr,
-                                       &frame.submissionFence));
+      VK_CHECK(vkDevApi->vkCreateFence(
+          dev, &fenceCreateInfo,
+          m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_FENCE),
+          &frame.submissionFence));
     }
   }
   LOGI << PREFIX
@@ -450,15 +466,21 @@ Swapchain::~Swapchain() noexcept AVK_NO_CFI {
     // WARNING: Supposes that presentation has finished (wait idle or present
     // fence in place)
     if (image.presentSemaphore != VK_NULL_HANDLE) {
-      vkDevApi->vkDestroySemaphore(dev, image.presentSemaphore, nullptr);
+      vkDevApi->vkDestroySemaphore(
+          dev, image.presentSemaphore,
+          m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_SEMAPHORE));
     }
     if (image.imageView != VK_NULL_HANDLE) {
-      vkDevApi->vkDestroyImageView(dev, image.imageView, nullptr);
+      vkDevApi->vkDestroyImageView(
+          dev, image.imageView,
+          m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW));
     }
   }
   m_images.clear();
   // 2. Destroy current swapchain
-  vkDevApi->vkDestroySwapchainKHR(dev, m_swapchain, nullptr);
+  vkDevApi->vkDestroySwapchainKHR(
+      dev, m_swapchain,
+      m_deps.device->allocationCallbacks(VK_OBJECT_TYPE_SWAPCHAIN_KHR));
   // 3. Destroy Frames (synchronization primitives and decommissioned handles)
   for (utils::Frame &frame : m_frames) {
     frame.destroy(m_deps.device, m_deps.instance->handle());
@@ -9,12 +9,21 @@
 #include "render/vk/discard-pool.h"
 #include "render/vk/instance-vk.h"
 #include "render/vk/pipeline-pool-vk.h"
+#include "render/vk/shader-object-pool-vk.h"
 #include "render/vk/surface-vk.h"
 #include "render/vk/swapchain-vk.h"
 
 // rendering stuff which might change
 #include "render/experimental/avk-basic-buffer-manager.h"
 #include "render/experimental/avk-basic-image-manager.h"
+#include "render/experimental/avk-buffer-suballocator.h"
+#include "render/experimental/avk-cross-queue-submitter.h"
+#include "render/experimental/avk-defragmentation-service.h"
+#include "render/experimental/avk-frame-linear-allocator.h"
+#include "render/experimental/avk-memory-budget-governor.h"
+#include "render/experimental/avk-readback-service.h"
+#include "render/experimental/avk-upload-context.h"
+#include "render/experimental/avk-upload-scheduler.h"
 
 // library
 #include <atomic>
@@ -347,17 +356,86 @@ class ApplicationBase : public NonMoveable {
     return m_vkDiscardPoolMonitor.get();
   };
   inline vk::CommandPools *vkCommandPools() { return m_vkCommandPools.get(); };
+  /// discard pool of the compute queue, whose values are the ones signaled by
+  /// the compute submissions of `crossQueueSubmitter()`
+  inline vk::DiscardPool *vkComputeDiscardPool() {
+    return m_vkComputeDiscardPool.get();
+  };
+  /// command pools of the compute queue family, which is the universal one
+  /// without async compute
+  inline vk::CommandPools *vkComputeCommandPools() {
+    return m_vkComputeCommandPools.get();
+  };
   inline vk::DescriptorPools *vkDescriptorPools() {
     return m_vkDescriptorPools.get();
   };
   inline vk::PipelinePool *vkPipelines() { return m_vkPipelines.get(); };
+  /// null if the device doesn't support `VK_EXT_shader_object`, in which case
+  /// graphics go through `vkPipelines()`
+  inline vk::ShaderObjectPool *vkShaderObjects() {
+    return m_vkShaderObjects.get();
+  };
 
+  /// submissions on the graphics and compute queues. The graphics one of
+  /// `RTdoOnRender` must signal `timeline() + 1`, eg. by going through it
+  inline experimental::CrossQueueSubmitter *crossQueueSubmitter() {
+    return m_crossQueueSubmitter.get();
+  }
   inline experimental::BufferManager *bufferManager() {
     return m_bufferManager.get();
   }
   inline experimental::ImageManager *imageManager() {
     return m_imageManager.get();
   }
+  /// per frame transient data, already reset for the frame being rendered
+  /// when `RTdoOnRender` is called
+  inline experimental::FrameLinearAllocator *frameAllocator() {
+    return m_frameAllocator.get();
+  }
+  /// ranges of shared "mega buffers" for small vertex/index/uniform data.
+  /// Ranges freed up to the last completed timeline value are released
+  /// before `RTdoOnRender` is called
+  inline experimental::BufferSuballocator *bufferSuballocator() {
+    return m_bufferSuballocator.get();
+  }
+  /// GPU to CPU copies, recorded in the frame command buffer with
+  /// `timeline() + 1` as signal value. Results are delivered on the render
+  /// thread before `RTdoOnRender`, once that value is reached
+  inline experimental::ReadbackService *readbackService() {
+    return m_readbackService.get();
+  }
+  /// uploads spread over frames under a byte budget. `RTdoOnRender` moves
+  /// the requests of the frame into its staging manager with
+  /// `RTrecordScheduledUploads`, completed ones are reported before
+  /// `RTdoOnRender`
+  inline experimental::UploadScheduler *uploadScheduler() {
+    return m_uploadScheduler.get();
+  }
+  /// uploads on the transfer queue, used by `RTrecordScheduledUploads` for
+  /// large requests. `false` if the device has no transfer queue
+  inline experimental::UploadContext *uploadContext() {
+    return m_uploadContext.get();
+  }
+  /// moves resources marked with `setMovable` by the managers. Idle unless
+  /// `recordFrame` is called by the frame recording
+  inline experimental::DefragmentationService *defragmentation() {
+    return m_defragmentation.get();
+  }
+  /// admission control of the managers, updated before `RTdoOnRender`.
+  /// Register eviction callbacks here to degrade quality on low VRAM
+  inline experimental::MemoryBudgetGovernor *budgetGovernor() {
+    return m_budgetGovernor.get();
+  }
+
+  /// enqueues the scheduled uploads of the frame into `staging`, refreshed
+  /// for `timeline() + 1`, before its `flush`. Large ones are submitted on
+  /// the transfer queue instead, and their acquire barriers recorded on
+  /// `cmd`, outside of a render pass. Returns the value of
+  /// `uploadContext()->semaphore()` the graphics submission must wait on with
+  /// `outWaitStages`, 0 if none
+  uint64_t RTrecordScheduledUploads(
+      VkCommandBuffer cmd, experimental::StagingTransientManager &staging,
+      VkPipelineStageFlags &outWaitStages);
 
   inline RenderCoordinator &renderCoordinator() { return m_renderCoordinator; }
   inline UpdateCoordinator &updateCoordinator() { return m_updateCoordinator; }
@@ -396,15 +474,42 @@ class ApplicationBase : public NonMoveable {
   /// to handle `VkCommandPool` and `VkCommandBuffer` caching
   /// depends on: `m_vkDevice`
   DelayedConstruct<vk::CommandPools> m_vkCommandPools;
+  /// same as `m_vkDiscardPool`, `m_vkDiscardPoolMonitor` and
+  /// `m_vkCommandPools`, for the compute queue, which has its own timeline
+  DelayedConstruct<vk::DiscardPool> m_vkComputeDiscardPool;
+  DelayedConstruct<vk::DiscardPoolMonitor> m_vkComputeDiscardPoolMonitor;
+  DelayedConstruct<vk::CommandPools> m_vkComputeCommandPools;
+  /// depends on: `m_vkDevice`, `m_vkDiscardPool`, `m_vkComputeDiscardPool`
+  DelayedConstruct<experimental::CrossQueueSubmitter> m_crossQueueSubmitter;
   /// manager for descriptor pools. Should be created by one thread at a time
   DelayedConstruct<vk::DescriptorPools> m_vkDescriptorPools;
   /// manager for `VkPipeline` and `VkPipelineCache` objects for compute
   /// pipelines and graphics pipelines
   DelayedConstruct<vk::PipelinePool> m_vkPipelines;
+  /// manager for `VkShaderEXT` objects, alternative to `m_vkPipelines` for
+  /// graphics. Created only if the device enables `VK_EXT_shader_object`
+  DelayedConstruct<vk::ShaderObjectPool> m_vkShaderObjects;
 
   // ----------- Vulkan: Resource Management --------------
+  /// depends on: `m_vkDevice`, `m_vkDiscardPool`. Outlives the managers
+  DelayedConstruct<experimental::MemoryBudgetGovernor> m_budgetGovernor;
   DelayedConstruct<experimental::BufferManager> m_bufferManager;
   DelayedConstruct<experimental::ImageManager> m_imageManager;
+  /// bytes of each frame region of `m_frameAllocator`
+  static constexpr VkDeviceSize FrameAllocatorBytes = 4 << 20;
+  /// depends on: `m_vkDevice`, `m_vkSwapchain` (frame count)
+  DelayedConstruct<experimental::FrameLinearAllocator> m_frameAllocator;
+  /// depends on: `m_vkDevice`
+  DelayedConstruct<experimental::BufferSuballocator> m_bufferSuballocator;
+  /// depends on: `m_vkDevice`
+  DelayedConstruct<experimental::ReadbackService> m_readbackService;
+  /// depends on: nothing, but its requests name buffers of the device
+  DelayedConstruct<experimental::UploadScheduler> m_uploadScheduler;
+  /// depends on: `m_vkDevice`. Waits its pending submissions on destruction
+  DelayedConstruct<experimental::UploadContext> m_uploadContext;
+  /// depends on: `m_vkDevice`, `m_vkDiscardPool`, `m_bufferManager`,
+  /// `m_imageManager`
+  DelayedConstruct<experimental::DefragmentationService> m_defragmentation;
 
   // ------------ Render Thread - Main Thread -------------
   /// A bunch of synchronization primitives to facilitate signaling
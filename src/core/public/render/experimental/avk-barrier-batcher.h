@@ -0,0 +1,70 @@
+#pragma once
+
+#include "render/vk/common-vk.h"
+#include "render/vk/device-vk.h"
+#include "utils/mixins.h"
+
+// std
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace avk::experimental {
+
+/// Collects the barriers of a recording scope (eg. a `flush`, a pass) and
+/// records them at once, with as few calls as possible
+/// - buffer barriers on the same buffer with the same stages and accesses
+///   are merged into one covering the union of their ranges. Image barriers
+///   are merged when they differ only by adjacent mip levels. Global memory
+///   barriers with the same stages are merged, or-ing their accesses
+/// - with `VK_KHR_synchronization2`, everything is one
+///   `vkCmdPipelineBarrier2KHR`, as stages are per barrier. Without, one
+///   `vkCmdPipelineBarrier` per distinct source/destination stage pair, hence
+///   only stages and accesses representable in the legacy flags are allowed
+/// - no queue family ownership transfers
+/// - 1 thread only, like the command buffer it records to
+class BarrierBatcher : public NonMoveable {
+ public:
+  BarrierBatcher();
+
+  void bufferBarrier(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size,
+                     VkPipelineStageFlags2KHR srcStages,
+                     VkAccessFlags2KHR srcAccess,
+                     VkPipelineStageFlags2KHR dstStages,
+                     VkAccessFlags2KHR dstAccess);
+  void imageBarrier(VkImage image, VkImageSubresourceRange const& range,
+                    VkImageLayout oldLayout, VkImageLayout newLayout,
+                    VkPipelineStageFlags2KHR srcStages,
+                    VkAccessFlags2KHR srcAccess,
+                    VkPipelineStageFlags2KHR dstStages,
+                    VkAccessFlags2KHR dstAccess);
+  void memoryBarrier(VkPipelineStageFlags2KHR srcStages,
+                     VkAccessFlags2KHR srcAccess,
+                     VkPipelineStageFlags2KHR dstStages,
+                     VkAccessFlags2KHR dstAccess);
+
+  /// records the collected barriers on `cmd` and clears them. Nothing is
+  /// recorded if there are none
+  void flush(vk::Device* device, VkCommandBuffer cmd);
+
+  inline bool empty() const {
+    return m_buffers.empty() && m_images.empty() && m_memory.empty();
+  }
+
+ private:
+  std::vector<VkMemoryBarrier2KHR> m_memory;
+  std::vector<VkBufferMemoryBarrier2KHR> m_buffers;
+  std::vector<VkImageMemoryBarrier2KHR> m_images;
+
+  // scratch storage of the legacy path, reused across flushes
+  std::vector<std::pair<VkPipelineStageFlags, VkPipelineStageFlags>>
+      m_stagePairs;
+  std::vector<VkMemoryBarrier> m_legacyMemory;
+  std::vector<VkBufferMemoryBarrier> m_legacyBuffers;
+  std::vector<VkImageMemoryBarrier> m_legacyImages;
+
+  void flushLegacy(vk::Device* device, VkCommandBuffer cmd);
+  void clear();
+};
+
+}  // namespace avk::experimental
@@ -6,13 +6,21 @@
 #include "render/vk/discard-pool.h"
 #include "render/vk/pipeline-info.h"
 #include "utils/mixins.h"
+#include "utils/sharded-table.h"
+#include "utils/slot-map.h"
 
 // libs and stuff
-#include <shared_mutex>
+#include <mutex>
 #include <unordered_map>
 
 namespace avk::experimental {
 
+class DefragmentationService;
+class MemoryBudgetGovernor;
+
+/// handle to a buffer of `BufferManager`, see `ResourceHandle`
+using BufferHandle = ResourceHandle<struct BufferHandleTag>;
+
 // TODO VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED when using transient images
 // TODO VMA_ALLCOATION_CREATE_WITHIN_BUDGET_BIT
 // TODO VMA_ALLOCATION_CREATE_NEVER_ALLOCATE_BIT
@@ -25,18 +33,40 @@ namespace avk::experimental {
 /// Factory Methods Follow the following guidelines.
 /// <https://gpuopen-librariesandsdks.github.io/VulkanMemoryAllocator/html/usage_patterns.html>
 /// Note: Assumes VK_SHARING_MODE_EXCLUSIVE
+/// Note: allocations go to the `VmaPool`s of the `vk::EMemoryClass` of each
+/// factory (GPU only -> static geometry, staging and readback -> staging,
+/// streaming -> streaming) when enabled, see `vk::Device::createPooledBuffer`
+/// Buffers live in a `SlotMap`, and each factory can return their
+/// `BufferHandle`, such that hot paths resolve them with an array access.
+/// The `uint64_t` id is an optional name (`NoName` to skip it), kept in a
+/// side table and resolved with `find`
+/// With a `MemoryBudgetGovernor`, factories of GPU only and streaming buffers
+/// return `OverBudget` instead of allocating past its hard threshold, and
+/// every factory retries once after eviction on out of device memory
 /// WARN: It does not protect from multithreaded discard. The thread which
-/// creates the buffer should be the thread which discards it
+/// creates the buffer should be the thread which discards it. Stale handles
+/// fail safely though
 class BufferManager : public NonMoveable {
+  friend class DefragmentationService;
+
  public:
   static int32_t constexpr Success = 0;
   static int32_t constexpr VulkanError = -1;
   static int32_t constexpr Collision = -2;
+  /// rejected by the `MemoryBudgetGovernor`, nothing was allocated
+  static int32_t constexpr OverBudget = -3;
   static int32_t constexpr TransferRequired = 1;
+  /// id of buffers reachable only through their handle
+  static uint64_t constexpr NoName = 0;
 
   /// start Buffer manager with a given capacity
   BufferManager(vk::Device* device, size_t cap = 256);
 
+  /// null to allocate without admission control. Must outlive the manager
+  inline void setBudgetGovernor(MemoryBudgetGovernor* governor) {
+    m_governor = governor;
+  }
+
   /// Creates a buffer used as a DEVICE_LOCAL only resource.
   /// - On Dedicated GPUs, should be paired with a staging buffer
   /// - On SoC or some Integrated GPUs, used as standalone
@@ -54,9 +84,13 @@ class BufferManager : public NonMoveable {
   /// `VMA_ALLOCATION_CREATE_NEVER_ALLOCATE_BIT` used, meaning VMA only uses
   /// pre-existing memory blocks, otherwise return error
   /// \return 0 on success
+  /// Note: small, long lived buffers (meshes, uniforms) should rather be
+  /// ranges of a `BufferSuballocator`, sharing a few `VkBuffer`s
+  /// \param outHandle if not null, receives the handle of the buffer
   int32_t createBufferGPUOnly(uint64_t id, size_t bytes,
                               VkBufferCreateFlags usage, bool forceWithinBudget,
-                              bool forceNoAllocation);
+                              bool forceNoAllocation,
+                              BufferHandle* outHandle = nullptr);
 
   /// Creates a HOST_VISIBLE buffer (use preferred for host coherent)
   /// uses VMA_ALLOCATION_CREATE_MAPPED_BIT. Should be used to
@@ -72,7 +106,8 @@ class BufferManager : public NonMoveable {
   /// `VMA_ALLOCATION_CREATE_MAPPED_BIT`,
   ///  hence no need to call `vmaMapMemory` or `vmaUnmapMemory`
   int32_t createBufferStaging(uint64_t id, size_t bytes, bool forceWithinBudget,
-                              bool forceNoAllocation);
+                              bool forceNoAllocation,
+                              BufferHandle* outHandle = nullptr);
 
   /// Since, if you don't use VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT`,
   /// VMA will try to use allocated blocks, sometimes it's more convenient
@@ -87,7 +122,8 @@ class BufferManager : public NonMoveable {
   /// - `VK_BUFFER_USAGE_TRANSFER_DST_BIT` (not `SRC`)
   /// - `VMA_ALLOCATION_CRAETE_HOST_ACCESS_RANDOM_BIT` (not sequential)
   int32_t createBufferReadback(uint64_t id, size_t bytes,
-                               bool forceWithinBudget, bool forceNoAllocation);
+                               bool forceWithinBudget, bool forceNoAllocation,
+                               BufferHandle* outHandle = nullptr);
 
   /// Buffers frequently written by the CPU and frequently written by the GPU
   /// meaning it is one of
@@ -114,11 +150,31 @@ class BufferManager : public NonMoveable {
   /// prepare a staging buffer
   int32_t createBufferStreaming(uint64_t id, size_t bytes,
                                 VkBufferUsageFlags usage,
-                                bool forceWithinBudget, bool forceNoAllocation);
-
-  /// false if it doesn't find anything
-  bool get(uint64_t id, VkBuffer& outBuffer, VmaAllocation& outAlloc);
-
+                                bool forceWithinBudget, bool forceNoAllocation,
+                                BufferHandle* outHandle = nullptr);
+
+  /// handle of the buffer named `id`, null handle if there's none
+  BufferHandle find(uint64_t id) const;
+  /// false if the handle is stale
+  bool get(BufferHandle handle, VkBuffer& outBuffer,
+           VmaAllocation& outAlloc) const;
+  /// false if it doesn't find anything. Prefer handles on hot paths
+  bool get(uint64_t id, VkBuffer& outBuffer, VmaAllocation& outAlloc) const;
+
+  /// allows `DefragmentationService` to move the buffer (GPU only buffers
+  /// only, as they are the only ones created with transfer src/dst usage).
+  /// Its `VkBuffer` changes on a move, hence whoever keeps the handle (eg.
+  /// descriptor sets) should listen to moves. The buffer shouldn't be written
+  /// from host while a defragmentation pass is pending. False if not found
+  /// or not movable
+  bool setMovable(BufferHandle handle, bool movable);
+  bool setMovable(uint64_t id, bool movable);
+
+  /// removes the discarded buffer (and its name), making its handle stale.
+  /// False if the handle is already stale
+  /// \warning assumes `discardPool` is on the same `vk::Device`
+  bool discard(vk::DiscardPool* discardPool, BufferHandle handle,
+               uint64_t timeline);
   /// removes the discarded buffer from the hash table. False if not found
   /// \warning assumes `discardPool` is on the same `vk::Device`
   bool discardById(vk::DiscardPool* discardPool, uint64_t id,
@@ -134,10 +190,66 @@ class BufferManager : public NonMoveable {
   struct Deps {
     vk::Device* device;
   } m_deps;
-  /// hash table of buffers. Meaning is given by user
-  std::unordered_map<uint64_t, vk::VMAResource<VkBuffer>> m_bufferMap;
-  /// synchronization for map modifications/reads
-  mutable std::shared_mutex m_mtx;
+  MemoryBudgetGovernor* m_governor = nullptr;
+  struct ManagedBuffer : public vk::VMAResource<VkBuffer> {
+    ManagedBuffer(VkBuffer buffer, VmaAllocation alloc,
+                  VkBufferCreateInfo const& createInfo, uint64_t name)
+        : vk::VMAResource<VkBuffer>(buffer, alloc),
+          size(createInfo.size),
+          usage(createInfo.usage),
+          name(name) {}
+
+    // to recreate the buffer when defragmentation moves it
+    VkDeviceSize size;
+    VkBufferUsageFlags usage;
+    // key in `m_names`, or `NoName`
+    uint64_t name;
+    bool movable = false;
+    // moved by the pending defragmentation pass, hence the allocation
+    // can't be freed until the pass ends
+    bool pinned = false;
+  };
+  // what `DefragmentationService` needs to move a buffer
+  struct MoveCandidate {
+    BufferHandle handle;
+    uint64_t id;
+    VkDeviceSize size;
+    VkBufferUsageFlags usage;
+  };
+
+  /// buffers, addressed by handle
+  SlotMap<ManagedBuffer, BufferHandle> m_buffers;
+  /// name side table, meaning is given by user. Lock striped, such that
+  /// lookups of different buffers rarely contend
+  ShardedTable<BufferHandle> m_names;
+  /// discards of pinned buffers, forwarded to the discard pool once the
+  /// defragmentation pass ends
+  vk::utils::TimelineResources<vk::VMAResource<VkBuffer>> m_pinnedDiscards;
+  std::mutex m_pinnedMtx;
+
+  // `vmaCreateBuffer` through the governor, if any: `admitted` classes are
+  // checked first, and out of device memory is retried once after eviction
+  int32_t allocateBuffer(vk::EMemoryClass memoryClass, bool admitted,
+                         VkBufferCreateInfo const& createInfo,
+                         VmaAllocationCreateInfo const& allocInfo,
+                         VkBuffer& outBuffer, VmaAllocation& outAlloc);
+  // stores the buffer and its name, destroying it on a name `Collision`
+  int32_t registerBuffer(uint64_t id, VkBuffer buffer, VmaAllocation alloc,
+                         VkBufferCreateInfo const& createInfo,
+                         BufferHandle* outHandle);
+  // discards `buffer`, or defers it if pinned (shard lock held)
+  void discardOrDefer(vk::DiscardPool* discardPool, ManagedBuffer const& buffer,
+                      uint64_t timeline);
+
+  // -- defragmentation, see `DefragmentationService` --
+  // movable, not pinned buffers by allocation
+  void collectMoveCandidates(
+      std::unordered_map<VmaAllocation, MoveCandidate>& outCandidates) const;
+  // swaps the handle of the buffer if it still owns `alloc`, and pins it
+  bool rebindForMove(BufferHandle handle, VmaAllocation alloc,
+                     VkBuffer newBuffer, VkBuffer& outOldBuffer);
+  // unpins every buffer and forwards discards deferred while pinned
+  void unpinAll(vk::DiscardPool* discardPool);
 };
 
 }  // namespace avk::experimental
@@ -4,29 +4,53 @@
 #include "render/vk/device-vk.h"
 #include "render/vk/discard-pool.h"
 #include "utils/mixins.h"
+#include "utils/sharded-table.h"
+#include "utils/slot-map.h"
 
 // library
-#include <shared_mutex>
+#include <mutex>
 #include <unordered_map>
 
 // TODO: Same todos of buffer manager
 
 namespace avk::experimental {
 
+class DefragmentationService;
+class MemoryBudgetGovernor;
+
+/// handle to an image of `ImageManager`, see `ResourceHandle`
+using ImageHandle = ResourceHandle<struct ImageHandleTag>;
+
 /// Vulkan Images and their allocations following VMA Guidelines
 /// images can be allocated by multiple threads concurrently, but each
 /// thread should free its own images. This class won't destroy its
 /// resources automatically
 /// Note: There is no "staging image", because you would use a staging buffer
 /// for that with `vkCmdCopyBufferToImage`
+/// Note: allocations go to the `VmaPool`s of `vk::EMemoryClass` render targets
+/// (attachments), textures or streaming (textures with `streamingNeeded`)
+/// when enabled, see `vk::Device::createPooledImage`
+/// Note: as `BufferManager`, images are addressed by `ImageHandle`, while
+/// `uint64_t` ids are optional names (`NoName` to skip them)
 class ImageManager : public NonMoveable {
+  friend class DefragmentationService;
+
  public:
   static constexpr int32_t Success = 0;
   static constexpr int32_t VulkanError = -1;
   static constexpr int32_t Collision = -2;
+  /// rejected by the `MemoryBudgetGovernor`, nothing was allocated
+  static constexpr int32_t OverBudget = -3;
+  /// id of images reachable only through their handle
+  static constexpr uint64_t NoName = 0;
 
   explicit ImageManager(vk::Device* device, size_t cap = 256);
 
+  /// null to allocate without admission control. Must outlive the manager
+  inline void setBudgetGovernor(MemoryBudgetGovernor* governor) {
+    m_governor = governor;
+  }
+
   /// create transient attachment (depth/stencil or color)
   /// these are temporary images which do not need a memory backing inside
   /// main memory (SoC systems, where main memory = GPU global memory),
@@ -43,9 +67,14 @@ class ImageManager : public NonMoveable {
   /// - Note: We now support only 2D images
   /// - Note: If `LAZILY_ALLOCATED_BIT` is chosen, it's probably not
   /// `HOST_VISIBLE`
+  /// - Note: chains of attachments with disjoint lifetimes within the frame
+  /// (eg. post processing) should rather share memory through a
+  /// `TransientAliasingAllocator`
+  /// \param outHandle if not null, receives the handle of the image
   int32_t createTransientAttachment(
       uint64_t id, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage,
-      VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT);
+      VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT,
+      ImageHandle* outHandle = nullptr);
 
   /// Create Sampled texture for an object. Assumes it's GPU-local and not
   /// critical. Note: By default, this is GPU-only. if flag `streamingNeeded`
@@ -54,7 +83,11 @@ class ImageManager : public NonMoveable {
   /// meaning we let VMA figure out if the memory chosen can be mapped,
   /// otherwise you need to use a staging buffer and a transfer operation
   ///
-  /// Note: Budget is tracked by `Device` class
+  /// Note: Budget is tracked by `Device` class. With a `MemoryBudgetGovernor`
+  /// the texture is admitted on a rough size estimate, hence `OverBudget` is
+  /// returned instead of allocating past its hard threshold (the caller can
+  /// fall back to a smaller mip or a placeholder), and out of device memory
+  /// is retried once after eviction
   ///
   /// \param streamingNeeded if true, signal that CPU frequently writes this
   /// \param forceWithinBudget if true,
@@ -68,11 +101,31 @@ class ImageManager : public NonMoveable {
   int32_t createTexture(uint64_t id, VkExtent2D extent, VkFormat format,
                         VkImageUsageFlags usage, VkSampleCountFlagBits samples,
                         bool streamingNeeded, bool forceWithinBudget,
-                        bool forceNoAllocation);
+                        bool forceNoAllocation,
+                        ImageHandle* outHandle = nullptr);
+
+  /// handle of the image named `id`, null handle if there's none
+  ImageHandle find(uint64_t id) const;
+  /// false if the handle is stale
+  bool get(ImageHandle handle, VkImage& outImage,
+           VmaAllocation& outAlloc) const;
+  /// false if it doesn't find anything. Prefer handles on hot paths
+  bool get(uint64_t id, VkImage& outImage, VmaAllocation& outAlloc) const;
 
-  /// false if it doesn't find anything
-  bool get(uint64_t id, VkImage& outImage, VmaAllocation& outAlloc);
+  /// allows `DefragmentationService` to move the image, which must be a color
+  /// image created with transfer src and dst usage, and whose layout is always
+  /// `layout` outside of the frame recording (eg. sampled textures).
+  /// `VK_IMAGE_LAYOUT_UNDEFINED` makes it unmovable. Its `VkImage` changes on
+  /// a move, hence whoever keeps the handle (eg. image views) should listen to
+  /// moves. False if not found or not movable
+  bool setMovable(ImageHandle handle, VkImageLayout layout);
+  bool setMovable(uint64_t id, VkImageLayout layout);
 
+  /// remove the discarded image (and its name) and insert it in discard pool,
+  /// making its handle stale. False if the handle is already stale
+  /// \warning assumes `discardPool` is on the same `vk::Device`
+  bool discard(vk::DiscardPool* discardPool, ImageHandle handle,
+               uint64_t timeline);
   /// remove the discarded image from hash table and insert it in discard pool
   /// if nothing is found return false
   /// \warning assumes `discardPool` is on the same `vk::Device`
@@ -88,17 +141,65 @@ class ImageManager : public NonMoveable {
   struct Deps {
     vk::Device* device;
   } m_deps;
+  MemoryBudgetGovernor* m_governor = nullptr;
 
   /// structure to hold all handles. Other objects/functions should always
   /// request them from here when needed and discard them manually when not used
   /// anymore
-  std::unordered_map<uint64_t, vk::VMAResource<VkImage>> m_imageMap;
+  struct ManagedImage : public vk::VMAResource<VkImage> {
+    ManagedImage(VkImage image, VmaAllocation alloc,
+                 VkImageCreateInfo const& createInfo, uint64_t name)
+        : vk::VMAResource<VkImage>(image, alloc),
+          createInfo(createInfo),
+          name(name) {}
+
+    // to recreate the image when defragmentation moves it (no pNext)
+    VkImageCreateInfo createInfo;
+    // key in `m_names`, or `NoName`
+    uint64_t name;
+    // steady layout if movable, `VK_IMAGE_LAYOUT_UNDEFINED` otherwise
+    VkImageLayout movableLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    // moved by the pending defragmentation pass, hence the allocation
+    // can't be freed until the pass ends
+    bool pinned = false;
+  };
+  // what `DefragmentationService` needs to move an image
+  struct MoveCandidate {
+    ImageHandle handle;
+    uint64_t id;
+    VkImageCreateInfo createInfo;
+    VkImageLayout layout;
+  };
+
+  /// images by handle, shared reads and exclusive writes per shard. Note:
+  /// When a thread reads a resource, the element is not locked inside the
+  /// slot map, someone else could come and delete it! hence each thread
+  /// should own its own resources (preferably, embedding TID inside hash)
+  SlotMap<ManagedImage, ImageHandle> m_images;
+  /// name side table, lock striped
+  ShardedTable<ImageHandle> m_names;
+  /// discards of pinned images, forwarded to the discard pool once the
+  /// defragmentation pass ends
+  vk::utils::TimelineResources<vk::VMAResource<VkImage>> m_pinnedDiscards;
+  std::mutex m_pinnedMtx;
+
+  // stores the image and its name, destroying it on a name `Collision`
+  int32_t registerImage(uint64_t id, VkImage image, VmaAllocation alloc,
+                        VkImageCreateInfo const& createInfo,
+                        ImageHandle* outHandle);
+  // discards `image`, or defers it if pinned (shard lock held)
+  void discardOrDefer(vk::DiscardPool* discardPool, ManagedImage const& image,
+                      uint64_t timeline);
 
-  /// synchronization primitive to achieve shared read, single write. Note: When
-  /// a thread reads a resource, the element is not locked inside the hash
-  /// table, someone else could come and delete it! hence each thread should own
-  /// its own resources (preferably, embedding TID inside hash)
-  mutable std::shared_mutex m_mtx;
+  // -- defragmentation, see `DefragmentationService` --
+  // movable, not pinned images by allocation
+  void collectMoveCandidates(
+      std::unordered_map<VmaAllocation, MoveCandidate>& outCandidates) const;
+  // swaps the handle of the image if it still owns `alloc`, and pins it
+  bool rebindForMove(ImageHandle handle, VmaAllocation alloc,
+                     VkImage newImage, VkImage& outOldImage);
+  // unpins every image and forwards discards deferred while pinned
+  void unpinAll(vk::DiscardPool* discardPool);
 };
 
 }  // namespace avk::experimental
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "render/vk/common-vk.h"
+#include "render/vk/device-vk.h"
+#include "render/vk/discard-pool.h"
+#include "utils/mixins.h"
+
+// std
+#include <mutex>
+#include <vector>
+
+namespace avk::experimental {
+
+/// "Mega buffer" suballocator for small, long lived GPU buffers (vertex,
+/// index, uniform). Hands out ranges of a few large `VkBuffer`s, each
+/// managed by a VMA virtual block, such that thousands of small meshes share
+/// a handful of handles, binds and memory allocations instead of one
+/// `BufferManager::createBufferGPUOnly` each
+/// - blocks are created on demand, `BlockBytes` each (or bigger for larger
+///   requests), in the `vk::EMemoryClass::eStaticGeometry` pools
+/// - ranges are freed through the timeline: `free` records the value after
+///   which the range is unused, and `releaseCompleted` returns the ranges
+///   whose value was reached to their virtual block
+/// - on SoC the blocks are host visible and persistently mapped, otherwise
+///   ranges are filled with transfers (`VK_BUFFER_USAGE_TRANSFER_DST_BIT`)
+/// - thread safe
+class BufferSuballocator : public NonMoveable {
+ public:
+  static VkBufferUsageFlags constexpr DefaultUsage =
+      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  static VkDeviceSize constexpr DefaultBlockBytes = 16 << 20;
+
+  struct Range {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    /// host address of `offset` if the block is mapped (SoC), else null
+    void* mapped = nullptr;
+    /// owning block and virtual allocation, needed by `free`
+    uint32_t block = 0;
+    VmaVirtualAllocation alloc = VK_NULL_HANDLE;
+
+    inline operator bool() const { return buffer != VK_NULL_HANDLE; }
+  };
+
+  BufferSuballocator(vk::Device* device,
+                     VkDeviceSize blockBytes = DefaultBlockBytes,
+                     VkBufferUsageFlags usage = DefaultUsage);
+  /// \warning assumes no submission using the ranges is pending
+  ~BufferSuballocator() noexcept;
+
+  /// returns an empty range if `bytes` is 0, or if no block can hold it and
+  /// a new block can't be allocated
+  /// \param alignment must be a power of two, 0 for the default alignment
+  /// (which already satisfies uniform and storage offset alignments)
+  Range allocate(VkDeviceSize bytes, VkDeviceSize alignment = 0);
+
+  /// the range is returned to its block by the first `releaseCompleted`
+  /// whose `completedValue` is at least `timeline`
+  void free(Range const& range, uint64_t timeline);
+  /// frees the ranges whose timeline value was reached, eg. with
+  /// `vk::DiscardPool::queryTime()`
+  void releaseCompleted(uint64_t completedValue);
+
+  /// allocated bytes (padding included) over every block
+  VkDeviceSize usedBytes() const;
+  inline size_t blockCount() const {
+    std::lock_guard lk{m_mtx};
+    return m_blocks.size();
+  }
+
+ private:
+  // dependencies which must outlive the object
+  struct Deps {
+    vk::Device* device;
+  } m_deps;
+
+  struct Block {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VmaAllocation alloc = VK_NULL_HANDLE;
+    VmaVirtualBlock virtualBlock = VK_NULL_HANDLE;
+    uint8_t* mapped = nullptr;
+  };
+
+  VkDeviceSize m_blockBytes = 0;
+  VkBufferUsageFlags m_usage = 0;
+  VkDeviceSize m_minAlignment = 1;
+  std::vector<Block> m_blocks;
+  vk::utils::TimelineResources<Range> m_pendingFrees;
+  // virtual blocks are not thread safe
+  mutable std::mutex m_mtx;
+
+  // false if the block couldn't be allocated (lock held)
+  bool createBlock(VkDeviceSize bytes);
+  // (lock held)
+  bool allocateFromBlock(uint32_t blockIndex, VkDeviceSize bytes,
+                         VkDeviceSize alignment, Range& outRange);
+};
+
+}  // namespace avk::experimental
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "render/vk/common-vk.h"
+#include "render/vk/device-vk.h"
+#include "render/vk/discard-pool.h"
+#include "utils/mixins.h"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace avk::experimental {
+
+/// Submissions on the graphics and compute queues, such that compute (post
+/// processing, simulation) overlaps with rasterization
+/// - each queue signals its own timeline, which is the semaphore of its
+///   `vk::DiscardPool`: resources used by a submission are discarded, on the
+///   pool of its queue, to the value it signals
+/// - `waitFor` makes the next submission on a queue wait for the last one on
+///   the other queue only, hence the queues serialize only where one consumes
+///   the output of the other
+/// - without async compute, compute submissions go to the universal queue,
+///   where the waits are still correct, only useless
+/// - resources used by both queues of different families need
+///   `VK_SHARING_MODE_CONCURRENT`, or queue family ownership transfers
+/// - render thread only, as queue submission is externally synchronized
+class CrossQueueSubmitter : public NonMoveable {
+ public:
+  enum class EQueue : uint32_t { eGraphics = 0, eCompute, eCount };
+
+  CrossQueueSubmitter(vk::Device* device, vk::DiscardPool* graphicsDiscardPool,
+                      vk::DiscardPool* computeDiscardPool);
+
+  /// the next submission on `queue` waits, at `stages`, for the last
+  /// submission on `other`. Nothing if `other` didn't submit anything yet
+  void waitFor(EQueue queue, EQueue other, VkPipelineStageFlags stages);
+  /// the next submission on `queue` waits for `semaphore` at `value`
+  /// (ignored for binary semaphores, eg. swapchain image acquisition)
+  void addWait(EQueue queue, VkSemaphore semaphore, uint64_t value,
+               VkPipelineStageFlags stages);
+  /// the next submission on `queue` also signals the binary `semaphore` (eg.
+  /// presentation)
+  void addSignal(EQueue queue, VkSemaphore semaphore);
+
+  /// submits `cmds` on `queue` with the waits and signals added since its
+  /// last submission, signaling `nextValue(queue)` on its timeline. Waits and
+  /// signals are dropped also on failure
+  VkResult submit(EQueue queue, VkCommandBuffer const* cmds,
+                  uint32_t cmdCount, VkFence fence = VK_NULL_HANDLE);
+  /// records that a submission made without `submit` signaled `value` on the
+  /// timeline of `queue`. Waits and signals added for `queue` stay pending
+  void notifySubmitted(EQueue queue, uint64_t value);
+
+  /// value signaled by the next submission on `queue`. Discard resources used
+  /// by the commands being recorded to it
+  inline uint64_t nextValue(EQueue queue) const {
+    return m_queues[index(queue)].lastValue + 1;
+  }
+  inline uint64_t lastValue(EQueue queue) const {
+    return m_queues[index(queue)].lastValue;
+  }
+  inline vk::DiscardPool* discardPool(EQueue queue) const {
+    return m_queues[index(queue)].discardPool;
+  }
+  inline VkQueue queue(EQueue queue) const {
+    return m_queues[index(queue)].queue;
+  }
+  /// family of the command pools to record the commands of `queue` from
+  inline uint32_t queueFamilyIndex(EQueue queue) const {
+    return m_queues[index(queue)].familyIndex;
+  }
+
+ private:
+  // dependencies which must outlive the object
+  struct Deps {
+    vk::Device* device;
+  } m_deps;
+
+  struct Queue {
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t familyIndex = VK_QUEUE_FAMILY_IGNORED;
+    vk::DiscardPool* discardPool = nullptr;
+    uint64_t lastValue = 0;
+
+    // of the next submission. Binary semaphores have value 0
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<uint64_t> waitValues;
+    std::vector<VkPipelineStageFlags> waitStages;
+    std::vector<VkSemaphore> signalSemaphores;
+    std::vector<uint64_t> signalValues;
+  };
+  Queue m_queues[static_cast<uint32_t>(EQueue::eCount)];
+
+  static inline uint32_t index(EQueue queue) {
+    return static_cast<uint32_t>(queue);
+  }
+  static void clearPending(Queue& queue);
+};
+
+}  // namespace avk::experimental
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "render/experimental/avk-basic-buffer-manager.h"
+#include "render/experimental/avk-basic-image-manager.h"
+#include "render/vk/common-vk.h"
+#include "render/vk/device-vk.h"
+#include "render/vk/discard-pool.h"
+#include "utils/mixins.h"
+
+// std
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace avk::experimental {
+
+/// Incremental defragmentation of the resources of `BufferManager` and
+/// `ImageManager`, spread over frames with `vmaBeginDefragmentation` passes
+/// - each pass moves at most `Config::MaxBytesPerPass` bytes and
+///   `Config::MaxAllocationsPerPass` allocations, recording the copies at the
+///   beginning of the frame command buffer
+/// - a pass ends once the timeline value signaled by its frame is reached,
+///   hence at most one pass is in flight
+/// - only resources opted in with `setMovable` are moved, everything else
+///   (eg. `FrameLinearAllocator` regions, KTX textures) is left in place
+/// - moved resources get a new handle, swapped inside the managers, while the
+///   old one is retired through the `DiscardPool`. Whoever keeps handles
+///   across frames (descriptor sets, image views) should register a listener
+/// - targets are the pools of `EMemoryClass::eStaticGeometry` and
+///   `EMemoryClass::eTextures` (unless linear), plus VMA default pools
+class DefragmentationService : public NonMoveable {
+ public:
+  struct Config {
+    VkDeviceSize MaxBytesPerPass = 16 << 20;
+    uint32_t MaxAllocationsPerPass = 64;
+    uint32_t RunEveryNFrames = 3600;  // 1 minute on 60fps
+  };
+
+  /// called on the render thread while the frame is being recorded, after
+  /// the Vulkan handle of the resource is swapped. `id` is its name, if any
+  using BufferMoveListener =
+      std::function<void(BufferHandle handle, uint64_t id, VkBuffer buffer)>;
+  using ImageMoveListener =
+      std::function<void(ImageHandle handle, uint64_t id, VkImage image)>;
+
+  DefragmentationService(vk::Device* device, vk::DiscardPool* discardPool,
+                         BufferManager* bufferManager,
+                         ImageManager* imageManager);
+  /// \warning assumes the device is idle
+  ~DefragmentationService() noexcept;
+
+  /// ends the pending pass if its copies are done, then, if a run is ongoing
+  /// (or due), records the copies of the next pass on `cmd`, which must be
+  /// outside of a render pass and submitted signaling `signalValue` on the
+  /// timeline of the discard pool. Render thread only
+  void recordFrame(VkCommandBuffer cmd, uint64_t signalValue);
+
+  /// starts a run on the next `recordFrame`, regardless of `RunEveryNFrames`
+  inline void requestRun() { m_runRequested = true; }
+  /// true while a run is moving allocations
+  inline bool running() const { return m_targetIndex < m_targets.size(); }
+
+  inline void setBufferMoveListener(BufferMoveListener listener) {
+    m_bufferMoveListener = std::move(listener);
+  }
+  inline void setImageMoveListener(ImageMoveListener listener) {
+    m_imageMoveListener = std::move(listener);
+  }
+
+  Config Conf;
+
+ private:
+  // dependencies which must outlive the object
+  struct Deps {
+    vk::Device* device;
+    vk::DiscardPool* discardPool;
+    BufferManager* bufferManager;
+    ImageManager* imageManager;
+  } m_deps;
+
+  // pools to defragment in the current run, `VK_NULL_HANDLE` for default pools
+  std::vector<VmaPool> m_targets;
+  size_t m_targetIndex = 0;
+  // context of `m_targets[m_targetIndex]`, null before its first pass
+  VmaDefragmentationContext m_context = VK_NULL_HANDLE;
+  VmaDefragmentationPassMoveInfo m_passInfo{};
+  bool m_passPending = false;
+  // timeline value signaled by the frame which copied the pending pass
+  uint64_t m_passValue = 0;
+  // accumulated over the targets of the current run
+  VmaDefragmentationStats m_runStats{};
+
+  uint32_t m_frameCounter = 0;
+  bool m_runRequested = false;
+
+  BufferMoveListener m_bufferMoveListener;
+  ImageMoveListener m_imageMoveListener;
+
+  // scratch storage reused across passes
+  std::unordered_map<VmaAllocation, BufferManager::MoveCandidate>
+      m_bufferCandidates;
+  std::unordered_map<VmaAllocation, ImageManager::MoveCandidate>
+      m_imageCandidates;
+  struct BufferMove {
+    VkBuffer oldBuffer;
+    VkBuffer newBuffer;
+    VkDeviceSize size;
+  };
+  std::vector<BufferMove> m_bufferMoves;
+  struct ImageMove {
+    VkImage oldImage;
+    VkImage newImage;
+    ImageManager::MoveCandidate candidate;
+  };
+  std::vector<ImageMove> m_imageMoves;
+  std::vector<VkImageMemoryBarrier> m_imageBarriers;
+  std::vector<VkImageCopy> m_imageCopies;
+
+  void startRun();
+  // creates the context of the first target from `m_targetIndex` which
+  // supports defragmentation. False if the run is over
+  bool beginTarget();
+  void endTarget();
+  void beginPass(VkCommandBuffer cmd, uint64_t signalValue);
+  void endPass();
+  // false if the move should be ignored
+  bool prepareBufferMove(VmaDefragmentationMove const& move,
+                         BufferManager::MoveCandidate const& candidate,
+                         uint64_t signalValue);
+  bool prepareImageMove(VmaDefragmentationMove const& move,
+                        ImageManager::MoveCandidate const& candidate,
+                        uint64_t signalValue);
+  void recordCopies(VkCommandBuffer cmd);
+};
+
+}  // namespace avk::experimental
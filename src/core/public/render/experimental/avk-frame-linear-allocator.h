@@ -0,0 +1,104 @@
+#pragma once
+
+#include "render/vk/common-vk.h"
+#include "render/vk/device-vk.h"
+#include "render/vk/discard-pool.h"
+#include "utils/mixins.h"
+
+// std
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace avk::experimental {
+
+/// Linear (bump) allocator for data rewritten every frame (uniforms, dynamic
+/// vertices and indices). Owns one persistently mapped buffer per frame in
+/// flight, suballocated with an atomic bump pointer, hence per frame data costs
+/// an offset increment instead of `BufferManager::createBuffer*` +
+/// `discardById`. The region of a frame is reset by `beginFrame` once the
+/// timeline value signaled by its previous submission is reached
+/// - `allocate` can be called by multiple recording threads, `beginFrame`
+///   only by the render thread
+/// - offsets are aligned to `minUniformBufferOffsetAlignment` (and
+///   `minStorageBufferOffsetAlignment` if created with storage usage), hence
+///   usable with dynamic offsets or `VkDescriptorBufferInfo`
+/// - memory is `HOST_COHERENT`, hence no flush is needed before submission
+class FrameLinearAllocator : public NonMoveable {
+ public:
+  static VkBufferUsageFlags constexpr DefaultUsage =
+      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+      VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+
+  struct Allocation {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    /// host address of `offset`
+    void* mapped = nullptr;
+
+    inline operator bool() const { return mapped != nullptr; }
+  };
+
+  /// \param frameCount number of regions, should be the number of frames in
+  /// flight of the swapchain
+  FrameLinearAllocator(vk::Device* device, uint32_t frameCount,
+                       VkDeviceSize bytesPerFrame,
+                       VkBufferUsageFlags usage = DefaultUsage);
+  /// \warning assumes no submission using the regions is pending
+  ~FrameLinearAllocator() noexcept;
+
+  /// resets the region of `frameIndex`, to be used by the submission which
+  /// signals `signalValue` on `discardPool`'s timeline. If the previous
+  /// submission of the region is still pending, waits for it (never happens
+  /// when `frameCount` matches the swapchain, whose fence is waited on
+  /// acquisition)
+  void beginFrame(uint32_t frameIndex, vk::DiscardPool* discardPool,
+                  uint64_t signalValue);
+
+  /// returns an empty allocation if the region is exhausted, such that the
+  /// caller can fall back to a dedicated buffer
+  /// \param alignment must be a power of two, 0 for the default alignment
+  Allocation allocate(VkDeviceSize bytes, VkDeviceSize alignment = 0);
+
+  /// allocates and copies `value`
+  template <typename T>
+  inline Allocation push(T const& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    Allocation const allocation = allocate(sizeof(T));
+    if (allocation) {
+      memcpy(allocation.mapped, &value, sizeof(T));
+    }
+    return allocation;
+  }
+
+  inline VkDeviceSize bytesPerFrame() const { return m_bytesPerFrame; }
+  /// bytes handed out in the current frame, alignment padding included
+  inline VkDeviceSize usedBytes() const {
+    return m_head.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // dependencies which must outlive the object
+  struct Deps {
+    vk::Device* device;
+  } m_deps;
+
+  struct Region {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VmaAllocation alloc = VK_NULL_HANDLE;
+    uint8_t* mapped = nullptr;
+    /// timeline value signaled by the last submission using the region
+    uint64_t pendingValue = 0;
+  };
+
+  std::vector<Region> m_regions;
+  VkDeviceSize m_bytesPerFrame = 0;
+  VkDeviceSize m_minAlignment = 1;
+  uint32_t m_current = 0;
+  /// bump pointer inside the current region
+  std::atomic<VkDeviceSize> m_head = 0;
+};
+
+}  // namespace avk::experimental
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "render/vk/common-vk.h"
+#include "render/vk/device-vk.h"
+#include "render/vk/discard-pool.h"
+#include "utils/mixins.h"
+
+// std
+#include <array>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace avk::experimental {
+
+/// Keeps device memory under the budget reported by `VK_EXT_memory_budget`
+/// (through `vk::Device::heapBudgets`), such that running low on VRAM
+/// degrades quality instead of failing allocations
+/// - usage is the sum over device local heaps (every heap on SoC), refreshed
+///   by `onFrame` and bumped by every admitted allocation in between
+/// - over `SoftThreshold` of the budget, eviction callbacks are asked to
+///   release memory (eg. far texture mips, cached meshes) until usage is back
+///   under it, and streaming allocations are limited to
+///   `StreamingBytesPerFrameUnderPressure` per frame
+/// - allocations which would cross `HardThreshold` are rejected by `admit`
+///   unless their class is critical (`eRenderTargets`, `eStaging`). Eviction
+///   is started for them, and the caller retries on a later frame
+/// - evicted resources go through the `vk::DiscardPool`, hence their memory
+///   is freed only once the frames in flight using them retire. Until then,
+///   evicted bytes are counted as pending, such that the same shortfall
+///   doesn't evict again every call
+/// - thread safe. Eviction callbacks run with the governor lock held, hence
+///   they must discard resources but never allocate
+class MemoryBudgetGovernor : public NonMoveable {
+ public:
+  enum class EPressure : uint8_t { eNone = 0, eSoft, eHard };
+
+  struct Config {
+    float SoftThreshold = 0.80f;
+    float HardThreshold = 0.95f;
+    VkDeviceSize StreamingBytesPerFrameUnderPressure = 8 << 20;
+    /// `onFrame`s after which pending evictions are assumed retired (frames
+    /// in flight + 1), in case the usage drop isn't observed
+    uint32_t EvictionRetireFrames = 3;
+  };
+
+  /// asked to release about `bytes` bytes, preferably of `memoryClass`
+  /// (`eCount` when any class will do). Returns (an estimate of) the bytes
+  /// released, which should go through the `vk::DiscardPool`
+  using EvictionCallback = std::function<VkDeviceSize(
+      vk::EMemoryClass memoryClass, VkDeviceSize bytes, EPressure pressure)>;
+
+  MemoryBudgetGovernor(vk::Device* device, vk::DiscardPool* discardPool);
+
+  /// callbacks are called in ascending `priority` order (cheapest to lose
+  /// first). Returns the id for `removeEvictionCallback`
+  uint32_t addEvictionCallback(EvictionCallback callback, int32_t priority = 0);
+  void removeEvictionCallback(uint32_t id);
+
+  /// to be called once per frame, after `vk::Device::refreshMemoryBudgets`
+  void onFrame();
+
+  /// whether an allocation of `bytes` of `memoryClass` should proceed. If
+  /// true, `bytes` are accounted until the next `onFrame`. If false, eviction
+  /// has been started and the allocation should be retried on a later frame
+  bool admit(vk::EMemoryClass memoryClass, VkDeviceSize bytes);
+  /// runs eviction callbacks for at least `bytes` (minus evictions still
+  /// pending) and destroys the discarded resources whose timeline value was
+  /// reached. Meant as a retry after an allocation failed with
+  /// `VK_ERROR_OUT_OF_DEVICE_MEMORY`. True only if heap usage actually went
+  /// down, hence an immediate retry can succeed. Resources evicted by this
+  /// call are usually still in flight, and free their memory frames later
+  bool reclaim(vk::EMemoryClass memoryClass, VkDeviceSize bytes);
+
+  EPressure pressure() const;
+  /// usage and budget of the device local heaps, as of the last `onFrame`
+  VkDeviceSize usage() const;
+  VkDeviceSize budget() const;
+  /// pool statistics of `memoryClass` as of the last `onFrame`
+  VmaStatistics classStatistics(vk::EMemoryClass memoryClass) const;
+
+  Config Conf;
+
+ private:
+  // dependencies which must outlive the object
+  struct Deps {
+    vk::Device* device;
+    vk::DiscardPool* discardPool;
+  } m_deps;
+
+  struct Eviction {
+    uint32_t id;
+    int32_t priority;
+    EvictionCallback callback;
+  };
+  // sorted by priority
+  std::vector<Eviction> m_evictions;
+  uint32_t m_nextEvictionId = 1;
+
+  // heaps counted in `m_usage` and `m_budget`
+  std::vector<uint32_t> m_heaps;
+  VkDeviceSize m_usage = 0;
+  VkDeviceSize m_budget = 0;
+  // admitted since the last `onFrame`, not yet reflected in `m_usage`
+  VkDeviceSize m_admittedBytes = 0;
+  VkDeviceSize m_streamingBytes = 0;
+  // evicted, but not yet seen leaving the heaps
+  VkDeviceSize m_pendingEvictedBytes = 0;
+  // `m_usage` as of the last `onFrame`, to observe pending evictions retire
+  VkDeviceSize m_frameUsage = 0;
+  uint32_t m_pendingEvictionFrames = 0;
+  EPressure m_pressure = EPressure::eNone;
+  std::array<VmaStatistics, static_cast<size_t>(vk::EMemoryClass::eCount)>
+      m_classStats{};
+
+  mutable std::mutex m_mtx;
+
+  // (lock held)
+  EPressure pressureOf(VkDeviceSize usage) const;
+  // evicts what `bytes` exceeds of the pending evictions
+  VkDeviceSize evict(vk::EMemoryClass memoryClass, VkDeviceSize bytes,
+                     EPressure pressure);
+  void refreshUsage();
+};
+
+}  // namespace avk::experimental
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "render/vk/common-vk.h"
+#include "render/vk/device-vk.h"
+#include "utils/mixins.h"
+
+// std
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <vector>
+
+namespace avk::experimental {
+
+/// GPU to CPU copies without stalls (picking, occlusion results, screenshots).
+/// Copies are recorded into a ring of persistently mapped readback memory and
+/// tagged with the timeline value signaled by the submission carrying them.
+/// `poll`, called every frame with the completed timeline value (eg.
+/// `vk::DiscardPool::queryTime()`), delivers results in request order and
+/// recycles their ring space, hence nothing ever waits on the GPU
+/// - a request which doesn't fit in the ring is refused (returns false or an
+///   invalid future), to be retried on a later frame
+/// - non coherent memory is invalidated before the callback
+/// - the source must be ready for transfer reads: a global barrier orders
+///   the copies after every previous write, but images must already be in
+///   `VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL` (or `GENERAL`)
+/// - data passed to callbacks is valid only during the call
+/// - render thread only
+class ReadbackService : public NonMoveable {
+ public:
+  static VkDeviceSize constexpr DefaultRingBytes = 8 << 20;
+
+  using Callback = std::function<void(void const* data, VkDeviceSize bytes)>;
+
+  explicit ReadbackService(vk::Device* device,
+                           VkDeviceSize ringBytes = DefaultRingBytes);
+  /// pending requests are dropped without calling their callback
+  /// \warning assumes no submission writing the ring is pending
+  ~ReadbackService() noexcept;
+
+  /// records a copy of `bytes` of `src` from `offset` on `cmd`, which must be
+  /// outside of a render pass and submitted signaling `signalValue`
+  bool readBuffer(VkCommandBuffer cmd, uint64_t signalValue, VkBuffer src,
+                  VkDeviceSize offset, VkDeviceSize bytes, Callback callback);
+  /// as `readBuffer`, for the tightly packed texels of `region` of `src`
+  /// \param texelBytes size of a texel of the format of `src`. Its ring
+  /// offset is aligned to it, hence 3 component formats are supported
+  bool readImage(VkCommandBuffer cmd, uint64_t signalValue, VkImage src,
+                 VkImageLayout layout, VkImageSubresourceLayers subresource,
+                 VkOffset3D offset, VkExtent3D extent, uint32_t texelBytes,
+                 Callback callback);
+
+  /// `readBuffer` delivering a copy of the data through a future, invalid if
+  /// the request was refused
+  std::future<std::vector<uint8_t>> readBuffer(VkCommandBuffer cmd,
+                                               uint64_t signalValue,
+                                               VkBuffer src,
+                                               VkDeviceSize offset,
+                                               VkDeviceSize bytes);
+
+  /// delivers every request whose value is at most `completedValue`
+  void poll(uint64_t completedValue);
+
+  inline size_t pendingCount() const { return m_pending.size(); }
+  inline VkDeviceSize ringBytes() const { return m_ringBytes; }
+
+ private:
+  // dependencies which must outlive the object
+  struct Deps {
+    vk::Device* device;
+  } m_deps;
+
+  struct Request {
+    uint64_t value;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    Callback callback;
+  };
+
+  VkBuffer m_buffer = VK_NULL_HANDLE;
+  VmaAllocation m_alloc = VK_NULL_HANDLE;
+  uint8_t* m_mapped = nullptr;
+  VkDeviceSize m_ringBytes = 0;
+  // multiple of `nonCoherentAtomSize` and of power of two texel sizes (up
+  // to 16 B). `readImage` aligns to its least common multiple with the
+  // texel size for the others
+  VkDeviceSize m_alignment = 16;
+  // next free byte; the oldest pending request marks the end of free space
+  VkDeviceSize m_head = 0;
+  // ordered by value, as requests are recorded in submission order
+  std::deque<Request> m_pending;
+
+  // ring offset for `bytes`, multiple of `alignment` (itself a multiple of
+  // `m_alignment`), false if full
+  bool reserve(VkDeviceSize bytes, VkDeviceSize alignment,
+               VkDeviceSize& outOffset);
+  void recordBarriers(VkCommandBuffer cmd, bool beforeCopy) const;
+};
+
+}  // namespace avk::experimental
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "render/vk/common-vk.h"
+#include "render/vk/device-vk.h"
+#include "utils/mixins.h"
+
+// std
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace avk::experimental {
+
+/// Partially resident buffer (`VK_BUFFER_CREATE_SPARSE_BINDING_BIT |
+/// VK_BUFFER_CREATE_SPARSE_RESIDENCY_BIT`) for datasets whose virtual range is
+/// larger than what should be committed (point clouds, terrain), hence memory
+/// follows the working set instead of the dataset size
+/// - memory is committed per page, the alignment of the buffer memory
+///   requirements (usually 64 KiB), each page with its own VMA allocation
+/// - `commit` and `decommit` update the residency bitmap and queue the binds,
+///   which `flush` submits in a single `vkQueueBindSparse` on the device
+///   queue. Submissions reading the new pages must wait on `semaphore()` at
+///   `bindValue()`. Reads of non resident pages return zero
+///   (`residencyNonResidentStrict`) or undefined values
+/// - decommitted pages are freed once their unbind completed
+/// - unavailable (`false`) if the device lacks `sparseResidencyBuffer()`,
+///   in which case callers fall back to `BufferManager` buffers
+/// - render thread only, as `flush` uses the queue
+class SparseBuffer : public NonMoveable {
+ public:
+  static int32_t constexpr Success = 0;
+  static int32_t constexpr VulkanError = -1;
+
+  /// reserves `size` bytes of address space, without committing memory.
+  /// `usage` gets `VK_BUFFER_USAGE_TRANSFER_DST_BIT` to upload pages
+  SparseBuffer(vk::Device* device, VkDeviceSize size, VkBufferUsageFlags usage);
+  /// waits for pending binds, then frees buffer and pages
+  /// \warning assumes no submission using the buffer is pending
+  ~SparseBuffer() noexcept;
+
+  inline operator bool() const { return m_buffer != VK_NULL_HANDLE; }
+
+  /// makes the pages overlapping [`offset`, `offset + bytes`) resident. On
+  /// `VulkanError` (out of memory), pages committed so far stay committed
+  int32_t commit(VkDeviceSize offset, VkDeviceSize bytes);
+  /// releases the pages entirely inside [`offset`, `offset + bytes`), such
+  /// that data of partially covered neighbour pages is preserved
+  void decommit(VkDeviceSize offset, VkDeviceSize bytes);
+  /// submits the queued binds, if any, after `waitSemaphore` reached
+  /// `waitValue` (eg. the frame timeline and the last submitted value, such
+  /// that pages are unbound after the frames reading them), and frees the
+  /// pages whose unbind completed
+  int32_t flush(VkSemaphore waitSemaphore, uint64_t waitValue);
+
+  /// whether all pages overlapping the range are committed (binds may still
+  /// be waiting for `flush`)
+  bool isResident(VkDeviceSize offset, VkDeviceSize bytes) const;
+
+  inline VkBuffer buffer() const { return m_buffer; }
+  inline VkDeviceSize size() const { return m_size; }
+  inline VkDeviceSize pageSize() const { return m_pageSize; }
+  inline uint32_t pageCount() const { return m_pageCount; }
+  inline VkDeviceSize committedBytes() const {
+    return m_pages.size() * m_pageSize;
+  }
+  /// signaled with `bindValue()` by the last `flush`
+  inline VkSemaphore semaphore() const { return m_semaphore; }
+  inline uint64_t bindValue() const { return m_bindValue; }
+
+ private:
+  // dependencies which must outlive the object
+  struct Deps {
+    vk::Device* device;
+  } m_deps;
+
+  struct RetiredPage {
+    VmaAllocation alloc;
+    /// bind value after which the page is unbound
+    uint64_t value;
+  };
+
+  VkBuffer m_buffer = VK_NULL_HANDLE;
+  VkSemaphore m_semaphore = VK_NULL_HANDLE;
+  uint64_t m_bindValue = 0;
+  VkDeviceSize m_size = 0;
+  VkDeviceSize m_pageSize = 0;
+  uint32_t m_pageCount = 0;
+  uint32_t m_memoryTypeBits = 0;
+
+  /// one bit per page, set when committed
+  std::vector<uint64_t> m_residency;
+  /// committed pages, sized by the working set rather than the page count
+  std::unordered_map<uint32_t, VmaAllocation> m_pages;
+  /// binds queued for the next `flush`, null for unbinds. One per page, as a
+  /// range can't be bound twice in a batch
+  std::unordered_map<uint32_t, VmaAllocation> m_pendingBinds;
+  /// ordered by value
+  std::vector<RetiredPage> m_retired;
+  // scratch storage of `flush`
+  std::vector<VkSparseMemoryBind> m_binds;
+
+  inline bool resident(uint32_t page) const {
+    return m_residency[page >> 6] & (uint64_t(1) << (page & 63));
+  }
+  void freeRetiredPages(uint64_t completedValue);
+};
+
+}  // namespace avk::experimental
@@ -1,10 +1,12 @@
 #pragma once
 
+#include "render/experimental/avk-barrier-batcher.h"
 #include "render/experimental/avk-basic-buffer-manager.h"
 #include "render/vk/common-vk.h"
 #include "utils/mixins.h"
 
 // std
+#include <deque>
 #include <vector>
 
 namespace avk::experimental {
@@ -14,9 +16,9 @@ struct StagingOperation {
   VmaAllocation dstAlloc = VK_NULL_HANDLE;
   void const* srcData = nullptr;
   size_t srcBytes = 0;
-  uint64_t stagingId = fnv1aHash("empty");  // 10398793620191490734
   VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
   VkAccessFlags dstAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+  VkDeviceSize dstOffset = 0;
 };
 
 /// Class which, During VkCommandBuffer recording, it can automate some of
@@ -28,17 +30,49 @@ struct StagingOperation {
 /// called "transient" because instead of taking vulkan handles as dependencies,
 /// they are "refreshed" every timeline
 /// - meant to be used by 1 thread only (as it's linked to a command buffer)
+/// Data of a flush is packed into a persistently mapped staging ring (a
+/// `BufferManager` staging buffer), one `memcpy` per operation. Copies to the
+/// same destination are coalesced into one `vkCmdCopyBuffer`, and the
+/// barriers of all destinations recorded at once by a `BarrierBatcher` (a
+/// single call with `VK_KHR_synchronization2`). Ring space of a flush is
+/// reused once the discard pool timeline reaches the timeline of its
+/// `refresh`. A flush which doesn't fit replaces the ring with a larger one,
+/// discarding the old one, hence flushes never wait on the GPU. If the larger
+/// ring can't be allocated, `flush` fails and keeps its operations
+/// Host visible destinations (SoC, ReBAR `DEVICE_LOCAL | HOST_VISIBLE`) skip
+/// staging: `flush` writes them in place, followed by a host write barrier,
+/// hence the same calling code fits discrete and integrated GPUs
 class StagingTransientManager : public NonMoveable {
  public:
+  static VkDeviceSize constexpr DefaultRingBytes = 4 << 20;
+
   StagingTransientManager();
 
   void enqueue(StagingOperation const& op);
   /// \warning all host side data enqueued must still be alive when calling
   /// flush
-  void flush();
+  /// \warning host visible destinations are written by `flush` on the host,
+  /// hence mustn't be in use by pending submissions
+  /// \warning ranges of the same destination in a flush shouldn't overlap,
+  /// as regions of a copy have no order
+  /// False if the staging ring couldn't grow: nothing is written nor
+  /// recorded, and the operations stay enqueued for the flush following the
+  /// next `refresh`, hence their host data must stay alive until then
+  bool flush();
+  /// `timeline` is the value signaled by the submission of `cmd` (eg.
+  /// `timeline() + 1` in the launchers): ring space, and rings replaced
+  /// while growing, are reused or destroyed once it's reached
   void refresh(VkCommandBuffer cmd, BufferManager* bufferManager,
                vk::Device* device, vk::DiscardPool* discardPool,
                uint64_t timeline);
+  /// discards the ring, to be called with the other buffers of
+  /// `bufferManager` on shutdown, `timeline` as their discard value
+  void discardRing(BufferManager* bufferManager, vk::DiscardPool* discardPool,
+                   uint64_t timeline);
+
+  inline VkDeviceSize ringBytes() const { return m_ringBytes; }
+  /// bytes enqueued since the last flush
+  inline VkDeviceSize enqueuedBytes() const { return m_enqueuedBytes; }
 
  private:
   // transient resources
@@ -50,14 +84,40 @@ class StagingTransientManager : public NonMoveable {
     uint64_t timeline = -1;
   } m_tmp;
 
-  // do a better job in memory management? note that we are allocating much of
-  // the memory at object construction
+  // ring space used by a flush, ordered by timeline
+  struct RingSpan {
+    uint64_t timeline;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+  };
+
+  BufferHandle m_ring;
+  VkBuffer m_ringBuffer = VK_NULL_HANDLE;
+  VmaAllocation m_ringAlloc = VK_NULL_HANDLE;
+  uint8_t* m_ringMapped = nullptr;
+  VkDeviceSize m_ringBytes = 0;
+  // next free byte; the oldest pending span marks the end of free space
+  VkDeviceSize m_head = 0;
+  std::deque<RingSpan> m_pending;
+
   std::vector<StagingOperation> m_stagingOps;
-  std::unordered_map<VkPipelineStageFlags, std::vector<VkBufferMemoryBarrier>>
-      m_barriersPerStage;
+  VkDeviceSize m_enqueuedBytes = 0;
+  // scratch storage of `flush`, reused across flushes
+  std::vector<uint32_t> m_order;
+  std::vector<uint32_t> m_inPlace;
+  std::vector<VkBufferCopy> m_regions;
+  BarrierBatcher m_barriers;
 
   // TODO kept for debugging, remove later
   bool refreshed = false;
+
+  void resetTransient();
+  // ring offset for `bytes`, growing the ring if needed. False on allocation
+  // failure, in which case the current ring is kept
+  bool reserve(VkDeviceSize bytes, VkDeviceSize& outOffset);
+  bool createRing(VkDeviceSize bytes, BufferHandle& outRing,
+                  VkBuffer& outBuffer, VmaAllocation& outAlloc,
+                  uint8_t*& outMapped);
 };
 
 }  // namespace avk::experimental
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "render/vk/common-vk.h"
+#include "render/vk/device-vk.h"
+#include "render/vk/discard-pool.h"
+#include "utils/mixins.h"
+
+// std
+#include <unordered_map>
+#include <vector>
+
+namespace avk::experimental {
+
+/// Places transient attachments of a frame (eg. a post processing chain) in a
+/// single allocation, where attachments whose pass lifetimes don't overlap
+/// share memory (`VMA_ALLOCATION_CREATE_CAN_ALIAS_BIT`), instead of a
+/// dedicated allocation each as `ImageManager::createTransientAttachment`
+/// - attachments are `declare`d with the first and last pass (inclusive) of
+///   the frame using them, then `build` creates the images and packs them,
+///   largest first, at the lowest offset not used by an overlapping lifetime
+/// - aliased contents are undefined at the beginning of each lifetime, hence
+///   `recordPassBarriers` transitions the attachments starting at a pass from
+///   `VK_IMAGE_LAYOUT_UNDEFINED`, waiting for the attachment writes (and
+///   fragment reads) of whoever used the memory before. Transitions within a
+///   lifetime (eg. attachment to sampled) are up to the caller
+/// - `reset` retires everything through the `DiscardPool` (eg. on resize),
+///   after which attachments can be declared again
+/// - render thread only
+class TransientAliasingAllocator : public NonMoveable {
+ public:
+  static int32_t constexpr Success = 0;
+  static int32_t constexpr VulkanError = -1;
+  static int32_t constexpr Collision = -2;
+
+  struct AttachmentDesc {
+    VkExtent2D extent;
+    VkFormat format;
+    VkImageUsageFlags usage;
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    /// layout of the first use, entered by `recordPassBarriers`
+    VkImageLayout layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    uint32_t firstPass;
+    uint32_t lastPass;
+  };
+
+  explicit TransientAliasingAllocator(vk::Device* device);
+  /// \warning assumes no submission using the attachments is pending
+  ~TransientAliasingAllocator() noexcept;
+
+  /// `Collision` if `id` is already declared. Only before `build`
+  int32_t declare(uint64_t id, AttachmentDesc const& desc);
+  /// creates the images of the declared attachments and binds them to one
+  /// aliased allocation
+  int32_t build();
+  inline bool built() const { return m_alloc != VK_NULL_HANDLE; }
+
+  /// `VK_NULL_HANDLE` if not declared or not built
+  VkImage image(uint64_t id) const;
+
+  /// records the barriers of the attachments whose lifetime starts at
+  /// `passIndex`, if any. Outside of a render pass
+  void recordPassBarriers(VkCommandBuffer cmd, uint32_t passIndex) const;
+
+  /// discards images and memory to `timeline` and forgets declarations
+  void reset(vk::DiscardPool* discardPool, uint64_t timeline);
+
+  /// bytes of the aliased allocation
+  inline VkDeviceSize allocatedBytes() const { return m_allocatedBytes; }
+  /// bytes the attachments would need without aliasing
+  inline VkDeviceSize requiredBytes() const { return m_requiredBytes; }
+
+ private:
+  // dependencies which must outlive the object
+  struct Deps {
+    vk::Device* device;
+  } m_deps;
+
+  struct Attachment {
+    AttachmentDesc desc;
+    VkImage image = VK_NULL_HANDLE;
+    VkMemoryRequirements requirements{};
+    VkDeviceSize offset = 0;
+  };
+
+  std::vector<Attachment> m_attachments;
+  std::unordered_map<uint64_t, uint32_t> m_indices;
+  VmaAllocation m_alloc = VK_NULL_HANDLE;
+  VkDeviceSize m_allocatedBytes = 0;
+  VkDeviceSize m_requiredBytes = 0;
+  // scratch storage of `recordPassBarriers`
+  mutable std::vector<VkImageMemoryBarrier> m_barriers;
+
+  // assigns offsets, returns the allocation size
+  VkDeviceSize pack();
+  void destroyImages();
+};
+
+}  // namespace avk::experimental
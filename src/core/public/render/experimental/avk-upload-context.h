@@ -0,0 +1,124 @@
+#pragma once
+
+#include "render/vk/common-vk.h"
+#include "render/vk/device-vk.h"
+#include "utils/mixins.h"
+
+// std
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace avk::experimental {
+
+/// Buffer uploads on the dedicated transfer queue of the device, such that
+/// large uploads run concurrently with rendering instead of being recorded
+/// into the graphics command buffer (as `StagingTransientManager` does)
+/// - data is copied into a persistently mapped staging ring, and the copies
+///   recorded on a transfer command buffer. `submit` submits them, signaling
+///   `semaphore()` with the returned value
+/// - destinations are `VK_SHARING_MODE_EXCLUSIVE`, hence each copy is
+///   followed by a release barrier to the graphics family, and
+///   `recordAcquireBarriers` records the matching acquire barriers on a
+///   graphics command buffer, whose submission must wait on `semaphore()` at
+///   the returned value only
+/// - ring space and command buffers are reused once their submission
+///   completed, hence nothing ever waits on the GPU. An upload which doesn't
+///   fit is refused (`RingFull`), to be retried later
+/// - unavailable (`false`) if the device has no `transferQueue()`, in which
+///   case callers upload with `StagingTransientManager`
+/// - 1 thread only, which owns the transfer queue
+class UploadContext : public NonMoveable {
+ public:
+  static VkDeviceSize constexpr DefaultRingBytes = 16 << 20;
+  static int32_t constexpr Success = 0;
+  static int32_t constexpr VulkanError = -1;
+  /// not enough ring space until previous uploads complete
+  static int32_t constexpr RingFull = -2;
+
+  explicit UploadContext(vk::Device* device,
+                         VkDeviceSize ringBytes = DefaultRingBytes);
+  /// waits for the pending submissions, then frees everything
+  ~UploadContext() noexcept;
+
+  inline operator bool() const { return m_commandPool != VK_NULL_HANDLE; }
+
+  /// copies `bytes` of `data` into the ring and records their copy into
+  /// `dst` at `dstOffset`
+  /// \param dstStage stages of the first use of the data on the graphics
+  /// queue, with accesses `dstAccess`
+  /// \warning no other queue may use `dst` until its acquire barrier
+  int32_t uploadBuffer(VkBuffer dst, VkDeviceSize dstOffset,
+                       void const* data, VkDeviceSize bytes,
+                       VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+  /// submits the copies recorded since the last call on the transfer queue.
+  /// Returns the value it signals, 0 if there was nothing to submit
+  uint64_t submit();
+  /// records on `cmd` (graphics queue) the acquire barriers of all submitted
+  /// uploads not acquired yet. The submission of `cmd` must wait on
+  /// `semaphore()` at the returned value, with `outWaitStages` as wait
+  /// stages. Returns 0, and records nothing, if there's nothing to acquire
+  uint64_t recordAcquireBarriers(VkCommandBuffer cmd,
+                                 VkPipelineStageFlags& outWaitStages);
+
+  inline VkSemaphore semaphore() const { return m_semaphore; }
+  /// value signaled by the last `submit`
+  inline uint64_t submittedValue() const { return m_submittedValue; }
+  inline VkDeviceSize ringBytes() const { return m_ringBytes; }
+
+ private:
+  // dependencies which must outlive the object
+  struct Deps {
+    vk::Device* device;
+  } m_deps;
+
+  // ring space and command buffer of a submission, ordered by value
+  struct RingSpan {
+    uint64_t value;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+  };
+  struct InFlightCommands {
+    uint64_t value;
+    VkCommandBuffer cmd;
+  };
+  struct Acquire {
+    VkBufferMemoryBarrier barrier;
+    VkPipelineStageFlags dstStage;
+  };
+
+  VkCommandPool m_commandPool = VK_NULL_HANDLE;
+  VkSemaphore m_semaphore = VK_NULL_HANDLE;
+  uint64_t m_submittedValue = 0;
+
+  VkBuffer m_buffer = VK_NULL_HANDLE;
+  VmaAllocation m_alloc = VK_NULL_HANDLE;
+  uint8_t* m_mapped = nullptr;
+  VkDeviceSize m_ringBytes = 0;
+  // multiple of `nonCoherentAtomSize`
+  VkDeviceSize m_alignment = 16;
+  // next free byte; the oldest pending span marks the end of free space
+  VkDeviceSize m_head = 0;
+  std::deque<RingSpan> m_pending;
+
+  // being recorded, null until the first upload after a `submit`
+  VkCommandBuffer m_cmd = VK_NULL_HANDLE;
+  std::deque<InFlightCommands> m_inFlight;
+  std::vector<VkCommandBuffer> m_freeCommands;
+
+  // release barriers recorded by the next `submit`, and their acquires
+  std::vector<VkBufferMemoryBarrier> m_releases;
+  std::vector<Acquire> m_recordedAcquires;
+  // acquires of submitted uploads, recorded by `recordAcquireBarriers`
+  std::vector<Acquire> m_submittedAcquires;
+  // scratch storage of `recordAcquireBarriers`
+  std::vector<VkBufferMemoryBarrier> m_barriers;
+
+  // recycles ring space and command buffers of completed submissions
+  void retireCompleted();
+  // ring offset for `bytes`, false if full
+  bool reserve(VkDeviceSize bytes, VkDeviceSize& outOffset);
+  VkCommandBuffer beginCommands();
+};
+
+}  // namespace avk::experimental
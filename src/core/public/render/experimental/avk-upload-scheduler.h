@@ -0,0 +1,111 @@
+#pragma once
+
+#include "render/experimental/avk-staging-transient-manager.h"
+#include "render/experimental/avk-upload-context.h"
+#include "render/vk/common-vk.h"
+#include "utils/mixins.h"
+
+// std
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace avk::experimental {
+
+/// Spreads buffer uploads over frames, such that streaming content in (eg.
+/// loading a level) doesn't produce one giant frame
+/// - every frame, `enqueueFrame` moves the most urgent requests into a
+///   `StagingTransientManager`, up to a byte budget which counts also what was
+///   enqueued into it directly. The rest carries over to the next frames
+/// - overdue requests (deadline reached) come first and ignore the budget,
+///   then higher priority first, then earlier deadline, then request order
+/// - a request larger than what's left of the budget is split, hence large
+///   uploads progress by chunks instead of blocking the queue
+/// - given an available `UploadContext`, requests of at least
+///   `transferThreshold` bytes go whole to the transfer queue instead,
+///   outside of the budget. If its ring is full, they're staged as usual
+/// - `poll`, called every frame with the completed timeline value (eg.
+///   `vk::DiscardPool::queryTime()`), reports each completed request with the
+///   timeline value of the submission carrying its last chunk
+/// - render thread only
+class UploadScheduler : public NonMoveable {
+ public:
+  static VkDeviceSize constexpr DefaultFrameBudget = 8 << 20;
+  static VkDeviceSize constexpr DefaultTransferThreshold = 1 << 20;
+
+  /// 0 is never a valid ticket
+  using Ticket = uint64_t;
+  using Callback = std::function<void(Ticket ticket, uint64_t value)>;
+
+  struct Request {
+    /// \warning `srcData` must stay alive until the request completes or is
+    /// canceled
+    StagingOperation op;
+    int32_t priority = 0;
+    /// timeline value whose submission must carry the upload
+    uint64_t deadline = UINT64_MAX;
+    /// called by `poll`, optional
+    Callback onComplete;
+  };
+
+  explicit UploadScheduler(VkDeviceSize frameBudget = DefaultFrameBudget);
+
+  Ticket schedule(Request request);
+  /// drops the part of the request not enqueued yet, without calling its
+  /// callback. False if already fully enqueued, or unknown
+  bool cancel(Ticket ticket);
+
+  /// enqueues into `staging`, refreshed for the submission signaling
+  /// `timeline`, the requests which fit in the budget, before its `flush`.
+  /// Large requests are recorded on `uploadContext` if not null: the caller
+  /// submits it, and records its acquire barriers on the same graphics
+  /// submission. Returns the bytes enqueued, transfers included
+  /// \warning if that `flush` fails, its operations are uploaded by a later
+  /// one, hence requests may complete later than reported by `poll`. Treat
+  /// a failed flush as fatal, or wait idle before reusing their data
+  /// \warning destinations of large requests mustn't be in use by the
+  /// graphics queue, as the transfer queue owns them until the acquire
+  VkDeviceSize enqueueFrame(StagingTransientManager& staging,
+                            uint64_t timeline,
+                            UploadContext* uploadContext = nullptr);
+  /// reports every request whose last chunk's value is at most
+  /// `completedValue`
+  void poll(uint64_t completedValue);
+
+  inline void setFrameBudget(VkDeviceSize bytes) { m_frameBudget = bytes; }
+  inline void setTransferThreshold(VkDeviceSize bytes) {
+    m_transferThreshold = bytes;
+  }
+  inline VkDeviceSize frameBudget() const { return m_frameBudget; }
+  /// requests with bytes still to enqueue
+  inline size_t queuedCount() const { return m_queued.size(); }
+  inline VkDeviceSize queuedBytes() const { return m_queuedBytes; }
+  /// requests fully enqueued, waiting for their submission to complete
+  inline size_t inFlightCount() const { return m_inFlight.size(); }
+
+ private:
+  struct Queued {
+    Ticket ticket;
+    Request request;
+    // already enqueued, from the start of the data
+    VkDeviceSize doneBytes;
+    // scratch key of `enqueueFrame`
+    bool overdue;
+  };
+  struct InFlight {
+    Ticket ticket;
+    uint64_t value;
+    Callback onComplete;
+  };
+
+  VkDeviceSize m_frameBudget;
+  VkDeviceSize m_transferThreshold = DefaultTransferThreshold;
+  Ticket m_nextTicket = 1;
+  std::vector<Queued> m_queued;
+  VkDeviceSize m_queuedBytes = 0;
+  // ordered by value, as `enqueueFrame` is called in submission order
+  std::deque<InFlight> m_inFlight;
+};
+
+}  // namespace avk::experimental
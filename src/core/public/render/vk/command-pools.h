@@ -82,13 +82,16 @@ namespace avk::vk {
 
 class DiscardPool;
 
+/// command pools of a single queue family, hence one instance per family
+/// (eg. universal graphics and, if present, async compute, see
+/// `Device::computeQueueFamilyIndex`)
 class CommandPools : public NonMoveable {
  public:
-  /// TODO Now we support creation from one pool. If required,
-  /// desktop machines may optionally have a async compute family
   CommandPools(Device* device, uint32_t queueFamilyIndex);
   ~CommandPools();
 
+  inline uint32_t queueFamilyIndex() const { return m_deps.queueFamilyIndex; }
+
   /// allocate a primary command buffer from the current active pool
   /// id should be unique (eg hashed name)
   VkCommandBuffer allocatePrimary(uint64_t id);
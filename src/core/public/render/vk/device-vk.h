@@ -14,12 +14,17 @@
 // - newer Valhall GPU allocates only for visible vertices
 
 #include "render/vk/common-vk.h"
+#include "render/vk/host-allocator-vk.h"
 #include "render/vk/instance-vk.h"
 #include "render/vk/surface-vk.h"
 #include "utils/mixins.h"
+#include "utils/sharded-table.h"
 
 // std
 #include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 namespace avk::vk::utils {
 
@@ -32,12 +37,67 @@ struct SampledImageCompressedFormats {
 struct QueueFamilyMap {
   /// queue family supporting graphics, compute, transfer and presentation
   uint32_t universalGraphics;
+  /// transfer only queue family (usually a DMA engine),
+  /// `VK_QUEUE_FAMILY_IGNORED` if there's none
+  uint32_t transfer = VK_QUEUE_FAMILY_IGNORED;
+  /// compute queue family without graphics, `VK_QUEUE_FAMILY_IGNORED` if
+  /// there's none
+  uint32_t asyncCompute = VK_QUEUE_FAMILY_IGNORED;
 };
 
 }  // namespace avk::vk::utils
 
 namespace avk::vk {
 
+/// resource classes with isolated memory, each backed by its own `VmaPool`s
+enum class EMemoryClass : uint32_t {
+  /// GPU only buffers (geometry, constant uniforms)
+  eStaticGeometry = 0,
+  /// sampled/storage textures which aren't written by the host
+  eTextures,
+  /// buffers and images rewritten by the host (streaming, per frame data)
+  eStreaming,
+  /// attachments
+  eRenderTargets,
+  /// staging and readback buffers
+  eStaging,
+  eCount
+};
+
+/// subsystem owning a VMA allocation, see `Device::tagAllocation`
+enum class EAllocationTag : uint32_t {
+  eUntagged = 0,
+  eBufferManager,
+  eImageManager,
+  eTextureLoader,
+  eFrameAllocator,
+  eSuballocator,
+  eReadback,
+  eTransientAttachments,
+  eSparseBuffers,
+  eUploads,
+  eCount
+};
+char const* allocationTagName(EAllocationTag tag);
+
+/// parameters of the pools of a `EMemoryClass`. Pools are opt-in: every class
+/// goes to VMA default pools unless enabled
+struct MemoryPoolConfig {
+  /// false means allocations of the class go to VMA default pools
+  bool enabled = false;
+  /// size of each `VkDeviceMemory` block, 0 lets VMA grow block sizes
+  /// progressively. Larger allocations go to VMA default pools
+  VkDeviceSize blockSize = 0;
+  /// blocks committed up front, hence kept even if empty
+  size_t minBlockCount = 0;
+  /// caps the blocks of a pool (per memory type), 0 for unlimited.
+  /// Allocations which don't fit go to VMA default pools
+  size_t maxBlockCount = 0;
+  /// `VMA_POOL_CREATE_LINEAR_ALGORITHM_BIT` (ring buffer when resources are
+  /// freed in allocation order) instead of the TLSF default
+  bool linear = false;
+};
+
 class Device : public NonMoveable {
  public:
   /// Selects a physical device with baseline features and extension support,
@@ -65,9 +125,71 @@ class Device : public NonMoveable {
   inline uint32_t universalGraphicsQueueFamilyIndex() const {
     return m_queueFamilies.universalGraphics;
   }
+  /// queue of the dedicated transfer family, null if the device has none or
+  /// when built with `AVK_NO_TRANSFER_QUEUE`. Uploads submitted there run
+  /// concurrently with rendering (see `experimental::UploadContext`)
+  inline VkQueue transferQueue() const { return m_transferQueue; }
+  inline uint32_t transferQueueFamilyIndex() const {
+    return m_queueFamilies.transfer;
+  }
+  /// whether compute has its own queue family, hence runs concurrently with
+  /// rendering. False when built with `AVK_NO_ASYNC_COMPUTE`
+  inline bool asyncCompute() const {
+    return m_queueFamilies.asyncCompute != VK_QUEUE_FAMILY_IGNORED;
+  }
+  /// queue of the async compute family, or the universal queue without one
+  inline VkQueue computeQueue() const {
+    return asyncCompute() ? m_computeQueue : m_queue;
+  }
+  inline uint32_t computeQueueFamilyIndex() const {
+    return asyncCompute() ? m_queueFamilies.asyncCompute
+                          : m_queueFamilies.universalGraphics;
+  }
   inline VolkDeviceTable const* table() const { return m_table.get(); }
+  /// host allocation callbacks attributing driver allocations to
+  /// `objectType`, for device level `vkCreate*` and the matching
+  /// `vkDestroy*`. Null when built with `AVK_NO_HOST_ALLOCATOR`
+  inline VkAllocationCallbacks const* allocationCallbacks(
+      VkObjectType objectType) const {
+#ifdef AVK_NO_HOST_ALLOCATOR
+    return nullptr;
+#else
+    return m_hostAllocator.callbacks(objectType);
+#endif
+  }
+  inline HostAllocator& hostAllocator() { return m_hostAllocator; }
 
   inline bool swapchainMaintenance1() const { return m_swapchainMaintenance1; }
+  /// whether `VK_KHR_dynamic_rendering` is enabled, hence graphics pipelines
+  /// can be created with a null `VkRenderPass` and recorded with
+  /// `vkCmdBeginRenderingKHR`
+  inline bool dynamicRendering() const { return m_dynamicRendering; }
+  /// `VK_EXT_extended_dynamic_state`: cull mode, front face, depth write,
+  /// stencil test and stencil ops settable at record time
+  inline bool extendedDynamicState() const { return m_extendedDynamicState; }
+  /// `VK_EXT_extended_dynamic_state2`: depth bias enable at record time
+  inline bool extendedDynamicState2() const { return m_extendedDynamicState2; }
+  /// `VK_EXT_extended_dynamic_state3` with polygon mode at record time
+  inline bool extendedDynamicState3PolygonMode() const {
+    return m_extendedDynamicState3PolygonMode;
+  }
+  /// `VK_EXT_shader_object`: graphics shaders can be bound as `VkShaderEXT`
+  /// with all state dynamic, instead of through `VkPipeline`
+  inline bool shaderObject() const { return m_shaderObject; }
+  /// `VK_EXT_pipeline_creation_feedback`: compile duration and cache hits can
+  /// be chained to pipeline creation
+  inline bool pipelineCreationFeedback() const {
+    return m_pipelineCreationFeedback;
+  }
+  /// `sparseBinding` and `sparseResidencyBuffer` are enabled and the queue
+  /// supports `VK_QUEUE_SPARSE_BINDING_BIT`, hence partially resident buffers
+  /// can be bound with `vkQueueBindSparse`
+  inline bool sparseResidencyBuffer() const { return m_sparseResidencyBuffer; }
+  /// `VK_KHR_synchronization2`: barriers can be recorded with
+  /// `vkCmdPipelineBarrier2KHR`, stages and accesses given per barrier
+  inline bool synchronization2() const { return m_synchronization2; }
+  /// limits of the selected physical device (alignments, granularities)
+  inline VkPhysicalDeviceLimits const& limits() const { return m_limits; }
   inline utils::SampledImageCompressedFormats compressedSampledImageFormat()
       const {
     return m_comprFormats;
@@ -79,6 +201,60 @@ class Device : public NonMoveable {
 
   inline bool isSoC() const { return m_isSoC; }
 
+  // -- Memory Pools: one `VmaPool` per memory class and memory type used --
+  /// affects only pools created after the call, hence call it before creating
+  /// resources of the class
+  void setMemoryPoolConfig(EMemoryClass memoryClass,
+                           MemoryPoolConfig const& config);
+  MemoryPoolConfig memoryPoolConfig(EMemoryClass memoryClass) const;
+  /// pool of `memoryClass` for the memory type VMA would choose for the given
+  /// create infos, created on first use. Null if the class is disabled or no
+  /// memory type fits, in which case VMA default pools should be used.
+  /// Thread safe
+  VmaPool bufferMemoryPool(EMemoryClass memoryClass,
+                           VkBufferCreateInfo const& createInfo,
+                           VmaAllocationCreateInfo const& allocInfo);
+  VmaPool imageMemoryPool(EMemoryClass memoryClass,
+                          VkImageCreateInfo const& createInfo,
+                          VmaAllocationCreateInfo const& allocInfo);
+  /// `vmaCreateBuffer` in the pool of `memoryClass` (`allocInfo.pool` must
+  /// be null), without dedicated memory. Falls back to VMA default pools,
+  /// hence dedicated memory where VMA prefers it, when the class is disabled,
+  /// the buffer is larger than its blocks or the pool allocation fails.
+  /// Thread safe
+  VkResult createPooledBuffer(EMemoryClass memoryClass,
+                              VkBufferCreateInfo const& createInfo,
+                              VmaAllocationCreateInfo const& allocInfo,
+                              VkBuffer& outBuffer, VmaAllocation& outAlloc,
+                              VmaAllocationInfo* outAllocInfo = nullptr);
+  /// as `createPooledBuffer`, for images
+  VkResult createPooledImage(EMemoryClass memoryClass,
+                             VkImageCreateInfo const& createInfo,
+                             VmaAllocationCreateInfo const& allocInfo,
+                             VkImage& outImage, VmaAllocation& outAlloc,
+                             VmaAllocationInfo* outAllocInfo = nullptr);
+  /// sum of the statistics of the pools of `memoryClass`
+  VmaStatistics memoryClassStatistics(EMemoryClass memoryClass) const;
+  /// appends the pools of `memoryClass` created so far to `outPools`
+  void collectMemoryPools(EMemoryClass memoryClass,
+                          std::vector<VmaPool>& outPools) const;
+
+  /// attributes `alloc` to `tag`: sets its VMA name (`name`) and user data
+  /// (the tag), both shown by detailed `buildStatsJson` maps, and tracks it
+  /// until `untagAllocation`, which should precede its free. Thread safe
+  void tagAllocation(VmaAllocation alloc, EAllocationTag tag,
+                     std::string name);
+  /// no-op for null or untagged allocations
+  void untagAllocation(VmaAllocation alloc);
+  /// `vmaBuildStatsString` JSON under "Vma", plus count and bytes of the live
+  /// allocations of each tag under "Tags" (untagged bytes are the VMA total
+  /// minus the tagged ones) and driver host memory under "Host" (see
+  /// `HostAllocator::buildStatsJson`)
+  std::string buildStatsJson(bool detailedMap = false) const;
+  /// logs the live tagged allocations grouped by tag. Called on destruction
+  /// as a leak report
+  void logLiveAllocations() const;
+
  private:
   // dependencies which must outlive this object
   struct Deps {
@@ -86,13 +262,29 @@ class Device : public NonMoveable {
     Surface* surface;
   } m_deps;
 
+  // driver host memory, outlives the device
+  HostAllocator m_hostAllocator;
+
   // Handles
   VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
   VkDevice m_device = VK_NULL_HANDLE;
-  // TODO Memory pools when work size becomes known after experimentation
-  // VmaPool m_pool = VK_NULL_HANDLE;
   VmaAllocator m_vmaAllocator = VK_NULL_HANDLE;
 
+  /// custom pools, indexed by memory class and memory type
+  static uint32_t constexpr MemoryClassCount =
+      static_cast<uint32_t>(EMemoryClass::eCount);
+  MemoryPoolConfig m_memoryPoolConfigs[MemoryClassCount];
+  VmaPool m_memoryPools[MemoryClassCount][VK_MAX_MEMORY_TYPES]{};
+  mutable std::mutex m_memoryPoolMtx;
+
+  /// allocations tagged by `tagAllocation`, keyed by `VmaAllocation`
+  struct TrackedAllocation {
+    EAllocationTag tag;
+    VkDeviceSize size;
+    std::string name;
+  };
+  ShardedTable<TrackedAllocation> m_trackedAllocations;
+
   /// VMA memory budget for each memory heap. Must be refreshed every frame
   std::vector<VmaBudget> m_heapBudgets;
 
@@ -102,18 +294,32 @@ class Device : public NonMoveable {
 
   // queue related data (*submit externally synchronized*)
   VkQueue m_queue = VK_NULL_HANDLE;
+  VkQueue m_transferQueue = VK_NULL_HANDLE;
+  VkQueue m_computeQueue = VK_NULL_HANDLE;
   utils::QueueFamilyMap m_queueFamilies;
 
   // features tracking
   // -- compressed formats for usage SAMPLED_IMAGE, TRANSFER, BLIT_SRC
   // TODO later: store an array of formats for linear, srgb, and hdr (float)
   utils::SampledImageCompressedFormats m_comprFormats;
+  VkPhysicalDeviceLimits m_limits{};
 
   // optional extensions/features tracking
   bool m_swapchainMaintenance1 = false;
+  bool m_dynamicRendering = false;
+  bool m_extendedDynamicState = false;
+  bool m_extendedDynamicState2 = false;
+  bool m_extendedDynamicState3PolygonMode = false;
+  bool m_shaderObject = false;
+  bool m_pipelineCreationFeedback = false;
+  bool m_sparseResidencyBuffer = false;
+  bool m_synchronization2 = false;
 
   // other
   bool m_isSoC = false;
+
+  // pool of the class for the memory type, created if missing (lock held)
+  VmaPool getOrCreateMemoryPool(uint32_t classIndex, uint32_t memoryTypeIndex);
 };
 
 }  // namespace avk::vk
\ No newline at end of file
@@ -74,6 +74,8 @@ class DiscardPool : public NonMoveable {
   void discardShaderModule(VkShaderModule shaderModule, uint64_t value);
   void discardPipeline(VkPipeline pipeline, uint64_t value);
   void discardPipelineLayout(VkPipelineLayout pipelineLayout, uint64_t value);
+  /// `VK_EXT_shader_object`
+  void discardShaderObject(VkShaderEXT shader, uint64_t value);
   void discardDescriptorPoolForReuse(VkDescriptorPool descriptorPool,
                                      DescriptorPools* pools, uint64_t value);
   void discardCommandPoolForReuse(VkCommandPool commandPool,
@@ -101,6 +103,7 @@ class DiscardPool : public NonMoveable {
   utils::TimelineResources<VkShaderModule> m_shaderModules;
   utils::TimelineResources<VkPipeline> m_pipelines;
   utils::TimelineResources<VkPipelineLayout> m_pipelineLayouts;
+  utils::TimelineResources<VkShaderEXT> m_shaderObjects;
 
   utils::TimelineResources<std::pair<VkDescriptorPool, DescriptorPools*>>
       m_descriptorPools;
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "render/vk/pipeline-info.h"
+
+// std
+#include <cassert>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace avk::vk {
+
+/// Interns `GraphicsKey`s: equal keys get the same ID, which indexes an array
+/// of `Value` slots, such that lookups by ID don't hash nor compare the key
+/// - `release` forgets a key, and its slot is reused by a later `intern`.
+///   IDs carry a generation, hence a released ID is never confused with the
+///   key reusing its slot: `find` returns null for it
+/// - not thread safe, `PipelinePool` uses it under its lock
+template <typename Value>
+class GraphicsKeyTable {
+ public:
+  using ID = uint64_t;
+  /// never returned by `intern`
+  static ID constexpr NullID = 0;
+
+  /// ID of `key`, interning a copy of it with a default `Value` if absent
+  ID intern(GraphicsKey const& key) {
+    if (auto const it = m_ids.find(key); it != m_ids.end()) {
+      return it->second;
+    }
+    uint32_t index = 0;
+    if (!m_freeIndices.empty()) {
+      index = m_freeIndices.back();
+      m_freeIndices.pop_back();
+    } else {
+      assert(m_slots.size() < UINT32_MAX);
+      index = static_cast<uint32_t>(m_slots.size());
+      m_slots.emplace_back();
+    }
+    // generation 0 would make `NullID` out of index 0
+    if (++m_generation == 0) {
+      ++m_generation;
+    }
+    ID const id = (static_cast<ID>(m_generation) << 32) | index;
+    auto const [it, inserted] = m_ids.try_emplace(key, id);
+    Slot& slot = m_slots[index];
+    slot.id = id;
+    // nodes of the map don't move on rehash
+    slot.key = &it->first;
+    slot.value = Value{};
+    return id;
+  }
+  /// ID of `key` if interned, `NullID` otherwise
+  ID idOf(GraphicsKey const& key) const {
+    auto const it = m_ids.find(key);
+    return it == m_ids.end() ? NullID : it->second;
+  }
+  /// null if `id` was released
+  Value* find(ID id) {
+    uint32_t const index = static_cast<uint32_t>(id);
+    if (index >= m_slots.size() || m_slots[index].id != id) {
+      return nullptr;
+    }
+    return &m_slots[index].value;
+  }
+  /// forgets the key of `id`, which must be interned
+  void release(ID id) {
+    uint32_t const index = static_cast<uint32_t>(id);
+    assert(index < m_slots.size() && m_slots[index].id == id);
+    Slot& slot = m_slots[index];
+    m_ids.erase(m_ids.find(*slot.key));
+    slot.id = NullID;
+    slot.key = nullptr;
+    slot.value = Value{};
+    m_freeIndices.push_back(index);
+  }
+  /// calls `f(id, value)` for each interned key. `f` may release `id`, but
+  /// mustn't intern
+  template <typename F>
+  void forEach(F&& f) {
+    for (Slot& slot : m_slots) {
+      if (slot.id != NullID) {
+        f(slot.id, slot.value);
+      }
+    }
+  }
+  /// releases every key. The generation is kept, hence IDs from before stay
+  /// invalid
+  void clear() {
+    m_ids.clear();
+    m_slots.clear();
+    m_freeIndices.clear();
+  }
+
+  inline size_t size() const { return m_ids.size(); }
+
+ private:
+  struct Slot {
+    ID id = NullID;
+    GraphicsKey const* key = nullptr;
+    Value value{};
+  };
+
+  std::unordered_map<GraphicsKey, ID> m_ids;
+  std::vector<Slot> m_slots;
+  std::vector<uint32_t> m_freeIndices;
+  uint32_t m_generation = 0;
+};
+
+}  // namespace avk::vk
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "render/vk/common-vk.h"
+#include "utils/mixins.h"
+
+// std
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace avk::vk {
+
+/// `VkAllocationCallbacks` tracking driver host memory per
+/// `VkSystemAllocationScope` and per object type. `Device` passes them to
+/// device level `vkCreate*`/`vkDestroy*` calls, to VMA and to KTX
+/// - callbacks don't know the object type they allocate for, hence each type
+///   gets its own callbacks, differing only in `pUserData`. Any of them frees
+///   the blocks of the others, as a header before each block records its
+///   size, alignment and origin
+/// - command scope allocations live only during a single Vulkan command, on
+///   the calling thread, hence are served by a thread local bump arena (when
+///   enabled), which rewinds once all its blocks are freed
+/// - thread safe, counters are relaxed atomics
+class HostAllocator : public NonMoveable {
+ public:
+  /// bytes of the arena of each thread
+  static size_t constexpr CommandArenaBytes = 64 << 10;
+  static uint32_t constexpr ScopeCount =
+      VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+  /// core object types have a slot each, extension ones share the last
+  static uint32_t constexpr ObjectTypeSlotCount =
+      VK_OBJECT_TYPE_COMMAND_POOL + 2;
+
+  struct Counters {
+    /// live bytes
+    uint64_t bytes;
+    uint64_t peakBytes;
+    /// allocations made since creation, including reallocations
+    uint64_t allocationCount;
+  };
+  struct Statistics {
+    Counters scopes[ScopeCount];
+    Counters objectTypes[ObjectTypeSlotCount];
+    /// memory the driver allocated itself and reported through
+    /// `pfnInternalAllocation` (eg. executable memory)
+    Counters internal[ScopeCount];
+    uint64_t arenaAllocationCount;
+    /// command scope allocations which didn't fit in the arena
+    uint64_t arenaFallbackCount;
+  };
+
+  HostAllocator();
+
+  /// callbacks attributing allocations to `objectType`
+  VkAllocationCallbacks const* callbacks(VkObjectType objectType) const;
+
+  /// whether command scope allocations use the thread local arena (default)
+  inline void setCommandArena(bool enabled) {
+    m_commandArena.store(enabled, std::memory_order_relaxed);
+  }
+
+  Statistics statistics() const;
+  /// `"Scopes"`, `"ObjectTypes"` (non empty only) and `"Internal"` objects of
+  /// `{"Bytes", "PeakBytes", "Count"}`, plus arena counters
+  std::string buildStatsJson() const;
+  /// logs live bytes of each scope, warning if any. Meant after the objects
+  /// using the callbacks have been destroyed
+  void logLiveBytes() const;
+
+  static char const* scopeName(uint32_t scope);
+  static char const* objectTypeSlotName(uint32_t slot);
+
+ private:
+  struct AtomicCounters {
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> peakBytes{0};
+    std::atomic<uint64_t> allocationCount{0};
+
+    void add(uint64_t size);
+    void sub(uint64_t size);
+    Counters load() const;
+  };
+  struct Slot {
+    HostAllocator* self;
+    uint32_t index;
+  };
+
+  Slot m_slots[ObjectTypeSlotCount];
+  VkAllocationCallbacks m_callbacks[ObjectTypeSlotCount];
+  AtomicCounters m_scopes[ScopeCount];
+  AtomicCounters m_objectTypes[ObjectTypeSlotCount];
+  AtomicCounters m_internal[ScopeCount];
+  std::atomic<uint64_t> m_arenaAllocationCount{0};
+  std::atomic<uint64_t> m_arenaFallbackCount{0};
+  std::atomic<bool> m_commandArena{true};
+
+  void* allocate(uint32_t slot, size_t size, size_t alignment,
+                 VkSystemAllocationScope scope);
+  void deallocate(void* memory);
+
+  static VKAPI_ATTR void* VKAPI_CALL
+  pfnAllocation(void* pUserData, size_t size, size_t alignment,
+                VkSystemAllocationScope scope);
+  static VKAPI_ATTR void* VKAPI_CALL
+  pfnReallocation(void* pUserData, void* pOriginal, size_t size,
+                  size_t alignment, VkSystemAllocationScope scope);
+  static VKAPI_ATTR void VKAPI_CALL pfnFree(void* pUserData, void* pMemory);
+  static VKAPI_ATTR void VKAPI_CALL
+  pfnInternalAllocation(void* pUserData, size_t size,
+                        VkInternalAllocationType type,
+                        VkSystemAllocationScope scope);
+  static VKAPI_ATTR void VKAPI_CALL
+  pfnInternalFree(void* pUserData, size_t size, VkInternalAllocationType type,
+                  VkSystemAllocationScope scope);
+};
+
+}  // namespace avk::vk
@@ -3,20 +3,93 @@
 #include "render/vk/common-vk.h"
 #include "utils/bits.h"
 
+// std
+#include <cassert>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
 namespace avk::vk {
 
+// ---------------- SPECIALIZATION CONSTANTS ---------------------------------
+
+// specialization constants of a single shader stage. Both the map entries and
+// the raw constant data are part of the pipeline key, such that multiple tuned
+// variants of the same SPIR-V module (workgroup sizes, feature toggles, unroll
+// counts) map to different pipelines
+struct SpecializationConstants {
+  std::vector<VkSpecializationMapEntry> mapEntries;
+  std::vector<uint8_t> data;
+
+  inline bool empty() const { return mapEntries.empty(); }
+
+  // sets the constant with the given `constant_id` (as in SPIR-V SpecId),
+  // overwriting its value if already set. T must be a scalar matching the type
+  // declared in the shader (VkBool32 for booleans)
+  template <typename T>
+  inline void set(uint32_t constantID, T const& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    // duplicate IDs are invalid (VUID-VkSpecializationInfo-constantID-04911)
+    for (VkSpecializationMapEntry const& existing : mapEntries) {
+      if (existing.constantID == constantID) {
+        assert(existing.size == sizeof(T) && "constant type changed");
+        memcpy(data.data() + existing.offset, &value, sizeof(T));
+        return;
+      }
+    }
+    VkSpecializationMapEntry entry{};
+    entry.constantID = constantID;
+    entry.offset = static_cast<uint32_t>(data.size());
+    entry.size = sizeof(T);
+    mapEntries.push_back(entry);
+    data.resize(data.size() + sizeof(T));
+    memcpy(data.data() + entry.offset, &value, sizeof(T));
+  }
+
+  inline bool operator==(SpecializationConstants const& other) const {
+    if (mapEntries.size() != other.mapEntries.size() ||
+        data.size() != other.data.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < mapEntries.size(); ++i) {
+      if (mapEntries[i].constantID != other.mapEntries[i].constantID ||
+          mapEntries[i].offset != other.mapEntries[i].offset ||
+          mapEntries[i].size != other.mapEntries[i].size) {
+        return false;
+      }
+    }
+    return data.empty() || memcmp(data.data(), other.data.data(),
+                                  data.size()) == 0;
+  }
+  inline bool operator!=(SpecializationConstants const& other) const {
+    return !((*this) == other);
+  }
+
+  uint64_t hash() const {
+    if (empty()) {
+      return 0;
+    }
+    uint64_t hash = vectorHash(mapEntries, [](VkSpecializationMapEntry x) {
+      return (uint64_t(x.constantID) * 33 ^ x.offset) * 33 ^ x.size;
+    });
+    hash = hash * 33 ^ fnv1aHashBytes(data.data(), data.size());
+    return hash;
+  }
+};
+
 // ---------------- COMPUTE PIPELINE HASH ------------------------------------
 
 // struct to identify compute pipeline
 struct ComputeInfo {
   VkShaderModule shaderModule;
   VkPipelineLayout pipelineLayout;
-  // TODO specialization constants
+  SpecializationConstants specialization;
 };
 
 inline bool operator==(ComputeInfo const& a, ComputeInfo const& b) {
   return a.shaderModule == b.shaderModule &&
-         a.pipelineLayout == b.pipelineLayout;
+         a.pipelineLayout == b.pipelineLayout &&
+         a.specialization == b.specialization;
 }
 
 }  // namespace avk::vk
@@ -26,6 +99,7 @@ struct std::hash<avk::vk::ComputeInfo> {
   size_t operator()(avk::vk::ComputeInfo const& computeInfo) const noexcept {
     size_t hash = reinterpret_cast<uint64_t>(computeInfo.shaderModule);
     hash = hash * 33 ^ reinterpret_cast<uint64_t>(computeInfo.pipelineLayout);
+    hash = hash * 33 ^ computeInfo.specialization.hash();
     return hash;
   }
 };
@@ -95,6 +169,31 @@ enum class EStencilLogicOp : uint32_t {
   eCountDepthFail
 };
 
+// pipeline options which are set at record time instead of being baked into
+// the pipeline (hence not part of the pipeline key). Decided by `PipelinePool`
+// according to the extended dynamic state extensions enabled on the device
+enum class EDynamicOpts : uint32_t {
+  eNone = 0,
+  // VK_EXT_extended_dynamic_state: cull mode, front face, depth write, stencil
+  // test and stencil ops (stencil reference and masks are core dynamic states)
+  eExtendedDynamicState = 1u << 0,
+  // VK_EXT_extended_dynamic_state2: depth bias enable
+  eExtendedDynamicState2 = 1u << 1,
+  // VK_EXT_extended_dynamic_state3: polygon mode
+  eExtendedDynamicState3PolygonMode = 1u << 2,
+};
+
+inline bool operator&(EDynamicOpts a, EDynamicOpts b) {
+  return static_cast<std::underlying_type_t<EDynamicOpts>>(a) &
+         static_cast<std::underlying_type_t<EDynamicOpts>>(b);
+}
+
+inline EDynamicOpts& operator|=(EDynamicOpts& a, EDynamicOpts b) {
+  *reinterpret_cast<std::underlying_type_t<EDynamicOpts>*>(&a) |=
+      static_cast<std::underlying_type_t<EDynamicOpts>>(b);
+  return a;
+}
+
 // -- Graphics Pipeline Parameters --
 
 // struct to identify graphics pipeline dividing it into
@@ -163,10 +262,14 @@ struct GraphicsInfo {
   struct PreRasterization {
     VkShaderModule vertexModule;
     VkShaderModule geometryModule;
+    SpecializationConstants vertexSpecialization;
+    SpecializationConstants geometrySpecialization;
 
     inline bool operator==(PreRasterization const& other) const {
       return vertexModule == other.vertexModule &&
-             geometryModule == other.geometryModule;
+             geometryModule == other.geometryModule &&
+             vertexSpecialization == other.vertexSpecialization &&
+             geometrySpecialization == other.geometrySpecialization;
     }
     inline bool operator!=(PreRasterization const& other) const {
       return !((*this) == other);
@@ -175,11 +278,14 @@ struct GraphicsInfo {
     uint64_t hash() const {
       uint64_t hash = 33 ^ reinterpret_cast<uint64_t>(vertexModule);
       hash = hash * 33 ^ reinterpret_cast<uint64_t>(geometryModule);
+      hash = hash * 33 ^ vertexSpecialization.hash();
+      hash = hash * 33 ^ geometrySpecialization.hash();
       return hash;
     }
   };
   struct FragmentShader {
     VkShaderModule fragmentModule;
+    SpecializationConstants fragmentSpecialization;
     // If dynamic states contains viewport, we care only about size. if dynamic
     // state contains viewport with count, this is unused (same for scissor)
     std::vector<VkViewport> viewports;
@@ -210,8 +316,9 @@ struct GraphicsInfo {
         }
       }
 
-      return fragmentModule == f.fragmentModule && viewportsEqual &&
-             scissorsEqual;
+      return fragmentModule == f.fragmentModule &&
+             fragmentSpecialization == f.fragmentSpecialization &&
+             viewportsEqual && scissorsEqual;
     }
     inline bool operator!=(FragmentShader const& f) const {
       return !((*this) == f);
@@ -221,6 +328,7 @@ struct GraphicsInfo {
       uint64_t hash = reinterpret_cast<uint64_t>(fragmentModule);
       hash = hash * 33 ^ viewports.size();
       hash = hash * 33 ^ scissors.size();
+      hash = hash * 33 ^ fragmentSpecialization.hash();
       return hash;
     }
   };
@@ -241,12 +349,10 @@ struct GraphicsInfo {
         return false;
       }
 
-      if (memcmp(colorAttachmentFormats.data(),
-                 other.colorAttachmentFormats.data(),
-                 colorAttachmentFormats.size() * sizeof(VkFormat)) == 0) {
-        return false;
-      }
-      return true;
+      return colorAttachmentFormats.empty() ||
+             memcmp(colorAttachmentFormats.data(),
+                    other.colorAttachmentFormats.data(),
+                    colorAttachmentFormats.size() * sizeof(VkFormat)) == 0;
     }
     inline bool operator!=(FragmentOut const& other) const {
       return !((*this) == other);
@@ -269,15 +375,43 @@ struct GraphicsInfo {
     uint32_t stencilReference;
     uint32_t stencilCompareMask;
     uint32_t stencilWriteMask;
+    // written by `PipelinePool` before lookup. Options covered by it are
+    // excluded from comparison and hash, and must be set with
+    // `PipelinePool::cmdSetDynamicOpts` after binding the pipeline
+    EDynamicOpts dynamicOpts;
+
+    // flags which are baked into the pipeline
+    inline std::underlying_type_t<EPipelineFlags> staticFlags() const {
+      using U = std::underlying_type_t<EPipelineFlags>;
+      U mask = static_cast<U>(EPipelineFlags::eAll);
+      if (dynamicOpts & EDynamicOpts::eExtendedDynamicState) {
+        // note: EPipelineFlags::operator| returns bool
+        mask &= ~(static_cast<U>(EPipelineFlags::eCullFront) |
+                  static_cast<U>(EPipelineFlags::eInvertFrontFace) |
+                  static_cast<U>(EPipelineFlags::eNoDepthWrite) |
+                  static_cast<U>(EPipelineFlags::eStencilEnable));
+      }
+      if (dynamicOpts & EDynamicOpts::eExtendedDynamicState2) {
+        mask &= ~static_cast<U>(EPipelineFlags::eDepthBias);
+      }
+      return static_cast<U>(flags) & mask;
+    }
 
     inline bool operator==(PipelineOpts const& other) const {
-      if (flags != other.flags ||
-          rasterizationPolygonMode != other.rasterizationPolygonMode ||
-          stencilCompareOp != other.stencilCompareOp ||
-          stencilLogicalOp != other.stencilLogicalOp ||
-          stencilReference != other.stencilReference ||
-          stencilCompareMask != other.stencilCompareMask ||
-          stencilWriteMask != other.stencilWriteMask) {
+      if (dynamicOpts != other.dynamicOpts ||
+          staticFlags() != other.staticFlags()) {
+        return false;
+      }
+      if (!(dynamicOpts & EDynamicOpts::eExtendedDynamicState3PolygonMode) &&
+          rasterizationPolygonMode != other.rasterizationPolygonMode) {
+        return false;
+      }
+      if (!(dynamicOpts & EDynamicOpts::eExtendedDynamicState) &&
+          (stencilCompareOp != other.stencilCompareOp ||
+           stencilLogicalOp != other.stencilLogicalOp ||
+           stencilReference != other.stencilReference ||
+           stencilCompareMask != other.stencilCompareMask ||
+           stencilWriteMask != other.stencilWriteMask)) {
         return false;
       }
       return true;
@@ -287,17 +421,22 @@ struct GraphicsInfo {
     }
 
     uint64_t hash() const {
-      uint64_t hash =
-          uint64_t(0) ^
-          static_cast<std::underlying_type_t<EPipelineFlags>>(flags);
-      hash = hash * 33 ^ rasterizationPolygonMode;
-      hash = hash * 33 ^ static_cast<std::underlying_type_t<EStencilCompareOp>>(
-                             stencilCompareOp);
-      hash = hash * 33 ^ stencilReference;
-      hash = hash * 33 ^ static_cast<std::underlying_type_t<EStencilLogicOp>>(
-                             stencilLogicalOp);
-      hash = hash * 33 ^ stencilCompareMask;
-      hash = hash * 33 ^ stencilWriteMask;
+      uint64_t hash = uint64_t(0) ^ staticFlags();
+      hash = hash * 33 ^
+             static_cast<std::underlying_type_t<EDynamicOpts>>(dynamicOpts);
+      if (!(dynamicOpts & EDynamicOpts::eExtendedDynamicState3PolygonMode)) {
+        hash = hash * 33 ^ rasterizationPolygonMode;
+      }
+      if (!(dynamicOpts & EDynamicOpts::eExtendedDynamicState)) {
+        hash = hash * 33 ^
+               static_cast<std::underlying_type_t<EStencilCompareOp>>(
+                   stencilCompareOp);
+        hash = hash * 33 ^ stencilReference;
+        hash = hash * 33 ^ static_cast<std::underlying_type_t<EStencilLogicOp>>(
+                               stencilLogicalOp);
+        hash = hash * 33 ^ stencilCompareMask;
+        hash = hash * 33 ^ stencilWriteMask;
+      }
       return hash;
     }
   };
@@ -305,6 +444,8 @@ struct GraphicsInfo {
   VertexIn vertexIn;
   PreRasterization preRasterization;
   FragmentShader fragmentShader;
+  // with a null renderPass, the pipeline is created for dynamic rendering and
+  // is identified by the attachment formats in here only
   FragmentOut fragmentOut;
   VkRenderPass renderPass;
   uint32_t subpass;
@@ -312,12 +453,11 @@ struct GraphicsInfo {
   // add GPU state?
   PipelineOpts opts;
   VkPipelineLayout pipelineLayout;
-  // TODO add specialization constants
 };
 
 inline bool operator==(GraphicsInfo const& a, GraphicsInfo const& b) {
   if (a.vertexIn != b.vertexIn || a.preRasterization != b.preRasterization ||
-      a.fragmentShader != b.fragmentShader ||
+      a.fragmentShader != b.fragmentShader || a.fragmentOut != b.fragmentOut ||
       a.pipelineLayout != b.pipelineLayout || a.opts != b.opts ||
       a.renderPass != b.renderPass || a.subpass != b.subpass) {
     return false;
@@ -342,6 +482,56 @@ struct std::hash<avk::vk::GraphicsInfo> {
   }
 };
 
+// ---------------- GRAPHICS PIPELINE KEY ------------------------------------
+
+namespace avk::vk {
+
+// immutable, canonical form of a `GraphicsInfo`: everything which is baked
+// into the pipeline, serialized field by field into a flat byte blob, with its
+// hash computed once. Equality is a hash compare followed by a single memcmp,
+// instead of walking every vector of `GraphicsInfo` on each bucket probe.
+// Canonicalization follows `GraphicsInfo::operator==`, except that only the
+// count of viewports and scissors is kept, as they are always dynamic state
+class GraphicsKey {
+ public:
+  GraphicsKey() = default;
+  explicit GraphicsKey(GraphicsInfo const& graphicsInfo) {
+    assign(graphicsInfo);
+  }
+
+  // rebuilds the key reusing its storage, such that a scratch key doesn't
+  // allocate on each lookup
+  void assign(GraphicsInfo const& graphicsInfo);
+
+  inline uint64_t hash() const { return m_hash; }
+  inline size_t size() const { return m_bytes.size(); }
+  // kept out of the blob as well, to discard pipelines by layout
+  inline VkPipelineLayout pipelineLayout() const { return m_pipelineLayout; }
+
+  inline bool operator==(GraphicsKey const& other) const {
+    return m_hash == other.m_hash && m_bytes.size() == other.m_bytes.size() &&
+           (m_bytes.empty() || memcmp(m_bytes.data(), other.m_bytes.data(),
+                                      m_bytes.size()) == 0);
+  }
+  inline bool operator!=(GraphicsKey const& other) const {
+    return !((*this) == other);
+  }
+
+ private:
+  std::vector<uint8_t> m_bytes;
+  uint64_t m_hash = 0;
+  VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+};
+
+}  // namespace avk::vk
+
+template <>
+struct std::hash<avk::vk::GraphicsKey> {
+  size_t operator()(avk::vk::GraphicsKey const& graphicsKey) const noexcept {
+    return graphicsKey.hash();
+  }
+};
+
 // ------------------- Factory Methods for quick graphics info ---------------
 
 namespace avk::vk {
@@ -354,4 +544,12 @@ VkPipelineLayout createPipelineLayout(
     VkPushConstantRange const* pPushConstantRanges = nullptr,
     uint32_t pushConstantRangeCount = 0);
 
+// translation of `GraphicsInfo::PipelineOpts` into Vulkan state, shared by
+// pipeline creation and record time dynamic state
+VkCullModeFlags cullModeFromFlags(EPipelineFlags flags);
+VkFrontFace frontFaceFromFlags(EPipelineFlags flags);
+bool stencilTestEnabled(GraphicsInfo const& graphicsInfo);
+void stencilOpStatesFromOpts(GraphicsInfo::PipelineOpts const& opts,
+                             VkStencilOpState& front, VkStencilOpState& back);
+
 }  // namespace avk::vk
\ No newline at end of file
@@ -1,10 +1,12 @@
 #pragma once
 
 #include "render/vk/common-vk.h"
+#include "render/vk/graphics-key-table.h"
 #include "render/vk/pipeline-info.h"
 #include "utils/mixins.h"
 
 // libraries and stuff
+#include <string>
 #include <unordered_map>
 #include <vector>
 #include <mutex>
@@ -16,6 +18,59 @@ class DiscardPool;
 
 class PipelinePool : public NonMoveable {
  public:
+  static uint32_t constexpr ShaderStageCount = 3;
+  /// interned `GraphicsKey`, see `internGraphicsKey`
+  using GraphicsKeyID = uint64_t;
+  static uint32_t constexpr CompileHistogramBucketCount = 20;
+
+  /// compile information of a single pipeline, recorded on creation
+  struct CompileRecord {
+    /// CPU time spent inside `vkCreate*Pipelines`
+    uint64_t durationNs;
+    bool graphics;
+    /// `VK_EXT_pipeline_creation_feedback`, meaningful only if `flags`
+    /// contains `VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT`
+    VkPipelineCreationFeedbackEXT feedback;
+    uint32_t stageCount;
+    VkPipelineCreationFeedbackEXT stageFeedbacks[ShaderStageCount];
+    /// `PipelineStageBytesEstimate` per shader stage
+    size_t estimatedBytes;
+  };
+
+  /// driver memory of a pipeline, per shader stage. Vulkan doesn't expose the
+  /// actual size, and the pipeline cache growth doesn't follow evictions
+  static size_t constexpr PipelineStageBytesEstimate = 16 << 10;
+
+  /// optional LRU policy, a zero limit means unlimited. Enforced by
+  /// `evictPipelines`
+  struct EvictionPolicy {
+    size_t maxPipelineCount = 0;
+    /// compared against the sum of `CompileRecord::estimatedBytes`
+    size_t maxEstimatedBytes = 0;
+    /// the pipeline cache is emptied once its data exceeds this. Its size is
+    /// queried by `evictPipelines` only if set
+    size_t maxPipelineCacheBytes = 0;
+  };
+
+  struct Statistics {
+    uint64_t hits;
+    uint64_t misses;
+    /// pipelines removed from the pool before its destruction
+    uint64_t evictions;
+    /// times the pipeline cache was emptied by `maxPipelineCacheBytes`
+    uint64_t pipelineCacheResets;
+    /// size of the `VkPipelineCache` data, as `vkGetPipelineCacheData`
+    size_t pipelineCacheBytes;
+    size_t graphicsPipelineCount;
+    size_t computePipelineCount;
+    /// sum of `CompileRecord::estimatedBytes` of resident pipelines
+    size_t estimatedBytes;
+    uint64_t totalCompileNs;
+    /// bucket `i` counts compiles lasting less than 2^(i+1) microseconds and
+    /// at least 2^i (bucket 0 from 0). The last bucket is open ended
+    uint64_t compileHistogram[CompileHistogramBucketCount];
+  };
+
   PipelinePool(Device* device);
   // since we don't own the handles in the info structs, we won't
   // destroy them
@@ -24,9 +79,51 @@ class PipelinePool : public NonMoveable {
   VkPipeline getOrCreateComputePipeline(ComputeInfo& computeInfo,
                                         bool isStaticShader,
                                         VkPipeline pipelineBase);
+  /// Note: writes `graphicsInfo.opts.dynamicOpts`, such that options which
+  /// are dynamic on this device don't take part in the pipeline key.
+  /// Serializes and interns `graphicsInfo` on each call
   VkPipeline getOrCreateGraphicsPipeline(GraphicsInfo& graphicsInfo,
                                          bool isStaticShader,
                                          VkPipeline pipelineBase);
+  /// Interns the key of `graphicsInfo` (writing its `dynamicOpts`): equal
+  /// keys get the same ID. Hot paths intern once and look up with the
+  /// overload below, which indexes an array instead of hashing and comparing
+  /// the key. A key is released with its pipeline (discard, eviction,
+  /// destruction), hence the table doesn't outgrow the resident pipelines
+  GraphicsKeyID internGraphicsKey(GraphicsInfo& graphicsInfo);
+  /// `graphicsKeyID` must come from `internGraphicsKey(graphicsInfo)`, and
+  /// `graphicsInfo` must not have changed since. If the key was released,
+  /// it's interned again and `graphicsKeyID` updated
+  VkPipeline getOrCreateGraphicsPipeline(GraphicsInfo const& graphicsInfo,
+                                         GraphicsKeyID& graphicsKeyID,
+                                         bool isStaticShader,
+                                         VkPipeline pipelineBase);
+
+  /// Records the pipeline options which are dynamic on this device (see
+  /// `dynamicOpts()`). Call after binding a pipeline from
+  /// `getOrCreateGraphicsPipeline` with the same `graphicsInfo`. No-op if
+  /// no extended dynamic state extension is enabled
+  void cmdSetDynamicOpts(VkCommandBuffer cmd,
+                         GraphicsInfo const& graphicsInfo) const;
+  inline EDynamicOpts dynamicOpts() const { return m_dynamicOpts; }
+
+  // -- Statistics: to spot permutation explosions and cache effectiveness --
+  Statistics statistics() const;
+  /// false if the pipeline is not (anymore) in the pool
+  bool compileRecord(VkPipeline pipeline, CompileRecord& outRecord) const;
+  /// statistics followed by the compile record of each resident pipeline
+  std::string statisticsJson() const;
+  /// zeroes counters and histogram. Compile records of resident pipelines
+  /// are kept
+  void resetStatistics();
+
+  /// WARNING: with an eviction policy, handles returned by `getOrCreate*`
+  /// shouldn't be kept across `evictPipelines` calls. Look them up each frame
+  void setEvictionPolicy(EvictionPolicy const& policy);
+  /// discards least recently used pipelines until the eviction policy is
+  /// satisfied. `value` must be reached only after every submission which may
+  /// use the evicted pipelines (eg. the timeline value of the last submit)
+  void evictPipelines(DiscardPool* discardPool, uint64_t value);
 
   // erase pipelines from the maps and inserts them in the discard pool, such
   // that they can live there until they are no longer in use
@@ -49,16 +146,42 @@ class PipelinePool : public NonMoveable {
     Device* device;
   } m_deps;
 
-  std::unordered_map<GraphicsInfo, VkPipeline> m_graphicsPipelines;
-  std::unordered_map<ComputeInfo, VkPipeline> m_computePipelines;
+  struct CachedPipeline {
+    VkPipeline pipeline;
+    // value of `m_useTick` at the last lookup (LRU eviction)
+    uint64_t lastUse;
+  };
+
+  struct GraphicsSlot {
+    // null until created
+    CachedPipeline cached;
+    // of the key, to discard pipelines by layout
+    VkPipelineLayout pipelineLayout;
+  };
+  // released with their pipeline
+  GraphicsKeyTable<GraphicsSlot> m_graphicsKeys;
+  size_t m_graphicsPipelineCount = 0;
+  // scratch key for lookups from a `GraphicsInfo` (lock held)
+  GraphicsKey m_lookupKey;
+  std::unordered_map<ComputeInfo, CachedPipeline> m_computePipelines;
+  uint64_t m_useTick = 0;
+  EvictionPolicy m_evictionPolicy{};
+  size_t m_estimatedBytes = 0;
+  // shared by every pipeline created by the pool
+  VkPipelineCache m_pipelineCache = VK_NULL_HANDLE;
+
+  // counters only, pipeline counts and cache size are queried on demand
+  Statistics m_statistics{};
+  std::unordered_map<VkPipeline, CompileRecord> m_compileRecords;
   // partially initialized structure to reuse
   VkComputePipelineCreateInfo m_computePipelineCreateInfo;
-
-  static uint32_t constexpr ShaderStageCount = 3;
+  VkSpecializationInfo m_computeSpecializationInfo;
 
   VkGraphicsPipelineCreateInfo m_graphicsPipelineCreateInfo;
   VkPipelineShaderStageCreateInfo
       m_pipelineShaderStageCreateInfos[ShaderStageCount];
+  // pointed to by each stage when it has specialization constants
+  VkSpecializationInfo m_specializationInfos[ShaderStageCount];
   VkPipelineInputAssemblyStateCreateInfo m_pipelineInputAssemblyStateCreateInfo;
   VkPipelineVertexInputStateCreateInfo m_pipelineVertexInputStateCreateInfo;
 
@@ -66,6 +189,8 @@ class PipelinePool : public NonMoveable {
 
   // no provoking vertex info
   std::vector<VkDynamicState> m_dynamicStates;
+  // pipeline options moved to dynamic state by extended dynamic state
+  EDynamicOpts m_dynamicOpts = EDynamicOpts::eNone;
   VkPipelineDynamicStateCreateInfo m_pipelineDynamicStateCreateInfo;
 
   VkPipelineViewportStateCreateInfo m_pipelineViewportStateCreateInfo;
@@ -81,17 +206,38 @@ class PipelinePool : public NonMoveable {
   VkPipelineColorBlendAttachmentState
       m_pipelineColorBlendAttachmentStateTemplate;
 
-  // VkSpecializationInfo m_specializationInfo;
-  // std::vector<VkSpecializationMapEntry> m_specializationMapEntries;
+  // chained when `GraphicsInfo::renderPass` is null (VK_KHR_dynamic_rendering)
+  VkPipelineRenderingCreateInfoKHR m_pipelineRenderingCreateInfo;
+
   // VkPushConstantRange m_pushConstantRange;
   // VkPipelineCache m_pipelineCacheStatic;
   // VkPipelineCache m_pipelineCacheNonStatic;
 
   // mutex to be acquired whenever getting/creating a pipeline
-  std::mutex m_mutex;
-
+  mutable std::mutex m_mutex;
+
+  // interns `m_lookupKey` (lock held)
+  GraphicsKeyID internLookupKey();
+  // lookup, or creation on miss (lock held)
+  VkPipeline findOrCreateGraphicsPipeline(GraphicsInfo const& graphicsInfo,
+                                          GraphicsKeyID graphicsKeyID,
+                                          VkPipeline pipelineBase);
+  // discards the pipeline of a slot and releases its key (lock held)
+  void discardGraphicsSlot(GraphicsKeyID graphicsKeyID, GraphicsSlot& slot,
+                           DiscardPool* discardPool, uint64_t value);
   // utility to reset all states after creating a graphics pipeline
   void clearGraphicsPipelineStates();
+  // updates statistics after a pipeline creation (lock held)
+  void recordCompile(VkPipeline pipeline, bool graphics, uint64_t durationNs,
+                     VkPipelineCreationFeedbackEXT const& feedback,
+                     VkPipelineCreationFeedbackEXT const* stageFeedbacks,
+                     uint32_t stageCount);
+  // forgets the compile record of a pipeline leaving the pool (lock held)
+  void eraseCompileRecord(VkPipeline pipeline);
+  // replaces the pipeline cache with an empty one (lock held)
+  void resetPipelineCache();
+  // size of the pipeline cache data
+  size_t pipelineCacheBytes() const;
 };
 
 }  // namespace avk::vk
\ No newline at end of file
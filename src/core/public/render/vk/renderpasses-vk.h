@@ -12,4 +12,19 @@ VkFormat basicDepthStencilFormat(VkPhysicalDevice physicalDevice);
 Expected<VkRenderPass> basicRenderPass(Device const* device, VkFormat colorFmt,
                                        VkFormat depthFmt);
 
+/// Dynamic rendering (`VK_KHR_dynamic_rendering`) equivalent of beginning the
+/// `basicRenderPass` on a framebuffer: transitions the color (swapchain) image
+/// and the depth stencil image to attachment layouts and begins rendering,
+/// clearing both. Nothing needs recreation when the swapchain is resized
+/// \param clear 2 values, color and depth stencil
+void basicBeginRendering(Device const* device, VkCommandBuffer cmd,
+                         VkImage colorImage, VkImageView colorView,
+                         VkImage depthImage, VkImageView depthView,
+                         VkRect2D renderArea, VkClearValue const* clear);
+
+/// Ends rendering started with `basicBeginRendering` and transitions the color
+/// image to `VK_IMAGE_LAYOUT_PRESENT_SRC_KHR`
+void basicEndRendering(Device const* device, VkCommandBuffer cmd,
+                       VkImage colorImage);
+
 }  // namespace avk::vk
\ No newline at end of file
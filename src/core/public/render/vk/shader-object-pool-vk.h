@@ -0,0 +1,132 @@
+#pragma once
+
+#include "render/vk/common-vk.h"
+#include "render/vk/pipeline-info.h"
+#include "utils/mixins.h"
+
+// libraries and stuff
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// ---------------- SHADER OBJECT HASH ---------------------------------------
+
+namespace avk::vk {
+
+// struct to identify a single `VkShaderEXT`. Shader code is identified by the
+// same `VkShaderModule` handles used by `GraphicsInfo`, such that both
+// backends share keys
+struct ShaderObjectInfo {
+  VkShaderModule shaderModule;
+  VkShaderStageFlagBits stage;
+  VkShaderStageFlags nextStage;
+  // stands for its descriptor set layouts and push constant ranges (see
+  // `ShaderObjectPool::registerPipelineLayout`)
+  VkPipelineLayout pipelineLayout;
+  SpecializationConstants specialization;
+};
+
+inline bool operator==(ShaderObjectInfo const& a, ShaderObjectInfo const& b) {
+  return a.shaderModule == b.shaderModule && a.stage == b.stage &&
+         a.nextStage == b.nextStage && a.pipelineLayout == b.pipelineLayout &&
+         a.specialization == b.specialization;
+}
+
+}  // namespace avk::vk
+
+template <>
+struct std::hash<avk::vk::ShaderObjectInfo> {
+  size_t operator()(avk::vk::ShaderObjectInfo const& info) const noexcept {
+    size_t hash = reinterpret_cast<uint64_t>(info.shaderModule);
+    hash = hash * 33 ^ info.stage;
+    hash = hash * 33 ^ info.nextStage;
+    hash = hash * 33 ^ reinterpret_cast<uint64_t>(info.pipelineLayout);
+    hash = hash * 33 ^ info.specialization.hash();
+    return hash;
+  }
+};
+
+namespace avk::vk {
+
+class Device;
+class DiscardPool;
+
+/// Alternative to `PipelinePool` for devices with `VK_EXT_shader_object`
+/// (see `Device::shaderObject()`). Graphics shaders are created per stage as
+/// `VkShaderEXT` and all state from `GraphicsInfo` is recorded as dynamic
+/// state, hence no pipeline is ever compiled. Requires dynamic rendering
+class ShaderObjectPool : public NonMoveable {
+ public:
+  /// vertex, fragment, geometry (same order as `PipelinePool`)
+  static uint32_t constexpr GraphicsStageCount = 3;
+
+  ShaderObjectPool(Device* device);
+  // since we don't own the handles in the info structs, we won't
+  // destroy them
+  ~ShaderObjectPool();
+
+  /// `VkShaderEXT` is created from SPIR-V, not from a `VkShaderModule`, hence
+  /// keep a copy of the code the module was created with
+  void registerShaderModule(VkShaderModule shaderModule, uint32_t const* code,
+                            size_t codeSize);
+  void unregisterShaderModule(VkShaderModule shaderModule);
+  /// `VkShaderEXT` is created with set layouts and push constant ranges
+  /// instead of a `VkPipelineLayout`. These must be the same the layout was
+  /// created with. Both arrays are copied, hence can be freed after the call,
+  /// but the set layout handles must stay valid while shaders are created
+  /// with `pipelineLayout`
+  void registerPipelineLayout(VkPipelineLayout pipelineLayout,
+                              VkDescriptorSetLayout const* pSetLayouts,
+                              uint32_t setLayoutCount,
+                              VkPushConstantRange const* pPushConstantRanges,
+                              uint32_t pushConstantRangeCount);
+
+  VkShaderEXT getOrCreateShader(ShaderObjectInfo const& shaderInfo);
+  /// Shaders for the stages of `graphicsInfo`, in `GraphicsStageCount` order
+  /// (null geometry shader if no geometry module)
+  void getOrCreateGraphicsShaders(
+      GraphicsInfo const& graphicsInfo,
+      VkShaderEXT (&outShaders)[GraphicsStageCount]);
+
+  /// Binds the shaders from `getOrCreateGraphicsShaders`, unbinding the
+  /// stages which are not used
+  void cmdBindGraphicsShaders(
+      VkCommandBuffer cmd,
+      VkShaderEXT const (&shaders)[GraphicsStageCount]) const;
+  /// Records every state a pipeline would bake from `graphicsInfo`, with the
+  /// same defaults as `PipelinePool`. Viewports and scissors are left to the
+  /// caller (`vkCmdSetViewportWithCountEXT`, `vkCmdSetScissorWithCountEXT`)
+  void cmdSetGraphicsState(VkCommandBuffer cmd,
+                           GraphicsInfo const& graphicsInfo) const;
+
+  // erase shaders created with the given layout from the map and inserts
+  // them in the discard pool. Forgets the layout registration too
+  // WARNING: calling this won't discard Vulkan Handles inside
+  // the info structs. only VkShaderEXTs
+  void discardAllShaders(DiscardPool* discardPool,
+                         VkPipelineLayout pipelineLayout, uint64_t value);
+
+  // WARNING: calling this won't destroy Vulkan Handles inside
+  // the info structs. only VkShaderEXTs
+  void destroyAllShaders();
+
+ private:
+  // dependencies which must outlive the object
+  struct Deps {
+    Device* device;
+  } m_deps;
+
+  struct LayoutInfo {
+    std::vector<VkDescriptorSetLayout> setLayouts;
+    std::vector<VkPushConstantRange> pushConstantRanges;
+  };
+
+  std::unordered_map<ShaderObjectInfo, VkShaderEXT> m_shaders;
+  std::unordered_map<VkShaderModule, std::vector<uint32_t>> m_moduleCode;
+  std::unordered_map<VkPipelineLayout, LayoutInfo> m_layouts;
+
+  // mutex to be acquired whenever getting/creating a shader
+  std::mutex m_mutex;
+};
+
+}  // namespace avk::vk
@@ -13,6 +13,11 @@ inline constexpr size_t nextMultipleOf(size_t x) {
   return (x + Base - 1) & (~size_t(Base - 1));
 }
 
+// WARNING: only for POT (runtime base, eg. device alignments)
+inline constexpr uint64_t nextMultipleOf(uint64_t x, uint64_t base) {
+  return (x + base - 1) & (~uint64_t(base - 1));
+}
+
 // ------------
 // Hash Function: FNV1a 64 bit
 // https://www.ietf.org/archive/id/draft-eastlake-fnv-22.html#name-fnv64-code
@@ -0,0 +1,278 @@
+#pragma once
+
+#include "utils/mixins.h"
+
+// std
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+namespace avk {
+
+/// Hash table from 64 bit keys (eg. `"name"_hash`) to `Value`s, split into
+/// `ShardCount` shards, each one a linear probing open addressing table
+/// behind its own `std::shared_mutex` (lock striping). Threads working on
+/// different keys rarely contend, and a lookup is a shard lock plus a probe
+/// over contiguous slots
+/// - deletion uses backward shifting, hence there are no tombstones and
+///   probe lengths don't degrade over create/discard churn
+/// - callbacks run with the shard lock held, hence they must not call back
+///   into the table
+/// - `Value` must be move constructible, as slots move on growth and erase
+template <typename Value, uint32_t ShardCount = 16>
+class ShardedTable : public NonMoveable {
+  static_assert(ShardCount > 0 && (ShardCount & (ShardCount - 1)) == 0,
+                "shard count must be a power of two");
+
+ public:
+  /// \param capacity expected number of keys, spread over the shards
+  explicit ShardedTable(size_t capacity = 0) {
+    size_t const perShard = (capacity + ShardCount - 1) / ShardCount;
+    for (Shard& shard : m_shards) {
+      shard.rehash(slotCountFor(perShard));
+    }
+  }
+
+  /// false if `key` is already present, in which case nothing is constructed
+  template <typename... Args>
+  bool tryEmplace(uint64_t key, Args&&... args) {
+    uint64_t const hash = mix(key);
+    Shard& shard = shardOf(hash);
+    std::unique_lock wlock{shard.mtx};
+    if (shard.find(key, hash) != NotFound) {
+      return false;
+    }
+    // keep the load factor under 3/4
+    if ((shard.count + 1) * 4 > shard.slots.size() * 3) {
+      shard.rehash(shard.slots.size() * 2);
+    }
+    shard.insert(key, hash, std::forward<Args>(args)...);
+    return true;
+  }
+
+  /// calls `f(Value const&)` under a shared lock. False if not found
+  template <typename F>
+  bool read(uint64_t key, F&& f) const {
+    uint64_t const hash = mix(key);
+    Shard const& shard = shardOf(hash);
+    std::shared_lock rlock{shard.mtx};
+    size_t const index = shard.find(key, hash);
+    if (index == NotFound) {
+      return false;
+    }
+    f(*shard.slots[index].value);
+    return true;
+  }
+
+  /// calls `f(Value&)` under an exclusive lock. False if not found
+  template <typename F>
+  bool modify(uint64_t key, F&& f) {
+    uint64_t const hash = mix(key);
+    Shard& shard = shardOf(hash);
+    std::unique_lock wlock{shard.mtx};
+    size_t const index = shard.find(key, hash);
+    if (index == NotFound) {
+      return false;
+    }
+    f(*shard.slots[index].value);
+    return true;
+  }
+
+  /// calls `f(Value&)` under an exclusive lock, then removes the entry.
+  /// False if not found
+  template <typename F>
+  bool erase(uint64_t key, F&& f) {
+    uint64_t const hash = mix(key);
+    Shard& shard = shardOf(hash);
+    std::unique_lock wlock{shard.mtx};
+    size_t const index = shard.find(key, hash);
+    if (index == NotFound) {
+      return false;
+    }
+    f(*shard.slots[index].value);
+    shard.eraseAt(index);
+    return true;
+  }
+
+  /// removes the entry only if `pred(Value&)`, called under an exclusive
+  /// lock, returns true. False if not found or not removed
+  template <typename Pred>
+  bool eraseIf(uint64_t key, Pred&& pred) {
+    uint64_t const hash = mix(key);
+    Shard& shard = shardOf(hash);
+    std::unique_lock wlock{shard.mtx};
+    size_t const index = shard.find(key, hash);
+    if (index == NotFound || !pred(*shard.slots[index].value)) {
+      return false;
+    }
+    shard.eraseAt(index);
+    return true;
+  }
+
+  /// calls `f(uint64_t key, Value const&)` on each entry, locking one shard
+  /// at a time. Not a snapshot: concurrent changes to other shards may or
+  /// may not be seen
+  template <typename F>
+  void forEach(F&& f) const {
+    for (Shard const& shard : m_shards) {
+      std::shared_lock rlock{shard.mtx};
+      for (Slot const& slot : shard.slots) {
+        if (slot.value) {
+          f(slot.key, *slot.value);
+        }
+      }
+    }
+  }
+
+  /// as `forEach`, with exclusive locks and mutable values
+  template <typename F>
+  void forEachMutable(F&& f) {
+    for (Shard& shard : m_shards) {
+      std::unique_lock wlock{shard.mtx};
+      for (Slot& slot : shard.slots) {
+        if (slot.value) {
+          f(slot.key, *slot.value);
+        }
+      }
+    }
+  }
+
+  /// calls `f(uint64_t key, Value&)` on each entry, then empties the table
+  template <typename F>
+  void drain(F&& f) {
+    for (Shard& shard : m_shards) {
+      std::unique_lock wlock{shard.mtx};
+      for (Slot& slot : shard.slots) {
+        if (slot.value) {
+          f(slot.key, *slot.value);
+          slot.value.reset();
+        }
+      }
+      shard.count = 0;
+    }
+  }
+
+  void clear() {
+    drain([](uint64_t /*key*/, Value& /*value*/) {});
+  }
+
+  /// approximate under concurrent modifications
+  size_t size() const {
+    size_t total = 0;
+    for (Shard const& shard : m_shards) {
+      std::shared_lock rlock{shard.mtx};
+      total += shard.count;
+    }
+    return total;
+  }
+
+ private:
+  static size_t constexpr NotFound = SIZE_MAX;
+  static size_t constexpr MinSlotCount = 8;
+
+  struct Slot {
+    uint64_t key = 0;
+    std::optional<Value> value;
+  };
+
+  // aligned such that locks of different shards don't share cache lines
+  struct alignas(64) Shard {
+    mutable std::shared_mutex mtx;
+    // power of two size, empty slots have no value
+    std::vector<Slot> slots;
+    size_t count = 0;
+
+    inline size_t mask() const { return slots.size() - 1; }
+
+    size_t find(uint64_t key, uint64_t hash) const {
+      for (size_t i = homeOf(hash, mask());; i = (i + 1) & mask()) {
+        Slot const& slot = slots[i];
+        if (!slot.value) {
+          return NotFound;
+        }
+        if (slot.key == key) {
+          return i;
+        }
+      }
+    }
+
+    template <typename... Args>
+    void insert(uint64_t key, uint64_t hash, Args&&... args) {
+      size_t i = homeOf(hash, mask());
+      while (slots[i].value) {
+        i = (i + 1) & mask();
+      }
+      slots[i].key = key;
+      slots[i].value.emplace(std::forward<Args>(args)...);
+      ++count;
+    }
+
+    // backward shift deletion: moves back the following entries of the
+    // cluster which wouldn't be found anymore past the hole
+    void eraseAt(size_t hole) {
+      slots[hole].value.reset();
+      --count;
+      for (size_t i = (hole + 1) & mask(); slots[i].value;
+           i = (i + 1) & mask()) {
+        size_t const home = homeOf(mix(slots[i].key), mask());
+        // distance from home to the candidate must cover the hole
+        if (((i - home) & mask()) >= ((i - hole) & mask())) {
+          slots[hole].key = slots[i].key;
+          slots[hole].value.emplace(std::move(*slots[i].value));
+          slots[i].value.reset();
+          hole = i;
+        }
+      }
+    }
+
+    void rehash(size_t slotCount) {
+      assert((slotCount & (slotCount - 1)) == 0);
+      std::vector<Slot> old =
+          std::exchange(slots, std::vector<Slot>(slotCount));
+      count = 0;
+      for (Slot& slot : old) {
+        if (slot.value) {
+          insert(slot.key, mix(slot.key), std::move(*slot.value));
+        }
+      }
+    }
+  };
+
+  // keys are usually FNV hashes already, the finalizer (murmur3 fmix64)
+  // decorrelates the bits used for the shard and for the slot
+  static inline uint64_t mix(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+  }
+  // high bits pick the shard, low bits the slot
+  static inline size_t homeOf(uint64_t hash, size_t mask) {
+    return static_cast<size_t>(hash) & mask;
+  }
+  static size_t slotCountFor(size_t keys) {
+    size_t slotCount = MinSlotCount;
+    while (slotCount * 3 < keys * 4) {
+      slotCount <<= 1;
+    }
+    return slotCount;
+  }
+
+  inline Shard& shardOf(uint64_t hash) {
+    return m_shards[(hash >> 32) & (ShardCount - 1)];
+  }
+  inline Shard const& shardOf(uint64_t hash) const {
+    return m_shards[(hash >> 32) & (ShardCount - 1)];
+  }
+
+  Shard m_shards[ShardCount];
+};
+
+}  // namespace avk
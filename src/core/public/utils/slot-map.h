@@ -0,0 +1,231 @@
+#pragma once
+
+#include "utils/mixins.h"
+
+// std
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+namespace avk {
+
+/// Typed index + generation handle into a `SlotMap`. `Tag` only tells apart
+/// handles of different resource kinds. The default constructed handle
+/// (generation 0) is never returned by a `SlotMap`, hence is the null handle
+template <typename Tag>
+struct ResourceHandle {
+  uint32_t index = 0;
+  uint32_t generation = 0;
+
+  inline explicit operator bool() const { return generation != 0; }
+  inline bool operator==(ResourceHandle const& other) const {
+    return index == other.index && generation == other.generation;
+  }
+  inline bool operator!=(ResourceHandle const& other) const {
+    return !(*this == other);
+  }
+};
+
+/// Array of `Value`s addressed by `Handle`s (a `ResourceHandle`), such that a
+/// lookup is an array access plus a generation compare, and handles of
+/// erased values fail safely, even if their slot is reused
+/// - slots are split over `ShardCount` shards with their own
+///   `std::shared_mutex`. The shard is encoded in the low bits of the index,
+///   and inserts go round robin, hence threads rarely contend
+/// - callbacks run with the shard lock held, hence they must not call back
+///   into the map
+template <typename Value, typename Handle, uint32_t ShardCount = 16>
+class SlotMap : public NonMoveable {
+  static_assert(ShardCount > 0 && (ShardCount & (ShardCount - 1)) == 0,
+                "shard count must be a power of two");
+
+ public:
+  /// \param capacity expected number of values, spread over the shards
+  explicit SlotMap(size_t capacity = 0) {
+    for (Shard& shard : m_shards) {
+      shard.slots.reserve((capacity + ShardCount - 1) / ShardCount);
+    }
+  }
+
+  template <typename... Args>
+  Handle insert(Args&&... args) {
+    uint32_t const shardIndex =
+        m_nextShard.fetch_add(1, std::memory_order_relaxed) & ShardMask;
+    Shard& shard = m_shards[shardIndex];
+    std::unique_lock wlock{shard.mtx};
+    uint32_t local = 0;
+    if (!shard.freeList.empty()) {
+      local = shard.freeList.back();
+      shard.freeList.pop_back();
+    } else {
+      assert(shard.slots.size() < UINT32_MAX / ShardCount);
+      local = static_cast<uint32_t>(shard.slots.size());
+      shard.slots.emplace_back();
+    }
+    Slot& slot = shard.slots[local];
+    slot.value.emplace(std::forward<Args>(args)...);
+    ++shard.count;
+    return Handle{local * ShardCount + shardIndex, slot.generation};
+  }
+
+  /// calls `f(Value const&)` under a shared lock. False if stale
+  template <typename F>
+  bool read(Handle handle, F&& f) const {
+    Shard const& shard = m_shards[handle.index & ShardMask];
+    std::shared_lock rlock{shard.mtx};
+    Slot const* slot = shard.find(handle);
+    if (!slot) {
+      return false;
+    }
+    f(*slot->value);
+    return true;
+  }
+
+  /// calls `f(Value&)` under an exclusive lock. False if stale
+  template <typename F>
+  bool modify(Handle handle, F&& f) {
+    Shard& shard = m_shards[handle.index & ShardMask];
+    std::unique_lock wlock{shard.mtx};
+    Slot* slot = shard.find(handle);
+    if (!slot) {
+      return false;
+    }
+    f(*slot->value);
+    return true;
+  }
+
+  /// calls `f(Value&)` under an exclusive lock, then frees the slot, making
+  /// every copy of `handle` stale. False if already stale
+  template <typename F>
+  bool erase(Handle handle, F&& f) {
+    Shard& shard = m_shards[handle.index & ShardMask];
+    std::unique_lock wlock{shard.mtx};
+    Slot* slot = shard.find(handle);
+    if (!slot) {
+      return false;
+    }
+    f(*slot->value);
+    shard.release(handle.index / ShardCount);
+    return true;
+  }
+
+  /// calls `f(Handle, Value const&)` on each value, locking one shard at a
+  /// time
+  template <typename F>
+  void forEach(F&& f) const {
+    for (uint32_t s = 0; s < ShardCount; ++s) {
+      Shard const& shard = m_shards[s];
+      std::shared_lock rlock{shard.mtx};
+      for (uint32_t local = 0; local < shard.slots.size(); ++local) {
+        Slot const& slot = shard.slots[local];
+        if (slot.value) {
+          f(Handle{local * ShardCount + s, slot.generation}, *slot.value);
+        }
+      }
+    }
+  }
+
+  /// as `forEach`, with exclusive locks and mutable values
+  template <typename F>
+  void forEachMutable(F&& f) {
+    for (uint32_t s = 0; s < ShardCount; ++s) {
+      Shard& shard = m_shards[s];
+      std::unique_lock wlock{shard.mtx};
+      for (uint32_t local = 0; local < shard.slots.size(); ++local) {
+        Slot& slot = shard.slots[local];
+        if (slot.value) {
+          f(Handle{local * ShardCount + s, slot.generation}, *slot.value);
+        }
+      }
+    }
+  }
+
+  /// calls `f(Handle, Value&)` on each value, then frees its slot
+  template <typename F>
+  void drain(F&& f) {
+    for (uint32_t s = 0; s < ShardCount; ++s) {
+      Shard& shard = m_shards[s];
+      std::unique_lock wlock{shard.mtx};
+      for (uint32_t local = 0; local < shard.slots.size(); ++local) {
+        Slot& slot = shard.slots[local];
+        if (slot.value) {
+          f(Handle{local * ShardCount + s, slot.generation}, *slot.value);
+          shard.release(local);
+        }
+      }
+    }
+  }
+
+  /// approximate under concurrent modifications
+  size_t size() const {
+    size_t total = 0;
+    for (Shard const& shard : m_shards) {
+      std::shared_lock rlock{shard.mtx};
+      total += shard.count;
+    }
+    return total;
+  }
+
+ private:
+  static uint32_t constexpr ShardMask = ShardCount - 1;
+
+  struct Slot {
+    std::optional<Value> value;
+    // starts from 1, such that the null handle never matches
+    uint32_t generation = 1;
+  };
+
+  // aligned such that locks of different shards don't share cache lines
+  struct alignas(64) Shard {
+    mutable std::shared_mutex mtx;
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeList;
+    size_t count = 0;
+
+    Slot const* find(Handle handle) const {
+      uint32_t const local = handle.index / ShardCount;
+      if (local >= slots.size()) {
+        return nullptr;
+      }
+      Slot const& slot = slots[local];
+      if (!slot.value || slot.generation != handle.generation) {
+        return nullptr;
+      }
+      return &slot;
+    }
+    Slot* find(Handle handle) {
+      return const_cast<Slot*>(std::as_const(*this).find(handle));
+    }
+
+    void release(uint32_t local) {
+      Slot& slot = slots[local];
+      slot.value.reset();
+      // skip 0 on wrap around, reserved to the null handle
+      if (++slot.generation == 0) {
+        slot.generation = 1;
+      }
+      freeList.push_back(local);
+      --count;
+    }
+  };
+
+  std::atomic<uint32_t> m_nextShard = 0;
+  Shard m_shards[ShardCount];
+};
+
+}  // namespace avk
+
+template <typename Tag>
+struct std::hash<avk::ResourceHandle<Tag>> {
+  inline size_t operator()(avk::ResourceHandle<Tag> const& handle) const {
+    return std::hash<uint64_t>{}(uint64_t(handle.index) << 32 |
+                                 handle.generation);
+  }
+};
@@ -131,8 +131,10 @@ void AndroidApp::createVulkanResources() AVK_NO_CFI {
   for (VkFramebuffer &framebuffer : m_framebuffers) {
     uint32_t const i = index++;
     attachments[0] = vkSwapchain()->imageViewAt(i);
-    VK_CHECK(
-        vkDevApi->vkCreateFramebuffer(dev, &createInfo, nullptr, &framebuffer));
+    VK_CHECK(vkDevApi->vkCreateFramebuffer(
+        dev, &createInfo,
+        vkDevice()->allocationCallbacks(VK_OBJECT_TYPE_FRAMEBUFFER),
+        &framebuffer));
   }
 
   // bookkeeping for command buffers: 1 ID per Frame in Flight
@@ -252,7 +254,8 @@ void AndroidApp::createConstantVulkanResources() AVK_NO_CFI {
     desLayoutCreateInfo.bindingCount = 2;
     desLayoutCreateInfo.pBindings = binding;
     VK_CHECK(vkDevTable()->vkCreateDescriptorSetLayout(
-        vkDeviceHandle(), &desLayoutCreateInfo, nullptr,
+        vkDeviceHandle(), &desLayoutCreateInfo,
+        vkDevice()->allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT),
         &m_descriptorSetLayout));
   }
 
@@ -298,7 +301,10 @@ void AndroidApp::createConstantVulkanResources() AVK_NO_CFI {
     createInfo.descriptorSetLayout = m_descriptorSetLayout;
 
     VK_CHECK(vkDevTable()->vkCreateDescriptorUpdateTemplateKHR(
-        vkDeviceHandle(), &createInfo, nullptr, &m_descriptorUpdateTemplate));
+        vkDeviceHandle(), &createInfo,
+        vkDevice()->allocationCallbacks(
+            VK_OBJECT_TYPE_DESCRIPTOR_UPDATE_TEMPLATE),
+        &m_descriptorUpdateTemplate));
   }
 
   // allocate GPU side buffers for descriptors
@@ -333,12 +339,15 @@ void AndroidApp::destroyConstantVulkanResources() AVK_NO_CFI {
   using namespace avk::literals;
   if (m_descriptorUpdateTemplate != VK_NULL_HANDLE) {
     vkDevTable()->vkDestroyDescriptorUpdateTemplateKHR(
-        vkDeviceHandle(), m_descriptorUpdateTemplate, nullptr);
+        vkDeviceHandle(), m_descriptorUpdateTemplate,
+        vkDevice()->allocationCallbacks(
+            VK_OBJECT_TYPE_DESCRIPTOR_UPDATE_TEMPLATE));
     m_descriptorUpdateTemplate = VK_NULL_HANDLE;
   }
   if (m_descriptorSetLayout != VK_NULL_HANDLE) {
-    vkDevTable()->vkDestroyDescriptorSetLayout(vkDeviceHandle(),
-                                               m_descriptorSetLayout, nullptr);
+    vkDevTable()->vkDestroyDescriptorSetLayout(
+        vkDeviceHandle(), m_descriptorSetLayout,
+        vkDevice()->allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT));
     m_descriptorSetLayout = VK_NULL_HANDLE;
   }
 
@@ -424,6 +433,7 @@ AVK_NO_CFI {
   // bind pipeline and vertex buffer
   vkDevApi->vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
                               m_graphicsPipeline);
+  vkPipelines()->cmdSetDynamicOpts(cmd, m_graphicsInfo);
   // bind vertex and index buffer
   VkDeviceSize offset = 0;
   VkBuffer buffer = VK_NULL_HANDLE;
@@ -466,31 +476,21 @@ AVK_NO_CFI {
   subEnd.sType = VK_STRUCTURE_TYPE_SUBPASS_END_INFO_KHR;
   vkDevApi->vkCmdEndRenderPass2KHR(cmd, &subEnd);
   VK_CHECK(vkDevApi->vkEndCommandBuffer(cmd));
-  // queue submit command buffer
-  VkSemaphore submitSignalSems[2]{swapchainData.presentSemaphore,
-                                  vkDiscardPool()->timelineSemaphore()};
-  uint64_t values[2]{0, timeline() + 1};
-  VkTimelineSemaphoreSubmitInfoKHR timelineSubmit{};
-  timelineSubmit.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
-  timelineSubmit.signalSemaphoreValueCount = 2;
-  timelineSubmit.pSignalSemaphoreValues = values;
-
-  VkPipelineStageFlags waitPresentationStage =
-      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-
-  VkSubmitInfo submitInfo{};
-  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  submitInfo.pNext = &timelineSubmit;
-  submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = &cmd;
-  submitInfo.signalSemaphoreCount = 2;
-  submitInfo.pSignalSemaphores = submitSignalSems;
-  submitInfo.waitSemaphoreCount = 1;
-  submitInfo.pWaitSemaphores = &swapchainData.acquireSemaphore;
-  // same as wait semaphores
-  submitInfo.pWaitDstStageMask = &waitPresentationStage;
-  return vkDevApi->vkQueueSubmit(vkDevice()->queue(), 1, &submitInfo,
-                                 swapchainData.submissionFence);
+  // queue submit command buffer, signaling `timeline() + 1` on the discard
+  // pool timeline, after the compute submissions of the frame (if any)
+  using EQueue = experimental::CrossQueueSubmitter::EQueue;
+  experimental::CrossQueueSubmitter* const submitter = crossQueueSubmitter();
+  assert(submitter->nextValue(EQueue::eGraphics) == timeline() + 1);
+  // compute output may be consumed from the first draw (indirect arguments,
+  // vertex data) or dispatch, later stages are ordered after those
+  submitter->waitFor(EQueue::eGraphics, EQueue::eCompute,
+                     VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+  submitter->addWait(EQueue::eGraphics, swapchainData.acquireSemaphore, 0,
+                     VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+  submitter->addSignal(EQueue::eGraphics, swapchainData.presentSemaphore);
+  return submitter->submit(EQueue::eGraphics, &cmd, 1,
+                           swapchainData.submissionFence);
 }
 
 vk::SurfaceSpec AndroidApp::doSurfaceSpec() {
@@ -113,18 +113,24 @@ void MacosApplication::destroyConstantVulkanResources() AVK_NO_CFI {
   // template and layout
   if (m_descriptorUpdateTemplate != VK_NULL_HANDLE) {
     vkDevTable()->vkDestroyDescriptorUpdateTemplateKHR(
-        vkDeviceHandle(), m_descriptorUpdateTemplate, nullptr);
+        vkDeviceHandle(), m_descriptorUpdateTemplate,
+        vkDevice()->allocationCallbacks(
+            VK_OBJECT_TYPE_DESCRIPTOR_UPDATE_TEMPLATE));
     m_descriptorUpdateTemplate = VK_NULL_HANDLE;
   }
   if (m_skyboxDescriptorUpdateTemplate != VK_NULL_HANDLE) {
     vkDevTable()->vkDestroyDescriptorUpdateTemplateKHR(
-        vkDeviceHandle(), m_skyboxDescriptorUpdateTemplate, nullptr);
+        vkDeviceHandle(), m_skyboxDescriptorUpdateTemplate,
+        vkDevice()->allocationCallbacks(
+            VK_OBJECT_TYPE_DESCRIPTOR_UPDATE_TEMPLATE));
     m_skyboxDescriptorUpdateTemplate = VK_NULL_HANDLE;
   }
 
   // skybox related resources
   if (m_cubeSampler != VK_NULL_HANDLE) {
-    vkDevTable()->vkDestroySampler(vkDeviceHandle(), m_cubeSampler, nullptr);
+    vkDevTable()->vkDestroySampler(
+        vkDeviceHandle(), m_cubeSampler,
+        vkDevice()->allocationCallbacks(VK_OBJECT_TYPE_SAMPLER));
     m_cubeSampler = VK_NULL_HANDLE;
   }
   experimental::discardGraphicsInfo(vkDiscardPool(), timeline(),
@@ -135,24 +141,28 @@ void MacosApplication::destroyConstantVulkanResources() AVK_NO_CFI {
                                     m_graphicsInfo);
   // index/vertex buffers + uniform buffers
   using namespace avk::literals;
-  bufferManager()->discardById(vkDiscardPool(), "SkyboxVertex"_hash,
-                               timeline());
-  bufferManager()->discardById(vkDiscardPool(), "SkyboxIndex"_hash, timeline());
+  bufferSuballocator()->free(m_skyboxVertexRange, timeline());
+  bufferSuballocator()->free(m_skyboxIndexRange, timeline());
+  m_skyboxVertexRange = {};
+  m_skyboxIndexRange = {};
   bufferManager()->discardById(vkDiscardPool(), hashes::Cube, timeline());
   bufferManager()->discardById(vkDiscardPool(), hashes::Model, timeline());
   bufferManager()->discardById(vkDiscardPool(), hashes::Vertex, timeline());
   bufferManager()->discardById(vkDiscardPool(), hashes::Index, timeline());
+  m_staging.discardRing(bufferManager(), vkDiscardPool(), timeline());
 
   // set layout only after pipeline layout (hopefully we don't need a discard)
   vkDiscardPool()->destroyDiscardedResources();
   if (m_descriptorSetLayout != VK_NULL_HANDLE) {
-    vkDevTable()->vkDestroyDescriptorSetLayout(vkDeviceHandle(),
-                                               m_descriptorSetLayout, nullptr);
+    vkDevTable()->vkDestroyDescriptorSetLayout(
+        vkDeviceHandle(), m_descriptorSetLayout,
+        vkDevice()->allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT));
     m_descriptorSetLayout = VK_NULL_HANDLE;
   }
   if (m_skyboxDescriptorSetLayout != VK_NULL_HANDLE) {
     vkDevTable()->vkDestroyDescriptorSetLayout(
-        vkDeviceHandle(), m_skyboxDescriptorSetLayout, nullptr);
+        vkDeviceHandle(), m_skyboxDescriptorSetLayout,
+        vkDevice()->allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT));
     m_skyboxDescriptorSetLayout = VK_NULL_HANDLE;
   }
   // discard KTX texture
@@ -225,8 +235,6 @@ void MacosApplication::createConstantVulkanResources() AVK_NO_CFI {
     m_RTcamera.proj[1][1] *= -1;
   }
 
-  // TODO: move first copy for SoC to timeline 0
-
   // --------------------- index/vertex buffers Main --------------------------
   [[maybe_unused]] std::array<glm::vec3, 8> vertexBuffer;
   [[maybe_unused]] std::array<glm::uvec3, 12> indexBuffer;
@@ -235,9 +243,6 @@ void MacosApplication::createConstantVulkanResources() AVK_NO_CFI {
   test::cubeColors(colors);
   test::cubePrimitive(vertexBuffer, indexBuffer, faceMap);
 
-  VkBuffer buffer = VK_NULL_HANDLE;
-  VmaAllocation alloc = VK_NULL_HANDLE;
-
   // 1. Allocate vertex and index buffers
   int bufRes = bufferManager()->createBufferGPUOnly(
       hashes::Vertex, sizeof(vertexBuffer), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
@@ -249,50 +254,20 @@ void MacosApplication::createConstantVulkanResources() AVK_NO_CFI {
       true, false);
   if (bufRes) showErrorScreenAndExit("Couldn't Allocate Index Buffer");
 
-  // Discrete GPUs can have DEVICE_LOCAL memory heaps that are not HOST_VISIBLE
-  // hence we'll use some staging buffers
-  if (!bufferManager()->get(hashes::Vertex, buffer, alloc))
-    showErrorScreenAndExit("Couldn't Retrieve Vertex Buffer");
-  // TODO Macro for this. mobile is always true
-  if (vkDevice()->isSoC() || vk::isAllocHostVisible(vmaAllocator(), alloc)) {
-    VK_CHECK(vmaCopyMemoryToAllocation(vmaAllocator(), vertexBuffer.data(),
-                                       alloc, 0, sizeof(vertexBuffer)));
-  }  // if not, copy done on first timeline with staging buffer
-
-  if (!bufferManager()->get(hashes::Index, buffer, alloc))
-    showErrorScreenAndExit("Couldn't Retrieve Index Buffer");
-  if (vkDevice()->isSoC() || vk::isAllocHostVisible(vmaAllocator(), alloc)) {
-    VK_CHECK(vmaCopyMemoryToAllocation(vmaAllocator(), indexBuffer.data(),
-                                       alloc, 0, sizeof(indexBuffer)));
-  }  // if not, copy done on first timeline with staging buffer
+  // contents are uploaded on the first timeline by `m_staging`, which
+  // writes host visible buffers (SoC, ReBAR) in place
 
   // --------------------- index/vertex buffers Skybox ------------------------
-  // 1. Allocate vertex and index buffers
-  bufRes = bufferManager()->createBufferGPUOnly(
-      "SkyboxVertex"_hash, sizeof(vertexBuffer),
-      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, true, false);
-  if (bufRes) showErrorScreenAndExit("Couldn't Allocate Vertex Buffer");
-
-  bufRes = bufferManager()->createBufferGPUOnly(
-      "SkyboxIndex"_hash, sizeof(indexBuffer), VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-      true, false);
-  if (bufRes) showErrorScreenAndExit("Couldn't Allocate Index Buffer");
-
-  // 2. copy if not discrete GPU
-  if (!bufferManager()->get("SkyboxVertex"_hash, buffer, alloc))
-    showErrorScreenAndExit("Couldn't Retrieve Vertex Buffer");
-  // TODO Macro for this. mobile is always true
-  if (vkDevice()->isSoC() || vk::isAllocHostVisible(vmaAllocator(), alloc)) {
-    VK_CHECK(vmaCopyMemoryToAllocation(vmaAllocator(), vertexBuffer.data(),
-                                       alloc, 0, sizeof(vertexBuffer)));
-  }  // if not, copy done on first timeline with staging buffer
-
-  if (!bufferManager()->get("SkyboxIndex"_hash, buffer, alloc))
-    showErrorScreenAndExit("Couldn't Retrieve Index Buffer");
-  if (vkDevice()->isSoC() || vk::isAllocHostVisible(vmaAllocator(), alloc)) {
-    VK_CHECK(vmaCopyMemoryToAllocation(vmaAllocator(), indexBuffer.data(),
-                                       alloc, 0, sizeof(indexBuffer)));
-  }  // if not, copy done on first timeline with staging buffer
+  // 1. Allocate vertex and index ranges, small enough to share a block of the
+  // buffer suballocator
+  m_skyboxVertexRange = bufferSuballocator()->allocate(sizeof(vertexBuffer));
+  if (!m_skyboxVertexRange) {
+    showErrorScreenAndExit("Couldn't Allocate Vertex Buffer");
+  }
+  m_skyboxIndexRange = bufferSuballocator()->allocate(sizeof(indexBuffer));
+  if (!m_skyboxIndexRange) {
+    showErrorScreenAndExit("Couldn't Allocate Index Buffer");
+  }
 
   // ------------------------- shaders and push constant (shared) --------------
   // shaders
@@ -326,7 +301,8 @@ void MacosApplication::createConstantVulkanResources() AVK_NO_CFI {
       desLayoutCreateInfo.pBindings = binding;
 
       VK_CHECK(vkDevTable()->vkCreateDescriptorSetLayout(
-          vkDeviceHandle(), &desLayoutCreateInfo, nullptr,
+          vkDeviceHandle(), &desLayoutCreateInfo,
+          vkDevice()->allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT),
           &m_descriptorSetLayout));
     }
     // shaders
@@ -377,7 +353,10 @@ void MacosApplication::createConstantVulkanResources() AVK_NO_CFI {
       createInfo.descriptorSetLayout = m_descriptorSetLayout;
 
       VK_CHECK(vkDevTable()->vkCreateDescriptorUpdateTemplateKHR(
-          vkDeviceHandle(), &createInfo, nullptr, &m_descriptorUpdateTemplate));
+          vkDeviceHandle(), &createInfo,
+          vkDevice()->allocationCallbacks(
+              VK_OBJECT_TYPE_DESCRIPTOR_UPDATE_TEMPLATE),
+          &m_descriptorUpdateTemplate));
     }
   }
 
@@ -396,7 +375,9 @@ void MacosApplication::createConstantVulkanResources() AVK_NO_CFI {
       createInfo.subresourceRange.baseMipLevel = 0;
       createInfo.subresourceRange.levelCount = 1;
       VK_CHECK(vkDevTable()->vkCreateImageView(
-          vkDeviceHandle(), &createInfo, nullptr, &m_cubeTexInfo.imageView));
+          vkDeviceHandle(), &createInfo,
+          vkDevice()->allocationCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW),
+          &m_cubeTexInfo.imageView));
     }
     // create separate sampler
     {
@@ -409,8 +390,10 @@ void MacosApplication::createConstantVulkanResources() AVK_NO_CFI {
       createInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
       createInfo.minLod = 0.f;
       createInfo.maxLod = m_cubeTexInfo.mipLevels;  // TODO now it's 1
-      VK_CHECK(vkDevTable()->vkCreateSampler(vkDeviceHandle(), &createInfo,
-                                             nullptr, &m_cubeSampler));
+      VK_CHECK(vkDevTable()->vkCreateSampler(
+          vkDeviceHandle(), &createInfo,
+          vkDevice()->allocationCallbacks(VK_OBJECT_TYPE_SAMPLER),
+          &m_cubeSampler));
     }
     // create descriptor set layout
     {
@@ -430,7 +413,8 @@ void MacosApplication::createConstantVulkanResources() AVK_NO_CFI {
       createInfo.bindingCount = 2;
       createInfo.pBindings = binding;
       VK_CHECK(vkDevTable()->vkCreateDescriptorSetLayout(
-          vkDeviceHandle(), &createInfo, nullptr,
+          vkDeviceHandle(), &createInfo,
+          vkDevice()->allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT),
           &m_skyboxDescriptorSetLayout));
     }
     // graphics Info
@@ -480,7 +464,9 @@ void MacosApplication::createConstantVulkanResources() AVK_NO_CFI {
       createInfo.descriptorSetLayout = m_skyboxDescriptorSetLayout;
 
       VK_CHECK(vkDevTable()->vkCreateDescriptorUpdateTemplateKHR(
-          vkDeviceHandle(), &createInfo, nullptr,
+          vkDeviceHandle(), &createInfo,
+          vkDevice()->allocationCallbacks(
+              VK_OBJECT_TYPE_DESCRIPTOR_UPDATE_TEMPLATE),
           &m_skyboxDescriptorUpdateTemplate));
     }
     // create its descriptor set
@@ -497,29 +483,12 @@ void MacosApplication::createConstantVulkanResources() AVK_NO_CFI {
       true, false);
   if (bufRes)
     showErrorScreenAndExit("Couldn't allocate buffer for face mapping");
-  if (!bufferManager()->get(hashes::Cube, buffer, alloc))
-    showErrorScreenAndExit("Couldn't retrieve buffer for face mapping");
-  if (vkDevice()->isSoC() || vk::isAllocHostVisible(vmaAllocator(), alloc)) {
-    CubeFaceMapping hostCubeFaceMapping{faceMap, colors};
-    VK_CHECK(vmaCopyMemoryToAllocation(vmaAllocator(), &hostCubeFaceMapping,
-                                       alloc, 0, sizeof(hostCubeFaceMapping)));
-  }
 
   // - model matrix (TODO: Inline Uniform Buffer)
   bufRes = bufferManager()->createBufferGPUOnly(
       hashes::Model, sizeof(glm::mat4), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
       true, false);
   if (bufRes) showErrorScreenAndExit("Couldn't allocate model matrix UBO");
-  if (!bufferManager()->get(hashes::Model, buffer, alloc))
-    showErrorScreenAndExit("Couldn't retrieve model matrix UBO");
-  if (vkDevice()->isSoC() || vk::isAllocHostVisible(vmaAllocator(), alloc)) {
-    glm::mat4 const cubeModel =
-        glm::translate(glm::mat4(1.f), glm::vec3(0, 1, -1));
-    VK_CHECK(vmaCopyMemoryToAllocation(vmaAllocator(),
-                                       glm::value_ptr(cubeModel), alloc, 0,
-                                       sizeof(glm::mat4)));
-  }
-  // TODO: timeline 0 should always insert a barrier for host transfer?
 }
 
 void MacosApplication::createVulkanResources() AVK_NO_CFI {
@@ -580,8 +549,10 @@ void MacosApplication::createVulkanResources() AVK_NO_CFI {
   for (VkFramebuffer& framebuffer : m_framebuffers) {
     uint32_t const i = index++;
     attachments[0] = vkSwapchain()->imageViewAt(i);
-    VK_CHECK(
-        vkDevApi->vkCreateFramebuffer(dev, &createInfo, nullptr, &framebuffer));
+    VK_CHECK(vkDevApi->vkCreateFramebuffer(
+        dev, &createInfo,
+        vkDevice()->allocationCallbacks(VK_OBJECT_TYPE_FRAMEBUFFER),
+        &framebuffer));
   }
 
   // bookkeeping for command buffers: 1 ID per Frame in Flight
@@ -687,8 +658,6 @@ VkResult MacosApplication::RTdoOnRender(
 
   // if first timeline, stage all resources to GPU local memory
   using namespace avk::literals;
-  static uint64_t constexpr StagingVert = "StagingVert"_hash;
-  static uint64_t constexpr StagingIndex = "StagingIndex"_hash;
 
   if (timeline() == 0) {
     // TODO not duplicate
@@ -705,7 +674,7 @@ VkResult MacosApplication::RTdoOnRender(
          << std::endl;
     // prepare staging manager with our main vulkan handles
     m_staging.refresh(cmd, bufferManager(), vkDevice(), vkDiscardPool(),
-                      timeline());
+                      timeline() + 1);
 
     // ----------------- vertex/index main ----------------------------------
     {
@@ -716,38 +685,25 @@ VkResult MacosApplication::RTdoOnRender(
       bufferManager()->get(hashes::Vertex, vertBuf, vertAlloc);
       assert(vertBuf && indexBuf);
 
-      if (!vkDevice()->isSoC() &&
-          !vk::isAllocHostVisible(vmaAllocator(), vertAlloc)) {
-        m_staging.enqueue({vertBuf, vertAlloc, vertexBuffer.data(),
-                           sizeof(vertexBuffer), StagingVert,
-                           VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-                           VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT});
-      }
-      if (!vkDevice()->isSoC() &&
-          !vk::isAllocHostVisible(vmaAllocator(), indexAlloc)) {
-        m_staging.enqueue({indexBuf, indexAlloc, indexBuffer.data(),
-                           sizeof(indexBuffer), StagingIndex,
-                           VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-                           VK_ACCESS_INDEX_READ_BIT});
-      }
+      m_staging.enqueue({vertBuf, vertAlloc, vertexBuffer.data(),
+                         sizeof(vertexBuffer),
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                         VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT});
+      m_staging.enqueue({indexBuf, indexAlloc, indexBuffer.data(),
+                         sizeof(indexBuffer),
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                         VK_ACCESS_INDEX_READ_BIT});
       // ----------------- vertex/index skybox --------------------------------
-      bufferManager()->get("SkyboxIndex"_hash, indexBuf, indexAlloc);
-      bufferManager()->get("SkyboxVertex"_hash, vertBuf, vertAlloc);
-      assert(vertBuf && indexBuf);
-      if (!vkDevice()->isSoC() &&
-          !vk::isAllocHostVisible(vmaAllocator(), vertAlloc)) {
-        m_staging.enqueue({vertBuf, vertAlloc, vertexBuffer.data(),
-                           sizeof(vertexBuffer), "SkyboxStagingVert"_hash,
-                           VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-                           VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT});
-      }
-      if (!vkDevice()->isSoC() &&
-          !vk::isAllocHostVisible(vmaAllocator(), indexAlloc)) {
-        m_staging.enqueue({indexBuf, indexAlloc, indexBuffer.data(),
-                           sizeof(indexBuffer), "SkyboxStagingIndex"_hash,
-                           VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-                           VK_ACCESS_INDEX_READ_BIT});
-      }
+      // ranges of a suballocator block, always staged
+      m_staging.enqueue({m_skyboxVertexRange.buffer, VK_NULL_HANDLE,
+                         vertexBuffer.data(), sizeof(vertexBuffer),
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                         VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+                         m_skyboxVertexRange.offset});
+      m_staging.enqueue({m_skyboxIndexRange.buffer, VK_NULL_HANDLE,
+                         indexBuffer.data(), sizeof(indexBuffer),
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                         VK_ACCESS_INDEX_READ_BIT, m_skyboxIndexRange.offset});
     }
     // --------------------- The rest ---------------------------------------
     // setup GPU only buffer for "cube" uniform buffer
@@ -756,14 +712,11 @@ VkResult MacosApplication::RTdoOnRender(
       VmaAllocation alloc = VK_NULL_HANDLE;
       bufferManager()->get(hashes::Cube, buffer, alloc);
       assert(buffer);
-      if (!vkDevice()->isSoC() &&
-          !vk::isAllocHostVisible(vmaAllocator(), alloc)) {
-        // allocate staging buffer and copy stuff there, then discard staging
-        m_staging.enqueue({buffer, alloc, &hostCubeFaceMapping,
-                           sizeof(hostCubeFaceMapping), "StagingCube"_hash,
-                           VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                           VK_ACCESS_UNIFORM_READ_BIT});
-      }
+      // through the staging ring, or in place if host visible
+      m_staging.enqueue({buffer, alloc, &hostCubeFaceMapping,
+                         sizeof(hostCubeFaceMapping),
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         VK_ACCESS_UNIFORM_READ_BIT});
     }
 
     // setup GPU only buffer for "model" uniform buffer
@@ -772,14 +725,11 @@ VkResult MacosApplication::RTdoOnRender(
       VmaAllocation alloc = VK_NULL_HANDLE;
       bufferManager()->get(hashes::Model, buffer, alloc);
       assert(buffer);
-      if (!vkDevice()->isSoC() &&
-          !vk::isAllocHostVisible(vmaAllocator(), alloc)) {
-        // create a staging buffer for the transfer, then discard it
-        m_staging.enqueue({buffer, alloc, glm::value_ptr(cubeModel),
-                           sizeof(cubeModel), "StagingModel"_hash,
-                           VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
-                           VK_ACCESS_UNIFORM_READ_BIT});
-      }
+      // through the staging ring, or in place if host visible
+      m_staging.enqueue({buffer, alloc, glm::value_ptr(cubeModel),
+                         sizeof(cubeModel),
+                         VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                         VK_ACCESS_UNIFORM_READ_BIT});
     }
 
     // now update the descriptors with the template
@@ -824,7 +774,22 @@ VkResult MacosApplication::RTdoOnRender(
     }
 
     // after everything staged, insert necessary pipeline barrier
-    m_staging.flush();
+    // host data is local to this block, hence the flush can't be retried
+    if (!m_staging.flush()) {
+      showErrorScreenAndExit("Couldn't flush first timeline staging");
+    }
+  }
+
+  // streamed uploads of this frame, within the scheduler budget, large ones
+  // on the transfer queue. A failed flush would carry them to a later
+  // submission than `poll` reports
+  m_staging.refresh(cmd, bufferManager(), vkDevice(), vkDiscardPool(),
+                    timeline() + 1);
+  VkPipelineStageFlags uploadWaitStages = 0;
+  uint64_t const uploadWaitValue =
+      RTrecordScheduledUploads(cmd, m_staging, uploadWaitStages);
+  if (!m_staging.flush()) {
+    showErrorScreenAndExit("Couldn't flush scheduled uploads");
   }
 
   // begin render pass (transition to optimal layout)
@@ -845,6 +810,7 @@ VkResult MacosApplication::RTdoOnRender(
   // bind pipeline and vertex buffer
   vkDevApi->vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
                               m_graphicsPipeline);
+  vkPipelines()->cmdSetDynamicOpts(cmd, m_graphicsInfo);
   // bind vertex and index buffer
   VkDeviceSize offset = 0;
 
@@ -884,16 +850,17 @@ VkResult MacosApplication::RTdoOnRender(
 
   // ------------------- The skybox ---------------------------------------
   // same viewport, scissor
-  bufferManager()->get("SkyboxVertex"_hash, vertBuf, vertAlloc);
-  bufferManager()->get("SkyboxIndex"_hash, indexBuf, indexAlloc);
-  assert(vertBuf && indexBuf);
-  vkDevApi->vkCmdBindVertexBuffers(cmd, 0, 1, &vertBuf, &offset);
-  vkDevApi->vkCmdBindIndexBuffer(cmd, indexBuf, 0, VK_INDEX_TYPE_UINT32);
+  vkDevApi->vkCmdBindVertexBuffers(cmd, 0, 1, &m_skyboxVertexRange.buffer,
+                                   &m_skyboxVertexRange.offset);
+  vkDevApi->vkCmdBindIndexBuffer(cmd, m_skyboxIndexRange.buffer,
+                                 m_skyboxIndexRange.offset,
+                                 VK_INDEX_TYPE_UINT32);
   vkDevApi->vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
                                     m_skyboxGraphicsInfo.pipelineLayout, 0, 1,
                                     &m_skyboxDescriptorSet, 0, nullptr);
   vkDevApi->vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
                               m_skyboxPipeline);
+  vkPipelines()->cmdSetDynamicOpts(cmd, m_skyboxGraphicsInfo);
   // remove camera position from view matrix (skybox follows you)
   pushConst.view[3] = glm::vec4(0, 0, 0, pushConst.view[3].w);
   vkDevApi->vkCmdPushConstants(cmd, m_skyboxGraphicsInfo.pipelineLayout,
@@ -906,31 +873,26 @@ VkResult MacosApplication::RTdoOnRender(
   subEnd.sType = VK_STRUCTURE_TYPE_SUBPASS_END_INFO_KHR;
   vkDevApi->vkCmdEndRenderPass2KHR(cmd, &subEnd);
   VK_CHECK(vkDevApi->vkEndCommandBuffer(cmd));
-  // queue submit command buffer
-  VkSemaphore submitSignalSems[2]{swapchainData.presentSemaphore,
-                                  vkDiscardPool()->timelineSemaphore()};
-  uint64_t values[2]{0, timeline() + 1};
-  VkTimelineSemaphoreSubmitInfoKHR timelineSubmit{};
-  timelineSubmit.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
-  timelineSubmit.signalSemaphoreValueCount = 2;
-  timelineSubmit.pSignalSemaphoreValues = values;
-
-  VkPipelineStageFlags waitPresentationStage =
-      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-
-  VkSubmitInfo submitInfo{};
-  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  submitInfo.pNext = &timelineSubmit;
-  submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = &cmd;
-  submitInfo.signalSemaphoreCount = 2;
-  submitInfo.pSignalSemaphores = submitSignalSems;
-  submitInfo.waitSemaphoreCount = 1;
-  submitInfo.pWaitSemaphores = &swapchainData.acquireSemaphore;
-  // same as wait semaphores
-  submitInfo.pWaitDstStageMask = &waitPresentationStage;
-  return vkDevApi->vkQueueSubmit(vkDevice()->queue(), 1, &submitInfo,
-                                 swapchainData.submissionFence);
+  // queue submit command buffer, signaling `timeline() + 1` on the discard
+  // pool timeline, after the compute submissions of the frame (if any)
+  using EQueue = experimental::CrossQueueSubmitter::EQueue;
+  experimental::CrossQueueSubmitter* const submitter = crossQueueSubmitter();
+  assert(submitter->nextValue(EQueue::eGraphics) == timeline() + 1);
+  // compute output may be consumed from the first draw (indirect arguments,
+  // vertex data) or dispatch, later stages are ordered after those
+  submitter->waitFor(EQueue::eGraphics, EQueue::eCompute,
+                     VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+  submitter->addWait(EQueue::eGraphics, swapchainData.acquireSemaphore, 0,
+                     VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+  // transfer queue uploads acquired by this command buffer
+  if (uploadWaitValue != 0) {
+    submitter->addWait(EQueue::eGraphics, uploadContext()->semaphore(),
+                       uploadWaitValue, uploadWaitStages);
+  }
+  submitter->addSignal(EQueue::eGraphics, swapchainData.presentSemaphore);
+  return submitter->submit(EQueue::eGraphics, &cmd, 1,
+                           swapchainData.submissionFence);
 }
 
 void MacosApplication::RTdoOnResize() {
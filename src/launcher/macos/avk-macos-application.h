@@ -55,6 +55,9 @@ class MacosApplication : public ApplicationBase {
 
   std::vector<VkFramebuffer> m_framebuffers;
   std::vector<uint64_t> m_commandBufferIds;
+  // skybox vertex/index data, in ranges of the buffer suballocator
+  experimental::BufferSuballocator::Range m_skyboxVertexRange{};
+  experimental::BufferSuballocator::Range m_skyboxIndexRange{};
 
   // TODO move to base if works well
   experimental::StagingTransientManager m_staging;
@@ -176,8 +176,6 @@ void WindowsApplication::createConstantVulkanResources() AVK_NO_CFI {
     m_RTcamera.proj[1][1] *= -1;
   }
 
-  // TODO: move first copy for SoC to timeline 0
-
   // --------------------- index/vertex buffers Main --------------------------
   [[maybe_unused]] std::array<glm::vec3, 8> vertexBuffer;
   [[maybe_unused]] std::array<glm::uvec3, 12> indexBuffer;
@@ -186,64 +184,35 @@ void WindowsApplication::createConstantVulkanResources() AVK_NO_CFI {
   test::cubeColors(colors);
   test::cubePrimitive(vertexBuffer, indexBuffer, faceMap);
 
-  VkBuffer buffer = VK_NULL_HANDLE;
-  VmaAllocation alloc = VK_NULL_HANDLE;
-
   // 1. Allocate vertex and index buffers
   int bufRes = bufferManager()->createBufferGPUOnly(
       hashes::Vertex, sizeof(vertexBuffer), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-      true, false);
+      true, false, &m_vertexBuffer);
   if (bufRes) showErrorScreenAndExit("Couldn't Allocate Vertex Buffer");
 
   bufRes = bufferManager()->createBufferGPUOnly(
       hashes::Index, sizeof(indexBuffer), VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-      true, false);
+      true, false, &m_indexBuffer);
   if (bufRes) showErrorScreenAndExit("Couldn't Allocate Index Buffer");
 
-  // Discrete GPUs can have DEVICE_LOCAL memory heaps that are not HOST_VISIBLE
-  // hence we'll use some staging buffers
-  if (!bufferManager()->get(hashes::Vertex, buffer, alloc))
-    showErrorScreenAndExit("Couldn't Retrieve Vertex Buffer");
-  // TODO Macro for this. mobile is always true
-  if (vkDevice()->isSoC() || vk::isAllocHostVisible(vmaAllocator(), alloc)) {
-    VK_CHECK(vmaCopyMemoryToAllocation(vmaAllocator(), vertexBuffer.data(),
-                                       alloc, 0, sizeof(vertexBuffer)));
-  }  // if not, copy done on first timeline with staging buffer
-
-  if (!bufferManager()->get(hashes::Index, buffer, alloc))
-    showErrorScreenAndExit("Couldn't Retrieve Index Buffer");
-  if (vkDevice()->isSoC() || vk::isAllocHostVisible(vmaAllocator(), alloc)) {
-    VK_CHECK(vmaCopyMemoryToAllocation(vmaAllocator(), indexBuffer.data(),
-                                       alloc, 0, sizeof(indexBuffer)));
-  }  // if not, copy done on first timeline with staging buffer
+  // contents are uploaded on the first timeline by `m_staging`, which
+  // writes host visible buffers (SoC, ReBAR) in place
 
   // --------------------- index/vertex buffers Skybox ------------------------
-  // 1. Allocate vertex and index buffers
-  bufRes = bufferManager()->createBufferGPUOnly(
-      "SkyboxVertex"_hash, sizeof(vertexBuffer),
-      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, true, false);
-  if (bufRes) showErrorScreenAndExit("Couldn't Allocate Vertex Buffer");
-
-  bufRes = bufferManager()->createBufferGPUOnly(
-      "SkyboxIndex"_hash, sizeof(indexBuffer), VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-      true, false);
-  if (bufRes) showErrorScreenAndExit("Couldn't Allocate Index Buffer");
+  // 1. Allocate vertex and index ranges, small enough to share a block of the
+  // buffer suballocator
+  m_skyboxVertexRange = bufferSuballocator()->allocate(sizeof(vertexBuffer));
+  if (!m_skyboxVertexRange) {
+    showErrorScreenAndExit("Couldn't Allocate Vertex Buffer");
+  }
+  m_skyboxIndexRange = bufferSuballocator()->allocate(sizeof(indexBuffer));
+  if (!m_skyboxIndexRange) {
+    showErrorScreenAndExit("Couldn't Allocate Index Buffer");
+  }
 
-  // 2. copy if not discrete GPU
-  if (!bufferManager()->get("SkyboxVertex"_hash, buffer, alloc))
-    showErrorScreenAndExit("Couldn't Retrieve Vertex Buffer");
-  // TODO Macro for this. mobile is always true
-  if (vkDevice()->isSoC() || vk::isAllocHostVisible(vmaAllocator(), alloc)) {
-    VK_CHECK(vmaCopyMemoryToAllocation(vmaAllocator(), vertexBuffer.data(),
-                                       alloc, 0, sizeof(vertexBuffer)));
-  }  // if not, copy done on first timeline with staging buffer
-
-  if (!bufferManager()->get("SkyboxIndex"_hash, buffer, alloc))
-    showErrorScreenAndExit("Couldn't Retrieve Index Buffer");
-  if (vkDevice()->isSoC() || vk::isAllocHostVisible(vmaAllocator(), alloc)) {
-    VK_CHECK(vmaCopyMemoryToAllocation(vmaAllocator(), indexBuffer.data(),
-                                       alloc, 0, sizeof(indexBuffer)));
-  }  // if not, copy done on first timeline with staging buffer
+  // vertex and index buffers are looked up each frame, hence can be moved
+  bufferManager()->setMovable(m_vertexBuffer, true);
+  bufferManager()->setMovable(m_indexBuffer, true);
 
   // ------------------------- shaders and push constant (shared) --------------
   // shaders
@@ -279,7 +248,8 @@ void WindowsApplication::createConstantVulkanResources() AVK_NO_CFI {
       desLayoutCreateInfo.pBindings = binding;
 
       VK_CHECK(vkDevTable()->vkCreateDescriptorSetLayout(
-          vkDeviceHandle(), &desLayoutCreateInfo, nullptr,
+          vkDeviceHandle(), &desLayoutCreateInfo,
+          vkDevice()->allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT),
           &m_descriptorSetLayout));
     }
     // shaders
@@ -296,6 +266,15 @@ void WindowsApplication::createConstantVulkanResources() AVK_NO_CFI {
                                  &pushConstantRange, 1),
         modules, depthFmt, experimental::StencilEqualityMode::eReplacing,
         false);
+    if (vkShaderObjects()) {
+      vkShaderObjects()->registerShaderModule(modules[0], vertCode.data(),
+                                              vertCode.size() << 2);
+      vkShaderObjects()->registerShaderModule(modules[1], fragCode.data(),
+                                              fragCode.size() << 2);
+      vkShaderObjects()->registerPipelineLayout(m_graphicsInfo.pipelineLayout,
+                                                &m_descriptorSetLayout, 1,
+                                                &pushConstantRange, 1);
+    }
 
     // allocate the descriptor set and its update template
     m_cubeDescriptorSet = vkDescriptorPools()->allocate(
@@ -327,7 +306,10 @@ void WindowsApplication::createConstantVulkanResources() AVK_NO_CFI {
       createInfo.descriptorSetLayout = m_descriptorSetLayout;
 
       VK_CHECK(vkDevTable()->vkCreateDescriptorUpdateTemplateKHR(
-          vkDeviceHandle(), &createInfo, nullptr, &m_descriptorUpdateTemplate));
+          vkDeviceHandle(), &createInfo,
+          vkDevice()->allocationCallbacks(
+              VK_OBJECT_TYPE_DESCRIPTOR_UPDATE_TEMPLATE),
+          &m_descriptorUpdateTemplate));
     }
   }
 
@@ -346,7 +328,9 @@ void WindowsApplication::createConstantVulkanResources() AVK_NO_CFI {
       createInfo.subresourceRange.baseMipLevel = 0;
       createInfo.subresourceRange.levelCount = 1;
       VK_CHECK(vkDevTable()->vkCreateImageView(
-          vkDeviceHandle(), &createInfo, nullptr, &m_cubeTexInfo.imageView));
+          vkDeviceHandle(), &createInfo,
+          vkDevice()->allocationCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW),
+          &m_cubeTexInfo.imageView));
     }
     // create separate sampler
     {
@@ -359,8 +343,10 @@ void WindowsApplication::createConstantVulkanResources() AVK_NO_CFI {
       createInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
       createInfo.minLod = 0.f;
       createInfo.maxLod = m_cubeTexInfo.mipLevels;  // TODO now it's 1
-      VK_CHECK(vkDevTable()->vkCreateSampler(vkDeviceHandle(), &createInfo,
-                                             nullptr, &m_cubeSampler));
+      VK_CHECK(vkDevTable()->vkCreateSampler(
+          vkDeviceHandle(), &createInfo,
+          vkDevice()->allocationCallbacks(VK_OBJECT_TYPE_SAMPLER),
+          &m_cubeSampler));
     }
     // create descriptor set layout
     {
@@ -380,7 +366,8 @@ void WindowsApplication::createConstantVulkanResources() AVK_NO_CFI {
       createInfo.bindingCount = 2;
       createInfo.pBindings = binding;
       VK_CHECK(vkDevTable()->vkCreateDescriptorSetLayout(
-          vkDeviceHandle(), &createInfo, nullptr,
+          vkDeviceHandle(), &createInfo,
+          vkDevice()->allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT),
           &m_skyboxDescriptorSetLayout));
     }
     // graphics Info
@@ -401,6 +388,17 @@ void WindowsApplication::createConstantVulkanResources() AVK_NO_CFI {
                                    &pushConstantRange, 1),
           skyboxModules, depthFmt,
           experimental::StencilEqualityMode::eZeroExpected, true);
+      if (vkShaderObjects()) {
+        vkShaderObjects()->registerShaderModule(
+            skyboxModules[0], skyboxVertCode.data(),
+            skyboxVertCode.size() << 2);
+        vkShaderObjects()->registerShaderModule(
+            skyboxModules[1], skyboxFragCode.data(),
+            skyboxFragCode.size() << 2);
+        vkShaderObjects()->registerPipelineLayout(
+            m_skyboxGraphicsInfo.pipelineLayout, &m_skyboxDescriptorSetLayout,
+            1, &pushConstantRange, 1);
+      }
     }
     // descriptor update template for skybox (1 image, 1 sampler)
     {
@@ -429,7 +427,9 @@ void WindowsApplication::createConstantVulkanResources() AVK_NO_CFI {
       createInfo.descriptorSetLayout = m_skyboxDescriptorSetLayout;
 
       VK_CHECK(vkDevTable()->vkCreateDescriptorUpdateTemplateKHR(
-          vkDeviceHandle(), &createInfo, nullptr,
+          vkDeviceHandle(), &createInfo,
+          vkDevice()->allocationCallbacks(
+              VK_OBJECT_TYPE_DESCRIPTOR_UPDATE_TEMPLATE),
           &m_skyboxDescriptorUpdateTemplate));
     }
     // create its descriptor set
@@ -446,76 +446,87 @@ void WindowsApplication::createConstantVulkanResources() AVK_NO_CFI {
       true, false);
   if (bufRes)
     showErrorScreenAndExit("Couldn't allocate buffer for face mapping");
-  if (!bufferManager()->get(hashes::Cube, buffer, alloc))
-    showErrorScreenAndExit("Couldn't retrieve buffer for face mapping");
-  if (vkDevice()->isSoC() || vk::isAllocHostVisible(vmaAllocator(), alloc)) {
-    CubeFaceMapping hostCubeFaceMapping{faceMap, colors};
-    VK_CHECK(vmaCopyMemoryToAllocation(vmaAllocator(), &hostCubeFaceMapping,
-                                       alloc, 0, sizeof(hostCubeFaceMapping)));
-  }
 
   // - model matrix (TODO: Inline Uniform Buffer)
   bufRes = bufferManager()->createBufferGPUOnly(
       hashes::Model, sizeof(glm::mat4), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
       true, false);
   if (bufRes) showErrorScreenAndExit("Couldn't allocate model matrix UBO");
-  if (!bufferManager()->get(hashes::Model, buffer, alloc))
-    showErrorScreenAndExit("Couldn't retrieve model matrix UBO");
-  if (vkDevice()->isSoC() || vk::isAllocHostVisible(vmaAllocator(), alloc)) {
-    glm::mat4 const cubeModel =
-        glm::translate(glm::mat4(1.f), glm::vec3(0, 1, -1));
-    VK_CHECK(vmaCopyMemoryToAllocation(vmaAllocator(),
-                                       glm::value_ptr(cubeModel), alloc, 0,
-                                       sizeof(glm::mat4)));
-  }
-  // TODO: timeline 0 should always insert a barrier for host transfer?
 }
 
 void WindowsApplication::destroyConstantVulkanResources() AVK_NO_CFI {
   // template and layout
   if (m_descriptorUpdateTemplate != VK_NULL_HANDLE) {
     vkDevTable()->vkDestroyDescriptorUpdateTemplateKHR(
-        vkDeviceHandle(), m_descriptorUpdateTemplate, nullptr);
+        vkDeviceHandle(), m_descriptorUpdateTemplate,
+        vkDevice()->allocationCallbacks(
+            VK_OBJECT_TYPE_DESCRIPTOR_UPDATE_TEMPLATE));
     m_descriptorUpdateTemplate = VK_NULL_HANDLE;
   }
   if (m_skyboxDescriptorUpdateTemplate != VK_NULL_HANDLE) {
     vkDevTable()->vkDestroyDescriptorUpdateTemplateKHR(
-        vkDeviceHandle(), m_skyboxDescriptorUpdateTemplate, nullptr);
+        vkDeviceHandle(), m_skyboxDescriptorUpdateTemplate,
+        vkDevice()->allocationCallbacks(
+            VK_OBJECT_TYPE_DESCRIPTOR_UPDATE_TEMPLATE));
     m_skyboxDescriptorUpdateTemplate = VK_NULL_HANDLE;
   }
 
   // skybox related resources
   if (m_cubeSampler != VK_NULL_HANDLE) {
-    vkDevTable()->vkDestroySampler(vkDeviceHandle(), m_cubeSampler, nullptr);
+    vkDevTable()->vkDestroySampler(
+        vkDeviceHandle(), m_cubeSampler,
+        vkDevice()->allocationCallbacks(VK_OBJECT_TYPE_SAMPLER));
     m_cubeSampler = VK_NULL_HANDLE;
   }
+  // shader objects, if any, are discarded together with the pipelines
+  if (vkShaderObjects()) {
+    for (vk::GraphicsInfo const* info :
+         {&m_skyboxGraphicsInfo, &m_graphicsInfo}) {
+      vkShaderObjects()->discardAllShaders(vkDiscardPool(),
+                                           info->pipelineLayout, timeline());
+      vkShaderObjects()->unregisterShaderModule(
+          info->preRasterization.vertexModule);
+      vkShaderObjects()->unregisterShaderModule(
+          info->fragmentShader.fragmentModule);
+    }
+  }
+  // pipelines outlive swapchain recreation on dynamic rendering
+  vkPipelines()->discardAllPipelines(
+      vkDiscardPool(), m_skyboxGraphicsInfo.pipelineLayout, timeline());
+  m_skyboxPipeline = VK_NULL_HANDLE;
   experimental::discardGraphicsInfo(vkDiscardPool(), timeline(),
                                     m_skyboxGraphicsInfo);
 
   // graphics info handles
+  vkPipelines()->discardAllPipelines(vkDiscardPool(),
+                                     m_graphicsInfo.pipelineLayout, timeline());
+  m_graphicsPipeline = VK_NULL_HANDLE;
   experimental::discardGraphicsInfo(vkDiscardPool(), timeline(),
                                     m_graphicsInfo);
   // index/vertex buffers + uniform buffers
   using namespace avk::literals;
-  bufferManager()->discardById(vkDiscardPool(), "SkyboxVertex"_hash,
-                               timeline());
-  bufferManager()->discardById(vkDiscardPool(), "SkyboxIndex"_hash,
-                               timeline());
+  bufferSuballocator()->free(m_skyboxVertexRange, timeline());
+  bufferSuballocator()->free(m_skyboxIndexRange, timeline());
+  m_skyboxVertexRange = {};
+  m_skyboxIndexRange = {};
   bufferManager()->discardById(vkDiscardPool(), hashes::Cube, timeline());
   bufferManager()->discardById(vkDiscardPool(), hashes::Model, timeline());
   bufferManager()->discardById(vkDiscardPool(), hashes::Vertex, timeline());
   bufferManager()->discardById(vkDiscardPool(), hashes::Index, timeline());
+  m_staging.discardRing(bufferManager(), vkDiscardPool(), timeline());
 
   // set layout only after pipeline layout (hopefully we don't need a discard)
   vkDiscardPool()->destroyDiscardedResources();
   if (m_descriptorSetLayout != VK_NULL_HANDLE) {
-    vkDevTable()->vkDestroyDescriptorSetLayout(vkDeviceHandle(),
-                                               m_descriptorSetLayout, nullptr);
+    vkDevTable()->vkDestroyDescriptorSetLayout(
+        vkDeviceHandle(), m_descriptorSetLayout,
+        vkDevice()->allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT));
     m_descriptorSetLayout = VK_NULL_HANDLE;
   }
   if (m_skyboxDescriptorSetLayout != VK_NULL_HANDLE) {
     vkDevTable()->vkDestroyDescriptorSetLayout(
-        vkDeviceHandle(), m_skyboxDescriptorSetLayout, nullptr);
+        vkDeviceHandle(), m_skyboxDescriptorSetLayout,
+        vkDevice()->allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT));
     m_skyboxDescriptorSetLayout = VK_NULL_HANDLE;
   }
   // discard KTX texture
@@ -529,27 +540,32 @@ void WindowsApplication::destroyConstantVulkanResources() AVK_NO_CFI {
 
 void WindowsApplication::cleanupVulkanResources() AVK_NO_CFI {
   using namespace avk::literals;
-  // render pass (common on both pipelines, same subpass)
-  vkDiscardPool()->discardRenderPass(m_graphicsInfo.renderPass, timeline());
-  m_graphicsInfo.renderPass = VK_NULL_HANDLE;
-  m_skyboxGraphicsInfo.renderPass = VK_NULL_HANDLE;
-  // graphics pipelines
-  // -- main pipeline
-  vkPipelines()->discardAllPipelines(vkDiscardPool(),
-                                     m_graphicsInfo.pipelineLayout, timeline());
-  m_graphicsPipeline = VK_NULL_HANDLE;
-  // -- skybox pipeline
-  vkPipelines()->discardAllPipelines(
-      vkDiscardPool(), m_skyboxGraphicsInfo.pipelineLayout, timeline());
-  m_skyboxPipeline = VK_NULL_HANDLE;
+  // with dynamic rendering, pipelines are keyed by attachment formats only,
+  // hence they survive swapchain recreation (discarded with constant resources)
+  if (m_graphicsInfo.renderPass != VK_NULL_HANDLE) {
+    // render pass (common on both pipelines, same subpass)
+    vkDiscardPool()->discardRenderPass(m_graphicsInfo.renderPass, timeline());
+    m_graphicsInfo.renderPass = VK_NULL_HANDLE;
+    m_skyboxGraphicsInfo.renderPass = VK_NULL_HANDLE;
+    // graphics pipelines
+    // -- main pipeline
+    vkPipelines()->discardAllPipelines(
+        vkDiscardPool(), m_graphicsInfo.pipelineLayout, timeline());
+    m_graphicsPipeline = VK_NULL_HANDLE;
+    // -- skybox pipeline
+    vkPipelines()->discardAllPipelines(
+        vkDiscardPool(), m_skyboxGraphicsInfo.pipelineLayout, timeline());
+    m_skyboxPipeline = VK_NULL_HANDLE;
+  }
   // depth image
   vkDiscardPool()->discardImageView(m_depthView, timeline());
   m_depthView = VK_NULL_HANDLE;
   imageManager()->discardById(vkDiscardPool(), "depth"_hash, timeline());
-  // framebuffer
+  // framebuffer (none with dynamic rendering)
   for (const VkFramebuffer framebuffer : m_framebuffers) {
     vkDiscardPool()->discardFramebuffer(framebuffer, timeline());
   }
+  m_framebuffers.clear();
   // command buffer bookkeeping
   m_commandBufferIds.clear();
 }
@@ -563,22 +579,36 @@ void WindowsApplication::createVulkanResources() AVK_NO_CFI {
     m_pushCameras.resize(vkSwapchain()->frameCount());
   }
   assert(vkSwapchain()->frameCount() <= m_pushCameras.size());
-  // renderPass
+  // renderPass (or attachment formats only, with dynamic rendering)
   VkFormat const depthFmt =
       vk::basicDepthStencilFormat(vkPhysicalDeviceHandle());
-  m_graphicsInfo.renderPass =
-      vk::basicRenderPass(vkDevice(), vkSwapchain()->surfaceFormat().format,
-                          depthFmt)
-          .get();
-  m_skyboxGraphicsInfo.renderPass = m_graphicsInfo.renderPass;
-  // graphics pipelines (main and skybox)
+  if (vkDevice()->dynamicRendering()) {
+    m_graphicsInfo.fragmentOut.colorAttachmentCount = 1;
+    m_graphicsInfo.fragmentOut.colorAttachmentFormats.assign(
+        1, vkSwapchain()->surfaceFormat().format);
+    m_skyboxGraphicsInfo.fragmentOut = m_graphicsInfo.fragmentOut;
+  } else {
+    m_graphicsInfo.renderPass =
+        vk::basicRenderPass(vkDevice(), vkSwapchain()->surfaceFormat().format,
+                            depthFmt)
+            .get();
+    m_skyboxGraphicsInfo.renderPass = m_graphicsInfo.renderPass;
+  }
+  // graphics pipelines (main and skybox), or shader objects if supported
   // TODO study about pipeline derivatives and pipeline cache
-  // -- main pipeline
-  m_graphicsPipeline = vkPipelines()->getOrCreateGraphicsPipeline(
-      m_graphicsInfo, true, VK_NULL_HANDLE);
-  // -- skybox pipeline
-  m_skyboxPipeline = vkPipelines()->getOrCreateGraphicsPipeline(
-      m_skyboxGraphicsInfo, true, VK_NULL_HANDLE);
+  if (vkShaderObjects()) {
+    vkShaderObjects()->getOrCreateGraphicsShaders(m_graphicsInfo,
+                                                  m_graphicsShaders);
+    vkShaderObjects()->getOrCreateGraphicsShaders(m_skyboxGraphicsInfo,
+                                                  m_skyboxShaders);
+  } else {
+    // -- main pipeline
+    m_graphicsPipeline = vkPipelines()->getOrCreateGraphicsPipeline(
+        m_graphicsInfo, true, VK_NULL_HANDLE);
+    // -- skybox pipeline
+    m_skyboxPipeline = vkPipelines()->getOrCreateGraphicsPipeline(
+        m_skyboxGraphicsInfo, true, VK_NULL_HANDLE);
+  }
   // depth image
   int32_t res = imageManager()->createTransientAttachment(
       "depth"_hash, vkSwapchain()->extent(), depthFmt,
@@ -596,24 +626,28 @@ void WindowsApplication::createVulkanResources() AVK_NO_CFI {
                     vkDevice(), depthImage,
                     vk::basicDepthStencilFormat(vkPhysicalDeviceHandle()))
                     .get();
-  // framebuffers
-  m_framebuffers.resize(vkSwapchain()->imageCount());
-  VkFramebufferCreateInfo createInfo{};
-  createInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-  createInfo.renderPass = m_graphicsInfo.renderPass;
-  createInfo.attachmentCount = 2;
-  createInfo.width = vkSwapchain()->extent().width;
-  createInfo.height = vkSwapchain()->extent().height;
-  createInfo.layers = 1;
-  VkImageView attachments[2]{};
-  createInfo.pAttachments = attachments;
-  attachments[1] = m_depthView;
-  uint32_t index = 0;
-  for (VkFramebuffer& framebuffer : m_framebuffers) {
-    uint32_t const i = index++;
-    attachments[0] = vkSwapchain()->imageViewAt(i);
-    VK_CHECK(
-        vkDevApi->vkCreateFramebuffer(dev, &createInfo, nullptr, &framebuffer));
+  // framebuffers (render pass only)
+  if (m_graphicsInfo.renderPass != VK_NULL_HANDLE) {
+    m_framebuffers.resize(vkSwapchain()->imageCount());
+    VkFramebufferCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    createInfo.renderPass = m_graphicsInfo.renderPass;
+    createInfo.attachmentCount = 2;
+    createInfo.width = vkSwapchain()->extent().width;
+    createInfo.height = vkSwapchain()->extent().height;
+    createInfo.layers = 1;
+    VkImageView attachments[2]{};
+    createInfo.pAttachments = attachments;
+    attachments[1] = m_depthView;
+    uint32_t index = 0;
+    for (VkFramebuffer& framebuffer : m_framebuffers) {
+      uint32_t const i = index++;
+      attachments[0] = vkSwapchain()->imageViewAt(i);
+      VK_CHECK(vkDevApi->vkCreateFramebuffer(
+          dev, &createInfo,
+          vkDevice()->allocationCallbacks(VK_OBJECT_TYPE_FRAMEBUFFER),
+          &framebuffer));
+    }
   }
 
   // bookkeeping for command buffers: 1 ID per Frame in Flight
@@ -665,10 +699,11 @@ VkResult WindowsApplication::RTdoOnRender(
   beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
   VK_CHECK(vkDevApi->vkBeginCommandBuffer(cmd, &beginInfo));
 
+  // incremental defragmentation copies, before anything uses the buffers
+  defragmentation()->recordFrame(cmd, timeline() + 1);
+
   // if first timeline, stage all resources to GPU local memory
   using namespace avk::literals;
-  static uint64_t constexpr StagingVert = "StagingVert"_hash;
-  static uint64_t constexpr StagingIndex = "StagingIndex"_hash;
 
   if (timeline() == 0) {
     // TODO not duplicate
@@ -685,7 +720,7 @@ VkResult WindowsApplication::RTdoOnRender(
          << std::endl;
     // prepare staging manager with our main vulkan handles
     m_staging.refresh(cmd, bufferManager(), vkDevice(), vkDiscardPool(),
-                      timeline());
+                      timeline() + 1);
 
     // ----------------- vertex/index main ----------------------------------
     {
@@ -696,38 +731,25 @@ VkResult WindowsApplication::RTdoOnRender(
       bufferManager()->get(hashes::Vertex, vertBuf, vertAlloc);
       assert(vertBuf && indexBuf);
 
-      if (!vkDevice()->isSoC() &&
-          !vk::isAllocHostVisible(vmaAllocator(), vertAlloc)) {
-        m_staging.enqueue({vertBuf, vertAlloc, vertexBuffer.data(),
-                           sizeof(vertexBuffer), StagingVert,
-                           VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-                           VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT});
-      }
-      if (!vkDevice()->isSoC() &&
-          !vk::isAllocHostVisible(vmaAllocator(), indexAlloc)) {
-        m_staging.enqueue({indexBuf, indexAlloc, indexBuffer.data(),
-                           sizeof(indexBuffer), StagingIndex,
-                           VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-                           VK_ACCESS_INDEX_READ_BIT});
-      }
+      m_staging.enqueue({vertBuf, vertAlloc, vertexBuffer.data(),
+                         sizeof(vertexBuffer),
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                         VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT});
+      m_staging.enqueue({indexBuf, indexAlloc, indexBuffer.data(),
+                         sizeof(indexBuffer),
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                         VK_ACCESS_INDEX_READ_BIT});
       // ----------------- vertex/index skybox --------------------------------
-      bufferManager()->get("SkyboxIndex"_hash, indexBuf, indexAlloc);
-      bufferManager()->get("SkyboxVertex"_hash, vertBuf, vertAlloc);
-      assert(vertBuf && indexBuf);
-      if (!vkDevice()->isSoC() &&
-          !vk::isAllocHostVisible(vmaAllocator(), vertAlloc)) {
-        m_staging.enqueue({vertBuf, vertAlloc, vertexBuffer.data(),
-                           sizeof(vertexBuffer), "SkyboxStagingVert"_hash,
-                           VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-                           VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT});
-      }
-      if (!vkDevice()->isSoC() &&
-          !vk::isAllocHostVisible(vmaAllocator(), indexAlloc)) {
-        m_staging.enqueue({indexBuf, indexAlloc, indexBuffer.data(),
-                           sizeof(indexBuffer), "SkyboxStagingIndex"_hash,
-                           VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-                           VK_ACCESS_INDEX_READ_BIT});
-      }
+      // ranges of a suballocator block, always staged
+      m_staging.enqueue({m_skyboxVertexRange.buffer, VK_NULL_HANDLE,
+                         vertexBuffer.data(), sizeof(vertexBuffer),
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                         VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+                         m_skyboxVertexRange.offset});
+      m_staging.enqueue({m_skyboxIndexRange.buffer, VK_NULL_HANDLE,
+                         indexBuffer.data(), sizeof(indexBuffer),
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                         VK_ACCESS_INDEX_READ_BIT, m_skyboxIndexRange.offset});
     }
     // --------------------- The rest ---------------------------------------
     // setup GPU only buffer for "cube" uniform buffer
@@ -736,14 +758,11 @@ VkResult WindowsApplication::RTdoOnRender(
       VmaAllocation alloc = VK_NULL_HANDLE;
       bufferManager()->get(hashes::Cube, buffer, alloc);
       assert(buffer);
-      if (!vkDevice()->isSoC() &&
-          !vk::isAllocHostVisible(vmaAllocator(), alloc)) {
-        // allocate staging buffer and copy stuff there, then discard staging
-        m_staging.enqueue({buffer, alloc, &hostCubeFaceMapping,
-                           sizeof(hostCubeFaceMapping), "StagingCube"_hash,
-                           VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                           VK_ACCESS_UNIFORM_READ_BIT});
-      }
+      // through the staging ring, or in place if host visible
+      m_staging.enqueue({buffer, alloc, &hostCubeFaceMapping,
+                         sizeof(hostCubeFaceMapping),
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         VK_ACCESS_UNIFORM_READ_BIT});
     }
 
     // setup GPU only buffer for "model" uniform buffer
@@ -752,14 +771,11 @@ VkResult WindowsApplication::RTdoOnRender(
       VmaAllocation alloc = VK_NULL_HANDLE;
       bufferManager()->get(hashes::Model, buffer, alloc);
       assert(buffer);
-      if (!vkDevice()->isSoC() &&
-          !vk::isAllocHostVisible(vmaAllocator(), alloc)) {
-        // create a staging buffer for the transfer, then discard it
-        m_staging.enqueue({buffer, alloc, glm::value_ptr(cubeModel),
-                           sizeof(cubeModel), "StagingModel"_hash,
-                           VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
-                           VK_ACCESS_UNIFORM_READ_BIT});
-      }
+      // through the staging ring, or in place if host visible
+      m_staging.enqueue({buffer, alloc, glm::value_ptr(cubeModel),
+                         sizeof(cubeModel),
+                         VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                         VK_ACCESS_UNIFORM_READ_BIT});
     }
 
     // now update the descriptors with the template
@@ -804,35 +820,69 @@ VkResult WindowsApplication::RTdoOnRender(
     }
 
     // after everything staged, insert necessary pipeline barrier
-    m_staging.flush();
+    // host data is local to this block, hence the flush can't be retried
+    if (!m_staging.flush()) {
+      showErrorScreenAndExit("Couldn't flush first timeline staging");
+    }
   }
 
-  // begin render pass (transition to optimal layout)
-  VkRenderPassBeginInfo renderBegin{};
-  renderBegin.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  renderBegin.renderPass = m_graphicsInfo.renderPass;
-  renderBegin.clearValueCount = 2;  // always match number of attachments
-  renderBegin.pClearValues = clear;
-  renderBegin.renderArea = rect;
-  renderBegin.framebuffer = m_framebuffers[vkSwapchain()->imageIndex()];
-
-  VkSubpassBeginInfoKHR subpassBegin{};
-  subpassBegin.sType = VK_STRUCTURE_TYPE_SUBPASS_BEGIN_INFO_KHR;
+  // streamed uploads of this frame, within the scheduler budget, large ones
+  // on the transfer queue. A failed flush would carry them to a later
+  // submission than `poll` reports
+  m_staging.refresh(cmd, bufferManager(), vkDevice(), vkDiscardPool(),
+                    timeline() + 1);
+  VkPipelineStageFlags uploadWaitStages = 0;
+  uint64_t const uploadWaitValue =
+      RTrecordScheduledUploads(cmd, m_staging, uploadWaitStages);
+  if (!m_staging.flush()) {
+    showErrorScreenAndExit("Couldn't flush scheduled uploads");
+  }
 
-  vkDevApi->vkCmdBeginRenderPass2KHR(cmd, &renderBegin, &subpassBegin);
+  // begin render pass (transition to optimal layout)
+  VkImage const colorImage =
+      vkSwapchain()->imageAt(vkSwapchain()->imageIndex());
+  if (m_graphicsInfo.renderPass == VK_NULL_HANDLE) {
+    VkImage depthImage = VK_NULL_HANDLE;
+    VmaAllocation depthAlloc = VK_NULL_HANDLE;
+    imageManager()->get("depth"_hash, depthImage, depthAlloc);
+    assert(depthImage);
+    vk::basicBeginRendering(
+        vkDevice(), cmd, colorImage,
+        vkSwapchain()->imageViewAt(vkSwapchain()->imageIndex()), depthImage,
+        m_depthView, rect, clear);
+  } else {
+    VkRenderPassBeginInfo renderBegin{};
+    renderBegin.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderBegin.renderPass = m_graphicsInfo.renderPass;
+    renderBegin.clearValueCount = 2;  // always match number of attachments
+    renderBegin.pClearValues = clear;
+    renderBegin.renderArea = rect;
+    renderBegin.framebuffer = m_framebuffers[vkSwapchain()->imageIndex()];
+
+    VkSubpassBeginInfoKHR subpassBegin{};
+    subpassBegin.sType = VK_STRUCTURE_TYPE_SUBPASS_BEGIN_INFO_KHR;
+
+    vkDevApi->vkCmdBeginRenderPass2KHR(cmd, &renderBegin, &subpassBegin);
+  }
 
   // -------------------------- Main ---------------------------------------
-  // bind pipeline and vertex buffer
-  vkDevApi->vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                              m_graphicsPipeline);
+  // bind pipeline (or shaders and their state) and vertex buffer
+  if (vkShaderObjects()) {
+    vkShaderObjects()->cmdBindGraphicsShaders(cmd, m_graphicsShaders);
+    vkShaderObjects()->cmdSetGraphicsState(cmd, m_graphicsInfo);
+  } else {
+    vkDevApi->vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                m_graphicsPipeline);
+    vkPipelines()->cmdSetDynamicOpts(cmd, m_graphicsInfo);
+  }
   // bind vertex and index buffer
   VkDeviceSize offset = 0;
 
   VkBuffer vertBuf = VK_NULL_HANDLE, indexBuf = VK_NULL_HANDLE;
   VmaAllocation vertAlloc = VK_NULL_HANDLE, indexAlloc = VK_NULL_HANDLE;
 
-  bufferManager()->get(hashes::Vertex, vertBuf, vertAlloc);
-  bufferManager()->get(hashes::Index, indexBuf, indexAlloc);
+  bufferManager()->get(m_vertexBuffer, vertBuf, vertAlloc);
+  bufferManager()->get(m_indexBuffer, indexBuf, indexAlloc);
   assert(vertBuf && indexBuf);
 
   vkDevApi->vkCmdBindVertexBuffers(cmd, 0, 1, &vertBuf, &offset);
@@ -852,28 +902,39 @@ VkResult WindowsApplication::RTdoOnRender(
                                VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Camera),
                                &pushConst);
 
-  // set scissor and viewport
-  vkDevApi->vkCmdSetScissor(cmd, 0, 1, &rect);
+  // set scissor and viewport (count is dynamic too with shader objects)
   VkViewport viewport{};
   viewport.width = rect.extent.width;
   viewport.height = rect.extent.height;
   viewport.maxDepth = 1.f;
-  vkDevApi->vkCmdSetViewport(cmd, 0, 1, &viewport);
+  if (vkShaderObjects()) {
+    vkDevApi->vkCmdSetScissorWithCountEXT(cmd, 1, &rect);
+    vkDevApi->vkCmdSetViewportWithCountEXT(cmd, 1, &viewport);
+  } else {
+    vkDevApi->vkCmdSetScissor(cmd, 0, 1, &rect);
+    vkDevApi->vkCmdSetViewport(cmd, 0, 1, &viewport);
+  }
 
   vkDevApi->vkCmdDrawIndexed(cmd, 36, 1, 0, 0, 0);
 
   // ------------------- The skybox ---------------------------------------
   // same viewport, scissor
-  bufferManager()->get("SkyboxVertex"_hash, vertBuf, vertAlloc);
-  bufferManager()->get("SkyboxIndex"_hash, indexBuf, indexAlloc);
-  assert(vertBuf && indexBuf);
-  vkDevApi->vkCmdBindVertexBuffers(cmd, 0, 1, &vertBuf, &offset);
-  vkDevApi->vkCmdBindIndexBuffer(cmd, indexBuf, 0, VK_INDEX_TYPE_UINT32);
+  vkDevApi->vkCmdBindVertexBuffers(cmd, 0, 1, &m_skyboxVertexRange.buffer,
+                                   &m_skyboxVertexRange.offset);
+  vkDevApi->vkCmdBindIndexBuffer(cmd, m_skyboxIndexRange.buffer,
+                                 m_skyboxIndexRange.offset,
+                                 VK_INDEX_TYPE_UINT32);
   vkDevApi->vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
                                     m_skyboxGraphicsInfo.pipelineLayout, 0, 1,
                                     &m_skyboxDescriptorSet, 0, nullptr);
-  vkDevApi->vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                              m_skyboxPipeline);
+  if (vkShaderObjects()) {
+    vkShaderObjects()->cmdBindGraphicsShaders(cmd, m_skyboxShaders);
+    vkShaderObjects()->cmdSetGraphicsState(cmd, m_skyboxGraphicsInfo);
+  } else {
+    vkDevApi->vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                m_skyboxPipeline);
+    vkPipelines()->cmdSetDynamicOpts(cmd, m_skyboxGraphicsInfo);
+  }
   // remove camera position from view matrix (skybox follows you)
   pushConst.view[3] = glm::vec4(0, 0, 0, pushConst.view[3].w);
   vkDevApi->vkCmdPushConstants(cmd, m_skyboxGraphicsInfo.pipelineLayout,
@@ -882,35 +943,34 @@ VkResult WindowsApplication::RTdoOnRender(
   vkDevApi->vkCmdDrawIndexed(cmd, 36, 1, 0, 0, 0);
 
   // end render pass (transition to present layout)
-  VkSubpassEndInfoKHR subEnd{};
-  subEnd.sType = VK_STRUCTURE_TYPE_SUBPASS_END_INFO_KHR;
-  vkDevApi->vkCmdEndRenderPass2KHR(cmd, &subEnd);
+  if (m_graphicsInfo.renderPass == VK_NULL_HANDLE) {
+    vk::basicEndRendering(vkDevice(), cmd, colorImage);
+  } else {
+    VkSubpassEndInfoKHR subEnd{};
+    subEnd.sType = VK_STRUCTURE_TYPE_SUBPASS_END_INFO_KHR;
+    vkDevApi->vkCmdEndRenderPass2KHR(cmd, &subEnd);
+  }
   VK_CHECK(vkDevApi->vkEndCommandBuffer(cmd));
-  // queue submit command buffer
-  VkSemaphore submitSignalSems[2]{swapchainData.presentSemaphore,
-                                  vkDiscardPool()->timelineSemaphore()};
-  uint64_t values[2]{0, timeline() + 1};
-  VkTimelineSemaphoreSubmitInfoKHR timelineSubmit{};
-  timelineSubmit.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
-  timelineSubmit.signalSemaphoreValueCount = 2;
-  timelineSubmit.pSignalSemaphoreValues = values;
-
-  VkPipelineStageFlags waitPresentationStage =
-      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-
-  VkSubmitInfo submitInfo{};
-  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  submitInfo.pNext = &timelineSubmit;
-  submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = &cmd;
-  submitInfo.signalSemaphoreCount = 2;
-  submitInfo.pSignalSemaphores = submitSignalSems;
-  submitInfo.waitSemaphoreCount = 1;
-  submitInfo.pWaitSemaphores = &swapchainData.acquireSemaphore;
-  // same as wait semaphores
-  submitInfo.pWaitDstStageMask = &waitPresentationStage;
-  return vkDevApi->vkQueueSubmit(vkDevice()->queue(), 1, &submitInfo,
-                                 swapchainData.submissionFence);
+  // queue submit command buffer, signaling `timeline() + 1` on the discard
+  // pool timeline, after the compute submissions of the frame (if any)
+  using EQueue = experimental::CrossQueueSubmitter::EQueue;
+  experimental::CrossQueueSubmitter* const submitter = crossQueueSubmitter();
+  assert(submitter->nextValue(EQueue::eGraphics) == timeline() + 1);
+  // compute output may be consumed from the first draw (indirect arguments,
+  // vertex data) or dispatch, later stages are ordered after those
+  submitter->waitFor(EQueue::eGraphics, EQueue::eCompute,
+                     VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+  submitter->addWait(EQueue::eGraphics, swapchainData.acquireSemaphore, 0,
+                     VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+  // transfer queue uploads acquired by this command buffer
+  if (uploadWaitValue != 0) {
+    submitter->addWait(EQueue::eGraphics, uploadContext()->semaphore(),
+                       uploadWaitValue, uploadWaitStages);
+  }
+  submitter->addSignal(EQueue::eGraphics, swapchainData.presentSemaphore);
+  return submitter->submit(EQueue::eGraphics, &cmd, 1,
+                           swapchainData.submissionFence);
 }
 
 void WindowsApplication::RTdoOnResize() {
@@ -57,6 +57,9 @@ class WindowsApplication : public ApplicationBase {
   vk::GraphicsInfo m_skyboxGraphicsInfo{};
   VkPipeline m_graphicsPipeline = VK_NULL_HANDLE;
   VkPipeline m_skyboxPipeline = VK_NULL_HANDLE;
+  // with VK_EXT_shader_object, bound instead of the pipelines above
+  VkShaderEXT m_graphicsShaders[vk::ShaderObjectPool::GraphicsStageCount]{};
+  VkShaderEXT m_skyboxShaders[vk::ShaderObjectPool::GraphicsStageCount]{};
   DelayedConstruct<experimental::TextureLoaderKTX2> m_textureLoader;
 
   VkImageView m_depthView = VK_NULL_HANDLE;
@@ -65,6 +68,12 @@ class WindowsApplication : public ApplicationBase {
 
   std::vector<VkFramebuffer> m_framebuffers;
   std::vector<uint64_t> m_commandBufferIds;
+  // vertex/index buffers, looked up by handle on the draw path
+  experimental::BufferHandle m_vertexBuffer{};
+  experimental::BufferHandle m_indexBuffer{};
+  // skybox vertex/index data, in ranges of the buffer suballocator
+  experimental::BufferSuballocator::Range m_skyboxVertexRange{};
+  experimental::BufferSuballocator::Range m_skyboxIndexRange{};
 
   // TODO move to base if works well
   experimental::StagingTransientManager m_staging;